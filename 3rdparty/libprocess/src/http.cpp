@@ -46,6 +46,7 @@
 #include <process/socket.hpp>
 #include <process/state_machine.hpp>
 
+#include <stout/cpp17.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/ip.hpp>
@@ -895,26 +896,27 @@ Try<hashmap<string, string>> decode(const string& query)
 {
   hashmap<string, string> result;
 
-  const vector<string> tokens = strings::tokenize(query, ";&");
-  foreach (const string& token, tokens) {
-    const vector<string> pairs = strings::split(token, "=", 2);
-    if (pairs.size() == 0) {
-      continue;
-    }
+  // We walk the query using views so that the only strings allocated
+  // are the decoded keys and values themselves.
+  cpp17::string_view remaining = query;
+  Option<cpp17::string_view> token;
 
-    Try<string> key = http::decode(pairs[0]);
+  while ((token = strings::view::next(&remaining, ";&")).isSome()) {
+    const size_t equals = token->find('=');
+
+    Try<string> key = http::decode(string(token->substr(0, equals)));
     if (key.isError()) {
       return Error(key.error());
     }
 
-    if (pairs.size() == 2) {
-      Try<string> value = http::decode(pairs[1]);
+    if (equals != cpp17::string_view::npos) {
+      Try<string> value = http::decode(string(token->substr(equals + 1)));
       if (value.isError()) {
         return Error(value.error());
       }
       result[key.get()] = value.get();
 
-    } else if (pairs.size() == 1) {
+    } else {
       result[key.get()] = "";
     }
   }
@@ -21,6 +21,7 @@
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
@@ -42,6 +43,10 @@
 #include <stout/hashset.hpp>
 #include <stout/stopwatch.hpp>
 
+#ifdef __linux__
+#include <stout/proc.hpp>
+#endif // __linux__
+
 #include "benchmarks.pb.h"
 
 #include "mpsc_linked_queue.hpp"
@@ -916,3 +921,41 @@ TEST(ProcessTest, Process_BENCHMARK_MpscLinkedQueueNonContendedRead)
   cout << "Estimated total throughput: "
        << std::fixed << throughput << " op/s" << endl;
 }
+
+
+#ifdef __linux__
+// Measures parsing of /proc/[pid]/stat, which the agent does for every
+// process of every container on each resource usage poll. Since a test
+// machine will typically not have 10k processes running, we cycle
+// through the pids that are present until we have done 10k lookups.
+TEST(ProcTest, Proc_BENCHMARK_ProcessStatus)
+{
+  const size_t lookups = 10000;
+
+  Try<std::set<pid_t>> pids = proc::pids();
+  ASSERT_SOME(pids);
+
+  const vector<pid_t> candidates(pids->begin(), pids->end());
+
+  size_t parsed = 0;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < lookups; i++) {
+    // NOTE: Processes may exit while we are scanning.
+    Result<proc::ProcessStatus> status =
+      proc::status(candidates[i % candidates.size()]);
+
+    if (status.isSome()) {
+      parsed++;
+    }
+  }
+
+  watch.stop();
+
+  cout << "Took " << watch.elapsed() << " to look up and parse "
+       << lookups << " /proc/[pid]/stat files (" << parsed
+       << " processes still existed)" << endl;
+}
+#endif // __linux__
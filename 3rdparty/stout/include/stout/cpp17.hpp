@@ -12,6 +12,11 @@
 #ifndef __STOUT_CPP17_HPP__
 #define __STOUT_CPP17_HPP__
 
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 // This file contains implementation of C++17 standard library features.
@@ -60,6 +65,272 @@ auto invoke(Pmf pmf, Ptr&& ptr, As&&... as)
 #undef RETURN
 #endif
 
+// <string_view>
+
+// `std::basic_string_view`
+
+// NOTE: This implementation only covers the subset of the standard
+// interface that is used within stout and mesos. A view does not own
+// the characters it refers to, so the referenced string must outlive
+// the view (e.g., never create a view of a temporary `std::string`).
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+class basic_string_view
+{
+public:
+  typedef Traits traits_type;
+  typedef CharT value_type;
+  typedef const CharT* pointer;
+  typedef const CharT* const_pointer;
+  typedef const CharT& reference;
+  typedef const CharT& const_reference;
+  typedef const CharT* const_iterator;
+  typedef const_iterator iterator;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  static constexpr size_type npos = size_type(-1);
+
+  constexpr basic_string_view() noexcept : data_(nullptr), size_(0) {}
+
+  constexpr basic_string_view(const CharT* s, size_type count)
+    : data_(s), size_(count) {}
+
+  basic_string_view(const CharT* s)
+    : data_(s), size_(Traits::length(s)) {}
+
+  template <typename Allocator>
+  basic_string_view(
+      const std::basic_string<CharT, Traits, Allocator>& s) noexcept
+    : data_(s.data()), size_(s.size()) {}
+
+  // NOTE: `std::basic_string` gains a constructor taking a view in
+  // C++17; until then we provide an explicit conversion instead.
+  template <typename Allocator>
+  explicit operator std::basic_string<CharT, Traits, Allocator>() const
+  {
+    return std::basic_string<CharT, Traits, Allocator>(data_, size_);
+  }
+
+  constexpr const_iterator begin() const noexcept { return data_; }
+  constexpr const_iterator end() const noexcept { return data_ + size_; }
+  constexpr const_iterator cbegin() const noexcept { return begin(); }
+  constexpr const_iterator cend() const noexcept { return end(); }
+
+  constexpr const_reference operator[](size_type pos) const
+  {
+    return data_[pos];
+  }
+
+  constexpr const_reference front() const { return data_[0]; }
+  constexpr const_reference back() const { return data_[size_ - 1]; }
+  constexpr const_pointer data() const noexcept { return data_; }
+
+  constexpr size_type size() const noexcept { return size_; }
+  constexpr size_type length() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+
+  void remove_prefix(size_type n)
+  {
+    data_ += n;
+    size_ -= n;
+  }
+
+  void remove_suffix(size_type n) { size_ -= n; }
+
+  basic_string_view substr(size_type pos = 0, size_type count = npos) const
+  {
+    if (pos > size_) {
+      throw std::out_of_range("basic_string_view::substr");
+    }
+
+    return basic_string_view(data_ + pos, std::min(count, size_ - pos));
+  }
+
+  int compare(basic_string_view v) const noexcept
+  {
+    const int result =
+      Traits::compare(data_, v.data_, std::min(size_, v.size_));
+
+    if (result != 0) {
+      return result;
+    }
+
+    return size_ == v.size_ ? 0 : (size_ < v.size_ ? -1 : 1);
+  }
+
+  size_type find(basic_string_view v, size_type pos = 0) const noexcept
+  {
+    if (v.size_ > size_ || pos > size_ - v.size_) {
+      return npos;
+    }
+
+    for (size_type i = pos; i <= size_ - v.size_; ++i) {
+      if (Traits::compare(data_ + i, v.data_, v.size_) == 0) {
+        return i;
+      }
+    }
+
+    return npos;
+  }
+
+  size_type find(CharT c, size_type pos = 0) const noexcept
+  {
+    if (pos >= size_) {
+      return npos;
+    }
+
+    const CharT* found = Traits::find(data_ + pos, size_ - pos, c);
+    return found == nullptr ? npos : found - data_;
+  }
+
+  size_type rfind(CharT c, size_type pos = npos) const noexcept
+  {
+    if (size_ == 0) {
+      return npos;
+    }
+
+    for (size_type i = std::min(pos, size_ - 1) + 1; i > 0; --i) {
+      if (Traits::eq(data_[i - 1], c)) {
+        return i - 1;
+      }
+    }
+
+    return npos;
+  }
+
+  size_type find_first_of(
+      basic_string_view v,
+      size_type pos = 0) const noexcept
+  {
+    for (size_type i = pos; i < size_; ++i) {
+      if (Traits::find(v.data_, v.size_, data_[i]) != nullptr) {
+        return i;
+      }
+    }
+
+    return npos;
+  }
+
+  size_type find_first_not_of(
+      basic_string_view v,
+      size_type pos = 0) const noexcept
+  {
+    for (size_type i = pos; i < size_; ++i) {
+      if (Traits::find(v.data_, v.size_, data_[i]) == nullptr) {
+        return i;
+      }
+    }
+
+    return npos;
+  }
+
+  size_type find_last_of(
+      basic_string_view v,
+      size_type pos = npos) const noexcept
+  {
+    if (size_ == 0) {
+      return npos;
+    }
+
+    for (size_type i = std::min(pos, size_ - 1) + 1; i > 0; --i) {
+      if (Traits::find(v.data_, v.size_, data_[i - 1]) != nullptr) {
+        return i - 1;
+      }
+    }
+
+    return npos;
+  }
+
+  size_type find_last_not_of(
+      basic_string_view v,
+      size_type pos = npos) const noexcept
+  {
+    if (size_ == 0) {
+      return npos;
+    }
+
+    for (size_type i = std::min(pos, size_ - 1) + 1; i > 0; --i) {
+      if (Traits::find(v.data_, v.size_, data_[i - 1]) == nullptr) {
+        return i - 1;
+      }
+    }
+
+    return npos;
+  }
+
+private:
+  const CharT* data_;
+  size_type size_;
+};
+
+
+template <typename CharT, typename Traits>
+constexpr typename basic_string_view<CharT, Traits>::size_type
+basic_string_view<CharT, Traits>::npos;
+
+
+typedef basic_string_view<char> string_view;
+
+
+namespace internal {
+
+// Used to exclude a parameter from template argument deduction so
+// that the comparison operators below also accept anything that is
+// implicitly convertible to a view (e.g., `std::string`, literals).
+template <typename T>
+struct identity
+{
+  typedef T type;
+};
+
+} // namespace internal {
+
+
+#define CPP17_STRING_VIEW_COMPARISON(OP)                                    \
+  template <typename CharT, typename Traits>                                \
+  bool operator OP(                                                         \
+      basic_string_view<CharT, Traits> lhs,                                 \
+      basic_string_view<CharT, Traits> rhs) noexcept                        \
+  {                                                                         \
+    return lhs.compare(rhs) OP 0;                                           \
+  }                                                                         \
+                                                                            \
+  template <typename CharT, typename Traits>                                \
+  bool operator OP(                                                         \
+      basic_string_view<CharT, Traits> lhs,                                 \
+      typename internal::identity<                                          \
+          basic_string_view<CharT, Traits>>::type rhs) noexcept             \
+  {                                                                         \
+    return lhs.compare(rhs) OP 0;                                           \
+  }                                                                         \
+                                                                            \
+  template <typename CharT, typename Traits>                                \
+  bool operator OP(                                                         \
+      typename internal::identity<                                          \
+          basic_string_view<CharT, Traits>>::type lhs,                      \
+      basic_string_view<CharT, Traits> rhs) noexcept                        \
+  {                                                                         \
+    return lhs.compare(rhs) OP 0;                                           \
+  }
+
+CPP17_STRING_VIEW_COMPARISON(==)
+CPP17_STRING_VIEW_COMPARISON(!=)
+CPP17_STRING_VIEW_COMPARISON(<)
+CPP17_STRING_VIEW_COMPARISON(<=)
+CPP17_STRING_VIEW_COMPARISON(>)
+CPP17_STRING_VIEW_COMPARISON(>=)
+
+#undef CPP17_STRING_VIEW_COMPARISON
+
+
+template <typename CharT, typename Traits>
+std::basic_ostream<CharT, Traits>& operator<<(
+    std::basic_ostream<CharT, Traits>& stream,
+    basic_string_view<CharT, Traits> view)
+{
+  return stream.write(view.data(), view.size());
+}
+
 } // namespace cpp17 {
 
 #endif // __STOUT_CPP17_HPP__
@@ -379,6 +379,24 @@ private:
 };
 
 
+// A value which has already been serialized to JSON, e.g., a cached
+// serialization of an object. `jsonify` writes it verbatim, i.e., the
+// string is neither validated nor escaped. Like `JSON::Proxy`, this
+// holds onto a reference to the string.
+//
+// NOTE: A raw value can not be used as the key of an object field.
+class Raw
+{
+public:
+  explicit Raw(const std::string& json) : json_(json) {}
+
+  const std::string& json() const { return json_; }
+
+private:
+  const std::string& json_;
+};
+
+
 // `json` function for boolean.
 inline void json(BooleanWriter* writer, bool value) { writer->set(value); }
 
@@ -679,6 +697,19 @@ std::function<void(rapidjson::Writer<rapidjson::StringBuffer>*)> jsonify(
   };
 }
 
+// Given a raw value, we copy it directly into the output stream.
+inline std::function<void(rapidjson::Writer<rapidjson::StringBuffer>*)> jsonify(
+    const Raw& raw,
+    Prefer)
+{
+  return [&raw](rapidjson::Writer<rapidjson::StringBuffer>* writer) {
+    // NOTE: The type is only used by rapidjson to validate that object
+    // keys are strings, which is why we do not determine the actual type.
+    CHECK(writer->RawValue(
+        raw.json().data(), raw.json().size(), rapidjson::kObjectType));
+  };
+}
+
 // Given a `T` which is not a "write" function itself, the default "write"
 // function is to perform an unqualified function call to `json`, which enables
 // argument-dependent lookup. This considers the `json` overloads in the `JSON`
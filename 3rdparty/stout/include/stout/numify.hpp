@@ -18,6 +18,7 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include "cpp17.hpp"
 #include "error.hpp"
 #include "none.hpp"
 #include "option.hpp"
@@ -93,6 +94,26 @@ Try<T> numify(const char* s)
 }
 
 
+// Avoids copying the view into a `std::string` for the common case of
+// a decimal number; hexadecimal numbers take the slow path above.
+template <typename T>
+Try<T> numify(const cpp17::string_view& s)
+{
+  if (strings::view::startsWith(s, "0x") ||
+      strings::view::startsWith(s, "0X") ||
+      strings::view::startsWith(s, "-0x") ||
+      strings::view::startsWith(s, "-0X")) {
+    return numify<T>(std::string(s));
+  }
+
+  try {
+    return boost::lexical_cast<T>(s.data(), s.size());
+  } catch (const boost::bad_lexical_cast&) {
+    return Error("Failed to convert '" + std::string(s) + "' to number");
+  }
+}
+
+
 template <typename T>
 Result<T> numify(const Option<std::string>& s)
 {
@@ -27,10 +27,10 @@
 #include <list>
 #include <queue>
 #include <set>
-#include <sstream> // For 'std::istringstream'.
 #include <string>
 #include <vector>
 
+#include <stout/cpp17.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/none.hpp>
@@ -161,6 +161,38 @@ struct ProcessStatus
 };
 
 
+namespace internal {
+
+inline bool parse(cpp17::string_view* fields)
+{
+  return true;
+}
+
+
+// Parses the next whitespace separated numeric fields out of 'fields'
+// into the given outputs, in order. Returns false if a field is
+// missing or is not a number.
+template <typename T, typename... Ts>
+bool parse(cpp17::string_view* fields, T* t, Ts*... ts)
+{
+  Option<cpp17::string_view> field = strings::view::next(fields, " \n");
+  if (field.isNone()) {
+    return false;
+  }
+
+  Try<T> number = numify<T>(field.get());
+  if (number.isError()) {
+    return false;
+  }
+
+  *t = number.get();
+
+  return parse(fields, ts...);
+}
+
+} // namespace internal {
+
+
 // Returns the process statistics from /proc/[pid]/stat.
 // The return value is None if the process does not exist.
 inline Result<ProcessStatus> status(pid_t pid)
@@ -177,10 +209,30 @@ inline Result<ProcessStatus> status(pid_t pid)
     return Error(read.error());
   }
 
-  std::istringstream data(read.get());
+  const cpp17::string_view data = read.get();
+
+  // NOTE: 'comm' is wrapped in parentheses and may itself contain
+  // spaces and parentheses, so we locate it using the first '(' and
+  // the last ')' rather than by splitting on whitespace.
+  const size_t openParen = data.find('(');
+  const size_t closeParen = data.rfind(')');
+
+  if (openParen == cpp17::string_view::npos ||
+      closeParen == cpp17::string_view::npos ||
+      closeParen < openParen) {
+    return Error("Failed to read/parse '" + path + "'");
+  }
+
+  const std::string comm(
+      data.substr(openParen + 1, closeParen - openParen - 1));
+
+  cpp17::string_view fields = data.substr(closeParen + 1);
+
+  Option<cpp17::string_view> state = strings::view::next(&fields, " \n");
+  if (state.isNone() || state->size() != 1) {
+    return Error("Failed to read/parse '" + path + "'");
+  }
 
-  std::string comm;
-  char state;
   pid_t ppid;
   pid_t pgrp;
   pid_t session;
@@ -223,28 +275,20 @@ inline Result<ProcessStatus> status(pid_t pid)
   // unsigned long guest_time;
   // unsigned int cguest_time;
 
-  std::string _; // For ignoring fields.
-
-  // Parse all fields from stat.
-  data >> _ >> comm >> state >> ppid >> pgrp >> session >> tty_nr
-       >> tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt
-       >> utime >> stime >> cutime >> cstime >> priority >> nice
-       >> num_threads >> itrealvalue >> starttime >> vsize >> rss
-       >> rsslim >> startcode >> endcode >> startstack >> kstkeip
-       >> signal >> blocked >> sigcatch >> wchan >> nswap >> cnswap;
-
-  // Check for any read/parse errors.
-  if (data.fail() && !data.eof()) {
+  // Parse all remaining fields from stat. This is done on views of the
+  // file contents, rather than through an `std::istringstream`, since
+  // this gets called for every process on every resource usage poll.
+  if (!internal::parse(
+          &fields, &ppid, &pgrp, &session, &tty_nr, &tpgid, &flags,
+          &minflt, &cminflt, &majflt, &cmajflt, &utime, &stime, &cutime,
+          &cstime, &priority, &nice, &num_threads, &itrealvalue,
+          &starttime, &vsize, &rss, &rsslim, &startcode, &endcode,
+          &startstack, &kstkeip, &signal, &blocked, &sigcatch, &wchan,
+          &nswap, &cnswap)) {
     return Error("Failed to read/parse '" + path + "'");
   }
 
-  // Remove the parentheses that is wrapped around 'comm' (when
-  // printing out the process in a process tree we use parentheses to
-  // indicate "zombie" processes).
-  comm = strings::remove(comm, "(", strings::PREFIX);
-  comm = strings::remove(comm, ")", strings::SUFFIX);
-
-  return ProcessStatus(pid, comm, state, ppid, pgrp, session, tty_nr,
+  return ProcessStatus(pid, comm, state->front(), ppid, pgrp, session, tty_nr,
                        tpgid, flags, minflt, cminflt, majflt, cmajflt,
                        utime, stime, cutime, cstime, priority, nice,
                        num_threads, itrealvalue, starttime, vsize, rss,
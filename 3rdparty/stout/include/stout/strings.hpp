@@ -20,8 +20,10 @@
 #include <string>
 #include <vector>
 
+#include "cpp17.hpp"
 #include "foreach.hpp"
 #include "format.hpp"
+#include "none.hpp"
 #include "option.hpp"
 #include "stringify.hpp"
 
@@ -441,6 +443,172 @@ inline std::string upper(const std::string& s)
   return result;
 }
 
+
+// Variants of some of the functions above which operate on and return
+// `cpp17::string_view`s into the input rather than copies of it. These
+// are intended for hot parsing paths (e.g., parsing files in /proc or
+// cgroups control files) where allocating a `std::string` for every
+// token dominates the cost of parsing. The caller must guarantee that
+// the input outlives any views returned.
+namespace view {
+
+inline cpp17::string_view trim(
+    cpp17::string_view from,
+    Mode mode = ANY,
+    cpp17::string_view chars = WHITESPACE)
+{
+  if (mode == ANY || mode == PREFIX) {
+    size_t start = from.find_first_not_of(chars);
+
+    // Bail early if 'from' contains only characters in 'chars'.
+    if (start == cpp17::string_view::npos) {
+      return cpp17::string_view();
+    }
+
+    from.remove_prefix(start);
+  }
+
+  if (mode == ANY || mode == SUFFIX) {
+    size_t end = from.find_last_not_of(chars);
+
+    if (end == cpp17::string_view::npos) {
+      return cpp17::string_view();
+    }
+
+    from.remove_suffix(from.size() - end - 1);
+  }
+
+  return from;
+}
+
+
+inline cpp17::string_view trim(
+    cpp17::string_view from,
+    cpp17::string_view chars)
+{
+  return trim(from, ANY, chars);
+}
+
+
+// Removes the next token (as defined by `tokenize` below) from the
+// front of 's' and returns it, or returns None if there are no tokens
+// left. This does not allocate and can be used to walk through the
+// tokens of a string one at a time:
+//
+//   cpp17::string_view remaining = contents;
+//   Option<cpp17::string_view> line;
+//
+//   while ((line = strings::view::next(&remaining, "\n")).isSome()) {
+//     ...
+//   }
+inline Option<cpp17::string_view> next(
+    cpp17::string_view* s,
+    cpp17::string_view delims)
+{
+  size_t nonDelim = s->find_first_not_of(delims);
+
+  if (nonDelim == cpp17::string_view::npos) {
+    *s = cpp17::string_view();
+    return None();
+  }
+
+  s->remove_prefix(nonDelim);
+
+  size_t delim = s->find_first_of(delims);
+
+  cpp17::string_view token = s->substr(0, delim);
+
+  s->remove_prefix(delim == cpp17::string_view::npos ? s->size() : delim);
+
+  return token;
+}
+
+
+// See `strings::tokenize` above.
+inline std::vector<cpp17::string_view> tokenize(
+    cpp17::string_view s,
+    cpp17::string_view delims,
+    const Option<size_t>& maxTokens = None())
+{
+  if (maxTokens.isSome() && maxTokens.get() == 0) {
+    return {};
+  }
+
+  std::vector<cpp17::string_view> tokens;
+  size_t offset = 0;
+
+  while (true) {
+    size_t nonDelim = s.find_first_not_of(delims, offset);
+
+    if (nonDelim == cpp17::string_view::npos) {
+      break; // Nothing left.
+    }
+
+    size_t delim = s.find_first_of(delims, nonDelim);
+
+    // Finish tokenizing if this is the last token,
+    // or we've found enough tokens.
+    if (delim == cpp17::string_view::npos ||
+        (maxTokens.isSome() && tokens.size() == maxTokens.get() - 1)) {
+      tokens.push_back(s.substr(nonDelim));
+      break;
+    }
+
+    tokens.push_back(s.substr(nonDelim, delim - nonDelim));
+    offset = delim;
+  }
+
+  return tokens;
+}
+
+
+// See `strings::split` above.
+inline std::vector<cpp17::string_view> split(
+    cpp17::string_view s,
+    cpp17::string_view delims,
+    const Option<size_t>& maxTokens = None())
+{
+  if (maxTokens.isSome() && maxTokens.get() == 0) {
+    return {};
+  }
+
+  std::vector<cpp17::string_view> tokens;
+  size_t offset = 0;
+
+  while (true) {
+    size_t next = s.find_first_of(delims, offset);
+
+    // Finish splitting if this is the last token,
+    // or we've found enough tokens.
+    if (next == cpp17::string_view::npos ||
+        (maxTokens.isSome() && tokens.size() == maxTokens.get() - 1)) {
+      tokens.push_back(s.substr(offset));
+      break;
+    }
+
+    tokens.push_back(s.substr(offset, next - offset));
+    offset = next + 1;
+  }
+
+  return tokens;
+}
+
+
+inline bool startsWith(cpp17::string_view s, cpp17::string_view prefix)
+{
+  return s.size() >= prefix.size() &&
+         std::equal(prefix.begin(), prefix.end(), s.begin());
+}
+
+
+inline bool endsWith(cpp17::string_view s, cpp17::string_view suffix)
+{
+  return s.size() >= suffix.size() &&
+         std::equal(suffix.begin(), suffix.end(), s.end() - suffix.size());
+}
+
+} // namespace view {
+
 } // namespace strings {
 
 #endif // __STOUT_STRINGS_HPP__
@@ -10,6 +10,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License
 
+#include <stdexcept>
+#include <string>
+
 #include <gtest/gtest.h>
 
 #include <stout/cpp17.hpp>
@@ -63,3 +66,40 @@ TEST(Invoke, FunctionObject)
 
   EXPECT_EQ(404, cpp17::invoke(F{}, 202));
 }
+
+
+TEST(StringView, Find)
+{
+  const std::string s = "hello world";
+  cpp17::string_view view = s;
+
+  EXPECT_EQ(s.size(), view.size());
+  EXPECT_EQ(s.data(), view.data());
+
+  EXPECT_EQ(2u, view.find('l'));
+  EXPECT_EQ(9u, view.rfind('l'));
+  EXPECT_EQ(6u, view.find("world"));
+  EXPECT_EQ(cpp17::string_view::npos, view.find("worlds"));
+
+  EXPECT_EQ(4u, view.find_first_of("o "));
+  EXPECT_EQ(1u, view.find_first_not_of("h"));
+  EXPECT_EQ(7u, view.find_last_of("o"));
+  EXPECT_EQ(8u, view.find_last_not_of("ld"));
+
+  EXPECT_EQ("world", view.substr(6));
+  EXPECT_EQ("wor", view.substr(6, 3));
+  EXPECT_EQ("", view.substr(s.size()));
+  EXPECT_THROW(view.substr(s.size() + 1), std::out_of_range);
+
+  EXPECT_EQ(s, std::string(view));
+}
+
+
+TEST(StringView, Compare)
+{
+  EXPECT_EQ(cpp17::string_view("abc"), std::string("abc"));
+  EXPECT_NE(cpp17::string_view("abc"), "ab");
+  EXPECT_LT(cpp17::string_view("ab"), cpp17::string_view("abc"));
+  EXPECT_GT(cpp17::string_view("b"), "abc");
+  EXPECT_TRUE(cpp17::string_view().empty());
+}
@@ -367,3 +367,25 @@ TEST(JsonifyTest, JSONNull)
   JSON::Array numbers = JSON::Array{1, JSON::Null(), 3};
   EXPECT_EQ("[1,null,3]", string(jsonify(numbers)));
 }
+
+
+// Tests that raw values are written verbatim.
+TEST(JsonifyTest, Raw)
+{
+  const string object = "{\"a\":[1,2]}";
+
+  EXPECT_EQ(object, string(jsonify(JSON::Raw(object))));
+
+  EXPECT_EQ(
+      "[" + object + "," + object + "]",
+      string(jsonify([&object](JSON::ArrayWriter* writer) {
+        writer->element(JSON::Raw(object));
+        writer->element(JSON::Raw(object));
+      })));
+
+  EXPECT_EQ(
+      "{\"b\":" + object + "}",
+      string(jsonify([&object](JSON::ObjectWriter* writer) {
+        writer->field("b", JSON::Raw(object));
+      })));
+}
@@ -57,3 +57,17 @@ TEST(NumifyTest, HexNumberTest)
   EXPECT_ERROR(numify<double>("0x10.9"));
   EXPECT_ERROR(numify<double>("0x1p-5"));
 }
+
+
+TEST(NumifyTest, StringViewTest)
+{
+  // Views into a larger string must only consider their own contents.
+  const cpp17::string_view s = "10 -10 0x10 123xyz";
+
+  EXPECT_SOME_EQ(10u, numify<unsigned int>(s.substr(0, 2)));
+  EXPECT_SOME_EQ(-10, numify<int>(s.substr(3, 3)));
+  EXPECT_SOME_EQ(16u, numify<unsigned int>(s.substr(7, 4)));
+
+  EXPECT_ERROR(numify<unsigned int>(cpp17::string_view()));
+  EXPECT_ERROR(numify<unsigned int>(s.substr(12)));
+}
@@ -507,3 +507,95 @@ TEST(StringsTest, Contains)
   EXPECT_TRUE(strings::contains("hello world", "world"));
   EXPECT_FALSE(strings::contains("hello world", "no"));
 }
+
+
+TEST(StringsTest, ViewTrim)
+{
+  EXPECT_EQ("", strings::view::trim("", " "));
+  EXPECT_EQ("", strings::view::trim("    ", " "));
+  EXPECT_EQ("hello world", strings::view::trim("  hello world  ", " "));
+  EXPECT_EQ("hello world", strings::view::trim(" \t hello world\t \n\r "));
+
+  EXPECT_EQ("hello world\t \n\r ",
+            strings::view::trim(" \t hello world\t \n\r ", strings::PREFIX));
+  EXPECT_EQ(" \t hello world",
+            strings::view::trim(" \t hello world\t \n\r ", strings::SUFFIX));
+
+  // The result must refer to the input rather than to a copy.
+  const string s = "  hello  ";
+  EXPECT_EQ(s.data() + 2, strings::view::trim(s).data());
+}
+
+
+TEST(StringsTest, ViewTokenize)
+{
+  vector<cpp17::string_view> tokens =
+    strings::view::tokenize("  hello\tworld,  \twhat's up?  ", " \t");
+  ASSERT_EQ(4u, tokens.size());
+  EXPECT_EQ("hello",  tokens[0]);
+  EXPECT_EQ("world,", tokens[1]);
+  EXPECT_EQ("what's", tokens[2]);
+  EXPECT_EQ("up?",    tokens[3]);
+
+  EXPECT_TRUE(strings::view::tokenize("", " ").empty());
+  EXPECT_TRUE(strings::view::tokenize("   ", " ").empty());
+  EXPECT_TRUE(strings::view::tokenize("hello world", " ", 0).empty());
+
+  tokens = strings::view::tokenize("  hello world,  what's up?  ", " ", 2);
+  ASSERT_EQ(2u, tokens.size());
+  EXPECT_EQ("hello", tokens[0]);
+  EXPECT_EQ("world,  what's up?  ", tokens[1]);
+}
+
+
+TEST(StringsTest, ViewSplit)
+{
+  vector<cpp17::string_view> tokens =
+    strings::view::split("  hello world,  what's up?", " ");
+  ASSERT_EQ(7u, tokens.size());
+  EXPECT_EQ("",       tokens[0]);
+  EXPECT_EQ("",       tokens[1]);
+  EXPECT_EQ("hello",  tokens[2]);
+  EXPECT_EQ("world,", tokens[3]);
+  EXPECT_EQ("",       tokens[4]);
+  EXPECT_EQ("what's", tokens[5]);
+  EXPECT_EQ("up?",    tokens[6]);
+
+  tokens = strings::view::split("foo=bar=baz", "=", 2);
+  ASSERT_EQ(2u, tokens.size());
+  EXPECT_EQ("foo",     tokens[0]);
+  EXPECT_EQ("bar=baz", tokens[1]);
+
+  tokens = strings::view::split("", " ");
+  ASSERT_EQ(1u, tokens.size());
+  EXPECT_EQ("", tokens[0]);
+}
+
+
+TEST(StringsTest, ViewNext)
+{
+  cpp17::string_view remaining = "\nfoo 1\n\nbar 2\n";
+
+  Option<cpp17::string_view> line = strings::view::next(&remaining, "\n");
+  ASSERT_SOME(line);
+  EXPECT_EQ("foo 1", line.get());
+
+  line = strings::view::next(&remaining, "\n");
+  ASSERT_SOME(line);
+  EXPECT_EQ("bar 2", line.get());
+
+  EXPECT_NONE(strings::view::next(&remaining, "\n"));
+  EXPECT_TRUE(remaining.empty());
+}
+
+
+TEST(StringsTest, ViewStartsWithEndsWith)
+{
+  EXPECT_TRUE(strings::view::startsWith("hello world", "hello"));
+  EXPECT_FALSE(strings::view::startsWith("hello world", "ello"));
+  EXPECT_FALSE(strings::view::startsWith("he", "hello"));
+
+  EXPECT_TRUE(strings::view::endsWith("hello world", "world"));
+  EXPECT_FALSE(strings::view::endsWith("hello world", "worl"));
+  EXPECT_FALSE(strings::view::endsWith("ld", "world"));
+}
@@ -17,6 +17,7 @@
 #ifndef __MESOS_ALLOCATOR_ALLOCATOR_HPP__
 #define __MESOS_ALLOCATOR_ALLOCATOR_HPP__
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,7 @@
 
 #include <process/future.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
@@ -41,6 +43,97 @@
 namespace mesos {
 namespace allocator {
 
+/**
+ * The options that the allocator is initialized with.
+ */
+struct Options
+{
+  /**
+   * The allocate interval for the allocator, it determines how often the
+   * allocator should perform the batch allocation. An allocator may also
+   * perform allocation based on events (a framework is added and so on),
+   * this depends on the implementation.
+   */
+  Duration allocationInterval = Seconds(1);
+
+  /**
+   * If set, the allocator performs the batch allocation every
+   * `allocationInterval` only for the agents whose allocation may have
+   * changed since the last one, and for all the agents only every
+   * `allocationSweepInterval`. Whether and how this is used depends on
+   * the implementation.
+   */
+  Option<Duration> allocationSweepInterval = None();
+
+  /**
+   * The resources (by name) that are excluded from the fair sharing.
+   */
+  Option<std::set<std::string>> fairnessExcludeResourceNames = None();
+
+  /**
+   * Whether GPU resources are only offered to the frameworks with the
+   * `GPU_RESOURCES` capability.
+   */
+  bool filterGpuResources = true;
+
+  /**
+   * The domain of the master, if any.
+   */
+  Option<DomainInfo> domain = None();
+
+  /**
+   * The minimum allocatable resources, if any.
+   */
+  Option<std::vector<Resources>> minAllocatableResources = None();
+
+  /**
+   * The maximum number of completed frameworks to keep metrics for.
+   */
+  size_t maxCompletedFrameworks = 0;
+
+  /**
+   * The maximum number of threads the allocator may use to evaluate
+   * the frameworks' offer filters in an allocation. Whether and how
+   * this is used depends on the implementation.
+   */
+  size_t offerFilterParallelism = 1;
+
+  /**
+   * The policy for the order in which the allocator considers agents,
+   * e.g. "random" or "binpack". The supported policies depend on the
+   * implementation.
+   */
+  std::string agentOrder = "random";
+
+  /**
+   * If set, the allocator allocates from at most this many agents at a
+   * time, and handles the calls into it that were made meanwhile before
+   * it continues with the next agents. Whether and how this is used
+   * depends on the implementation.
+   */
+  Option<size_t> allocationBatchSize = None();
+
+  /**
+   * The HTTP authentication realm of the endpoints that the allocator
+   * exposes, if any. Whether and how this is used depends on the
+   * implementation.
+   */
+  Option<std::string> authenticationRealm = None();
+
+  /**
+   * If set, the allocator records the calls into it to this file, so
+   * that its allocations can be replayed offline. Whether and how this
+   * is used depends on the implementation.
+   */
+  Option<std::string> recordPath = None();
+
+  /**
+   * The maximum size of the recording, if `recordPath` is set.
+   */
+  Bytes recordMaxSize = Gigabytes(1);
+};
+
+
 /**
  * Basic model of an allocator: resources are allocated to a framework
  * in the form of offers. A framework can refuse some resources in
@@ -79,17 +172,14 @@ public:
    * initialization should fail fast and result in an ABORT. The master expects
    * the allocator to be successfully initialized if this call returns.
    *
-   * @param allocationInterval The allocate interval for the allocator, it
-   *     determines how often the allocator should perform the batch
-   *     allocation. An allocator may also perform allocation based on events
-   *     (a framework is added and so on), this depends on the implementation.
+   * @param options The options of the allocator, see `Options`.
    * @param offerCallback A callback the allocator uses to send allocations
    *     to the frameworks.
    * @param inverseOfferCallback A callback the allocator uses to send reclaim
    *     allocations from the frameworks.
    */
   virtual void initialize(
-      const Duration& allocationInterval,
+      const Options& options,
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
@@ -97,14 +187,7 @@ public:
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<SlaveID, UnavailableResources>&)>&
-        inverseOfferCallback,
-      const Option<std::set<std::string>>&
-        fairnessExcludeResourceNames = None(),
-      bool filterGpuResources = true,
-      const Option<DomainInfo>& domain = None(),
-      const Option<std::vector<Resources>>&
-        minAllocatableResources = None(),
-      const size_t maxCompletedFrameworks = 0) = 0;
+        inverseOfferCallback) = 0;
 
   /**
    * Informs the allocator of the recovered state from the master.
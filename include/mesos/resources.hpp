@@ -19,10 +19,13 @@
 
 #include <map>
 #include <iosfwd>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
+#include <boost/iterator/indirect_iterator.hpp>
+
 #include <google/protobuf/repeated_field.h>
 
 #include <mesos/mesos.hpp>
@@ -165,6 +168,17 @@ private:
     Option<int> sharedCount;
   };
 
+  // `Resources` objects are copied very frequently (e.g., by the
+  // allocator and the sorters), so the `Resource_` objects are held
+  // through shared pointers: copying a `Resources` only copies the
+  // pointers and identical `Resource_` objects are stored only once.
+  //
+  // The pointee is "unsafe" to mutate in place since it may be shared
+  // with other `Resources` objects. All mutations must go through
+  // `exclusive()` which copies the `Resource_` first if it is shared
+  // (i.e., copy-on-write).
+  typedef std::shared_ptr<Resource_> Resource_Unsafe;
+
 public:
   /**
    * Returns a Resource with the given name, value, and role.
@@ -588,21 +602,27 @@ public:
   // NOTE: Non-`const` `iterator`, `begin()` and `end()` are __intentionally__
   // defined with `const` semantics in order to prevent mutable access to the
   // `Resource` objects within `resources`.
-  typedef std::vector<Resource_>::const_iterator iterator;
-  typedef std::vector<Resource_>::const_iterator const_iterator;
+  typedef boost::indirect_iterator<
+      std::vector<Resource_Unsafe>::const_iterator,
+      const Resource_> iterator;
+  typedef boost::indirect_iterator<
+      std::vector<Resource_Unsafe>::const_iterator,
+      const Resource_> const_iterator;
 
   const_iterator begin()
   {
-    return static_cast<const std::vector<Resource_>&>(resources).begin();
+    return const_iterator(
+        static_cast<const std::vector<Resource_Unsafe>&>(resources).begin());
   }
 
   const_iterator end()
   {
-    return static_cast<const std::vector<Resource_>&>(resources).end();
+    return const_iterator(
+        static_cast<const std::vector<Resource_Unsafe>&>(resources).end());
   }
 
-  const_iterator begin() const { return resources.begin(); }
-  const_iterator end() const { return resources.end(); }
+  const_iterator begin() const { return const_iterator(resources.begin()); }
+  const_iterator end() const { return const_iterator(resources.end()); }
 
   // Using this operator makes it easy to copy a resources object into
   // a protocol buffer field.
@@ -668,12 +688,44 @@ private:
   void add(Resource_&& r);
   void subtract(const Resource_& r);
 
+  // Adds a `Resource_` that is already held by another `Resources`
+  // object. If it cannot be combined with an existing `Resource_` the
+  // pointer is shared rather than the `Resource_` being copied.
+  void add(const Resource_Unsafe& r);
+
+  // Adds all the `Resource_` objects held by another `Resources`
+  // object, see above.
+  void add(const std::vector<Resource_Unsafe>& that);
+
+  // Subtracts `that` from the given `Resource_`, which must be
+  // subtractable. Returns false if the `Resource_` has become empty
+  // (or negative) and should be removed.
+  static bool _subtract(Resource_Unsafe& r, const Resource_& that);
+
+  // Returns a mutable reference to the given `Resource_`, first making
+  // a private copy of it if it is shared with other `Resources`.
+  static Resource_& exclusive(Resource_Unsafe& r);
+
+  // Returns the positions of the `Resource_` objects, keyed by a hash
+  // of the metadata that must match for two `Resource_` objects to be
+  // added or subtracted (see `metadataHash()` in resources.cpp).
+  //
+  // The bulk `contains`, `+=` and `-=` operations use this to only
+  // consider the candidates that may match, rather than comparing
+  // every pair of `Resource_` objects. This matters for agents with
+  // many persistent volumes, reservations, etc.
+  hashmap<size_t, std::vector<size_t>> index() const;
+
+  // Below this number of `Resource_` objects it is cheaper to scan
+  // them linearly than to build the index.
+  static constexpr size_t INDEX_THRESHOLD = 16;
+
   Resources& operator+=(const Resource_& that);
   Resources& operator+=(Resource_&& that);
 
   Resources& operator-=(const Resource_& that);
 
-  std::vector<Resource_> resources;
+  std::vector<Resource_Unsafe> resources;
 };
 
 
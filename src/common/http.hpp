@@ -230,6 +230,15 @@ public:
     return approved.get();
   }
 
+  // Returns true if all objects are approved for the action, which
+  // allows callers to skip constructing expensive objects.
+  bool approvesAll(authorization::Action action) const
+  {
+    return approvers.contains(action) &&
+      dynamic_cast<const AcceptingObjectApprover*>(
+          approvers.at(action).get()) != nullptr;
+  }
+
 private:
   ObjectApprovers(
       hashmap<
@@ -395,11 +395,15 @@ struct Capabilities
         case MasterInfo::Capability::AGENT_UPDATE:
           agentUpdate = true;
           break;
+        case MasterInfo::Capability::BATCHED_STATUS_UPDATES:
+          batchedStatusUpdates = true;
+          break;
       }
     }
   }
 
   bool agentUpdate = false;
+  bool batchedStatusUpdates = false;
 };
 
 namespace event {
@@ -0,0 +1,323 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+#include <mesos/values.hpp>
+
+#include <stout/foreach.hpp>
+
+#include "common/resource_quantities.hpp"
+
+using std::set;
+using std::string;
+using std::vector;
+
+namespace mesos {
+
+// NOTE: These mirror the fixed-point conversions in `values.cpp`,
+// which defines the precision of all scalar resource arithmetic.
+static int64_t convertToFixed(double floatValue)
+{
+  return std::llround(floatValue * 1000);
+}
+
+
+static double convertToFloating(int64_t fixedValue)
+{
+  double quotient = static_cast<double>(fixedValue / 1000);
+  double remainder = static_cast<double>(fixedValue % 1000) / 1000.0;
+
+  return quotient + remainder;
+}
+
+
+ResourceQuantities ResourceQuantities::fromScalarResources(
+    const Resources& resources)
+{
+  ResourceQuantities result;
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      result.add(resource.name(), convertToFixed(resource.scalar().value()));
+    }
+  }
+
+  return result;
+}
+
+
+Value::Scalar ResourceQuantities::get(const string& name) const
+{
+  Value::Scalar result;
+  result.set_value(0);
+
+  auto it = std::lower_bound(names_.begin(), names_.end(), name);
+
+  if (it != names_.end() && *it == name) {
+    result.set_value(convertToFloating(amounts_[it - names_.begin()]));
+  }
+
+  return result;
+}
+
+
+bool ResourceQuantities::contains(const ResourceQuantities& that) const
+{
+  if (sameNames(that)) {
+    bool result = true;
+    for (size_t i = 0; i < amounts_.size(); ++i) {
+      result &= amounts_[i] >= that.amounts_[i];
+    }
+
+    return result;
+  }
+
+  // Both collections are sorted by name, so we can walk them in
+  // lockstep. Every name in `that` must be present here since all
+  // amounts are positive.
+  size_t i = 0;
+  for (size_t j = 0; j < that.names_.size(); ++j) {
+    while (i < names_.size() && names_[i] < that.names_[j]) {
+      ++i;
+    }
+
+    if (i == names_.size() ||
+        names_[i] != that.names_[j] ||
+        amounts_[i] < that.amounts_[j]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+double ResourceQuantities::dominantShare(
+    const ResourceQuantities& total,
+    const Option<set<string>>& excludeNames) const
+{
+  double share = 0.0;
+
+  // Both collections are sorted by name, so we can walk them in
+  // lockstep. Names that are only in `total` contribute a zero share.
+  size_t i = 0;
+  for (size_t j = 0; j < total.names_.size(); ++j) {
+    while (i < names_.size() && names_[i] < total.names_[j]) {
+      ++i;
+    }
+
+    if (i == names_.size()) {
+      break;
+    }
+
+    if (names_[i] != total.names_[j]) {
+      continue;
+    }
+
+    if (excludeNames.isSome() && excludeNames->count(names_[i]) > 0) {
+      continue;
+    }
+
+    // NOTE: All amounts are positive, so there is no division by zero.
+    // The ratio of the fixed-point amounts is the ratio of the values.
+    share = std::max(
+        share,
+        static_cast<double>(amounts_[i]) /
+          static_cast<double>(total.amounts_[j]));
+  }
+
+  return share;
+}
+
+
+bool ResourceQuantities::operator==(const ResourceQuantities& that) const
+{
+  return names_ == that.names_ && amounts_ == that.amounts_;
+}
+
+
+bool ResourceQuantities::operator!=(const ResourceQuantities& that) const
+{
+  return !(*this == that);
+}
+
+
+ResourceQuantities& ResourceQuantities::operator+=(
+    const ResourceQuantities& that)
+{
+  if (sameNames(that)) {
+    for (size_t i = 0; i < amounts_.size(); ++i) {
+      amounts_[i] += that.amounts_[i];
+    }
+
+    return *this;
+  }
+
+  vector<string> names;
+  vector<int64_t> amounts;
+
+  names.reserve(names_.size() + that.names_.size());
+  amounts.reserve(names_.size() + that.names_.size());
+
+  size_t i = 0;
+  size_t j = 0;
+
+  while (i < names_.size() || j < that.names_.size()) {
+    if (j == that.names_.size() ||
+        (i < names_.size() && names_[i] < that.names_[j])) {
+      names.push_back(std::move(names_[i]));
+      amounts.push_back(amounts_[i]);
+      ++i;
+    } else if (i == names_.size() || that.names_[j] < names_[i]) {
+      names.push_back(that.names_[j]);
+      amounts.push_back(that.amounts_[j]);
+      ++j;
+    } else {
+      names.push_back(std::move(names_[i]));
+      amounts.push_back(amounts_[i] + that.amounts_[j]);
+      ++i;
+      ++j;
+    }
+  }
+
+  names_ = std::move(names);
+  amounts_ = std::move(amounts);
+
+  return *this;
+}
+
+
+ResourceQuantities& ResourceQuantities::operator-=(
+    const ResourceQuantities& that)
+{
+  if (sameNames(that)) {
+    bool exhausted = false;
+    for (size_t i = 0; i < amounts_.size(); ++i) {
+      amounts_[i] = std::max<int64_t>(amounts_[i] - that.amounts_[i], 0);
+      exhausted |= amounts_[i] == 0;
+    }
+
+    if (!exhausted) {
+      return *this;
+    }
+  } else {
+    size_t i = 0;
+    for (size_t j = 0; j < that.names_.size(); ++j) {
+      while (i < names_.size() && names_[i] < that.names_[j]) {
+        ++i;
+      }
+
+      if (i == names_.size()) {
+        break;
+      }
+
+      if (names_[i] == that.names_[j]) {
+        amounts_[i] = std::max<int64_t>(amounts_[i] - that.amounts_[j], 0);
+      }
+    }
+  }
+
+  // Drop the resources that have been exhausted.
+  size_t size = 0;
+  for (size_t i = 0; i < names_.size(); ++i) {
+    if (amounts_[i] > 0) {
+      if (size != i) {
+        names_[size] = std::move(names_[i]);
+        amounts_[size] = amounts_[i];
+      }
+      ++size;
+    }
+  }
+
+  names_.resize(size);
+  amounts_.resize(size);
+
+  return *this;
+}
+
+
+ResourceQuantities ResourceQuantities::operator+(
+    const ResourceQuantities& that) const
+{
+  ResourceQuantities result = *this;
+  result += that;
+  return result;
+}
+
+
+ResourceQuantities ResourceQuantities::operator-(
+    const ResourceQuantities& that) const
+{
+  ResourceQuantities result = *this;
+  result -= that;
+  return result;
+}
+
+
+void ResourceQuantities::add(const string& name, int64_t amount)
+{
+  if (amount <= 0) {
+    return;
+  }
+
+  auto it = std::lower_bound(names_.begin(), names_.end(), name);
+  size_t index = it - names_.begin();
+
+  if (it != names_.end() && *it == name) {
+    amounts_[index] += amount;
+    return;
+  }
+
+  names_.insert(it, name);
+  amounts_.insert(amounts_.begin() + index, amount);
+}
+
+
+bool ResourceQuantities::sameNames(const ResourceQuantities& that) const
+{
+  return names_ == that.names_;
+}
+
+
+std::ostream& operator<<(
+    std::ostream& stream,
+    const ResourceQuantities& quantities)
+{
+  bool first = true;
+
+  foreach (const string& name, quantities.names()) {
+    if (!first) {
+      stream << "; ";
+    }
+
+    first = false;
+
+    stream << name << ":" << quantities.get(name);
+  }
+
+  return stream;
+}
+
+} // namespace mesos {
@@ -0,0 +1,127 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __COMMON_RESOURCE_QUANTITIES_HPP__
+#define __COMMON_RESOURCE_QUANTITIES_HPP__
+
+#include <stdint.h>
+
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+
+// An efficient collection of scalar resource quantities, i.e. a
+// mapping from resource name to an aggregated amount, without any
+// of the metadata (reservations, disk info, sharedness, etc.) that
+// a `Resource` carries.
+//
+// E.g. [("cpus", 4.5), ("disk", 1024), ("mem", 2048)]
+//
+// This is used by the allocator and the sorters to do the quantity
+// arithmetic behind DRF shares and quota headroom without building
+// `Resource` protobufs, which is what
+// `Resources::createStrippedScalarQuantity()` would otherwise do.
+//
+// Entries are kept sorted by name. Amounts are stored in the same
+// fixed-point representation that `Value::Scalar` arithmetic uses
+// (three decimal digits, see `values.cpp`), so that the results are
+// identical to the equivalent `Resources` arithmetic. All amounts are
+// positive: subtraction saturates at zero and entries that reach zero
+// are removed.
+class ResourceQuantities
+{
+public:
+  // Aggregates the scalar resources in `resources` by name, ignoring
+  // all metadata. Non-scalar resources are skipped.
+  static ResourceQuantities fromScalarResources(const Resources& resources);
+
+  ResourceQuantities() = default;
+
+  ResourceQuantities(const ResourceQuantities& that) = default;
+  ResourceQuantities(ResourceQuantities&& that) = default;
+
+  ResourceQuantities& operator=(const ResourceQuantities& that) = default;
+  ResourceQuantities& operator=(ResourceQuantities&& that) = default;
+
+  size_t size() const { return names_.size(); }
+
+  bool empty() const { return names_.empty(); }
+
+  // Returns the (sorted) names of the resources with a non-zero
+  // quantity.
+  const std::vector<std::string>& names() const { return names_; }
+
+  // Returns the quantity of the named resource, or zero if there is
+  // no such resource.
+  Value::Scalar get(const std::string& name) const;
+
+  // Returns true if every quantity in `that` is less than or equal
+  // to the corresponding quantity in this collection.
+  bool contains(const ResourceQuantities& that) const;
+
+  // Returns the largest ratio of a quantity in this collection to the
+  // corresponding quantity in `total`, i.e. the dominant share used
+  // by DRF. Resources that are absent from `total` or whose name is
+  // in `excludeNames` are ignored.
+  //
+  // Both collections are walked in a single merge pass over the
+  // sorted names, without building any `Value::Scalar`.
+  double dominantShare(
+      const ResourceQuantities& total,
+      const Option<std::set<std::string>>& excludeNames = None()) const;
+
+  bool operator==(const ResourceQuantities& that) const;
+  bool operator!=(const ResourceQuantities& that) const;
+
+  ResourceQuantities& operator+=(const ResourceQuantities& that);
+  ResourceQuantities& operator-=(const ResourceQuantities& that);
+
+  ResourceQuantities operator+(const ResourceQuantities& that) const;
+  ResourceQuantities operator-(const ResourceQuantities& that) const;
+
+private:
+  // Adds `amount` (fixed-point) to the named resource.
+  void add(const std::string& name, int64_t amount);
+
+  // Returns true if `that` has exactly the same resource names as
+  // this collection. This is the common case in the allocator (e.g.
+  // cpus, disk, mem, ...) and lets the arithmetic operate on the
+  // amounts directly, without merging the names.
+  bool sameNames(const ResourceQuantities& that) const;
+
+  // The names and fixed-point amounts are stored in two parallel
+  // vectors, sorted by name.
+  std::vector<std::string> names_;
+  std::vector<int64_t> amounts_;
+};
+
+
+std::ostream& operator<<(
+    std::ostream& stream,
+    const ResourceQuantities& quantities);
+
+} // namespace mesos {
+
+#endif // __COMMON_RESOURCE_QUANTITIES_HPP__
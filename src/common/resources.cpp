@@ -16,11 +16,15 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
 #include <ostream>
 #include <set>
 #include <string>
 #include <vector>
 
+#include <boost/functional/hash.hpp>
+
 #include <glog/logging.h>
 
 #include <google/protobuf/repeated_field.h>
@@ -30,6 +34,7 @@
 #include <mesos/values.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <stout/cpp17.hpp>
 #include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -573,6 +578,59 @@ static bool contains(const Resource& left, const Resource& right)
 }
 
 
+// Returns a hash of the metadata that must be equal for two Resource
+// objects to be addable or subtractable (and hence for one to contain
+// the other). Resource objects with different hashes can never be
+// combined, so `Resources` uses this to index its `Resource_` objects
+// instead of comparing every pair of them.
+//
+// NOTE: This only needs to be a necessary condition for `addable` and
+// `subtractable`. Reservation labels are only hashed by their number
+// since the equality of `Labels` does not depend on their order.
+static size_t metadataHash(const Resource& resource)
+{
+  size_t seed = 0;
+
+  boost::hash_combine(seed, resource.name());
+  boost::hash_combine(seed, static_cast<int>(resource.type()));
+  boost::hash_combine(seed, resource.has_shared());
+  boost::hash_combine(seed, resource.has_revocable());
+
+  if (resource.has_allocation_info()) {
+    boost::hash_combine(seed, resource.allocation_info().role());
+  }
+
+  foreach (const Resource::ReservationInfo& reservation,
+           resource.reservations()) {
+    boost::hash_combine(seed, static_cast<int>(reservation.type()));
+    boost::hash_combine(seed, reservation.role());
+    boost::hash_combine(seed, reservation.principal());
+    boost::hash_combine(seed, reservation.labels().labels_size());
+  }
+
+  boost::hash_combine(seed, resource.has_disk());
+
+  if (resource.has_disk()) {
+    const Resource::DiskInfo& disk = resource.disk();
+
+    if (disk.has_persistence()) {
+      boost::hash_combine(seed, disk.persistence().id());
+    }
+
+    if (disk.has_source()) {
+      boost::hash_combine(seed, static_cast<int>(disk.source().type()));
+      boost::hash_combine(seed, disk.source().id());
+    }
+  }
+
+  if (resource.has_provider_id()) {
+    boost::hash_combine(seed, resource.provider_id().value());
+  }
+
+  return seed;
+}
+
+
 /**
  * Checks that a Resources object is valid for command line specification.
  *
@@ -789,36 +847,38 @@ Try<vector<Resource>> Resources::fromSimpleString(
 {
   vector<Resource> resources;
 
-  foreach (const string& token, strings::tokenize(text, ";")) {
+  foreach (cpp17::string_view token, strings::view::tokenize(text, ";")) {
     // TODO(anindya_sinha): Allow text based representation of resources
     // to specify PATH or MOUNT type disks along with its root.
-    vector<string> pair = strings::tokenize(token, ":");
+    vector<cpp17::string_view> pair = strings::view::tokenize(token, ":");
     if (pair.size() != 2) {
       return Error(
-          "Bad value for resources, missing or extra ':' in " + token);
+          "Bad value for resources, missing or extra ':' in " +
+          string(token));
     }
 
     string name;
     string role;
     size_t openParen = pair[0].find('(');
-    if (openParen == string::npos) {
-      name = strings::trim(pair[0]);
+    if (openParen == cpp17::string_view::npos) {
+      name = string(strings::view::trim(pair[0]));
       role = defaultRole;
     } else {
       size_t closeParen = pair[0].find(')');
-      if (closeParen == string::npos || closeParen < openParen) {
+      if (closeParen == cpp17::string_view::npos || closeParen < openParen) {
         return Error(
-            "Bad value for resources, mismatched parentheses in " + token);
+            "Bad value for resources, mismatched parentheses in " +
+            string(token));
       }
 
-      name = strings::trim(pair[0].substr(0, openParen));
+      name = string(strings::view::trim(pair[0].substr(0, openParen)));
 
-      role = strings::trim(pair[0].substr(
+      role = string(strings::view::trim(pair[0].substr(
           openParen + 1,
-          closeParen - openParen - 1));
+          closeParen - openParen - 1)));
     }
 
-    Try<Resource> resource = Resources::parse(name, pair[1], role);
+    Try<Resource> resource = Resources::parse(name, string(pair[1]), role);
     if (resource.isError()) {
       return Error(resource.error());
     }
@@ -1466,18 +1526,56 @@ Resources::Resources(RepeatedPtrField<Resource>&& _resources)
 
 bool Resources::contains(const Resources& that) const
 {
+  // NOTE: Copying is cheap here since the `Resource_` objects are
+  // shared; they are only copied if `remaining` gets mutated.
   Resources remaining = *this;
 
-  foreach (const Resource_& resource_, that.resources) {
-    // NOTE: We use _contains because Resources only contain valid
-    // Resource objects, and we don't want the performance hit of the
-    // validity check.
-    if (!remaining._contains(resource_)) {
+  if (resources.size() < INDEX_THRESHOLD) {
+    foreach (const Resource_Unsafe& resource_, that.resources) {
+      // NOTE: We use _contains because Resources only contain valid
+      // Resource objects, and we don't want the performance hit of the
+      // validity check.
+      if (!remaining._contains(*resource_)) {
+        return false;
+      }
+
+      if (isPersistentVolume(resource_->resource)) {
+        remaining.subtract(*resource_);
+      }
+    }
+
+    return true;
+  }
+
+  // Only the `Resource_` objects with a matching metadata hash can
+  // contain a given `Resource_`. The positions in the index stay
+  // valid since we only clear (rather than erase) the persistent
+  // volumes that have been accounted for.
+  const hashmap<size_t, vector<size_t>> index = remaining.index();
+
+  foreach (const Resource_Unsafe& resource_, that.resources) {
+    auto candidates = index.find(internal::metadataHash(resource_->resource));
+    if (candidates == index.end()) {
       return false;
     }
 
-    if (isPersistentVolume(resource_.resource)) {
-      remaining.subtract(resource_);
+    bool found = false;
+    foreach (size_t i, candidates->second) {
+      Resource_Unsafe& candidate = remaining.resources[i];
+
+      if (candidate != nullptr && candidate->contains(*resource_)) {
+        if (isPersistentVolume(resource_->resource) &&
+            !_subtract(candidate, *resource_)) {
+          candidate.reset();
+        }
+
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      return false;
     }
   }
 
@@ -1496,11 +1594,11 @@ bool Resources::contains(const Resource& that) const
 
 size_t Resources::count(const Resource& that) const
 {
-  foreach (const Resource_& resource_, resources) {
-    if (resource_.resource == that) {
+  foreach (const Resource_Unsafe& resource_, resources) {
+    if (resource_->resource == that) {
       // Return 1 for non-shared resources because non-shared
       // Resource objects in Resources are unique.
-      return resource_.isShared() ? resource_.sharedCount.get() : 1;
+      return resource_->isShared() ? resource_->sharedCount.get() : 1;
     }
   }
 
@@ -1510,17 +1608,25 @@ size_t Resources::count(const Resource& that) const
 
 void Resources::allocate(const string& role)
 {
-  foreach (Resource_& resource_, resources) {
-    resource_.resource.mutable_allocation_info()->set_role(role);
+  foreach (Resource_Unsafe& resource_, resources) {
+    // Avoid copying shared `Resource_` objects that are
+    // already allocated to the role.
+    if (resource_->resource.has_allocation_info() &&
+        resource_->resource.allocation_info().has_role() &&
+        resource_->resource.allocation_info().role() == role) {
+      continue;
+    }
+
+    exclusive(resource_).resource.mutable_allocation_info()->set_role(role);
   }
 }
 
 
 void Resources::unallocate()
 {
-  foreach (Resource_& resource_, resources) {
-    if (resource_.resource.has_allocation_info()) {
-      resource_.resource.clear_allocation_info();
+  foreach (Resource_Unsafe& resource_, resources) {
+    if (resource_->resource.has_allocation_info()) {
+      exclusive(resource_).resource.clear_allocation_info();
     }
   }
 }
@@ -1530,8 +1636,8 @@ Resources Resources::filter(
     const lambda::function<bool(const Resource&)>& predicate) const
 {
   Resources result;
-  foreach (const Resource_& resource_, resources) {
-    if (predicate(resource_.resource)) {
+  foreach (const Resource_Unsafe& resource_, resources) {
+    if (predicate(resource_->resource)) {
       result.add(resource_);
     }
   }
@@ -1543,9 +1649,9 @@ hashmap<string, Resources> Resources::reservations() const
 {
   hashmap<string, Resources> result;
 
-  foreach (const Resource_& resource_, resources) {
-    if (isReserved(resource_.resource)) {
-      result[reservationRole(resource_.resource)].add(resource_);
+  foreach (const Resource_Unsafe& resource_, resources) {
+    if (isReserved(resource_->resource)) {
+      result[reservationRole(resource_->resource)].add(resource_);
     }
   }
 
@@ -1607,12 +1713,12 @@ hashmap<string, Resources> Resources::allocations() const
 {
   hashmap<string, Resources> result;
 
-  foreach (const Resource_& resource_, resources) {
+  foreach (const Resource_Unsafe& resource_, resources) {
     // We require that this is called only when
     // the resources are allocated.
-    CHECK(resource_.resource.has_allocation_info());
-    CHECK(resource_.resource.allocation_info().has_role());
-    result[resource_.resource.allocation_info().role()].add(resource_);
+    CHECK(resource_->resource.has_allocation_info());
+    CHECK(resource_->resource.allocation_info().has_role());
+    result[resource_->resource.allocation_info().role()].add(resource_);
   }
 
   return result;
@@ -1627,7 +1733,7 @@ Resources Resources::pushReservation(
   foreach (Resource_ resource_, *this) {
     resource_.resource.add_reservations()->CopyFrom(reservation);
     CHECK_NONE(Resources::validate(resource_.resource));
-    result.add(resource_);
+    result.add(std::move(resource_));
   }
 
   return result;
@@ -1638,10 +1744,10 @@ Resources Resources::popReservation() const
 {
   Resources result;
 
-  foreach (Resource_ resource_, resources) {
+  foreach (Resource_ resource_, *this) {
     CHECK_GT(resource_.resource.reservations_size(), 0);
     resource_.resource.mutable_reservations()->RemoveLast();
-    result.add(resource_);
+    result.add(std::move(resource_));
   }
 
   return result;
@@ -1654,7 +1760,7 @@ Resources Resources::toUnreserved() const
 
   foreach (Resource_ resource_, *this) {
     resource_.resource.clear_reservations();
-    result.add(resource_);
+    result.add(std::move(resource_));
   }
 
   return result;
@@ -1665,7 +1771,7 @@ Resources Resources::createStrippedScalarQuantity() const
 {
   Resources stripped;
 
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     if (resource.type() == Value::SCALAR) {
       Resource scalar;
 
@@ -1740,7 +1846,7 @@ Option<Value::Scalar> Resources::get(const string& name) const
   Value::Scalar total;
   bool found = false;
 
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     if (resource.name() == name &&
         resource.type() == Value::SCALAR) {
       total += resource.scalar();
@@ -1762,7 +1868,7 @@ Option<Value::Set> Resources::get(const string& name) const
   Value::Set total;
   bool found = false;
 
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     if (resource.name() == name &&
         resource.type() == Value::SET) {
       total += resource.set();
@@ -1784,7 +1890,7 @@ Option<Value::Ranges> Resources::get(const string& name) const
   Value::Ranges total;
   bool found = false;
 
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     if (resource.name() == name &&
         resource.type() == Value::RANGES) {
       total += resource.ranges();
@@ -1819,7 +1925,7 @@ Resources Resources::scalars() const
 set<string> Resources::names() const
 {
   set<string> result;
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     result.insert(resource.name());
   }
 
@@ -1830,7 +1936,7 @@ set<string> Resources::names() const
 map<string, Value_Type> Resources::types() const
 {
   map<string, Value_Type> result;
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     result[resource.name()] = resource.type();
   }
 
@@ -1906,9 +2012,9 @@ Option<Value::Ranges> Resources::ephemeral_ports() const
 
 Option<Resource> Resources::match(const Resource& resource) const
 {
-  foreach (const Resource_& resource_, resources) {
-    if (compareResourceMetadata(resource_.resource, resource)) {
-      return resource_.resource;
+  foreach (const Resource_Unsafe& resource_, resources) {
+    if (compareResourceMetadata(resource_->resource, resource)) {
+      return resource_->resource;
     }
   }
 
@@ -1921,8 +2027,8 @@ Option<Resource> Resources::match(const Resource& resource) const
 
 bool Resources::_contains(const Resource_& that) const
 {
-  foreach (const Resource_& resource_, resources) {
-    if (resource_.contains(that)) {
+  foreach (const Resource_Unsafe& resource_, resources) {
+    if (resource_->contains(that)) {
       return true;
     }
   }
@@ -1983,7 +2089,7 @@ Option<Resources> Resources::find(const Resource& target) const
 Resources::operator RepeatedPtrField<Resource>() const
 {
   RepeatedPtrField<Resource> all;
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, *this) {
     all.Add()->CopyFrom(resource);
   }
 
@@ -2074,9 +2180,9 @@ void Resources::add(const Resource_& that)
   }
 
   bool found = false;
-  foreach (Resource_& resource_, resources) {
-    if (internal::addable(resource_.resource, that)) {
-      resource_ += that;
+  foreach (Resource_Unsafe& resource_, resources) {
+    if (internal::addable(resource_->resource, that)) {
+      exclusive(resource_) += that;
       found = true;
       break;
     }
@@ -2084,7 +2190,7 @@ void Resources::add(const Resource_& that)
 
   // Cannot be combined with any existing Resource object.
   if (!found) {
-    resources.push_back(that);
+    resources.push_back(std::make_shared<Resource_>(that));
   }
 }
 
@@ -2096,9 +2202,9 @@ void Resources::add(Resource_&& that)
   }
 
   bool found = false;
-  foreach (Resource_& resource_, resources) {
-    if (internal::addable(resource_.resource, that)) {
-      resource_ += that;
+  foreach (Resource_Unsafe& resource_, resources) {
+    if (internal::addable(resource_->resource, that)) {
+      exclusive(resource_) += that;
       found = true;
       break;
     }
@@ -2106,11 +2212,55 @@ void Resources::add(Resource_&& that)
 
   // Cannot be combined with any existing Resource object.
   if (!found) {
-    resources.push_back(std::move(that));
+    resources.push_back(std::make_shared<Resource_>(std::move(that)));
+  }
+}
+
+
+void Resources::add(const Resource_Unsafe& that)
+{
+  if (that->isEmpty()) {
+    return;
+  }
+
+  bool found = false;
+  foreach (Resource_Unsafe& resource_, resources) {
+    if (internal::addable(resource_->resource, *that)) {
+      exclusive(resource_) += *that;
+      found = true;
+      break;
+    }
+  }
+
+  // Cannot be combined with any existing Resource object, so we
+  // can share it rather than copying it.
+  if (!found) {
+    resources.push_back(that);
   }
 }
 
 
+Resources::Resource_& Resources::exclusive(Resource_Unsafe& resource_)
+{
+  // NOTE: `Resources` objects may be copied from and read by several
+  // threads (e.g., by the allocator when evaluating the offer filters
+  // in parallel), so this must be safe when the `Resource_` is shared
+  // across threads. Another thread can only take a new reference from
+  // a `Resources` holding one, so once the use count is 1 it can only
+  // increase through this object. `use_count()` is a relaxed load,
+  // though, so we need an acquire fence to ensure that the reads of
+  // the `Resource_` by the threads which dropped their references
+  // happen before we mutate it.
+  if (resource_.use_count() > 1) {
+    resource_ = std::make_shared<Resource_>(*resource_);
+  } else {
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+
+  return *resource_;
+}
+
+
 Resources& Resources::operator+=(const Resource_& that)
 {
   if (that.validate().isNone()) {
@@ -2149,9 +2299,7 @@ Resources& Resources::operator+=(Resource&& that)
 
 Resources& Resources::operator+=(const Resources& that)
 {
-  foreach (const Resource_& resource_, that) {
-    add(resource_);
-  }
+  add(that.resources);
 
   return *this;
 }
@@ -2159,14 +2307,56 @@ Resources& Resources::operator+=(const Resources& that)
 
 Resources& Resources::operator+=(Resources&& that)
 {
-  foreach (Resource_& resource_, that.resources) {
-    add(std::move(resource_));
+  if (resources.empty()) {
+    resources = std::move(that.resources);
+    return *this;
   }
 
+  add(that.resources);
+
   return *this;
 }
 
 
+void Resources::add(const vector<Resource_Unsafe>& that)
+{
+  if (resources.size() < INDEX_THRESHOLD) {
+    foreach (const Resource_Unsafe& resource_, that) {
+      add(resource_);
+    }
+
+    return;
+  }
+
+  hashmap<size_t, vector<size_t>> index = this->index();
+
+  foreach (const Resource_Unsafe& resource_, that) {
+    if (resource_->isEmpty()) {
+      continue;
+    }
+
+    vector<size_t>& candidates =
+      index[internal::metadataHash(resource_->resource)];
+
+    bool found = false;
+    foreach (size_t i, candidates) {
+      if (internal::addable(resources[i]->resource, *resource_)) {
+        exclusive(resources[i]) += *resource_;
+        found = true;
+        break;
+      }
+    }
+
+    // Cannot be combined with any existing Resource object, so we
+    // can share it rather than copying it.
+    if (!found) {
+      candidates.push_back(resources.size());
+      resources.push_back(resource_);
+    }
+  }
+}
+
+
 Resources Resources::operator-(const Resource& that) const
 {
   Resources result = *this;
@@ -2190,26 +2380,8 @@ void Resources::subtract(const Resource_& that)
   }
 
   for (size_t i = 0; i < resources.size(); i++) {
-    Resource_& resource_ = resources[i];
-
-    if (internal::subtractable(resource_.resource, that)) {
-      resource_ -= that;
-
-      // Remove the resource if it has become negative or empty.
-      // Note that a negative resource means the caller is
-      // subtracting more than they should!
-      //
-      // TODO(gyliu513): Provide a stronger interface to avoid
-      // silently allowing this to occur.
-
-      // A "negative" Resource_ either has a negative sharedCount or
-      // a negative scalar value.
-      bool negative =
-        (resource_.isShared() && resource_.sharedCount.get() < 0) ||
-        (resource_.resource.type() == Value::SCALAR &&
-         resource_.resource.scalar().value() < 0);
-
-      if (negative || resource_.isEmpty()) {
+    if (internal::subtractable(resources[i]->resource, that)) {
+      if (!_subtract(resources[i], that)) {
         // As `resources` is not ordered, and erasing an element
         // from the middle is expensive, we swap with the last element
         // and then shrink the vector by one.
@@ -2223,6 +2395,30 @@ void Resources::subtract(const Resource_& that)
 }
 
 
+bool Resources::_subtract(Resource_Unsafe& resource_, const Resource_& that)
+{
+  Resource_& result = exclusive(resource_);
+
+  result -= that;
+
+  // Remove the resource if it has become negative or empty.
+  // Note that a negative resource means the caller is
+  // subtracting more than they should!
+  //
+  // TODO(gyliu513): Provide a stronger interface to avoid
+  // silently allowing this to occur.
+
+  // A "negative" Resource_ either has a negative sharedCount or
+  // a negative scalar value.
+  bool negative =
+    (result.isShared() && result.sharedCount.get() < 0) ||
+    (result.resource.type() == Value::SCALAR &&
+     result.resource.scalar().value() < 0);
+
+  return !negative && !result.isEmpty();
+}
+
+
 Resources& Resources::operator-=(const Resource_& that)
 {
   if (that.validate().isNone()) {
@@ -2243,14 +2439,72 @@ Resources& Resources::operator-=(const Resource& that)
 
 Resources& Resources::operator-=(const Resources& that)
 {
+  // Subtracting a `Resources` from itself always leaves it empty.
+  // We handle this upfront since `that` is iterated below while
+  // the `Resource_` objects are mutated.
+  if (this == &that) {
+    resources.clear();
+    return *this;
+  }
+
+  if (resources.size() < INDEX_THRESHOLD) {
+    foreach (const Resource_& resource_, that) {
+      subtract(resource_);
+    }
+
+    return *this;
+  }
+
+  // Exhausted `Resource_` objects are cleared while subtracting, so
+  // that the positions in the index stay valid, and erased at the end.
+  const hashmap<size_t, vector<size_t>> index = this->index();
+  bool exhausted = false;
+
   foreach (const Resource_& resource_, that) {
-    subtract(resource_);
+    if (resource_.isEmpty()) {
+      continue;
+    }
+
+    auto candidates = index.find(internal::metadataHash(resource_.resource));
+    if (candidates == index.end()) {
+      continue;
+    }
+
+    foreach (size_t i, candidates->second) {
+      if (resources[i] != nullptr &&
+          internal::subtractable(resources[i]->resource, resource_)) {
+        if (!_subtract(resources[i], resource_)) {
+          resources[i].reset();
+          exhausted = true;
+        }
+
+        break;
+      }
+    }
+  }
+
+  if (exhausted) {
+    resources.erase(
+        std::remove(resources.begin(), resources.end(), nullptr),
+        resources.end());
   }
 
   return *this;
 }
 
 
+hashmap<size_t, vector<size_t>> Resources::index() const
+{
+  hashmap<size_t, vector<size_t>> result;
+
+  for (size_t i = 0; i < resources.size(); i++) {
+    result[internal::metadataHash(resources[i]->resource)].push_back(i);
+  }
+
+  return result;
+}
+
+
 ostream& operator<<(ostream& stream, const Resource::DiskInfo::Source& source)
 {
   switch (source.type()) {
@@ -22,6 +22,7 @@
 #include <limits>
 #include <ostream>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -145,6 +146,40 @@ struct Range
 };
 
 
+static bool compareRanges(const Range& left, const Range& right)
+{
+  return std::tie(left.start, left.end) < std::tie(right.start, right.end);
+}
+
+
+// Returns true if `ranges` is in coalesced form, i.e., the ranges are
+// sorted and neither overlap nor are adjacent to each other. All the
+// arithmetic operations below produce coalesced ranges, so in practice
+// most `Value::Ranges` (e.g., the ports of an agent) are coalesced, and
+// operating on them can use binary search rather than sorting.
+static bool isCoalesced(const Value::Ranges& ranges)
+{
+  for (int i = 0; i < ranges.range_size(); ++i) {
+    const Value::Range& range = ranges.range(i);
+
+    if (range.begin() > range.end()) {
+      return false;
+    }
+
+    if (i > 0) {
+      const Value::Range& previous = ranges.range(i - 1);
+
+      if (previous.end() == std::numeric_limits<uint64_t>::max() ||
+          range.begin() <= previous.end() + 1) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
 // Coalesces the vector of ranges provided and modifies `result` to contain the
 // solution.
 // The algorithm first sorts all the individual intervals so that we can iterate
@@ -161,13 +196,11 @@ void coalesce(Value::Ranges* result, vector<Range> ranges)
     return;
   }
 
-  std::sort(
-      ranges.begin(),
-      ranges.end(),
-      [](const Range& left, const Range& right) {
-        return std::tie(left.start, left.end) <
-               std::tie(right.start, right.end);
-      });
+  // NOTE: The ranges are often sorted already (e.g., when merging
+  // coalesced ranges, see below), in which case we skip the sort.
+  if (!std::is_sorted(ranges.begin(), ranges.end(), compareRanges)) {
+    std::sort(ranges.begin(), ranges.end(), compareRanges);
+  }
 
   // We build up initial state of the current range.
   CHECK(!ranges.empty());
@@ -230,6 +263,181 @@ void coalesce(Value::Ranges* result, vector<Range> ranges)
 }
 
 
+// Returns `ranges` if they are coalesced, otherwise coalesces them
+// into `storage` and returns that. This avoids copying the (common)
+// ranges that are coalesced already.
+static const Value::Ranges& coalesced(
+    const Value::Ranges& ranges,
+    Value::Ranges* storage)
+{
+  if (isCoalesced(ranges)) {
+    return ranges;
+  }
+
+  vector<Range> result;
+  result.reserve(ranges.range_size());
+
+  foreach (const Value::Range& range, ranges.range()) {
+    result.push_back({range.begin(), range.end()});
+  }
+
+  coalesce(storage, std::move(result));
+  return *storage;
+}
+
+
+// Inserts `range` at position `index` of `ranges`.
+static void insert(Value::Ranges* ranges, int index, const Range& range)
+{
+  Value::Range* added = ranges->add_range();
+  added->set_begin(range.start);
+  added->set_end(range.end);
+
+  // `RepeatedPtrField` only appends, so we move the new element into
+  // place by swapping pointers.
+  for (int i = ranges->range_size() - 1; i > index; --i) {
+    ranges->mutable_range()->SwapElements(i, i - 1);
+  }
+}
+
+
+// Adds `range` to the coalesced `ranges` in place, keeping them
+// coalesced. The existing ranges that overlap or are adjacent to
+// `range` are located by binary search and merged with it.
+static void add(Value::Ranges* ranges, const Range& range)
+{
+  const auto& field = ranges->range();
+
+  // The first range that ends at or after `range.start - 1`.
+  auto first = std::lower_bound(
+      field.begin(),
+      field.end(),
+      range.start,
+      [](const Value::Range& left, uint64_t start) {
+        return start > 0 && left.end() < start - 1;
+      });
+
+  // The first range that begins after `range.end + 1`.
+  auto last = std::upper_bound(
+      first,
+      field.end(),
+      range.end,
+      [](uint64_t end, const Value::Range& right) {
+        return end < std::numeric_limits<uint64_t>::max() &&
+               right.begin() > end + 1;
+      });
+
+  const int index = static_cast<int>(first - field.begin());
+  const int count = static_cast<int>(last - first);
+
+  if (count == 0) {
+    insert(ranges, index, range);
+    return;
+  }
+
+  // Merge the overlapping and adjacent ranges into the first of them.
+  const uint64_t end = max(ranges->range(index + count - 1).end(), range.end);
+
+  Value::Range* merged = ranges->mutable_range(index);
+  merged->set_begin(min(merged->begin(), range.start));
+  merged->set_end(end);
+
+  if (count > 1) {
+    ranges->mutable_range()->DeleteSubrange(index + 1, count - 1);
+  }
+}
+
+
+// Subtracts `range` from the coalesced `ranges` in place, keeping them
+// coalesced. The existing ranges that overlap `range` are located by
+// binary search.
+static void subtract(Value::Ranges* ranges, const Range& range)
+{
+  const auto& field = ranges->range();
+
+  // The first range that ends at or after `range.start`.
+  auto first = std::lower_bound(
+      field.begin(),
+      field.end(),
+      range.start,
+      [](const Value::Range& left, uint64_t start) {
+        return left.end() < start;
+      });
+
+  // The first range that begins after `range.end`.
+  auto last = std::upper_bound(
+      first,
+      field.end(),
+      range.end,
+      [](uint64_t end, const Value::Range& right) {
+        return end < right.begin();
+      });
+
+  const int index = static_cast<int>(first - field.begin());
+  const int count = static_cast<int>(last - first);
+
+  if (count == 0) {
+    return;
+  }
+
+  // Only the first and the last of the overlapping ranges can remain
+  // in part, on the left and on the right of `range` respectively.
+  vector<Range> remaining;
+
+  const Value::Range& head = ranges->range(index);
+  if (head.begin() < range.start) {
+    remaining.push_back({head.begin(), range.start - 1});
+  }
+
+  const Value::Range& tail = ranges->range(index + count - 1);
+  if (tail.end() > range.end) {
+    remaining.push_back({range.end + 1, tail.end()});
+  }
+
+  // Replace the overlapping ranges with the remaining ones.
+  const int overwritten = min(count, static_cast<int>(remaining.size()));
+
+  for (int i = 0; i < overwritten; ++i) {
+    ranges->mutable_range(index + i)->set_begin(remaining[i].start);
+    ranges->mutable_range(index + i)->set_end(remaining[i].end);
+  }
+
+  if (count > overwritten) {
+    ranges->mutable_range()->DeleteSubrange(
+        index + overwritten, count - overwritten);
+  } else if (static_cast<int>(remaining.size()) > overwritten) {
+    // A single range was split in two.
+    insert(ranges, index + overwritten, remaining.back());
+  }
+}
+
+
+// Returns true if the arithmetic between `left` and `right` should be
+// done in place, one range of `right` at a time (see `add` and
+// `subtract` above), rather than by merging all the ranges. This is
+// the case when `left` is coalesced and `right` only has a few valid
+// ranges, e.g., when allocating or recovering some ports of an agent.
+static bool inPlace(const Value::Ranges& left, const Value::Ranges& right)
+{
+  // The in place operations take logarithmic time to locate the
+  // affected ranges, but may still need to shift the ranges after
+  // them, so merging is cheaper once `right` has many ranges.
+  const int MAX_IN_PLACE_RANGES = 16;
+
+  if (right.range_size() > MAX_IN_PLACE_RANGES) {
+    return false;
+  }
+
+  foreach (const Value::Range& range, right.range()) {
+    if (range.begin() > range.end()) {
+      return false;
+    }
+  }
+
+  return isCoalesced(left);
+}
+
+
 // Subtract `right_` from `left_`, and return the result as Value::Ranges.
 Value::Ranges subtract(const Value::Ranges& left_, const Value::Ranges& right_)
 {
@@ -247,12 +455,14 @@ Value::Ranges subtract(const Value::Ranges& left_, const Value::Ranges& right_)
       result.push_back({range.begin(), range.end()});
     }
 
-    std::sort(
-        result.begin(),
-        result.end(),
-        [](const internal::Range& left, const internal::Range& right) {
-          return left.start < right.start;
-        });
+    auto compare =
+      [](const internal::Range& left, const internal::Range& right) {
+        return left.start < right.start;
+      };
+
+    if (!std::is_sorted(result.begin(), result.end(), compare)) {
+      std::sort(result.begin(), result.end(), compare);
+    }
 
     return result;
   };
@@ -344,11 +554,27 @@ void coalesce(
   vector<internal::Range> ranges;
   ranges.reserve(rangesSum);
 
-  // Merges ranges into a vector.
-  auto fill = [&ranges](const Value::Ranges& inputs) {
+  // Merges ranges into a vector. As long as all the inputs are sorted
+  // (e.g., coalesced) we merge them in linear time, which lets
+  // `internal::coalesce` skip sorting the vector.
+  bool sorted = true;
+  auto fill = [&ranges, &sorted](const Value::Ranges& inputs) {
+    const size_t size = ranges.size();
+
     foreach (const Value::Range& range, inputs.range()) {
       ranges.push_back({range.begin(), range.end()});
     }
+
+    sorted = sorted && std::is_sorted(
+        ranges.begin() + size, ranges.end(), internal::compareRanges);
+
+    if (sorted) {
+      std::inplace_merge(
+          ranges.begin(),
+          ranges.begin() + size,
+          ranges.end(),
+          internal::compareRanges);
+    }
   };
 
   // Merge both ranges into the vector;
@@ -394,55 +620,50 @@ ostream& operator<<(ostream& stream, const Value::Ranges& ranges)
 
 bool operator==(const Value::Ranges& _left, const Value::Ranges& _right)
 {
-  Value::Ranges left;
-  coalesce(&left, {_left});
+  Value::Ranges leftStorage;
+  const Value::Ranges& left = internal::coalesced(_left, &leftStorage);
 
-  Value::Ranges right;
-  coalesce(&right, {_right});
+  Value::Ranges rightStorage;
+  const Value::Ranges& right = internal::coalesced(_right, &rightStorage);
 
-  if (left.range_size() == right.range_size()) {
-    for (int i = 0; i < left.range_size(); i++) {
-      // Make sure this range is equal to a range in the right.
-      bool found = false;
-      for (int j = 0; j < right.range_size(); j++) {
-        if (left.range(i).begin() == right.range(j).begin() &&
-            left.range(i).end() == right.range(j).end()) {
-          found = true;
-          break;
-        }
-      }
+  // Coalesced ranges are sorted, so we can compare them pairwise.
+  if (left.range_size() != right.range_size()) {
+    return false;
+  }
 
-      if (!found) {
-        return false;
-      }
+  for (int i = 0; i < left.range_size(); i++) {
+    if (left.range(i).begin() != right.range(i).begin() ||
+        left.range(i).end() != right.range(i).end()) {
+      return false;
     }
-
-    return true;
   }
 
-  return false;
+  return true;
 }
 
 
-bool operator<=(const Value::Ranges& _left, const Value::Ranges& _right)
+bool operator<=(const Value::Ranges& left, const Value::Ranges& _right)
 {
-  Value::Ranges left;
-  coalesce(&left, {_left});
+  Value::Ranges rightStorage;
+  const Value::Ranges& right = internal::coalesced(_right, &rightStorage);
 
-  Value::Ranges right;
-  coalesce(&right, {_right});
+  // NOTE: There is no need to coalesce `left`: since the ranges in
+  // `right` neither overlap nor are adjacent, each range in `left` is
+  // contained in `right` iff it is a subset of a single range in it.
+  foreach (const Value::Range& range, left.range()) {
+    // The only range in `right` that can contain `range` is the first
+    // one that ends at or after its beginning.
+    auto candidate = std::lower_bound(
+        right.range().begin(),
+        right.range().end(),
+        range.begin(),
+        [](const Value::Range& range, uint64_t begin) {
+          return range.end() < begin;
+        });
 
-  for (int i = 0; i < left.range_size(); i++) {
-    // Make sure this range is a subset of a range in right.
-    bool matched = false;
-    for (int j = 0; j < right.range_size(); j++) {
-      if (left.range(i).begin() >= right.range(j).begin() &&
-          left.range(i).end() <= right.range(j).end()) {
-        matched = true;
-        break;
-      }
-    }
-    if (!matched) {
+    if (candidate == right.range().end() ||
+        range.begin() < candidate->begin() ||
+        range.end() > candidate->end()) {
       return false;
     }
   }
@@ -451,24 +672,32 @@ bool operator<=(const Value::Ranges& _left, const Value::Ranges& _right)
 }
 
 
-// TODO(mzhu): Make this consistent with how we do subtraction.
 Value::Ranges operator+(const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges result;
-  coalesce(&result, {left, right});
+  Value::Ranges result = left;
+  result += right;
   return result;
 }
 
 
 Value::Ranges operator-(const Value::Ranges& left, const Value::Ranges& right)
 {
-  return internal::subtract(left, right);
+  Value::Ranges result = left;
+  result -= right;
+  return result;
 }
 
 
-// TODO(mzhu): Make this consistent with how we do subtraction.
 Value::Ranges& operator+=(Value::Ranges& left, const Value::Ranges& right)
 {
+  if (internal::inPlace(left, right)) {
+    foreach (const Value::Range& range, right.range()) {
+      internal::add(&left, {range.begin(), range.end()});
+    }
+
+    return left;
+  }
+
   coalesce(&left, {right});
   return left;
 }
@@ -476,6 +705,14 @@ Value::Ranges& operator+=(Value::Ranges& left, const Value::Ranges& right)
 
 Value::Ranges& operator-=(Value::Ranges& left, const Value::Ranges& right)
 {
+  if (internal::inPlace(left, right)) {
+    foreach (const Value::Range& range, right.range()) {
+      internal::subtract(&left, {range.begin(), range.end()});
+    }
+
+    return left;
+  }
+
   left = internal::subtract(left, right);
 
   return left;
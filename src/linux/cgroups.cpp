@@ -49,12 +49,14 @@ extern "C" {
 #include <process/process.hpp>
 #include <process/reap.hpp>
 
+#include <stout/cpp17.hpp>
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
+#include <stout/numify.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
@@ -1675,24 +1677,37 @@ Try<hashmap<string, uint64_t>> stat(
 
   hashmap<string, uint64_t> result;
 
-  foreach (const string& line, strings::split(contents.get(), "\n")) {
+  // NOTE: This is called for every container on every resource usage
+  // poll, so we parse using views into 'contents' to avoid allocating
+  // a string for every line and field.
+  cpp17::string_view remaining = contents.get();
+  Option<cpp17::string_view> line;
+
+  while ((line = strings::view::next(&remaining, "\n")).isSome()) {
     // Skip empty lines.
-    if (strings::trim(line).empty()) {
+    if (strings::view::trim(line.get()).empty()) {
       continue;
     }
 
-    string name;
-    uint64_t value;
-
     // Expected line format: "%s %llu".
-    istringstream stream(line);
-    stream >> name >> value;
+    cpp17::string_view fields = line.get();
+    Option<cpp17::string_view> name =
+      strings::view::next(&fields, strings::WHITESPACE);
+    Option<cpp17::string_view> value =
+      strings::view::next(&fields, strings::WHITESPACE);
+
+    if (name.isNone() || value.isNone()) {
+      return Error(
+          "Unexpected line format in " + file + ": " + string(line.get()));
+    }
 
-    if (stream.fail()) {
-      return Error("Unexpected line format in " + file + ": " + line);
+    Try<uint64_t> number = numify<uint64_t>(value.get());
+    if (number.isError()) {
+      return Error(
+          "Unexpected line format in " + file + ": " + string(line.get()));
     }
 
-    result[name] = value;
+    result[string(name.get())] = number.get();
   }
 
   return result;
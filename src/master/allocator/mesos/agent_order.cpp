@@ -0,0 +1,195 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "master/allocator/mesos/agent_order.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/strings.hpp>
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+constexpr size_t AgentOrder::RESOURCES;
+
+
+AgentOrder::Quantities AgentOrder::quantities(const Resources& resources)
+{
+  Quantities result = {};
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() != Value::SCALAR) {
+      continue;
+    }
+
+    const string& name = resource.name();
+    const double value = resource.scalar().value();
+
+    if (name == "cpus") {
+      result[0] += value;
+    } else if (name == "mem") {
+      result[1] += value;
+    } else if (name == "disk") {
+      result[2] += value;
+    } else if (name == "gpus") {
+      result[3] += value;
+    }
+  }
+
+  return result;
+}
+
+
+Try<AgentOrder> AgentOrder::parse(const string& value)
+{
+  AgentOrder order;
+
+  if (value == "random") {
+    order.policy_ = RANDOM;
+  } else if (value == "binpack") {
+    order.policy_ = BINPACK;
+  } else if (value == "spread") {
+    order.policy_ = SPREAD;
+  } else if (strings::startsWith(value, "attribute:")) {
+    order.policy_ = ATTRIBUTE;
+    order.attribute_ = strings::remove(value, "attribute:", strings::PREFIX);
+
+    if (order.attribute_.empty()) {
+      return Error("Expected an attribute name after 'attribute:'");
+    }
+  } else {
+    return Error(
+        "Unknown agent order '" + value + "': expected one of"
+        " [random, binpack, spread, attribute:<NAME>]");
+  }
+
+  return order;
+}
+
+
+void AgentOrder::sort(
+    vector<SlaveID>* agents,
+    const vector<double>& available,
+    const vector<double>& total,
+    const vector<Option<string>>& localities) const
+{
+  CHECK_NOTNULL(agents);
+
+  const size_t count = agents->size();
+
+  // We sort the positions of the agents rather than the agents, so
+  // that the inputs can be indexed while sorting. Shuffling them first
+  // breaks the ties between the agents randomly.
+  vector<size_t> positions(count);
+  for (size_t i = 0; i < count; ++i) {
+    positions[i] = i;
+  }
+
+  std::random_shuffle(positions.begin(), positions.end());
+
+  switch (policy_) {
+    case RANDOM: {
+      break;
+    }
+    case BINPACK:
+    case SPREAD: {
+      CHECK_EQ(count * RESOURCES, available.size());
+      CHECK_EQ(count * RESOURCES, total.size());
+
+      // An agent is scored by the allocated fraction of its most
+      // allocated resource, like a dominant share. This is a tight loop
+      // over the packed quantities which the compiler can vectorize.
+      vector<double> scores(count);
+
+      for (size_t i = 0; i < count; ++i) {
+        const double* available_ = available.data() + i * RESOURCES;
+        const double* total_ = total.data() + i * RESOURCES;
+
+        double score = 0.0;
+        for (size_t j = 0; j < RESOURCES; ++j) {
+          const double allocated = total_[j] - available_[j];
+          score = std::max(
+              score, total_[j] > 0.0 ? allocated / total_[j] : 0.0);
+        }
+
+        scores[i] = score;
+      }
+
+      if (policy_ == BINPACK) {
+        std::stable_sort(
+            positions.begin(),
+            positions.end(),
+            [&scores](size_t left, size_t right) {
+              return scores[left] > scores[right];
+            });
+      } else {
+        std::stable_sort(
+            positions.begin(),
+            positions.end(),
+            [&scores](size_t left, size_t right) {
+              return scores[left] < scores[right];
+            });
+      }
+
+      break;
+    }
+    case ATTRIBUTE: {
+      CHECK_EQ(count, localities.size());
+
+      std::stable_sort(
+          positions.begin(),
+          positions.end(),
+          [&localities](size_t left, size_t right) {
+            const Option<string>& left_ = localities[left];
+            const Option<string>& right_ = localities[right];
+
+            if (left_.isNone() || right_.isNone()) {
+              return left_.isSome() && right_.isNone();
+            }
+
+            return left_.get() < right_.get();
+          });
+
+      break;
+    }
+  }
+
+  vector<SlaveID> result;
+  result.reserve(count);
+
+  foreach (size_t position, positions) {
+    result.push_back(std::move((*agents)[position]));
+  }
+
+  *agents = std::move(result);
+}
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,113 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_ALLOCATOR_MESOS_AGENT_ORDER_HPP__
+#define __MASTER_ALLOCATOR_MESOS_AGENT_ORDER_HPP__
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+// The order in which the hierarchical allocator considers the agents
+// in an allocation cycle. Since the allocator offers all the remaining
+// resources of an agent at once, this determines which agents the
+// frameworks that come first in the (DRF) sort order are offered, and
+// which agents are left over once the quota headroom is exhausted.
+//
+// The supported policies are:
+//
+//   random:           The agents are shuffled (the default).
+//
+//   binpack:          The most allocated agents come first, so that
+//                     allocations are packed onto as few agents as
+//                     possible and the remaining agents can be drained.
+//
+//   spread:           The least allocated agents come first, so that
+//                     allocations are spread across the agents.
+//
+//   attribute:<NAME>: The agents with the same value of the `NAME`
+//                     attribute (e.g. a rack) come one after the other,
+//                     so that the frameworks are offered agents that
+//                     are close to each other. The agents without the
+//                     attribute come last.
+//
+// Agents that compare equal under a policy are shuffled.
+class AgentOrder
+{
+public:
+  enum Policy
+  {
+    RANDOM,
+    BINPACK,
+    SPREAD,
+    ATTRIBUTE
+  };
+
+  // The number of scalar resources that agents are scored by, i.e.
+  // cpus, mem, disk and gpus.
+  static constexpr size_t RESOURCES = 4;
+
+  // The quantities of the scalar resources that agents are scored by.
+  // The allocator caches these for each agent, so that ordering the
+  // agents does not need to look at their `Resources`.
+  typedef std::array<double, RESOURCES> Quantities;
+
+  static Quantities quantities(const Resources& resources);
+
+  static Try<AgentOrder> parse(const std::string& value);
+
+  AgentOrder() : policy_(RANDOM) {}
+
+  Policy policy() const { return policy_; }
+
+  // The attribute that agents are grouped by, for `ATTRIBUTE`.
+  const std::string& attribute() const { return attribute_; }
+
+  // Reorders `agents` according to the policy.
+  //
+  // For `BINPACK` and `SPREAD`, `available` and `total` hold the
+  // `Quantities` of the available and total resources of each agent,
+  // packed one agent after the other. For `ATTRIBUTE`, `localities`
+  // holds the value of the attribute on each agent, if any. The inputs
+  // that the policy does not use may be empty.
+  void sort(
+      std::vector<SlaveID>* agents,
+      const std::vector<double>& available,
+      const std::vector<double>& total,
+      const std::vector<Option<std::string>>& localities) const;
+
+private:
+  Policy policy_;
+  std::string attribute_;
+};
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_ALLOCATOR_MESOS_AGENT_ORDER_HPP__
@@ -17,6 +17,7 @@
 #include "master/allocator/mesos/hierarchical.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <set>
 #include <string>
 #include <utility>
@@ -27,21 +28,30 @@
 #include <mesos/type_utils.hpp>
 
 #include <process/after.hpp>
+#include <process/clock.hpp>
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/event.hpp>
+#include <process/help.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/loop.hpp>
+#include <process/time.hpp>
 #include <process/timeout.hpp>
 
 #include <stout/check.hpp>
 #include <stout/hashset.hpp>
+#include <stout/json.hpp>
+#include <stout/numify.hpp>
 #include <stout/set.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
 #include "common/protobuf_utils.hpp"
+#include "common/resource_quantities.hpp"
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -49,14 +59,22 @@ using std::vector;
 using mesos::allocator::InverseOfferStatus;
 
 using process::after;
+using process::AUTHENTICATION;
+using process::Clock;
 using process::Continue;
 using process::ControlFlow;
+using process::DESCRIPTION;
 using process::Failure;
 using process::Future;
+using process::HELP;
 using process::loop;
 using process::Owned;
 using process::PID;
+using process::Time;
 using process::Timeout;
+using process::TLDR;
+
+using process::http::authentication::Principal;
 
 
 namespace mesos {
@@ -143,8 +161,19 @@ HierarchicalAllocatorProcess::Framework::Framework(
     metrics(new FrameworkMetrics(frameworkInfo)) {}
 
 
+HierarchicalAllocatorProcess::~HierarchicalAllocatorProcess()
+{
+  foreachvalue (const vector<ExpiringOfferFilter>& expiring,
+                offerFilterExpiry) {
+    foreach (const ExpiringOfferFilter& expiringOfferFilter, expiring) {
+      delete expiringOfferFilter.offerFilter;
+    }
+  }
+}
+
+
 void HierarchicalAllocatorProcess::initialize(
-    const Duration& _allocationInterval,
+    const mesos::allocator::Options& options,
     const lambda::function<
         void(const FrameworkID&,
              const hashmap<string, hashmap<SlaveID, Resources>>&)>&
@@ -152,26 +181,52 @@ void HierarchicalAllocatorProcess::initialize(
     const lambda::function<
         void(const FrameworkID&,
              const hashmap<SlaveID, UnavailableResources>&)>&
-      _inverseOfferCallback,
-    const Option<set<string>>& _fairnessExcludeResourceNames,
-    bool _filterGpuResources,
-    const Option<DomainInfo>& _domain,
-    const Option<std::vector<Resources>>& _minAllocatableResources,
-    const size_t maxCompletedFrameworks)
-{
-  allocationInterval = _allocationInterval;
+      _inverseOfferCallback)
+{
+  CHECK_GT(options.offerFilterParallelism, 0u);
+  CHECK(options.allocationBatchSize.getOrElse(1) > 0);
+
+  allocationInterval = options.allocationInterval;
+  allocationSweepInterval = options.allocationSweepInterval;
   offerCallback = _offerCallback;
   inverseOfferCallback = _inverseOfferCallback;
-  fairnessExcludeResourceNames = _fairnessExcludeResourceNames;
-  filterGpuResources = _filterGpuResources;
-  domain = _domain;
-  minAllocatableResources = _minAllocatableResources;
+  fairnessExcludeResourceNames = options.fairnessExcludeResourceNames;
+  filterGpuResources = options.filterGpuResources;
+  domain = options.domain;
+  minAllocatableResources = options.minAllocatableResources;
+  offerFilterParallelism = options.offerFilterParallelism;
+
+  // The allocator's thread evaluates offer filters as well, so the
+  // pool only needs the additional threads.
+  if (offerFilterParallelism > 1) {
+    offerFilterWorkers.reset(new WorkerPool(offerFilterParallelism - 1));
+  }
+  agentOrder = CHECK_NOTERROR(AgentOrder::parse(options.agentOrder));
+  allocationBatchSize = options.allocationBatchSize;
   initialized = true;
   paused = false;
 
+  if (options.recordPath.isSome()) {
+    Try<Owned<Recorder>> create =
+      Recorder::create(options.recordPath.get(), options.recordMaxSize);
+
+    if (create.isError()) {
+      LOG(ERROR) << "Not recording the allocator: " << create.error();
+    } else {
+      recorder = create.get();
+      recorder->initialize(options);
+    }
+  }
+
+  route(
+      "/profile",
+      options.authenticationRealm,
+      profileHelp(),
+      &HierarchicalAllocatorProcess::profile);
+
   completedFrameworkMetrics =
     BoundedHashMap<FrameworkID, process::Owned<FrameworkMetrics>>(
-        maxCompletedFrameworks);
+        options.maxCompletedFrameworks);
 
   // Resources for quota'ed roles are allocated separately and prior to
   // non-quota'ed roles, hence a dedicated sorter for quota'ed roles is
@@ -181,8 +236,11 @@ void HierarchicalAllocatorProcess::initialize(
 
   VLOG(1) << "Initialized hierarchical allocator process";
 
+  nextAllocationSweep = Clock::now();
+
   // Start a loop to run allocation periodically.
   PID<HierarchicalAllocatorProcess> _self = self();
+  const Duration _allocationInterval = allocationInterval;
 
   loop(
       None(), // Use `None` so we iterate outside the allocator process.
@@ -190,7 +248,7 @@ void HierarchicalAllocatorProcess::initialize(
         return after(_allocationInterval);
       },
       [_self](const Nothing&) {
-        return dispatch(_self, &HierarchicalAllocatorProcess::allocate)
+        return dispatch(_self, &HierarchicalAllocatorProcess::periodicAllocate)
           .then([]() -> ControlFlow<Nothing> { return Continue(); });
       });
 }
@@ -206,6 +264,10 @@ void HierarchicalAllocatorProcess::recover(
   CHECK_EQ(0u, quotaRoleSorter->count());
   CHECK(_expectedAgentCount >= 0);
 
+  if (recorder.get() != nullptr) {
+    recorder->recover(_expectedAgentCount, quotas);
+  }
+
   // If there is no quota, recovery is a no-op. Otherwise, we need
   // to delay allocations while agents are reregistering because
   // otherwise we perform allocations on a partial view of resources!
@@ -223,9 +285,10 @@ void HierarchicalAllocatorProcess::recover(
     return;
   }
 
-  // NOTE: `quotaRoleSorter` is updated implicitly in `setQuota()`.
+  // NOTE: `quotaRoleSorter` is updated implicitly in `_setQuota()`.
+  // The quotas were recorded above, so we bypass `setQuota()`.
   foreachpair (const string& role, const Quota& quota, quotas) {
-    setQuota(role, quota);
+    _setQuota(role, quota);
   }
 
   // TODO(alexr): Consider exposing these constants.
@@ -270,6 +333,11 @@ void HierarchicalAllocatorProcess::addFramework(
   CHECK(initialized);
   CHECK(!frameworks.contains(frameworkId));
 
+  if (recorder.get() != nullptr) {
+    recorder->addFramework(
+        frameworkId, frameworkInfo, used, active, suppressedRoles);
+  }
+
   frameworks.insert(
       {frameworkId, Framework(frameworkInfo, suppressedRoles, active)});
 
@@ -289,6 +357,8 @@ void HierarchicalAllocatorProcess::addFramework(
     }
   }
 
+  ++offerFiltersEpoch;
+
   // Update the allocation for this framework.
   foreachpair (const SlaveID& slaveId, const Resources& resources, used) {
     // TODO(bmahler): The master won't tell us about resources
@@ -319,6 +389,10 @@ void HierarchicalAllocatorProcess::removeFramework(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId)) << frameworkId;
 
+  if (recorder.get() != nullptr) {
+    recorder->removeFramework(frameworkId);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
 
   foreach (const string& role, framework.roles) {
@@ -366,6 +440,10 @@ void HierarchicalAllocatorProcess::activateFramework(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId));
 
+  if (recorder.get() != nullptr) {
+    recorder->activateFramework(frameworkId);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
 
   framework.active = true;
@@ -383,6 +461,8 @@ void HierarchicalAllocatorProcess::activateFramework(
     }
   }
 
+  ++offerFiltersEpoch;
+
   LOG(INFO) << "Activated framework " << frameworkId;
 
   allocate();
@@ -395,6 +475,10 @@ void HierarchicalAllocatorProcess::deactivateFramework(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId)) << frameworkId;
 
+  if (recorder.get() != nullptr) {
+    recorder->deactivateFramework(frameworkId);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
 
   foreach (const string& role, framework.roles) {
@@ -429,6 +513,10 @@ void HierarchicalAllocatorProcess::updateFramework(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId));
 
+  if (recorder.get() != nullptr) {
+    recorder->updateFramework(frameworkId, frameworkInfo, suppressedRoles);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
 
   set<string> oldRoles = framework.roles;
@@ -517,6 +605,12 @@ void HierarchicalAllocatorProcess::updateFramework(
   framework.roles = newRoles;
   framework.suppressedRoles = suppressedRoles;
   framework.capabilities = frameworkInfo.capabilities();
+
+  // The framework may now be offered resources in other roles, or
+  // resources that it was not capable of receiving before.
+  ++offerFiltersEpoch;
+
+  markAllAgentsChanged();
 }
 
 
@@ -533,6 +627,11 @@ void HierarchicalAllocatorProcess::addSlave(
   CHECK_EQ(slaveId, slaveInfo.id());
   CHECK(!paused || expectedAgentCount.isSome());
 
+  if (recorder.get() != nullptr) {
+    recorder->addSlave(
+        slaveId, slaveInfo, capabilities, unavailability, total, used);
+  }
+
   slaves.insert({slaveId,
                  Slave(
                      slaveInfo,
@@ -551,6 +650,9 @@ void HierarchicalAllocatorProcess::addSlave(
 
   trackReservations(total.reservations());
 
+  totalUnreservedNonRevocableScalarQuantities +=
+    ResourceQuantities::fromScalarResources(total.unreserved().nonRevocable());
+
   roleSorter->add(slaveId, total);
 
   // See comment at `quotaRoleSorter` declaration regarding non-revocable.
@@ -612,6 +714,10 @@ void HierarchicalAllocatorProcess::removeSlave(
   CHECK(initialized);
   CHECK(slaves.contains(slaveId));
 
+  if (recorder.get() != nullptr) {
+    recorder->removeSlave(slaveId);
+  }
+
   // TODO(bmahler): Per MESOS-621, this should remove the allocations
   // that any frameworks have on this slave. Otherwise the caller may
   // "leak" allocated resources accidentally if they forget to recover
@@ -626,13 +732,16 @@ void HierarchicalAllocatorProcess::removeSlave(
 
   untrackReservations(slaves.at(slaveId).getTotal().reservations());
 
+  totalUnreservedNonRevocableScalarQuantities -=
+    ResourceQuantities::fromScalarResources(
+        slaves.at(slaveId).getTotal().unreserved().nonRevocable());
+
   slaves.erase(slaveId);
   allocationCandidates.erase(slaveId);
+  heldBackAgents.erase(slaveId);
 
   // Note that we DO NOT actually delete any filters associated with
-  // this slave, that will occur when the delayed
-  // HierarchicalAllocatorProcess::expire gets invoked (or the framework
-  // that applied the filters gets removed).
+  // this slave, that will occur when the filters expire.
 
   LOG(INFO) << "Removed agent " << slaveId;
 }
@@ -648,6 +757,10 @@ void HierarchicalAllocatorProcess::updateSlave(
   CHECK(slaves.contains(slaveId));
   CHECK_EQ(slaveId, info.id());
 
+  if (recorder.get() != nullptr) {
+    recorder->updateSlave(slaveId, info, total, capabilities);
+  }
+
   Slave& slave = slaves.at(slaveId);
 
   bool updated = false;
@@ -686,6 +799,8 @@ void HierarchicalAllocatorProcess::updateSlave(
     if (newCapabilities != oldCapabilities) {
       updated = true;
 
+      slave.allFilteredEpoch = None();
+
       LOG(INFO) << "Agent " << slaveId << " (" << slave.info.hostname() << ")"
                 << " updated with capabilities " << slave.capabilities;
     }
@@ -737,6 +852,8 @@ void HierarchicalAllocatorProcess::addResourceProvider(
   updateSlaveTotal(slaveId, slave.getTotal() + total);
   slave.allocate(Resources::sum(used));
 
+  markAgentChanged(slaveId);
+
   VLOG(1)
     << "Grew agent " << slaveId << " by "
     << total << " (total), "
@@ -768,6 +885,12 @@ void HierarchicalAllocatorProcess::removeFilters(const SlaveID& slaveId)
     }
   }
 
+  // Since suppressed roles may have been revived above,
+  // this affects the frameworks' filters on all agents.
+  ++offerFiltersEpoch;
+
+  markAllAgentsChanged();
+
   LOG(INFO) << "Removed all filters for agent " << slaveId;
 }
 
@@ -778,8 +901,14 @@ void HierarchicalAllocatorProcess::activateSlave(
   CHECK(initialized);
   CHECK(slaves.contains(slaveId));
 
+  if (recorder.get() != nullptr) {
+    recorder->activateSlave(slaveId);
+  }
+
   slaves.at(slaveId).activated = true;
 
+  markAgentChanged(slaveId);
+
   LOG(INFO) << "Agent " << slaveId << " reactivated";
 }
 
@@ -790,6 +919,10 @@ void HierarchicalAllocatorProcess::deactivateSlave(
   CHECK(initialized);
   CHECK(slaves.contains(slaveId));
 
+  if (recorder.get() != nullptr) {
+    recorder->deactivateSlave(slaveId);
+  }
+
   slaves.at(slaveId).activated = false;
 
   LOG(INFO) << "Agent " << slaveId << " deactivated";
@@ -803,6 +936,8 @@ void HierarchicalAllocatorProcess::updateWhitelist(
 
   whitelist = _whitelist;
 
+  markAllAgentsChanged();
+
   if (whitelist.isSome()) {
     LOG(INFO) << "Updated agent whitelist: " << stringify(whitelist.get());
 
@@ -876,6 +1011,28 @@ void HierarchicalAllocatorProcess::updateAllocation(
   slave.unallocate(offeredResources);
   slave.allocate(updatedOfferedResources);
 
+  markAgentChanged(slaveId);
+
+  // Update the unreserved allocation, e.g., for reservations made on
+  // the offered resources. The changes to the reservations themselves
+  // are tracked when updating the agent's total below.
+  const ResourceQuantities unreservedQuantities =
+    ResourceQuantities::fromScalarResources(
+        offeredResources.unreserved().nonRevocable());
+
+  const ResourceQuantities updatedUnreservedQuantities =
+    ResourceQuantities::fromScalarResources(
+        updatedOfferedResources.unreserved().nonRevocable());
+
+  if (unreservedQuantities != updatedUnreservedQuantities) {
+    allocatedUnreservedNonRevocableScalarQuantities -= unreservedQuantities;
+    allocatedUnreservedNonRevocableScalarQuantities +=
+      updatedUnreservedQuantities;
+
+    untrackConsumedQuota(role, unreservedQuantities);
+    trackConsumedQuota(role, updatedUnreservedQuantities);
+  }
+
   // Update the allocation in the framework sorter.
   frameworkSorter->update(
       frameworkId.value(),
@@ -957,12 +1114,12 @@ void HierarchicalAllocatorProcess::updateAllocation(
   //
   // TODO(chhsiao): Revisit this constraint if we want to support other type of
   // resource conversions. See MESOS-9015.
-  const Resources removedAllocationQuantities =
-    frameworkAllocation.createStrippedScalarQuantity() -
-    updatedFrameworkAllocation.createStrippedScalarQuantity();
+  const ResourceQuantities removedAllocationQuantities =
+    ResourceQuantities::fromScalarResources(frameworkAllocation) -
+    ResourceQuantities::fromScalarResources(updatedFrameworkAllocation);
   CHECK_EQ(
       removedAllocationQuantities,
-      removedResources.createStrippedScalarQuantity());
+      ResourceQuantities::fromScalarResources(removedResources));
 
   LOG(INFO) << "Updated allocation of framework " << frameworkId
             << " on agent " << slaveId
@@ -1011,6 +1168,8 @@ Future<Nothing> HierarchicalAllocatorProcess::updateAvailable(
   // Update the total resources in the allocator and role and quota sorters.
   updateSlaveTotal(slaveId, updatedTotal.get());
 
+  markAgentChanged(slaveId);
+
   return Nothing();
 }
 
@@ -1080,6 +1239,8 @@ void HierarchicalAllocatorProcess::updateInverseOffer(
     // out the next time we schedule inverse offers.
     maintenance.offersOutstanding.erase(frameworkId);
 
+    markAgentChanged(slaveId);
+
     // If the response is `Some`, this means the framework responded. Otherwise
     // if it is `None` the inverse offer timed out or was rescinded.
     if (status.isSome()) {
@@ -1138,17 +1299,10 @@ void HierarchicalAllocatorProcess::updateInverseOffer(
 
     framework.inverseOfferFilters[slaveId].insert(inverseOfferFilter);
 
-    // We need to disambiguate the function call to pick the correct
-    // `expire()` overload.
-    void (Self::*expireInverseOffer)(
-             const FrameworkID&,
-             const SlaveID&,
-             InverseOfferFilter*) = &Self::expire;
-
     delay(
         timeout.get(),
         self(),
-        expireInverseOffer,
+        &Self::expire,
         frameworkId,
         slaveId,
         inverseOfferFilter);
@@ -1182,6 +1336,10 @@ void HierarchicalAllocatorProcess::recoverResources(
 {
   CHECK(initialized);
 
+  if (recorder.get() != nullptr) {
+    recorder->recoverResources(frameworkId, slaveId, resources, filters);
+  }
+
   if (resources.empty()) {
     return;
   }
@@ -1233,6 +1391,8 @@ void HierarchicalAllocatorProcess::recoverResources(
 
     slave.unallocate(resources);
 
+    markAgentChanged(slaveId);
+
     VLOG(1) << "Recovered " << resources
             << " (total: " << slave.getTotal()
             << ", allocated: " << slave.getAllocated() << ")"
@@ -1297,29 +1457,28 @@ void HierarchicalAllocatorProcess::recoverResources(
     // expire before we perform the next allocation for this agent,
     // see MESOS-4302 for more information.
     //
-    // Because the next periodic allocation goes through a dispatch
-    // after `allocationInterval`, we do the same for `expire()`
-    // (with a helper `_expire()`) to achieve the above.
+    // The filter is expired in a batch with all the filters that
+    // expire by its deadline (see `offerFilterExpiry`). Because the
+    // next periodic allocation goes through a dispatch after
+    // `allocationInterval`, `expireOfferFilters()` also dispatches
+    // (to `_expireOfferFilters()`) to achieve the above.
     //
     // TODO(alexr): If we allocated upon resource recovery
     // (MESOS-3078), we would not need to increase the timeout here.
     timeout = std::max(allocationInterval, timeout.get());
 
-    // We need to disambiguate the function call to pick the correct
-    // `expire()` overload.
-    void (Self::*expireOffer)(
-        const FrameworkID&,
-        const string&,
-        const SlaveID&,
-        OfferFilter*) = &Self::expire;
+    const Time deadline = Clock::now() + timeout.get();
+
+    offerFilterExpiry[deadline].push_back(
+        ExpiringOfferFilter{frameworkId, role, slaveId, offerFilter});
+
+    // We only need a new timer if the filter expires before all the
+    // filters that we already have timers for.
+    if (offerFilterTimers.empty() || deadline < *offerFilterTimers.begin()) {
+      offerFilterTimers.insert(deadline);
 
-    delay(timeout.get(),
-          self(),
-          expireOffer,
-          frameworkId,
-          role,
-          slaveId,
-          offerFilter);
+      delay(timeout.get(), self(), &Self::expireOfferFilters, deadline);
+    }
   }
 }
 
@@ -1331,6 +1490,10 @@ void HierarchicalAllocatorProcess::suppressOffers(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId));
 
+  if (recorder.get() != nullptr) {
+    recorder->suppressOffers(frameworkId, roles_);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
 
   // Deactivating the framework in the sorter is fine as long as
@@ -1358,6 +1521,10 @@ void HierarchicalAllocatorProcess::reviveOffers(
   CHECK(initialized);
   CHECK(frameworks.contains(frameworkId));
 
+  if (recorder.get() != nullptr) {
+    recorder->reviveOffers(frameworkId, roles_);
+  }
+
   Framework& framework = frameworks.at(frameworkId);
   framework.offerFilters.clear();
   framework.inverseOfferFilters.clear();
@@ -1375,12 +1542,14 @@ void HierarchicalAllocatorProcess::reviveOffers(
     framework.metrics->reviveRole(role);
   }
 
-  // We delete each actual `OfferFilter` when
+  ++offerFiltersEpoch;
+
+  // We delete each actual `OfferFilter` when it expires (see
+  // `offerFilterExpiry`) and each `InverseOfferFilter` when
   // `HierarchicalAllocatorProcess::expire` gets invoked. If we delete the
-  // `OfferFilter` here it's possible that the same `OfferFilter` (i.e., same
-  // address) could get reused and `HierarchicalAllocatorProcess::expire`
-  // would expire that filter too soon. Note that this only works
-  // right now because ALL Filter types "expire".
+  // filters here it's possible that the same filter (i.e., same address)
+  // could get reused and would be expired too soon. Note that this only
+  // works right now because ALL Filter types "expire".
 
   LOG(INFO) << "Revived offers for roles " << stringify(roles)
             << " of framework " << frameworkId;
@@ -1395,6 +1564,18 @@ void HierarchicalAllocatorProcess::setQuota(
 {
   CHECK(initialized);
 
+  if (recorder.get() != nullptr) {
+    recorder->setQuota(role, quota);
+  }
+
+  _setQuota(role, quota);
+}
+
+
+void HierarchicalAllocatorProcess::_setQuota(
+    const string& role,
+    const Quota& quota)
+{
   // This method should be called by the master only if the quota for
   // the role is not set. Setting quota differs from updating it because
   // the former moves the role to a different allocation group with a
@@ -1407,6 +1588,14 @@ void HierarchicalAllocatorProcess::setQuota(
   quotaRoleSorter->add(role);
   quotaRoleSorter->activate(role);
 
+  const ResourceQuantities& guarantee =
+    quotaGuaranteeScalarQuantities[role] =
+      ResourceQuantities::fromScalarResources(quota.info.guarantee());
+
+  requiredHeadroom +=
+    guarantee -
+    consumedQuotaScalarQuantities.get(role).getOrElse(ResourceQuantities());
+
   // Copy allocation information for the quota'ed role.
   if (roleSorter->contains(role)) {
     foreachpair (
@@ -1430,6 +1619,7 @@ void HierarchicalAllocatorProcess::setQuota(
   //
   // If we add the ability for quota changes to incur a rebalancing
   // of offered resources, then we should trigger that here.
+  markAllAgentsChanged();
 }
 
 
@@ -1442,6 +1632,10 @@ void HierarchicalAllocatorProcess::removeQuota(
   CHECK(quotas.contains(role));
   CHECK(quotaRoleSorter->contains(role));
 
+  if (recorder.get() != nullptr) {
+    recorder->removeQuota(role);
+  }
+
   // TODO(alexr): Print all quota info for the role.
   LOG(INFO) << "Removed quota " << quotas[role].info.guarantee()
             << " for role '" << role << "'";
@@ -1450,6 +1644,18 @@ void HierarchicalAllocatorProcess::removeQuota(
   quotas.erase(role);
   quotaRoleSorter->remove(role);
 
+  CHECK(quotaGuaranteeScalarQuantities.contains(role));
+
+  requiredHeadroom -=
+    quotaGuaranteeScalarQuantities.at(role) -
+    consumedQuotaScalarQuantities.get(role).getOrElse(ResourceQuantities());
+
+  quotaGuaranteeScalarQuantities.erase(role);
+
+  // The frameworks in the role are now allocated resources in the
+  // second stage, where agents are skipped if they are all filtered.
+  ++offerFiltersEpoch;
+
   metrics.removeQuota(role);
 
   // NOTE: Since quota changes do not result in rebalancing of
@@ -1458,6 +1664,7 @@ void HierarchicalAllocatorProcess::removeQuota(
   //
   // If we add the ability for quota changes to incur a rebalancing
   // of offered resources, then we should trigger that here.
+  markAllAgentsChanged();
 }
 
 
@@ -1466,6 +1673,10 @@ void HierarchicalAllocatorProcess::updateWeights(
 {
   CHECK(initialized);
 
+  if (recorder.get() != nullptr) {
+    recorder->updateWeights(weightInfos);
+  }
+
   foreach (const WeightInfo& weightInfo, weightInfos) {
     CHECK(weightInfo.has_role());
 
@@ -1479,6 +1690,7 @@ void HierarchicalAllocatorProcess::updateWeights(
   //
   // If we add the ability for weight changes to incur a rebalancing
   // of offered resources, then we should trigger that here.
+  markAllAgentsChanged();
 }
 
 
@@ -1498,6 +1710,10 @@ void HierarchicalAllocatorProcess::resume()
     VLOG(1) << "Allocation resumed";
 
     paused = false;
+
+    // The allocations that were skipped while paused did not
+    // keep track of the agents that they were triggered for.
+    markAllAgentsChanged();
   }
 }
 
@@ -1530,13 +1746,62 @@ Future<Nothing> HierarchicalAllocatorProcess::allocate(
   if (allocation.isNone() || !allocation->isPending()) {
     metrics.allocation_run_latency.start();
     allocation = dispatch(self(), &Self::_allocate);
+  } else if (allocationCycle.isSome()) {
+    // The run in progress may already have passed these agents, so we
+    // follow it with another run, see `continueAllocation()`.
+    allocationRequested = true;
   }
 
   return allocation.get();
 }
 
 
-Nothing HierarchicalAllocatorProcess::_allocate()
+Future<Nothing> HierarchicalAllocatorProcess::periodicAllocate()
+{
+  if (allocationSweepInterval.isNone() ||
+      allocationSweepRequired ||
+      Clock::now() >= nextAllocationSweep) {
+    if (allocationSweepInterval.isSome()) {
+      allocationSweepRequired = false;
+      nextAllocationSweep = Clock::now() + allocationSweepInterval.get();
+    }
+
+    return allocate();
+  }
+
+  // Only allocate from the agents that changed since the last
+  // allocation, i.e. the current allocation candidates, and from the
+  // agents that had resources held back for the quota headroom. Most
+  // of the time, when nothing changed, this does not run an allocation.
+  if (allocationCandidates.empty() && heldBackAgents.empty()) {
+    return Nothing();
+  }
+
+  return allocate(heldBackAgents);
+}
+
+
+void HierarchicalAllocatorProcess::markAgentChanged(const SlaveID& slaveId)
+{
+  // NOTE: Without a sweep interval, all the agents are allocation
+  // candidates of the next periodic allocation anyway, and we do not
+  // want the changed agents to become candidates of an allocation
+  // that is triggered for other agents in the meantime.
+  if (allocationSweepInterval.isSome()) {
+    allocationCandidates.insert(slaveId);
+  }
+}
+
+
+void HierarchicalAllocatorProcess::markAllAgentsChanged()
+{
+  if (allocationSweepInterval.isSome()) {
+    allocationSweepRequired = true;
+  }
+}
+
+
+Future<Nothing> HierarchicalAllocatorProcess::_allocate()
 {
   metrics.allocation_run_latency.stop();
 
@@ -1546,26 +1811,155 @@ Nothing HierarchicalAllocatorProcess::_allocate()
     return Nothing();
   }
 
+  CHECK_NONE(allocationCycle);
+
   ++metrics.allocation_runs;
 
-  Stopwatch stopwatch;
-  stopwatch.start();
+  allocationCycle = AllocationCycle();
+  allocationCycle->stopwatch.start();
   metrics.allocation_run.start();
 
+  AllocationProfile& profile = allocationCycle->profile;
+  profile.start = Clock::now();
+  profile.candidates = allocationCandidates.size();
+
+  // NOTE: This function can operate on a small subset of
+  // `allocationCandidates`, we have to make sure that we don't
+  // assume cluster knowledge when summing resources from that set.
+
+  vector<SlaveID>& slaveIds = allocationCycle->slaveIds;
+  slaveIds.reserve(allocationCandidates.size());
+
+  // Filter out non-whitelisted, removed, and deactivated slaves
+  // in order not to send offers for them.
+  foreach (const SlaveID& slaveId, allocationCandidates) {
+    // The agent is added back below if resources are still held back.
+    heldBackAgents.erase(slaveId);
+
+    if (isWhitelisted(slaveId) &&
+        slaves.contains(slaveId) &&
+        slaves.at(slaveId).activated) {
+      slaveIds.push_back(slaveId);
+    }
+  }
+
+  // Order the agents according to the configured policy. The inputs of
+  // the policy are packed into arrays, which keeps the ordering cheap
+  // even with many agents.
+  vector<double> availableQuantities;
+  vector<double> totalQuantities;
+  vector<Option<string>> localities;
+
+  switch (agentOrder.policy()) {
+    case AgentOrder::RANDOM: {
+      break;
+    }
+    case AgentOrder::BINPACK:
+    case AgentOrder::SPREAD: {
+      availableQuantities.reserve(slaveIds.size() * AgentOrder::RESOURCES);
+      totalQuantities.reserve(slaveIds.size() * AgentOrder::RESOURCES);
+
+      foreach (const SlaveID& slaveId, slaveIds) {
+        const Slave& slave = slaves.at(slaveId);
+
+        availableQuantities.insert(
+            availableQuantities.end(),
+            slave.getAvailableQuantities().begin(),
+            slave.getAvailableQuantities().end());
+
+        totalQuantities.insert(
+            totalQuantities.end(),
+            slave.getTotalQuantities().begin(),
+            slave.getTotalQuantities().end());
+      }
+
+      break;
+    }
+    case AgentOrder::ATTRIBUTE: {
+      localities.reserve(slaveIds.size());
+
+      foreach (const SlaveID& slaveId, slaveIds) {
+        Option<string> locality;
+
+        foreach (const Attribute& attribute,
+                 slaves.at(slaveId).info.attributes()) {
+          if (attribute.name() == agentOrder.attribute()) {
+            locality = stringify(attribute);
+            break;
+          }
+        }
+
+        localities.push_back(std::move(locality));
+      }
+
+      break;
+    }
+  }
+
+  agentOrder.sort(&slaveIds, availableQuantities, totalQuantities, localities);
+
+  profile.agents = slaveIds.size();
+  profile.filterCandidates = allocationCycle->stopwatch.elapsed();
+
+  // Clear the candidates on the start of the allocation run. The agents
+  // that become candidates while the run is in progress are allocated
+  // from by a later run.
+  allocationCycle->candidates = std::move(allocationCandidates);
+  allocationCandidates.clear();
+
+  return continueAllocation();
+}
+
+
+Future<Nothing> HierarchicalAllocatorProcess::continueAllocation()
+{
+  CHECK_SOME(allocationCycle);
+
   __allocate();
 
+  if (allocationCycle->position < 2 * allocationCycle->slaveIds.size()) {
+    // Let the calls that were made into the allocator meanwhile (e.g.,
+    // to recover resources) be handled before the next batch.
+    return dispatch(self(), &Self::continueAllocation);
+  }
+
   // NOTE: For now, we implement maintenance inverse offers within the
   // allocator. We leverage the existing timer/cycle of offers to also do any
   // "deallocation" (inverse offers) necessary to satisfy maintenance needs.
-  deallocate();
+  AllocationProfile& profile = allocationCycle->profile;
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  deallocate(allocationCycle->candidates);
+
+  profile.deallocate = stopwatch.elapsed();
 
   metrics.allocation_run.stop();
 
-  VLOG(1) << "Performed allocation for " << allocationCandidates.size()
-          << " agents in " << stopwatch.elapsed();
+  // Write the events that led to this allocation out, so that a
+  // recording is complete up to the last allocation.
+  if (recorder.get() != nullptr) {
+    recorder->flush();
+  }
 
-  // Clear the candidates on completion of the allocation run.
-  allocationCandidates.clear();
+  profile.total = allocationCycle->stopwatch.elapsed();
+
+  metrics.allocationRun(profile);
+  allocationProfiles.push_back(profile);
+
+  VLOG(1) << "Performed allocation for "
+          << allocationCycle->candidates.size() << " agents in "
+          << profile.total;
+
+  allocationCycle = None();
+
+  if (allocationRequested) {
+    allocationRequested = false;
+
+    metrics.allocation_run_latency.start();
+    return dispatch(self(), &Self::_allocate);
+  }
 
   return Nothing();
 }
@@ -1574,52 +1968,38 @@ Nothing HierarchicalAllocatorProcess::_allocate()
 // TODO(alexr): Consider factoring out the quota allocation logic.
 void HierarchicalAllocatorProcess::__allocate()
 {
+  CHECK_SOME(allocationCycle);
+
+  const vector<SlaveID>& slaveIds = allocationCycle->slaveIds;
+
   // Compute the offerable resources, per framework:
   //   (1) For reserved resources on the slave, allocate these to a
   //       framework having the corresponding role.
   //   (2) For unreserved resources on the slave, allocate these
   //       to a framework of any role.
-  hashmap<FrameworkID, hashmap<string, hashmap<SlaveID, Resources>>> offerable;
+  hashmap<FrameworkID, hashmap<string, hashmap<SlaveID, Resources>>>&
+    offerable = allocationCycle->offerable;
 
-  // NOTE: This function can operate on a small subset of
-  // `allocationCandidates`, we have to make sure that we don't
-  // assume cluster knowledge when summing resources from that set.
+  // The positions of the agents of this batch, see `AllocationCycle`.
+  const size_t first = allocationCycle->position;
+  const size_t last = first + std::min(
+      allocationBatchSize.getOrElse(2 * slaveIds.size()),
+      2 * slaveIds.size() - first);
 
-  vector<SlaveID> slaveIds;
-  slaveIds.reserve(allocationCandidates.size());
+  allocationCycle->position = last;
 
-  // Filter out non-whitelisted, removed, and deactivated slaves
-  // in order not to send offers for them.
-  foreach (const SlaveID& slaveId, allocationCandidates) {
-    if (isWhitelisted(slaveId) &&
-        slaves.contains(slaveId) &&
-        slaves.at(slaveId).activated) {
-      slaveIds.push_back(slaveId);
-    }
-  }
+  AllocationProfile& profile = allocationCycle->profile;
+  ++profile.batches;
 
-  // Randomize the order in which slaves' resources are allocated.
-  //
-  // TODO(vinod): Implement a smarter sorting algorithm.
-  std::random_shuffle(slaveIds.begin(), slaveIds.end());
-
-  // Returns the __quantity__ of resources allocated to a role with
-  // non-default quota. Since we account for reservations and persistent
-  // volumes toward quota, we strip reservation and persistent volumes
-  // related information for comparability. The result is used to
-  // determine whether a role's quota guarantee is satisfied, and
-  // also to determine how many resources the role would need in
-  // order to meet its quota guarantee.
-  //
-  // NOTE: Revocable resources are excluded in `quotaRoleSorter`.
-  auto getQuotaRoleAllocatedScalarQuantities = [this](const string& role) {
-    CHECK(quotas.contains(role));
-    return quotaRoleSorter->allocationScalarQuantities(role);
-  };
+  Stopwatch stopwatch;
+  stopwatch.start();
 
-  // Returns the result of shrinking the provided resources down to the
-  // target scalar quantities. If a resource does not have a target
-  // quantity provided, it will not be shrunk.
+  // Returns the result of shrinking the provided scalar resources down
+  // to the target scalar quantities. Resources that do not have a
+  // (remaining) target quantity are excluded in entirety. The target
+  // is reduced by the amount of each resource that is kept, so that
+  // several resources of the same name (e.g. two disks) can together
+  // make up the target.
   //
   // Note that some resources are indivisible (e.g. MOUNT volume) and
   // may be excluded in entirety in order to achieve the target size
@@ -1630,7 +2010,7 @@ void HierarchicalAllocatorProcess::__allocate()
   // will make a random choice in these cases.
   auto shrinkResources =
     [](const Resources& resources,
-       hashmap<string, Value::Scalar> targetScalarQuantites) {
+       ResourceQuantities targetScalarQuantities) {
     google::protobuf::RepeatedPtrField<Resource>
       resourceVector = resources;
 
@@ -1638,17 +2018,18 @@ void HierarchicalAllocatorProcess::__allocate()
 
     Resources result;
     foreach (Resource& resource, resourceVector) {
-      if (!targetScalarQuantites.contains(resource.name())) {
-        // Resource that has no target quantity is left as is.
-        result += std::move(resource);
+      CHECK_EQ(Value::SCALAR, resource.type()) << resource;
+
+      const Value::Scalar target =
+        targetScalarQuantities.get(resource.name());
+
+      if (target.value() == 0) {
         continue;
       }
 
-      Option<Value::Scalar> limitScalar =
-        targetScalarQuantites.get(resource.name());
-
-      if (Resources::shrink(&resource, limitScalar.get())) {
-        targetScalarQuantites[resource.name()] -= limitScalar.get();
+      if (Resources::shrink(&resource, target)) {
+        targetScalarQuantities -=
+          ResourceQuantities::fromScalarResources(resource);
         result += std::move(resource);
       }
     }
@@ -1656,73 +2037,10 @@ void HierarchicalAllocatorProcess::__allocate()
     return result;
   };
 
-  // To enforce quota, we keep track of consumed quota for roles with a
-  // non-default quota.
-  //
-  // NOTE: We build the map here to avoid repetitive aggregation in the
-  // allocation loop. But this map will still need to be updated in the
-  // allocation loop as we make new allocations.
-  //
-  // TODO(mzhu): Build and persist this information across allocation cycles in
-  // track/untrackAllocatedResources().
-  //
-  // TODO(mzhu): Ideally, we want the sorter to track consumed quota. It then
-  // could use consumed quota instead of allocated resources (the former
-  // includes unallocated reservations while the latter does not) to calculate
-  // the DRF share. This would help to:
-  //
-  //   (1) Solve the fairness issue when roles with unallocated
-  //       reservations may game the allocator (See MESOS-8299).
-  //
-  //   (2) Simplify the quota enforcement logic -- the allocator
-  //       would no longer need to track reservations separately.
-  //
-  // Note these are __quantities__ with no meta-data.
-  hashmap<string, Resources> rolesConsumedQuotaScalarQuantites;
-
-  // We charge a role against its quota by considering its allocation as well
-  // as any unallocated reservations since reservations are bound to the role.
-  // In other words, we always consider reservations as consuming quota,
-  // regardless of whether they are allocated.
-  // It is calculated as:
-  //
-  //   Consumed Quota = reservations + unreserved allocation
-  //                  = reservations + allocation - allocated reservations
-  foreachkey (const string& role, quotas) {
-    // First add reservations.
-    rolesConsumedQuotaScalarQuantites[role] +=
-      reservationScalarQuantities.get(role).getOrElse(Resources());
-
-    // Then add allocated resoruces.
-    rolesConsumedQuotaScalarQuantites[role] +=
-      getQuotaRoleAllocatedScalarQuantities(role);
-
-    // Lastly subtract allocated reservations on each agent.
-    foreachvalue (
-        const Resources& resources, quotaRoleSorter->allocation(role)) {
-      rolesConsumedQuotaScalarQuantites[role] -=
-        resources.reserved().createStrippedScalarQuantity();
-    }
-  }
-
-  // We need to constantly make sure that we are holding back enough
-  // unreserved resources that the remaining quota guarantee can later
-  // be satisfied when needed:
-  //
-  //   Required unreserved headroom =
-  //     sum (guarantee - consumed quota) for each role.
-  //
-  // Given the above, if a role has more reservations (which count towards
-  // consumed quota) than quota guarantee, we don't need to hold back any
-  // unreserved headroom for it.
-  Resources requiredHeadroom;
-  foreachpair (const string& role, const Quota& quota, quotas) {
-    // We can safely subtract resources without checking inclusion. If the
-    // minuend resource is less than the subtrahend resource, the result is an
-    // empty resource.
-    requiredHeadroom += Resources(quota.info.guarantee()) -
-      rolesConsumedQuotaScalarQuantites.get(role).getOrElse(Resources());
-  }
+  // To enforce quota, we keep track of the consumed quota of each role
+  // and of the required headroom for the unsatisfied quota guarantees
+  // across allocation cycles, see `trackConsumedQuota()`. Both are
+  // updated as we make new allocations below.
 
   // We will allocate resources while ensuring that the required
   // unreserved non-revocable headroom is still available. Otherwise,
@@ -1730,49 +2048,11 @@ void HierarchicalAllocatorProcess::__allocate()
   //
   //   available headroom = unallocated unreserved non-revocable resources
   //
-  // We compute this as:
-  //
-  //   available headroom = total resources -
-  //                        allocated resources -
-  //                        unallocated reservations -
-  //                        unallocated revocable resources
-  Resources availableHeadroom = roleSorter->totalScalarQuantities();
-
-  // Subtract allocated resources from the total.
-  foreachkey (const string& role, roles) {
-    availableHeadroom -= roleSorter->allocationScalarQuantities(role);
-  }
-
-  // Calculate total allocated reservations. Note that we need to ensure
-  // we count a reservation for "a" being allocated to "a/b", therefore
-  // we cannot simply loop over the reservations' roles.
-  Resources totalAllocatedReservationScalarQuantities;
-  foreachkey (const string& role, roles) {
-    const hashmap<SlaveID, Resources>* allocations;
-    if (quotaRoleSorter->contains(role)) {
-      allocations = &quotaRoleSorter->allocation(role);
-    } else if (roleSorter->contains(role)) {
-      allocations = &roleSorter->allocation(role);
-    } else {
-      continue; // This role has no allocation.
-    }
-
-    foreachvalue (const Resources& resources, *CHECK_NOTNULL(allocations)) {
-      totalAllocatedReservationScalarQuantities +=
-        resources.reserved().createStrippedScalarQuantity();
-    }
-  }
-
-  // Subtract total unallocated reservations.
-  availableHeadroom -=
-    Resources::sum(reservationScalarQuantities) -
-    totalAllocatedReservationScalarQuantities;
-
-  // Subtract revocable resources.
-  foreachvalue (const Slave& slave, slaves) {
-    availableHeadroom -=
-      slave.getAvailable().revocable().createStrippedScalarQuantity();
-  }
+  // NOTE: This is computed again for each batch of agents, since the
+  // resources may have changed in between.
+  ResourceQuantities availableHeadroom =
+    totalUnreservedNonRevocableScalarQuantities -
+    allocatedUnreservedNonRevocableScalarQuantities;
 
   // Due to the two stages in the allocation algorithm and the nature of
   // shared resources being re-offerable even if already allocated, the
@@ -1783,7 +2063,102 @@ void HierarchicalAllocatorProcess::__allocate()
   // shared resource is only allocated once in one offer cycle. We use
   // `offeredSharedResources` to keep track of shared resources already
   // allocated in the current cycle.
-  hashmap<SlaveID, Resources> offeredSharedResources;
+  hashmap<SlaveID, Resources>& offeredSharedResources =
+    allocationCycle->offeredSharedResources;
+
+  // Returns the result of `Sorter::sort()`, timing it for the profile.
+  auto sort = [&profile](Sorter* sorter) {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    vector<string> sorted = sorter->sort();
+
+    profile.sorts += stopwatch.elapsed();
+
+    return sorted;
+  };
+
+  // Returns the result of `isFiltered()`, timing it for the profile.
+  auto checkFilters = [this, &profile](
+      const FrameworkID& frameworkId,
+      const string& role,
+      const SlaveID& slaveId,
+      const Resources& resources) {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    const bool filtered = isFiltered(frameworkId, role, slaveId, resources);
+
+    profile.filterChecks += stopwatch.elapsed();
+
+    return filtered;
+  };
+
+  // The sorted frameworks of the roles, see `SortedFrameworks`.
+  //
+  // NOTE: These are not kept across the batches of agents, since the
+  // frameworks may have changed in between.
+  hashmap<string, SortedFrameworks> sortedFrameworks;
+
+  // Returns the sorted frameworks of the role, sorting them if needed.
+  //
+  // NOTE: Like the result of `Sorter::sort()`, the frameworks are not
+  // reordered when resources are allocated to the role while iterating
+  // over them. They are sorted again on the next call for the role.
+  auto sortFrameworks = [this, &sortedFrameworks, &sort](
+      const string& role) -> SortedFrameworks& {
+    SortedFrameworks& sorted = sortedFrameworks[role];
+
+    if (sorted.stale) {
+      // NOTE: Suppressed frameworks are not included in the sort.
+      CHECK(frameworkSorters.contains(role));
+
+      sorted.stale = false;
+      sorted.clients = sort(frameworkSorters.at(role).get());
+      sorted.resolved.assign(sorted.clients.size(), nullptr);
+
+      foreach (vector<size_t>& capable, sorted.capable) {
+        capable.clear();
+      }
+
+      sorted.checked.fill(0);
+    }
+
+    return sorted;
+  };
+
+  // Returns the `index`-th of the sorted frameworks that are capable of
+  // receiving the agents of the given class, or `nullptr` if there are
+  // no more such frameworks. Each framework is only looked up and
+  // checked once per class until the frameworks are sorted again.
+  auto capableFramework = [this](
+      SortedFrameworks& sorted,
+      size_t agentClass,
+      size_t index) -> const pair<const FrameworkID, Framework>* {
+    vector<size_t>& capable = sorted.capable[agentClass];
+    size_t& checked = sorted.checked[agentClass];
+
+    while (capable.size() <= index && checked < sorted.clients.size()) {
+      const size_t position = checked++;
+
+      if (sorted.resolved[position] == nullptr) {
+        FrameworkID frameworkId;
+        frameworkId.set_value(sorted.clients[position]);
+
+        auto framework = frameworks.find(frameworkId);
+        CHECK(framework != frameworks.end()) << frameworkId;
+
+        sorted.resolved[position] = &*framework;
+      }
+
+      if (isCapableOfReceivingAgent(
+              sorted.resolved[position]->second.capabilities, agentClass)) {
+        capable.push_back(position);
+      }
+    }
+
+    return index < capable.size() ? sorted.resolved[capable[index]] : nullptr;
+  };
 
   // Quota guarantee comes first and bursting above the quota guarantee
   // up to the quota limit comes second. Here we process only those
@@ -1798,11 +2173,38 @@ void HierarchicalAllocatorProcess::__allocate()
   // we try to satisfy the quota guarantee in this first stage so that those
   // roles with unsatisfied guarantee can have more choices and higher
   // probability in getting their guarantee satisfied.
-  foreach (const SlaveID& slaveId, slaveIds) {
-    foreach (const string& role, quotaRoleSorter->sort()) {
-      CHECK(quotas.contains(role));
+  profile.quotaPreamble += stopwatch.elapsed();
+  stopwatch.start();
 
-      const Quota& quota = quotas.at(role);
+  for (size_t i = std::min(first, slaveIds.size());
+       i < std::min(last, slaveIds.size());
+       ++i) {
+    const SlaveID& slaveId = slaveIds[i];
+
+    // The agent may have been removed or deactivated since the
+    // allocation run started, see `AllocationCycle`.
+    if (!slaves.contains(slaveId) || !slaves.at(slaveId).activated) {
+      continue;
+    }
+
+    ++profile.quotaStageAgents;
+
+    Slave& slave = slaves.at(slaveId);
+
+    const size_t slaveClass = agentClass(slave);
+
+    // The agent's available resources without the resources that the
+    // frameworks of each class are not capable of receiving, computed
+    // on first use, see `resourceClass()`.
+    std::array<Option<Resources>, RESOURCE_CLASSES> capableAvailable;
+
+    foreach (const string& role, sort(quotaRoleSorter.get())) {
+      CHECK(quotas.contains(role));
+
+      CHECK(quotaGuaranteeScalarQuantities.contains(role));
+
+      const ResourceQuantities& quotaGuarantee =
+        quotaGuaranteeScalarQuantities.at(role);
 
       // If there are no active frameworks in this role, we do not
       // need to do any allocations for this role.
@@ -1811,30 +2213,27 @@ void HierarchicalAllocatorProcess::__allocate()
       }
 
       // Fetch frameworks according to their fair share.
-      // NOTE: Suppressed frameworks are not included in the sort.
-      CHECK(frameworkSorters.contains(role));
-      const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
-
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
-        FrameworkID frameworkId;
-        frameworkId.set_value(frameworkId_);
-
-        CHECK(slaves.contains(slaveId));
-        CHECK(frameworks.contains(frameworkId));
+      SortedFrameworks& sorted = sortFrameworks(role);
 
-        const Framework& framework = frameworks.at(frameworkId);
+      size_t next = 0;
+      while (const auto* entry = capableFramework(sorted, slaveClass, next++)) {
+        const FrameworkID& frameworkId = entry->first;
+        const Framework& framework = entry->second;
         CHECK(framework.active) << frameworkId;
 
-        Slave& slave = slaves.at(slaveId);
-
-        if (!isCapableOfReceivingAgent(framework.capabilities, slave)) {
-          continue;
-        }
+        ++profile.quotaStageFrameworks;
 
         // Get the currently available resources on the agent and strip
         // resources that are incompatible with the framework capabilities.
-        Resources available =
-          stripIncapableResources(slave.getAvailable(), framework.capabilities);
+        Option<Resources>& capable =
+          capableAvailable[resourceClass(framework.capabilities)];
+
+        if (capable.isNone()) {
+          capable = stripIncapableResources(
+              slave.getAvailable(), framework.capabilities);
+        }
+
+        Resources available = capable.get();
 
         // Offer a shared resource only if it has not been offered in this
         // offer cycle to a framework.
@@ -1877,28 +2276,18 @@ void HierarchicalAllocatorProcess::__allocate()
         Resources toAllocate = available.reserved(role).nonRevocable();
 
         // This is a scalar quantity with no meta-data.
-        Resources unsatisfiedQuotaGuarantee =
-          Resources(quota.info.guarantee()) -
-            rolesConsumedQuotaScalarQuantites.get(role).getOrElse(Resources());
+        ResourceQuantities unsatisfiedQuotaGuarantee = quotaGuarantee;
+
+        auto consumedQuota = consumedQuotaScalarQuantities.find(role);
+        if (consumedQuota != consumedQuotaScalarQuantities.end()) {
+          unsatisfiedQuotaGuarantee -= consumedQuota->second;
+        }
 
         Resources unreserved = available.nonRevocable().unreserved();
 
         // First, allocate resources up to a role's quota guarantee.
-
-        hashmap<string, Value::Scalar> unsatisfiedQuotaGuaranteeScalarLimit;
-        foreach (const string& name, unsatisfiedQuotaGuarantee.names()) {
-          unsatisfiedQuotaGuaranteeScalarLimit[name] +=
-            CHECK_NOTNONE(unsatisfiedQuotaGuarantee.get<Value::Scalar>(name));
-        }
-
         Resources newQuotaAllocation =
-          unreserved.filter([&](const Resource& resource) {
-            return
-              unsatisfiedQuotaGuaranteeScalarLimit.contains(resource.name());
-          });
-
-        newQuotaAllocation = shrinkResources(newQuotaAllocation,
-            unsatisfiedQuotaGuaranteeScalarLimit);
+          shrinkResources(unreserved.scalars(), unsatisfiedQuotaGuarantee);
 
         toAllocate += newQuotaAllocation;
 
@@ -1914,36 +2303,20 @@ void HierarchicalAllocatorProcess::__allocate()
         // Second, allocate scalar resources with unset quota while maintaining
         // the quota headroom.
 
-        set<string> quotaGuaranteeResourceNames =
-          Resources(quota.info.guarantee()).names();
-
         Resources nonQuotaGuaranteeResources =
-          unreserved.filter(
-              [&quotaGuaranteeResourceNames] (const Resource& resource) {
-                return quotaGuaranteeResourceNames.count(resource.name()) == 0;
+          unreserved.scalars().filter(
+              [&quotaGuarantee] (const Resource& resource) {
+                return quotaGuarantee.get(resource.name()).value() == 0;
               }
           );
 
         // Allocation Limit = Available Headroom - Required Headroom
-        Resources headroomResourcesLimit = availableHeadroom - requiredHeadroom;
-
-        hashmap<string, Value::Scalar> headroomScalarLimit;
-        foreach (const string& name, headroomResourcesLimit.names()) {
-          headroomScalarLimit[name] =
-            CHECK_NOTNONE(headroomResourcesLimit.get<Value::Scalar>(name));
-        }
-
-        // If a resource type is absent in `headroomScalarLimit`, it means this
-        // type of resource is already in quota headroom deficit and we make
-        // no more allocations. They are filtered out.
-        nonQuotaGuaranteeResources = nonQuotaGuaranteeResources.filter(
-            [&] (const Resource& resource) {
-              return headroomScalarLimit.contains(resource.name());
-            }
-          );
-
-        nonQuotaGuaranteeResources =
-          shrinkResources(nonQuotaGuaranteeResources, headroomScalarLimit);
+        //
+        // If a resource type is absent in the limit, it means this type of
+        // resource is already in quota headroom deficit and we make no more
+        // allocations. `shrinkResources` filters those out.
+        nonQuotaGuaranteeResources = shrinkResources(
+            nonQuotaGuaranteeResources, availableHeadroom - requiredHeadroom);
 
         toAllocate += nonQuotaGuaranteeResources;
 
@@ -1969,7 +2342,7 @@ void HierarchicalAllocatorProcess::__allocate()
         }
 
         // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, role, slaveId, toAllocate)) {
+        if (checkFilters(frameworkId, role, slaveId, toAllocate)) {
           continue;
         }
 
@@ -1982,32 +2355,28 @@ void HierarchicalAllocatorProcess::__allocate()
         offerable[frameworkId][role][slaveId] += toAllocate;
         offeredSharedResources[slaveId] += toAllocate.shared();
 
-        Resources allocatedUnreserved =
-          toAllocate.unreserved().createStrippedScalarQuantity();
-
-        // Update role consumed quota.
-        rolesConsumedQuotaScalarQuantites[role] += allocatedUnreserved;
-
-        // Track quota guarantee headroom change.
-
-        // `requiredHeadroom` counts total unsatisfied quota guarantee. Thus
-        // only the part of the allocated resources that satisfy some of the
-        // role's guarantee should be subtracted. Allocation of reserved
-        // resources or resources that this role has unset guarantee do not
-        // affect `requiredHeadroom`.
-        requiredHeadroom -= newQuotaAllocation.createStrippedScalarQuantity();
-
         // `availableHeadroom` counts total unreserved non-revocable resources
         // in the cluster.
-        availableHeadroom -= allocatedUnreserved;
+        availableHeadroom -=
+          ResourceQuantities::fromScalarResources(toAllocate.unreserved());
 
         slave.allocate(toAllocate);
+        capableAvailable.fill(None());
 
+        // NOTE: This also updates the role's consumed quota and the
+        // `requiredHeadroom`. Only the part of the allocated resources
+        // that satisfies some of the role's guarantee is subtracted from
+        // the latter. Allocation of reserved resources or resources that
+        // this role has unset guarantee do not affect it.
         trackAllocatedResources(slaveId, frameworkId, toAllocate);
+        sorted.stale = true;
       }
     }
   }
 
+  profile.quotaStage += stopwatch.elapsed();
+  stopwatch.start();
+
   // Similar to the first stage, we will allocate resources while ensuring
   // that the required unreserved non-revocable headroom is still available
   // for unsastified quota guarantees. Otherwise, we will not be able to
@@ -2015,37 +2384,174 @@ void HierarchicalAllocatorProcess::__allocate()
   // revocable resources will always be included in the offers since these
   // are not part of the headroom (and therefore can't be used to satisfy
   // quota guarantees).
-
-  foreach (const SlaveID& slaveId, slaveIds) {
-    foreach (const string& role, roleSorter->sort()) {
-      // In the second allocation stage, we only allocate
-      // for non-quota roles.
+  //
+  // Once frameworks decline the resources of many agents, most of the
+  // time of this stage can be spent evaluating the offer filters. When
+  // allowed to use multiple threads, we first determine in parallel, for
+  // disjoint shards of the agents, which frameworks have filtered each
+  // agent's resources (see `FilteredFrameworks`). Until it allocates
+  // resources on an agent, the loop below then skips those frameworks.
+  // This does not change the allocations made (and therefore preserves
+  // the DRF ordering and the quota headroom): the offer filters only
+  // depend on the agent's available resources, which do not change until
+  // resources are allocated on the agent.
+  vector<FilteredFrameworks> filtered;
+
+  // The agents of this batch in this stage are `slaveIds[begin, end)`.
+  const size_t begin = std::max(first, slaveIds.size()) - slaveIds.size();
+  const size_t end = std::max(last, slaveIds.size()) - slaveIds.size();
+
+  const size_t shards = std::min(
+      offerFilterParallelism,
+      (end - begin) / MIN_OFFER_FILTER_AGENTS_PER_THREAD);
+
+  if (shards > 1) {
+    vector<pair<string, vector<FrameworkID>>> roleFrameworks;
+
+    foreach (const string& role, sort(roleSorter.get())) {
       if (quotas.contains(role)) {
         continue;
       }
 
-      // NOTE: Suppressed frameworks are not included in the sort.
       CHECK(frameworkSorters.contains(role));
-      const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
 
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
+      vector<FrameworkID> frameworkIds;
+      foreach (const string& frameworkId_,
+               sort(frameworkSorters.at(role).get())) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
-        CHECK(slaves.contains(slaveId));
-        CHECK(frameworks.contains(frameworkId));
+        frameworkIds.push_back(std::move(frameworkId));
+      }
 
-        const Framework& framework = frameworks.at(frameworkId);
-        Slave& slave = slaves.at(slaveId);
+      roleFrameworks.emplace_back(role, std::move(frameworkIds));
+    }
 
-        if (!isCapableOfReceivingAgent(framework.capabilities, slave)) {
+    filtered.resize(end - begin);
+
+    vector<std::function<void()>> tasks;
+    tasks.reserve(shards);
+
+    const size_t shardSize = (end - begin + shards - 1) / shards;
+
+    for (size_t i = 0; i < shards; ++i) {
+      const size_t shardBegin = begin + i * shardSize;
+      const size_t shardEnd = std::min(shardBegin + shardSize, end);
+
+      tasks.push_back([=, &roleFrameworks, &offeredSharedResources,
+                       &slaveIds, &filtered]() {
+        computeFilteredFrameworks(
+            roleFrameworks,
+            offeredSharedResources,
+            slaveIds,
+            shardBegin,
+            shardEnd,
+            begin,
+            &filtered);
+      });
+    }
+
+    // NOTE: The allocator's thread runs some of the shards as well.
+    // The workers only read the allocator's state, which is not
+    // modified until all the shards are computed, and make their own
+    // copies of the `Resources` they modify (see `Resources::exclusive()`
+    // for why the copy-on-write of `Resources` is safe across threads).
+    CHECK_NOTNULL(offerFilterWorkers.get())->run(std::move(tasks));
+  }
+
+  for (size_t i = begin; i < end; ++i) {
+    const SlaveID& slaveId = slaveIds[i];
+
+    if (!slaves.contains(slaveId) || !slaves.at(slaveId).activated) {
+      continue;
+    }
+
+    ++profile.nonQuotaStageAgents;
+
+    Slave& slave = slaves.at(slaveId);
+
+    // Skip the agent if a previous allocation cycle found that all
+    // frameworks filter its resources, see `Slave::allFilteredEpoch`.
+    if (slave.allFilteredEpoch == offerFiltersEpoch) {
+      continue;
+    }
+
+    // Whether none of the frameworks can be allocated any resources on
+    // this agent for as long as its resources and the offer filters do
+    // not change. This is the case if each framework is not capable of
+    // receiving the agent, or filters all the resources that it could
+    // be allocated in this stage (the offer filters are monotone: if
+    // they filter some resources, they filter any subset of them).
+    //
+    // NOTE: If resources were allocated on the agent in the first stage,
+    // its shared resources are not offered again in this cycle, and the
+    // offer filters are only evaluated for a subset of its resources.
+    bool allFiltered = !offeredSharedResources.contains(slaveId);
+
+    // The filtered frameworks are only valid until resources are
+    // allocated on the agent.
+    const FilteredFrameworks* agentFiltered =
+      filtered.empty() ? nullptr : &filtered[i - begin];
+
+    if (agentFiltered != nullptr && agentFiltered->all) {
+      if (allFiltered) {
+        slave.allFilteredEpoch = offerFiltersEpoch;
+      }
+
+      continue;
+    }
+
+    const size_t slaveClass = agentClass(slave);
+
+    // The agent's available resources without the resources that the
+    // frameworks of each class are not capable of receiving, computed
+    // on first use, see `resourceClass()`.
+    std::array<Option<Resources>, RESOURCE_CLASSES> capableAvailable;
+
+    foreach (const string& role, sort(roleSorter.get())) {
+      // In the second allocation stage, we only allocate
+      // for non-quota roles.
+      if (quotas.contains(role)) {
+        continue;
+      }
+
+      const FilteredFrameworks::Role* roleFiltered = nullptr;
+      if (agentFiltered != nullptr) {
+        auto it = agentFiltered->roles.find(role);
+        if (it != agentFiltered->roles.end()) {
+          if (it->second.all) {
+            continue;
+          }
+
+          roleFiltered = &it->second;
+        }
+      }
+
+      SortedFrameworks& sorted = sortFrameworks(role);
+
+      size_t next = 0;
+      while (const auto* entry = capableFramework(sorted, slaveClass, next++)) {
+        const FrameworkID& frameworkId = entry->first;
+        const Framework& framework = entry->second;
+
+        if (roleFiltered != nullptr &&
+            roleFiltered->frameworks.contains(frameworkId)) {
           continue;
         }
 
+        ++profile.nonQuotaStageFrameworks;
+
         // Get the currently available resources on the agent and strip
         // resources that are incompatible with the framework capabilities.
-        Resources available =
-          stripIncapableResources(slave.getAvailable(), framework.capabilities);
+        Option<Resources>& capable =
+          capableAvailable[resourceClass(framework.capabilities)];
+
+        if (capable.isNone()) {
+          capable = stripIncapableResources(
+              slave.getAvailable(), framework.capabilities);
+        }
+
+        Resources available = capable.get();
 
         // Offer a shared resource only if it has not been offered in this offer
         // cycle to a framework.
@@ -2072,6 +2578,12 @@ void HierarchicalAllocatorProcess::__allocate()
         // work basis, which requires us to go through all frameworks in case we
         // have allocatable revocable resources.
         if (!allocatable(toAllocate)) {
+          // Depending on their capabilities, frameworks that come later
+          // in the sort order might be allocated resources.
+          if (allocatable(slave.getAvailable().allocatableTo(role))) {
+            allFiltered = false;
+          }
+
           break;
         }
 
@@ -2080,24 +2592,37 @@ void HierarchicalAllocatorProcess::__allocate()
         const Resources headroomToAllocate = toAllocate
           .scalars().unreserved().nonRevocable();
 
+        const ResourceQuantities headroomQuantitiesToAllocate =
+          ResourceQuantities::fromScalarResources(headroomToAllocate);
+
         bool sufficientHeadroom =
-          (availableHeadroom -
-            headroomToAllocate.createStrippedScalarQuantity())
+          (availableHeadroom - headroomQuantitiesToAllocate)
             .contains(requiredHeadroom);
 
         if (!sufficientHeadroom) {
           toAllocate -= headroomToAllocate;
+
+          if (!headroomToAllocate.empty()) {
+            heldBackAgents.insert(slaveId);
+          }
         }
 
         // If the resources are not allocatable, ignore. We cannot break
         // here, because another framework under the same role could accept
         // revocable resources and breaking would skip all other frameworks.
         if (!allocatable(toAllocate)) {
+          allFiltered = false;
           continue;
         }
 
         // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, role, slaveId, toAllocate)) {
+        if (checkFilters(frameworkId, role, slaveId, toAllocate)) {
+          // The framework could be allocated more resources than
+          // `toAllocate` once the headroom allows it.
+          if (!sufficientHeadroom) {
+            allFiltered = false;
+          }
+
           continue;
         }
 
@@ -2112,13 +2637,90 @@ void HierarchicalAllocatorProcess::__allocate()
         offeredSharedResources[slaveId] += toAllocate.shared();
 
         if (sufficientHeadroom) {
-          availableHeadroom -=
-            headroomToAllocate.createStrippedScalarQuantity();
+          availableHeadroom -= headroomQuantitiesToAllocate;
         }
 
         slave.allocate(toAllocate);
+        capableAvailable.fill(None());
 
         trackAllocatedResources(slaveId, frameworkId, toAllocate);
+        sorted.stale = true;
+
+        agentFiltered = nullptr;
+        roleFiltered = nullptr;
+        allFiltered = false;
+      }
+    }
+
+    if (allFiltered) {
+      slave.allFilteredEpoch = offerFiltersEpoch;
+    }
+  }
+
+  profile.nonQuotaStage += stopwatch.elapsed();
+
+  // Offer the resources once all the agents have been allocated from.
+  if (last < 2 * slaveIds.size()) {
+    return;
+  }
+
+  stopwatch.start();
+
+  // Return the allocations that became invalid while the allocation
+  // run was in progress (e.g., since the framework was removed), as if
+  // their resources were recovered. This is only possible if the run
+  // took more than one batch.
+  //
+  // NOTE: An agent that was removed and added back has none of these
+  // resources allocated, which is why we check for them.
+  if (first > 0) {
+    foreach (const FrameworkID& frameworkId, offerable.keys()) {
+      hashmap<string, hashmap<SlaveID, Resources>>& frameworkOfferable =
+        offerable.at(frameworkId);
+
+      foreach (const string& role, frameworkOfferable.keys()) {
+        hashmap<SlaveID, Resources>& roleOfferable =
+          frameworkOfferable.at(role);
+
+        foreach (const SlaveID& slaveId, roleOfferable.keys()) {
+          const Resources& resources = roleOfferable.at(slaveId);
+
+          const bool frameworkActive =
+            frameworks.contains(frameworkId) &&
+            frameworks.at(frameworkId).active;
+
+          const bool slaveAllocated =
+            slaves.contains(slaveId) &&
+            slaves.at(slaveId).activated &&
+            slaves.at(slaveId).getAllocated().contains(resources);
+
+          if (frameworkActive && slaveAllocated) {
+            continue;
+          }
+
+          VLOG(1) << "Not offering " << resources << " on agent " << slaveId
+                  << " to framework " << frameworkId << " since either was"
+                  << " removed or deactivated meanwhile";
+
+          if (frameworks.contains(frameworkId)) {
+            untrackAllocatedResources(slaveId, frameworkId, resources);
+          }
+
+          if (slaves.contains(slaveId) &&
+              slaves.at(slaveId).getAllocated().contains(resources)) {
+            slaves.at(slaveId).unallocate(resources);
+          }
+
+          roleOfferable.erase(slaveId);
+        }
+
+        if (roleOfferable.empty()) {
+          frameworkOfferable.erase(role);
+        }
+      }
+
+      if (frameworkOfferable.empty()) {
+        offerable.erase(frameworkId);
       }
     }
   }
@@ -2129,12 +2731,21 @@ void HierarchicalAllocatorProcess::__allocate()
     // Now offer the resources to each framework.
     foreachkey (const FrameworkID& frameworkId, offerable) {
       offerCallback(frameworkId, offerable.at(frameworkId));
+
+      ++profile.frameworksOffered;
+
+      foreachvalue (const auto& resources, offerable.at(frameworkId)) {
+        profile.offers += resources.size();
+      }
     }
   }
+
+  profile.offerCallback += stopwatch.elapsed();
 }
 
 
-void HierarchicalAllocatorProcess::deallocate()
+void HierarchicalAllocatorProcess::deallocate(
+    const hashset<SlaveID>& slaveIds)
 {
   // If no frameworks are currently registered, no work to do.
   if (roles.empty()) {
@@ -2158,8 +2769,11 @@ void HierarchicalAllocatorProcess::deallocate()
   // responded yet.
 
   foreachvalue (const Owned<Sorter>& frameworkSorter, frameworkSorters) {
-    foreach (const SlaveID& slaveId, allocationCandidates) {
-      CHECK(slaves.contains(slaveId));
+    foreach (const SlaveID& slaveId, slaveIds) {
+      // The agent may have been removed since the allocation run started.
+      if (!slaves.contains(slaveId)) {
+        continue;
+      }
 
       Slave& slave = slaves.at(slaveId);
 
@@ -2234,56 +2848,83 @@ void HierarchicalAllocatorProcess::deallocate()
 }
 
 
-void HierarchicalAllocatorProcess::_expire(
-    const FrameworkID& frameworkId,
-    const string& role,
-    const SlaveID& slaveId,
-    OfferFilter* offerFilter)
+void HierarchicalAllocatorProcess::expireOfferFilters(
+    const Time& deadline)
 {
-  // The filter might have already been removed (e.g., if the
-  // framework no longer exists or in `reviveOffers()`) but not
-  // yet deleted (to keep the address from getting reused
-  // possibly causing premature expiration).
-  //
-  // Since this is a performance-sensitive piece of code,
-  // we use find to avoid the doing any redundant lookups.
+  dispatch(self(), &Self::_expireOfferFilters, deadline);
+}
 
-  auto frameworkIterator = frameworks.find(frameworkId);
-  if (frameworkIterator != frameworks.end()) {
-    Framework& framework = frameworkIterator->second;
 
-    auto roleFilters = framework.offerFilters.find(role);
-    if (roleFilters != framework.offerFilters.end()) {
-      auto agentFilters = roleFilters->second.find(slaveId);
+void HierarchicalAllocatorProcess::_expireOfferFilters(
+    const Time& deadline)
+{
+  // An offer filter applies to at least one whole allocation run, so
+  // the filters do not expire between the batches of a run.
+  if (allocationCycle.isSome()) {
+    CHECK_SOME(allocation);
+
+    allocation->onAny(defer(self(), &Self::_expireOfferFilters, deadline));
+    return;
+  }
+
+  offerFilterTimers.erase(deadline);
+
+  const Time now = Clock::now();
+
+  while (!offerFilterExpiry.empty() &&
+         offerFilterExpiry.begin()->first <= now) {
+    foreach (const ExpiringOfferFilter& expiring,
+             offerFilterExpiry.begin()->second) {
+      // The filter might have already been removed (e.g., if the
+      // framework no longer exists or in `reviveOffers()`) but not
+      // yet deleted (to keep the address from getting reused
+      // possibly causing premature expiration).
+      //
+      // Since this is a performance-sensitive piece of code,
+      // we use find to avoid the doing any redundant lookups.
+      auto frameworkIterator = frameworks.find(expiring.frameworkId);
+      if (frameworkIterator != frameworks.end()) {
+        Framework& framework = frameworkIterator->second;
+
+        auto roleFilters = framework.offerFilters.find(expiring.role);
+        if (roleFilters != framework.offerFilters.end()) {
+          auto agentFilters = roleFilters->second.find(expiring.slaveId);
 
-      if (agentFilters != roleFilters->second.end()) {
-        // Erase the filter (may be a no-op per the comment above).
-        agentFilters->second.erase(offerFilter);
+          if (agentFilters != roleFilters->second.end()) {
+            // Erase the filter (may be a no-op per the comment above).
+            agentFilters->second.erase(expiring.offerFilter);
 
-        if (agentFilters->second.empty()) {
-          roleFilters->second.erase(slaveId);
+            if (agentFilters->second.empty()) {
+              roleFilters->second.erase(expiring.slaveId);
+            }
+          }
         }
       }
+
+      // The resources on the agent may no longer be filtered.
+      auto slaveIterator = slaves.find(expiring.slaveId);
+      if (slaveIterator != slaves.end()) {
+        slaveIterator->second.allFilteredEpoch = None();
+
+        markAgentChanged(expiring.slaveId);
+      }
+
+      delete expiring.offerFilter;
     }
+
+    offerFilterExpiry.erase(offerFilterExpiry.begin());
   }
 
-  delete offerFilter;
-}
+  // Make sure that a timer is scheduled for the next filter to expire.
+  if (!offerFilterExpiry.empty()) {
+    const Time& next = offerFilterExpiry.begin()->first;
 
+    if (offerFilterTimers.empty() || next < *offerFilterTimers.begin()) {
+      offerFilterTimers.insert(next);
 
-void HierarchicalAllocatorProcess::expire(
-    const FrameworkID& frameworkId,
-    const string& role,
-    const SlaveID& slaveId,
-    OfferFilter* offerFilter)
-{
-  dispatch(
-      self(),
-      &Self::_expire,
-      frameworkId,
-      role,
-      slaveId,
-      offerFilter);
+      delay(next - now, self(), &Self::expireOfferFilters, next);
+    }
+  }
 }
 
 
@@ -2315,6 +2956,10 @@ void HierarchicalAllocatorProcess::expire(
     }
   }
 
+  if (slaves.contains(slaveId)) {
+    markAgentChanged(slaveId);
+  }
+
   delete inverseOfferFilter;
 }
 
@@ -2421,7 +3066,8 @@ bool HierarchicalAllocatorProcess::isFiltered(
 }
 
 
-bool HierarchicalAllocatorProcess::allocatable(const Resources& resources)
+bool HierarchicalAllocatorProcess::allocatable(
+    const Resources& resources) const
 {
   if (minAllocatableResources.isNone() ||
       CHECK_NOTNONE(minAllocatableResources).empty()) {
@@ -2440,6 +3086,88 @@ bool HierarchicalAllocatorProcess::allocatable(const Resources& resources)
 }
 
 
+Future<process::http::Response> HierarchicalAllocatorProcess::profile(
+    const process::http::Request& request,
+    const Option<Principal>&)
+{
+  size_t limit = allocationProfiles.size();
+
+  Option<string> limit_ = request.url.query.get("limit");
+  if (limit_.isSome()) {
+    Try<size_t> parse = numify<size_t>(limit_.get());
+    if (parse.isError()) {
+      return process::http::BadRequest(
+          "Failed to parse query parameter 'limit': " + parse.error());
+    }
+
+    limit = std::min(limit, parse.get());
+  }
+
+  JSON::Array runs;
+  runs.values.reserve(limit);
+
+  // The most recent runs come first.
+  for (auto profile = allocationProfiles.rbegin();
+       profile != allocationProfiles.rbegin() + limit;
+       ++profile) {
+    JSON::Object run;
+    run.values["start"] = profile->start.secs();
+    run.values["candidates"] = profile->candidates;
+    run.values["agents"] = profile->agents;
+    run.values["batches"] = profile->batches;
+
+    JSON::Object quotaStage;
+    quotaStage.values["agents"] = profile->quotaStageAgents;
+    quotaStage.values["frameworks"] = profile->quotaStageFrameworks;
+    run.values["quota_stage"] = quotaStage;
+
+    JSON::Object nonQuotaStage;
+    nonQuotaStage.values["agents"] = profile->nonQuotaStageAgents;
+    nonQuotaStage.values["frameworks"] = profile->nonQuotaStageFrameworks;
+    run.values["non_quota_stage"] = nonQuotaStage;
+
+    run.values["frameworks_offered"] = profile->frameworksOffered;
+    run.values["offers"] = profile->offers;
+
+    JSON::Object steps;
+    foreach (const auto& step, profile->steps()) {
+      steps.values[step.first] = step.second.ms();
+    }
+
+    run.values["steps_ms"] = steps;
+    run.values["total_ms"] = profile->total.ms();
+
+    runs.values.push_back(run);
+  }
+
+  JSON::Object result;
+  result.values["allocation_runs"] = runs;
+
+  return process::http::OK(result, request.url.query.get("jsonp"));
+}
+
+
+string HierarchicalAllocatorProcess::profileHelp()
+{
+  return HELP(
+      TLDR(
+          "Returns the timings and counts of the recent allocation runs."),
+      DESCRIPTION(
+          "Returns the profiles of the most recent allocation runs of the",
+          "allocator, most recent first: the time spent in each step of a",
+          "run, the agents and frameworks that each allocation stage",
+          "considered, and the offers that the run made.",
+          "",
+          "Sorting and checking the offer filters happen within the quota",
+          "and non-quota stages, and are also included in their times.",
+          "",
+          "Query parameters:",
+          "",
+          ">        limit=VALUE          The maximum number of runs "
+          "to return."),
+      AUTHENTICATION(true));
+}
+
 double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
     const string& resource)
 {
@@ -2461,11 +3189,7 @@ double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
 double HierarchicalAllocatorProcess::_resources_total(
     const string& resource)
 {
-  Option<Value::Scalar> total =
-    roleSorter->totalScalarQuantities()
-      .get<Value::Scalar>(resource);
-
-  return total.isSome() ? total->value() : 0;
+  return roleSorter->totalScalarQuantities().get(resource).value();
 }
 
 
@@ -2479,11 +3203,7 @@ double HierarchicalAllocatorProcess::_quota_allocated(
     return 0.;
   }
 
-  Option<Value::Scalar> used =
-    roleSorter->allocationScalarQuantities(role)
-      .get<Value::Scalar>(resource);
-
-  return used.isSome() ? used->value() : 0;
+  return roleSorter->allocationScalarQuantities(role).get(resource).value();
 }
 
 
@@ -2548,7 +3268,6 @@ void HierarchicalAllocatorProcess::untrackFrameworkUnderRole(
     const string& role)
 {
   CHECK(initialized);
-
   CHECK(roles.contains(role));
   CHECK(roles.at(role).contains(frameworkId));
   CHECK(frameworkSorters.contains(role));
@@ -2584,10 +3303,12 @@ void HierarchicalAllocatorProcess::trackReservations(
 {
   foreachpair (const string& role,
                const Resources& resources, reservations) {
-    const Resources scalarQuantitesToTrack =
-      resources.createStrippedScalarQuantity();
+    const ResourceQuantities scalarQuantitesToTrack =
+      ResourceQuantities::fromScalarResources(resources);
 
     reservationScalarQuantities[role] += scalarQuantitesToTrack;
+
+    trackConsumedQuota(role, scalarQuantitesToTrack);
   }
 }
 
@@ -2598,17 +3319,78 @@ void HierarchicalAllocatorProcess::untrackReservations(
   foreachpair (const string& role,
                const Resources& resources, reservations) {
     CHECK(reservationScalarQuantities.contains(role));
-    Resources& currentReservationQuantity =
+    ResourceQuantities& currentReservationQuantity =
         reservationScalarQuantities.at(role);
 
-    const Resources scalarQuantitesToUntrack =
-      resources.createStrippedScalarQuantity();
+    const ResourceQuantities scalarQuantitesToUntrack =
+      ResourceQuantities::fromScalarResources(resources);
     CHECK(currentReservationQuantity.contains(scalarQuantitesToUntrack));
     currentReservationQuantity -= scalarQuantitesToUntrack;
 
     if (currentReservationQuantity.empty()) {
       reservationScalarQuantities.erase(role);
     }
+
+    untrackConsumedQuota(role, scalarQuantitesToUntrack);
+  }
+}
+
+
+void HierarchicalAllocatorProcess::trackConsumedQuota(
+    const string& role,
+    const ResourceQuantities& consumed)
+{
+  if (consumed.empty()) {
+    return;
+  }
+
+  ResourceQuantities& consumedQuota = consumedQuotaScalarQuantities[role];
+
+  // Only the unsatisfied part of a role's quota guarantee counts towards
+  // the required headroom, so we replace the role's contribution.
+  //
+  // NOTE: Since the required headroom is the sum of these contributions,
+  // subtracting a role's contribution from it is exact.
+  auto guarantee = quotaGuaranteeScalarQuantities.find(role);
+  if (guarantee != quotaGuaranteeScalarQuantities.end()) {
+    requiredHeadroom -= guarantee->second - consumedQuota;
+  }
+
+  consumedQuota += consumed;
+
+  if (guarantee != quotaGuaranteeScalarQuantities.end()) {
+    requiredHeadroom += guarantee->second - consumedQuota;
+  }
+}
+
+
+void HierarchicalAllocatorProcess::untrackConsumedQuota(
+    const string& role,
+    const ResourceQuantities& consumed)
+{
+  if (consumed.empty()) {
+    return;
+  }
+
+  CHECK(consumedQuotaScalarQuantities.contains(role));
+  ResourceQuantities& consumedQuota = consumedQuotaScalarQuantities.at(role);
+
+  CHECK(consumedQuota.contains(consumed))
+    << consumedQuota << " does not contain " << consumed;
+
+  auto guarantee = quotaGuaranteeScalarQuantities.find(role);
+  if (guarantee != quotaGuaranteeScalarQuantities.end()) {
+    requiredHeadroom -= guarantee->second - consumedQuota;
+  }
+
+  consumedQuota -= consumed;
+
+  if (guarantee != quotaGuaranteeScalarQuantities.end()) {
+    requiredHeadroom += guarantee->second - consumedQuota;
+  }
+
+  if (consumedQuota.empty()) {
+    consumedQuotaScalarQuantities.erase(role);
   }
 }
 
@@ -2637,6 +3419,11 @@ bool HierarchicalAllocatorProcess::updateSlaveTotal(
     trackReservations(newReservations);
   }
 
+  totalUnreservedNonRevocableScalarQuantities -=
+    ResourceQuantities::fromScalarResources(oldTotal.unreserved().nonRevocable());
+  totalUnreservedNonRevocableScalarQuantities +=
+    ResourceQuantities::fromScalarResources(total.unreserved().nonRevocable());
+
   // Currently `roleSorter` and `quotaRoleSorter`, being the root-level
   // sorters, maintain all of `slaves[slaveId].total` (or the `nonRevocable()`
   // portion in the case of `quotaRoleSorter`) in their own totals (which
@@ -2691,17 +3478,51 @@ bool HierarchicalAllocatorProcess::isCapableOfReceivingAgent(
     const protobuf::framework::Capabilities& frameworkCapabilities,
     const Slave& slave) const
 {
+  return isCapableOfReceivingAgent(frameworkCapabilities, agentClass(slave));
+}
+
+
+constexpr size_t HierarchicalAllocatorProcess::AGENT_CLASSES;
+
+
+// The bits of an agent class.
+static constexpr size_t AGENT_CLASS_GPUS = 1;
+static constexpr size_t AGENT_CLASS_REMOTE = 2;
+
+
+size_t HierarchicalAllocatorProcess::agentClass(const Slave& slave) const
+{
+  size_t result = 0;
+
+  if (filterGpuResources && slave.getTotal().gpus().getOrElse(0) > 0) {
+    result |= AGENT_CLASS_GPUS;
+  }
+
+  if (isRemoteSlave(slave)) {
+    result |= AGENT_CLASS_REMOTE;
+  }
+
+  return result;
+}
+
+
+bool HierarchicalAllocatorProcess::isCapableOfReceivingAgent(
+    const protobuf::framework::Capabilities& frameworkCapabilities,
+    size_t agentClass) const
+{
+  CHECK_LT(agentClass, AGENT_CLASSES);
+
   // Only offer resources from slaves that have GPUs to
   // frameworks that are capable of receiving GPUs.
   // See MESOS-5634.
-  if (filterGpuResources && !frameworkCapabilities.gpuResources &&
-      slave.getTotal().gpus().getOrElse(0) > 0) {
+  if ((agentClass & AGENT_CLASS_GPUS) && !frameworkCapabilities.gpuResources) {
     return false;
   }
 
   // If this framework is not region-aware, don't offer it
   // resources on agents in remote regions.
-  if (!frameworkCapabilities.regionAware && isRemoteSlave(slave)) {
+  if ((agentClass & AGENT_CLASS_REMOTE) &&
+      !frameworkCapabilities.regionAware) {
     return false;
   }
 
@@ -2743,6 +3564,146 @@ Resources HierarchicalAllocatorProcess::stripIncapableResources(
 }
 
 
+constexpr size_t HierarchicalAllocatorProcess::RESOURCE_CLASSES;
+
+
+size_t HierarchicalAllocatorProcess::resourceClass(
+    const protobuf::framework::Capabilities& frameworkCapabilities)
+{
+  return (frameworkCapabilities.sharedResources ? 1 : 0) |
+         (frameworkCapabilities.revocableResources ? 2 : 0) |
+         (frameworkCapabilities.reservationRefinement ? 4 : 0);
+}
+
+
+void HierarchicalAllocatorProcess::computeFilteredFrameworks(
+    const vector<pair<string, vector<FrameworkID>>>& roleFrameworks,
+    const hashmap<SlaveID, Resources>& offeredSharedResources,
+    const vector<SlaveID>& slaveIds,
+    size_t begin,
+    size_t end,
+    size_t offset,
+    vector<FilteredFrameworks>* filtered) const
+{
+  CHECK_LE(end, slaveIds.size());
+  CHECK_LE(offset, begin);
+  CHECK_LE(end - offset, filtered->size());
+
+  for (size_t i = begin; i < end; ++i) {
+    const SlaveID& slaveId = slaveIds[i];
+
+    // The second stage skips the agents that were removed or deactivated
+    // since the allocation run started.
+    if (!slaves.contains(slaveId) || !slaves.at(slaveId).activated) {
+      continue;
+    }
+
+    const Slave& slave = slaves.at(slaveId);
+
+    FilteredFrameworks& agentFiltered = (*filtered)[i - offset];
+
+    if (slave.allFilteredEpoch == offerFiltersEpoch) {
+      agentFiltered.all = true;
+      continue;
+    }
+
+    // These are the resources that the second allocation stage starts
+    // with for the agent, see `__allocate()`.
+    Resources available = slave.getAvailable();
+    if (offeredSharedResources.contains(slaveId)) {
+      available -= offeredSharedResources.at(slaveId);
+    }
+
+    bool all = true;
+
+    foreach (const auto& roleFramework, roleFrameworks) {
+      const string& role = roleFramework.first;
+
+      FilteredFrameworks::Role roleFiltered;
+
+      // The resources allocatable to the role, computed on first use.
+      Option<Resources> allocatableToRole;
+
+      // We stop at the first framework which does not filter the
+      // agent's resources: the second stage either allocates them to
+      // that framework, which invalidates the `FilteredFrameworks` of
+      // the agent, or evaluates the frameworks which are not known to
+      // filter them as usual.
+      foreach (const FrameworkID& frameworkId, roleFramework.second) {
+        const Framework& framework = frameworks.at(frameworkId);
+
+        if (!isCapableOfReceivingAgent(framework.capabilities, slave)) {
+          continue;
+        }
+
+        auto roleFilters = framework.offerFilters.find(role);
+        if (roleFilters == framework.offerFilters.end()) {
+          break;
+        }
+
+        auto agentFilters = roleFilters->second.find(slaveId);
+        if (agentFilters == roleFilters->second.end()) {
+          break;
+        }
+
+        if (allocatableToRole.isNone()) {
+          allocatableToRole = available.allocatableTo(role);
+        }
+
+        // NOTE: This is equivalent to the second stage's computation,
+        // since both only filter the agent's available resources.
+        const Resources toAllocate = stripIncapableResources(
+            allocatableToRole.get(), framework.capabilities);
+
+        // NOTE: The second stage stops considering the role's frameworks
+        // on the agent when it reaches a framework for which the resources
+        // are not allocatable, so we must not mark such a framework.
+        if (!allocatable(toAllocate)) {
+          break;
+        }
+
+        // NOTE: The resources allocated in the second stage are a subset
+        // of `toAllocate` (e.g., without the headroom), so an offer filter
+        // that declines `toAllocate` also declines them.
+        bool filters = false;
+        foreach (OfferFilter* offerFilter, agentFilters->second) {
+          if (offerFilter->filter(toAllocate)) {
+            filters = true;
+            break;
+          }
+        }
+
+        if (!filters) {
+          break;
+        }
+
+        roleFiltered.frameworks.insert(frameworkId);
+      }
+
+      if (roleFiltered.frameworks.size() < roleFramework.second.size()) {
+        all = false;
+      }
+
+      if (roleFiltered.frameworks.empty()) {
+        continue;
+      }
+
+      if (roleFiltered.frameworks.size() == roleFramework.second.size()) {
+        roleFiltered.frameworks.clear();
+        roleFiltered.all = true;
+      }
+
+      agentFiltered.roles.emplace(role, std::move(roleFiltered));
+    }
+
+    if (all) {
+      agentFiltered.roles.clear();
+      agentFiltered.all = true;
+    }
+  }
+}
+
+
 void HierarchicalAllocatorProcess::trackAllocatedResources(
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
@@ -2776,6 +3737,16 @@ void HierarchicalAllocatorProcess::trackAllocatedResources(
       // See comment at `quotaRoleSorter` declaration regarding non-revocable.
       quotaRoleSorter->allocated(role, slaveId, allocation.nonRevocable());
     }
+
+    // NOTE: Unreserved resources cannot be shared, so each allocation
+    // of them is accounted for.
+    const ResourceQuantities unreserved =
+      ResourceQuantities::fromScalarResources(
+          allocation.unreserved().nonRevocable());
+
+    allocatedUnreservedNonRevocableScalarQuantities += unreserved;
+
+    trackConsumedQuota(role, unreserved);
   }
 }
 
@@ -2812,6 +3783,14 @@ void HierarchicalAllocatorProcess::untrackAllocatedResources(
       // See comment at `quotaRoleSorter` declaration regarding non-revocable.
       quotaRoleSorter->unallocated(role, slaveId, allocation.nonRevocable());
     }
+
+    const ResourceQuantities unreserved =
+      ResourceQuantities::fromScalarResources(
+          allocation.unreserved().nonRevocable());
+
+    allocatedUnreservedNonRevocableScalarQuantities -= unreserved;
+
+    untrackConsumedQuota(role, unreserved);
   }
 }
 
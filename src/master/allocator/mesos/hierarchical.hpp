@@ -17,26 +17,38 @@
 #ifndef __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 #define __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 
+#include <array>
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
 #include <process/future.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/boundedhashmap.hpp>
+#include <stout/circular_buffer.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
 #include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
 
 #include "common/protobuf_utils.hpp"
+#include "common/resource_quantities.hpp"
 
+#include "master/allocator/mesos/agent_order.hpp"
 #include "master/allocator/mesos/allocator.hpp"
 #include "master/allocator/mesos/metrics.hpp"
+#include "master/allocator/mesos/recorder.hpp"
+#include "master/allocator/mesos/worker_pool.hpp"
 
 #include "master/allocator/sorter/drf/sorter.hpp"
 #include "master/allocator/sorter/random/sorter.hpp"
@@ -89,11 +101,16 @@ public:
       paused(true),
       metrics(*this),
       completedFrameworkMetrics(0),
+      allocationSweepRequired(false),
+      allocationRequested(false),
+      offerFilterParallelism(1),
+      allocationProfiles(MAX_ALLOCATION_PROFILES),
+      offerFiltersEpoch(0),
       roleSorter(roleSorterFactory()),
       quotaRoleSorter(quotaRoleSorterFactory()),
       frameworkSorterFactory(_frameworkSorterFactory) {}
 
-  ~HierarchicalAllocatorProcess() override {}
+  ~HierarchicalAllocatorProcess() override;
 
   process::PID<HierarchicalAllocatorProcess> self() const
   {
@@ -101,7 +118,7 @@ public:
   }
 
   void initialize(
-      const Duration& allocationInterval,
+      const mesos::allocator::Options& options,
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<std::string, hashmap<SlaveID, Resources>>&)>&
@@ -109,14 +126,7 @@ public:
       const lambda::function<
           void(const FrameworkID&,
                const hashmap<SlaveID, UnavailableResources>&)>&
-        inverseOfferCallback,
-      const Option<std::set<std::string>>&
-        fairnessExcludeResourceNames = None(),
-      bool filterGpuResources = true,
-      const Option<DomainInfo>& domain = None(),
-      const Option<std::vector<Resources>>&
-        minAllocatableResources = None(),
-      const size_t maxCompletedFrameworks = 0) override;
+        inverseOfferCallback) override;
 
   void recover(
       const int _expectedAgentCount,
@@ -248,27 +258,48 @@ protected:
   // is deferred and batched with other allocation requests.
   process::Future<Nothing> allocate(const hashset<SlaveID>& slaveIds);
 
-  // Method that performs allocation work.
-  Nothing _allocate();
+  // Performs the allocation that is due every `allocationInterval`.
+  // If `allocationSweepInterval` is set, this only allocates from the
+  // agents that were marked as changed since the last allocation, and
+  // from all the agents only every `allocationSweepInterval`.
+  process::Future<Nothing> periodicAllocate();
 
-  // Helper for `_allocate()` that allocates resources for offers.
+  // Marks the agent as changed, so that the next periodic allocation
+  // allocates from it. Only used if `allocationSweepInterval` is set.
+  void markAgentChanged(const SlaveID& slaveId);
+
+  // Marks all the agents as changed, e.g. if a change to a role or a
+  // framework may affect the allocation of any agent.
+  void markAllAgentsChanged();
+
+  // Method that performs allocation work. The returned future becomes
+  // ready once the allocation run is complete, see `allocationCycle`.
+  process::Future<Nothing> _allocate();
+
+  // Helper for `_allocate()` that allocates from the agents of the next
+  // batch of the allocation cycle, and completes the cycle once it has
+  // allocated from all of its agents.
+  process::Future<Nothing> continueAllocation();
+
+  // Helper for `continueAllocation()` that allocates resources for
+  // offers from the agents of the next batch, and offers the resources
+  // once the batch is the cycle's last one.
   void __allocate();
 
-  // Helper for `_allocate()` that deallocates resources for inverse offers.
-  void deallocate();
+  // Helper for `_allocate()` that deallocates resources for inverse offers
+  // on the given agents.
+  void deallocate(const hashset<SlaveID>& slaveIds);
 
-  // Remove an offer filter for the specified role of the framework.
-  void expire(
-      const FrameworkID& frameworkId,
-      const std::string& role,
-      const SlaveID& slaveId,
-      OfferFilter* offerFilter);
+  // Helper for `setQuota()` and `recover()`, which records the quotas
+  // that it recovers itself.
+  void _setQuota(const std::string& role, const Quota& quota);
 
-  void _expire(
-      const FrameworkID& frameworkId,
-      const std::string& role,
-      const SlaveID& slaveId,
-      OfferFilter* offerFilter);
+  // Remove the offer filters that are due to expire by the time this
+  // is processed, see `offerFilterExpiry`. `deadline` is the expiry
+  // time that the timer was scheduled for.
+  void expireOfferFilters(const process::Time& deadline);
+
+  void _expireOfferFilters(const process::Time& deadline);
 
   // Remove an inverse offer filter for the specified framework.
   void expire(
@@ -293,7 +324,14 @@ protected:
       const FrameworkID& frameworkID,
       const SlaveID& slaveID) const;
 
-  bool allocatable(const Resources& resources);
+  bool allocatable(const Resources& resources) const;
+
+  // HTTP handlers.
+  // /hierarchical-allocator(N)/profile
+  process::Future<process::http::Response> profile(
+      const process::http::Request& request,
+      const Option<process::http::authentication::Principal>&);
+  static std::string profileHelp();
 
   bool initialized;
   bool paused;
@@ -303,6 +341,17 @@ protected:
 
   Duration allocationInterval;
 
+  // If set, the periodic allocation only allocates from the agents
+  // that changed, and from all the agents only this often.
+  Option<Duration> allocationSweepInterval;
+
+  // When the periodic allocation allocates from all the agents next.
+  process::Time nextAllocationSweep;
+
+  // Whether the next periodic allocation allocates from all the agents
+  // regardless of `nextAllocationSweep`.
+  bool allocationSweepRequired;
+
   lambda::function<
       void(const FrameworkID&,
            const hashmap<std::string, hashmap<SlaveID, Resources>>&)>
@@ -381,7 +430,8 @@ protected:
         activated(_activated),
         total(_total),
         allocated(_allocated),
-        shared(_total.shared())
+        shared(_total.shared()),
+        totalQuantities(AgentOrder::quantities(_total))
     {
       updateAvailable();
     }
@@ -392,9 +442,22 @@ protected:
 
     const Resources& getAvailable() const { return available; }
 
+    // The quantities of the total and available resources that the
+    // agents are ordered by, see `AgentOrder`.
+    const AgentOrder::Quantities& getTotalQuantities() const
+    {
+      return totalQuantities;
+    }
+
+    const AgentOrder::Quantities& getAvailableQuantities() const
+    {
+      return availableQuantities;
+    }
+
     void updateTotal(const Resources& newTotal) {
       total = newTotal;
       shared = total.shared();
+      totalQuantities = AgentOrder::quantities(total);
 
       updateAvailable();
     }
@@ -459,8 +522,20 @@ protected:
     // to send out `InverseOffers`.
     Option<Maintenance> maintenance;
 
+    // Set by the allocation loop to the current `offerFiltersEpoch` when
+    // the offer filters of all the frameworks that can be allocated this
+    // agent's resources above quota guarantees (i.e. in the second
+    // stage) filter its available resources. This lets the loop skip
+    // the agent until its resources change (which resets this, see
+    // `updateAvailable()`), one of its offer filters is removed, or the
+    // epoch is bumped because frameworks can be offered more resources.
+    Option<uint64_t> allFilteredEpoch;
+
   private:
     void updateAvailable() {
+      // The offer filters may not filter the changed resources.
+      allFilteredEpoch = None();
+
       // In order to subtract from the total,
       // we strip the allocation information.
       Resources allocated_ = allocated;
@@ -481,6 +556,8 @@ protected:
         // always include them as part of available resources.
         available = (total.nonShared() - allocated_.nonShared()) + shared;
       }
+
+      availableQuantities = AgentOrder::quantities(available);
     }
 
     // Total amount of regular *and* oversubscribed resources.
@@ -515,6 +592,9 @@ protected:
 
     // We keep a copy of the shared resources to avoid unnecessary copying.
     Resources shared;
+
+    AgentOrder::Quantities totalQuantities;
+    AgentOrder::Quantities availableQuantities;
   };
 
   hashmap<SlaveID, Slave> slaves;
@@ -524,10 +604,55 @@ protected:
   // processed, the set of candidates is cleared.
   hashset<SlaveID> allocationCandidates;
 
+  // The agents that had resources held back for the quota headroom in
+  // their last allocation. Since the headroom can change without these
+  // agents changing, they are allocation candidates of every periodic
+  // allocation, see `periodicAllocate()`.
+  hashset<SlaveID> heldBackAgents;
+
   // Future for the dispatched allocation that becomes
   // ready after the allocation run is complete.
   Option<process::Future<Nothing>> allocation;
 
+  // The state of an allocation run that is kept across its batches of
+  // agents. Without an `allocationBatchSize`, the run is a single batch.
+  //
+  // NOTE: Between the batches, the allocator handles the calls that
+  // were made into it meanwhile, so each batch allocates from the live
+  // state (e.g., skipping the agents that were removed), and the
+  // allocations are checked against it again before they are offered.
+  struct AllocationCycle
+  {
+    // The agents to allocate from, in the order of `agentOrder`.
+    std::vector<SlaveID> slaveIds;
+
+    // The position of the next agent to allocate from: the positions
+    // `[0, n)` are the agents in the first (quota) stage, and `[n, 2n)`
+    // are the agents in the second stage, where `n` is the number of
+    // agents.
+    size_t position = 0;
+
+    // The allocation candidates that the run started with.
+    hashset<SlaveID> candidates;
+
+    hashmap<FrameworkID, hashmap<std::string, hashmap<SlaveID, Resources>>>
+      offerable;
+
+    // See `__allocate()`.
+    hashmap<SlaveID, Resources> offeredSharedResources;
+
+    AllocationProfile profile;
+
+    Stopwatch stopwatch;
+  };
+
+  // The allocation run in progress, if any.
+  Option<AllocationCycle> allocationCycle;
+
+  // Whether an allocation was requested while an allocation run was in
+  // progress, in which case another run follows it.
+  bool allocationRequested;
+
   // We track information about roles that we're aware of in the system.
   // Specifically, we keep track of the roles when a framework subscribes to
   // the role, and/or when there are resources allocated to the role
@@ -539,11 +664,46 @@ protected:
   hashmap<std::string, Quota> quotas;
 
   // Aggregated resource reservations on all agents tied to a
-  // particular role, if any. These are stripped scalar quantities
-  // that contain no meta-data.
+  // particular role, if any. These are scalar quantities that contain
+  // no meta-data.
   //
   // Only roles with non-empty reservations will be stored in the map.
-  hashmap<std::string, Resources> reservationScalarQuantities;
+  hashmap<std::string, ResourceQuantities> reservationScalarQuantities;
+
+  // The quota consumed by each role, if any. We charge a role against
+  // its quota by considering its unreserved (non-revocable) allocation
+  // as well as all of its reservations, since reservations are bound to
+  // the role regardless of whether they are allocated:
+  //
+  //   Consumed Quota = reservations + unreserved allocation
+  //
+  // This is tracked for all roles (not only those with quota), so that
+  // it is readily available when quota is set. These are scalar
+  // quantities that contain no meta-data.
+  //
+  // Only roles with a non-empty consumed quota will be stored in the map.
+  hashmap<std::string, ResourceQuantities> consumedQuotaScalarQuantities;
+
+  // The quota guarantee of each role with quota, as quantities, to
+  // avoid converting the `Quota` protobuf in the allocation loop.
+  hashmap<std::string, ResourceQuantities> quotaGuaranteeScalarQuantities;
+
+  // The unreserved non-revocable resources that need to be held back
+  // so that the remaining quota guarantees can later be satisfied:
+  //
+  //   Required unreserved headroom =
+  //     sum (guarantee - consumed quota) for each role.
+  //
+  // Given the above, if a role has more reservations (which count towards
+  // consumed quota) than quota guarantee, we don't need to hold back any
+  // unreserved headroom for it.
+  ResourceQuantities requiredHeadroom;
+
+  // The unreserved non-revocable resources on all agents, and the
+  // portion of them that is allocated. Their difference is the headroom
+  // that is available to satisfy quota guarantees.
+  ResourceQuantities totalUnreservedNonRevocableScalarQuantities;
+  ResourceQuantities allocatedUnreservedNonRevocableScalarQuantities;
 
   // Slaves to send offers for.
   Option<hashset<std::string>> whitelist;
@@ -560,6 +720,60 @@ protected:
   // The minimum allocatable resources, if any.
   Option<std::vector<Resources>> minAllocatableResources;
 
+  // The maximum number of threads used to evaluate the offer filters
+  // in an allocation cycle.
+  size_t offerFilterParallelism;
+
+  // The threads which evaluate the offer filters along with the
+  // allocator's thread, if `offerFilterParallelism` is more than 1.
+  process::Owned<WorkerPool> offerFilterWorkers;
+
+  // The order in which an allocation cycle considers the agents.
+  AgentOrder agentOrder;
+
+  // The maximum number of agents that an allocation cycle allocates
+  // from before it handles the calls that were made meanwhile, if any.
+  Option<size_t> allocationBatchSize;
+
+  // The profiles of the most recent allocation runs, oldest first.
+  circular_buffer<AllocationProfile> allocationProfiles;
+
+  // Records the calls into the allocator, if `recordPath` is set.
+  process::Owned<Recorder> recorder;
+
+  // An offer filter along with the framework, role and agent that it
+  // is installed for.
+  struct ExpiringOfferFilter
+  {
+    FrameworkID frameworkId;
+    std::string role;
+    SlaveID slaveId;
+    OfferFilter* offerFilter;
+  };
+
+  // The offer filters that have yet to expire, keyed by expiry time.
+  //
+  // Rather than scheduling a timer for each offer filter, we only
+  // keep a timer scheduled for the earliest expiry time (see
+  // `offerFilterTimers`) and expire all the offer filters that are
+  // due whenever it fires. Frameworks that decline with the same (or
+  // longer) `refuse_seconds` therefore do not schedule any timers.
+  //
+  // NOTE: The allocator owns the offer filters through this map: an
+  // offer filter that is removed from its framework (e.g. on revive)
+  // is only deleted when it expires, so that its address is not reused
+  // for a filter that would be expired prematurely.
+  std::map<process::Time, std::vector<ExpiringOfferFilter>> offerFilterExpiry;
+
+  // The expiry times that timers have been scheduled for.
+  std::set<process::Time> offerFilterTimers;
+
+  // Bumped whenever a framework may be offered resources that its
+  // offer filters previously filtered, e.g. when a framework is added,
+  // activated or revived, which invalidates the `allFilteredEpoch` of
+  // all agents.
+  uint64_t offerFiltersEpoch;
+
   // There are two stages of allocation:
   //
   //   Stage 1: Allocate to satisfy quota guarantees.
@@ -663,6 +877,16 @@ private:
   void untrackReservations(
       const hashmap<std::string, Resources>& reservations);
 
+  // Helpers to update the quota consumed by a role, which also keep
+  // the `requiredHeadroom` up to date.
+  void trackConsumedQuota(
+      const std::string& role,
+      const ResourceQuantities& consumed);
+
+  void untrackConsumedQuota(
+      const std::string& role,
+      const ResourceQuantities& consumed);
+
   // Helper to update the agent's total resources maintained in the allocator
   // and the role and quota sorters (whose total resources match the agent's
   // total resources). Returns true iff the stored agent total was changed.
@@ -682,6 +906,21 @@ private:
       const protobuf::framework::Capabilities& frameworkCapabilities,
       const Slave& slave) const;
 
+  // The number of classes of agents, see `agentClass()`.
+  static constexpr size_t AGENT_CLASSES = 4;
+
+  // Returns the class of the agent, which determines the frameworks
+  // that are capable of receiving it: whether the agent has GPUs that
+  // are only offered to GPU-capable frameworks, and whether it is in a
+  // remote region.
+  size_t agentClass(const Slave& slave) const;
+
+  // Checks if a framework is capable of receiving the agents of the
+  // given class, see `agentClass()`.
+  bool isCapableOfReceivingAgent(
+      const protobuf::framework::Capabilities& frameworkCapabilities,
+      size_t agentClass) const;
+
   // Helper function that removes any resources that the framework is not
   // capable of receiving based on the given framework capability.
   //
@@ -691,6 +930,84 @@ private:
       const Resources& resources,
       const protobuf::framework::Capabilities& frameworkCapabilities) const;
 
+  // The number of classes of frameworks, see `resourceClass()`.
+  static constexpr size_t RESOURCE_CLASSES = 8;
+
+  // Returns the class of the framework by the capabilities that
+  // `stripIncapableResources()` depends on, so that the frameworks of
+  // the same class are capable of receiving the same resources.
+  static size_t resourceClass(
+      const protobuf::framework::Capabilities& frameworkCapabilities);
+
+  // The active frameworks of a role in the order of the role's framework
+  // sorter. An allocation cycle sorts the frameworks of a role once, and
+  // again only after it allocates resources to the role (which changes
+  // the order), rather than for every agent. For each class of agents
+  // (see `agentClass()`), it also keeps track of the frameworks that are
+  // capable of receiving such agents, so that the loop over the
+  // frameworks for an agent does not visit the frameworks that are
+  // suppressed or that are not capable of receiving the agent.
+  struct SortedFrameworks
+  {
+    // Whether the frameworks need to be sorted (again), e.g., since
+    // resources were allocated to the role after they were sorted.
+    bool stale = true;
+
+    // The framework IDs, as returned by the sorter.
+    std::vector<std::string> clients;
+
+    // The entries of `frameworks` for the `clients`, looked up on
+    // first use.
+    std::vector<const std::pair<const FrameworkID, Framework>*> resolved;
+
+    // For each class of agents, the positions in `clients` of the
+    // frameworks that are capable of receiving such agents. These are
+    // only computed up to the number of `checked` clients, as needed.
+    std::array<std::vector<size_t>, AGENT_CLASSES> capable;
+    std::array<size_t, AGENT_CLASSES> checked;
+  };
+
+  // Frameworks whose offer filters decline an agent's resources in the
+  // second stage of an allocation cycle, as long as none of the agent's
+  // resources have been allocated in that stage. For each role, these
+  // are the frameworks that come before the first one that does not
+  // filter the resources. See `__allocate()`.
+  struct FilteredFrameworks
+  {
+    struct Role
+    {
+      // If true, all the frameworks of the role have filtered the
+      // agent's resources, and `frameworks` is empty.
+      bool all = false;
+
+      hashset<FrameworkID> frameworks;
+    };
+
+    // The roles with at least one framework that has filtered the
+    // agent's resources.
+    hashmap<std::string, Role> roles;
+
+    // If true, all the frameworks of all the roles have filtered the
+    // agent's resources, and `roles` is empty.
+    bool all = false;
+  };
+
+  // Computes the `FilteredFrameworks` of the agents `slaveIds[begin,
+  // end)` for the given roles and their frameworks, storing the one of
+  // `slaveIds[i]` in `(*filtered)[i - offset]`.
+  //
+  // NOTE: This only reads the allocator's state, so it is safe to run
+  // it concurrently for disjoint agents.
+  void computeFilteredFrameworks(
+      const std::vector<std::pair<std::string, std::vector<FrameworkID>>>&
+        roleFrameworks,
+      const hashmap<SlaveID, Resources>& offeredSharedResources,
+      const std::vector<SlaveID>& slaveIds,
+      size_t begin,
+      size_t end,
+      size_t offset,
+      std::vector<FilteredFrameworks>* filtered) const;
+
   // Helper to track allocated resources on an agent.
   void trackAllocatedResources(
       const SlaveID& slaveId,
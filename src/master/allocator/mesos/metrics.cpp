@@ -32,7 +32,9 @@
 
 #include "master/allocator/mesos/hierarchical.hpp"
 
+using std::pair;
 using std::string;
+using std::vector;
 
 using process::metrics::PullGauge;
 using process::metrics::PushGauge;
@@ -43,6 +45,20 @@ namespace master {
 namespace allocator {
 namespace internal {
 
+vector<pair<string, Duration>> AllocationProfile::steps() const
+{
+  return {
+    {"filter_candidates", filterCandidates},
+    {"quota_preamble", quotaPreamble},
+    {"quota_stage", quotaStage},
+    {"non_quota_stage", nonQuotaStage},
+    {"sorts", sorts},
+    {"filter_checks", filterChecks},
+    {"offer_callback", offerCallback},
+    {"deallocate", deallocate}};
+}
+
+
 Metrics::Metrics(const HierarchicalAllocatorProcess& _allocator)
   : allocator(_allocator.self()),
     event_queue_dispatches(
@@ -63,6 +79,14 @@ Metrics::Metrics(const HierarchicalAllocatorProcess& _allocator)
   process::metrics::add(allocation_run);
   process::metrics::add(allocation_run_latency);
 
+  foreach (const auto& step, AllocationProfile().steps()) {
+    PushGauge gauge("allocator/mesos/allocation_run/" + step.first + "_ms");
+
+    allocation_run_steps.put(step.first, gauge);
+
+    process::metrics::add(gauge);
+  }
+
   // Create and install gauges for the total and allocated
   // amount of standard scalar resources.
   //
@@ -102,6 +126,10 @@ Metrics::~Metrics()
   process::metrics::remove(allocation_run);
   process::metrics::remove(allocation_run_latency);
 
+  foreachvalue (const PushGauge& gauge, allocation_run_steps) {
+    process::metrics::remove(gauge);
+  }
+
   foreach (const PullGauge& gauge, resources_total) {
     process::metrics::remove(gauge);
   }
@@ -214,6 +242,16 @@ void Metrics::removeRole(const string& role)
 }
 
 
+void Metrics::allocationRun(const AllocationProfile& profile)
+{
+  foreach (const auto& step, profile.steps()) {
+    CHECK(allocation_run_steps.contains(step.first));
+
+    allocation_run_steps.at(step.first) = step.second.ms();
+  }
+}
+
+
 FrameworkMetrics::FrameworkMetrics(const FrameworkInfo& _frameworkInfo)
   : frameworkInfo(_frameworkInfo)
 {
@@ -18,6 +18,7 @@
 #define __MASTER_ALLOCATOR_MESOS_METRICS_HPP__
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <mesos/quota/quota.hpp>
@@ -28,7 +29,9 @@
 #include <process/metrics/timer.hpp>
 
 #include <process/pid.hpp>
+#include <process/time.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 
 namespace mesos {
@@ -40,6 +43,53 @@ namespace internal {
 // Forward declarations.
 class HierarchicalAllocatorProcess;
 
+
+// The timings and counts of an allocation run, which the allocator
+// keeps for its most recent runs, see its `/profile` endpoint.
+struct AllocationProfile
+{
+  // The time spent in each step of the run, by name. Sorting and
+  // checking the offer filters happen within the two stages.
+  std::vector<std::pair<std::string, Duration>> steps() const;
+
+  // When the run started.
+  process::Time start;
+
+  // The number of allocation candidates, and the number of them that
+  // were allocated from (e.g., without the deactivated agents).
+  size_t candidates = 0;
+  size_t agents = 0;
+
+  // The number of batches that the run took.
+  size_t batches = 0;
+
+  // The agents and frameworks that each stage considered. A framework
+  // is counted once for each agent that it was considered for.
+  size_t quotaStageAgents = 0;
+  size_t quotaStageFrameworks = 0;
+  size_t nonQuotaStageAgents = 0;
+  size_t nonQuotaStageFrameworks = 0;
+
+  // The number of frameworks that were offered resources, and of the
+  // agents (per role) that they were offered resources on.
+  size_t frameworksOffered = 0;
+  size_t offers = 0;
+
+  Duration filterCandidates;
+  Duration quotaPreamble;
+  Duration quotaStage;
+  Duration nonQuotaStage;
+  Duration sorts;
+  Duration filterChecks;
+  Duration offerCallback;
+  Duration deallocate;
+
+  // The duration of the whole run, including the time between its
+  // batches.
+  Duration total;
+};
+
+
 // Collection of metrics for the allocator; these begin
 // with the following prefix: `allocator/mesos/`.
 struct Metrics
@@ -54,6 +104,9 @@ struct Metrics
   void addRole(const std::string& role);
   void removeRole(const std::string& role);
 
+  // Updates the step timings of the last allocation run.
+  void allocationRun(const AllocationProfile& profile);
+
   const process::PID<HierarchicalAllocatorProcess> allocator;
 
   // Number of dispatch events currently waiting in the allocator process.
@@ -73,6 +126,10 @@ struct Metrics
   // The latency of allocation runs due to the batching of allocation requests.
   process::metrics::Timer<Milliseconds> allocation_run_latency;
 
+  // PushGauges for the time spent in each step of the last allocation
+  // run, see `AllocationProfile::steps()`.
+  hashmap<std::string, process::metrics::PushGauge> allocation_run_steps;
+
   // PullGauges for the total amount of each resource in the cluster.
   std::vector<process::metrics::PullGauge> resources_total;
 
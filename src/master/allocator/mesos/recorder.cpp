@@ -0,0 +1,449 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "master/allocator/mesos/recorder.hpp"
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <process/clock.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/nothing.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/write.hpp>
+
+using std::set;
+using std::string;
+using std::vector;
+
+using process::Clock;
+using process::Owned;
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+// The number of bytes of events that are buffered before they are
+// written to the file, regardless of `flush()`.
+static const size_t FLUSH_THRESHOLD = 1024 * 1024;
+
+
+static AllocatorEvent createEvent(AllocatorEvent::Type type)
+{
+  AllocatorEvent event;
+  event.set_type(type);
+  event.set_timestamp(Clock::now().secs());
+  return event;
+}
+
+
+Try<Owned<Recorder>> Recorder::create(
+    const string& path,
+    const Bytes& maxSize)
+{
+  Try<int_fd> fd = os::open(
+      path,
+      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  return Owned<Recorder>(new Recorder(fd.get(), maxSize));
+}
+
+
+Recorder::~Recorder()
+{
+  flush();
+  os::close(fd);
+}
+
+
+void Recorder::initialize(const mesos::allocator::Options& options)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::INITIALIZE);
+  AllocatorEvent::Initialize* initialize = event.mutable_initialize();
+
+  initialize->set_allocation_interval(options.allocationInterval.secs());
+
+  if (options.allocationSweepInterval.isSome()) {
+    initialize->set_allocation_sweep_interval(
+        options.allocationSweepInterval->secs());
+  }
+
+  if (options.fairnessExcludeResourceNames.isSome()) {
+    foreach (const string& name, options.fairnessExcludeResourceNames.get()) {
+      initialize->add_fairness_exclude_resource_names(name);
+    }
+  }
+
+  initialize->set_filter_gpu_resources(options.filterGpuResources);
+
+  if (options.domain.isSome()) {
+    initialize->mutable_domain()->CopyFrom(options.domain.get());
+  }
+
+  if (options.minAllocatableResources.isSome()) {
+    foreach (const Resources& resources,
+             options.minAllocatableResources.get()) {
+      initialize->add_min_allocatable_resources()->mutable_resources()
+        ->CopyFrom(resources);
+    }
+  }
+
+  initialize->set_agent_order(options.agentOrder);
+
+  record(event);
+}
+
+
+void Recorder::recover(
+    int expectedAgentCount,
+    const hashmap<string, Quota>& quotas)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::RECOVER);
+  AllocatorEvent::Recover* recover = event.mutable_recover();
+
+  recover->set_expected_agent_count(expectedAgentCount);
+
+  foreachvalue (const Quota& quota, quotas) {
+    recover->add_quotas()->CopyFrom(quota.info);
+  }
+
+  record(event);
+}
+
+
+void Recorder::addFramework(
+    const FrameworkID& frameworkId,
+    const FrameworkInfo& frameworkInfo,
+    const hashmap<SlaveID, Resources>& used,
+    bool active,
+    const set<string>& suppressedRoles)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::ADD_FRAMEWORK);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+
+  AllocatorEvent::AddFramework* addFramework = event.mutable_add_framework();
+  addFramework->mutable_framework_info()->CopyFrom(frameworkInfo);
+
+  foreachpair (const SlaveID& slaveId, const Resources& resources, used) {
+    AllocatorEvent::Allocation* allocation = addFramework->add_used();
+    allocation->mutable_slave_id()->CopyFrom(slaveId);
+    allocation->mutable_resources()->CopyFrom(resources);
+  }
+
+  addFramework->set_active(active);
+
+  foreach (const string& role, suppressedRoles) {
+    addFramework->add_suppressed_roles(role);
+  }
+
+  record(event);
+}
+
+
+void Recorder::removeFramework(const FrameworkID& frameworkId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::REMOVE_FRAMEWORK);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+  record(event);
+}
+
+
+void Recorder::activateFramework(const FrameworkID& frameworkId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::ACTIVATE_FRAMEWORK);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+  record(event);
+}
+
+
+void Recorder::deactivateFramework(const FrameworkID& frameworkId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::DEACTIVATE_FRAMEWORK);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+  record(event);
+}
+
+
+void Recorder::updateFramework(
+    const FrameworkID& frameworkId,
+    const FrameworkInfo& frameworkInfo,
+    const set<string>& suppressedRoles)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::UPDATE_FRAMEWORK);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+
+  AllocatorEvent::UpdateFramework* updateFramework =
+    event.mutable_update_framework();
+
+  updateFramework->mutable_framework_info()->CopyFrom(frameworkInfo);
+
+  foreach (const string& role, suppressedRoles) {
+    updateFramework->add_suppressed_roles(role);
+  }
+
+  record(event);
+}
+
+
+void Recorder::addSlave(
+    const SlaveID& slaveId,
+    const SlaveInfo& slaveInfo,
+    const vector<SlaveInfo::Capability>& capabilities,
+    const Option<Unavailability>& unavailability,
+    const Resources& total,
+    const hashmap<FrameworkID, Resources>& used)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::ADD_SLAVE);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+
+  AllocatorEvent::AddSlave* addSlave = event.mutable_add_slave();
+  addSlave->mutable_slave_info()->CopyFrom(slaveInfo);
+
+  foreach (const SlaveInfo::Capability& capability, capabilities) {
+    addSlave->add_capabilities()->CopyFrom(capability);
+  }
+
+  if (unavailability.isSome()) {
+    addSlave->mutable_unavailability()->CopyFrom(unavailability.get());
+  }
+
+  addSlave->mutable_total()->CopyFrom(total);
+
+  foreachpair (const FrameworkID& frameworkId,
+               const Resources& resources,
+               used) {
+    AllocatorEvent::Allocation* allocation = addSlave->add_used();
+    allocation->mutable_framework_id()->CopyFrom(frameworkId);
+    allocation->mutable_resources()->CopyFrom(resources);
+  }
+
+  record(event);
+}
+
+
+void Recorder::removeSlave(const SlaveID& slaveId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::REMOVE_SLAVE);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+  record(event);
+}
+
+
+void Recorder::updateSlave(
+    const SlaveID& slaveId,
+    const SlaveInfo& slaveInfo,
+    const Option<Resources>& total,
+    const Option<vector<SlaveInfo::Capability>>& capabilities)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::UPDATE_SLAVE);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+
+  AllocatorEvent::UpdateSlave* updateSlave = event.mutable_update_slave();
+  updateSlave->mutable_slave_info()->CopyFrom(slaveInfo);
+
+  if (total.isSome()) {
+    updateSlave->set_update_total(true);
+    updateSlave->mutable_total()->CopyFrom(total.get());
+  }
+
+  if (capabilities.isSome()) {
+    updateSlave->set_update_capabilities(true);
+
+    foreach (const SlaveInfo::Capability& capability, capabilities.get()) {
+      updateSlave->add_capabilities()->CopyFrom(capability);
+    }
+  }
+
+  record(event);
+}
+
+
+void Recorder::activateSlave(const SlaveID& slaveId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::ACTIVATE_SLAVE);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+  record(event);
+}
+
+
+void Recorder::deactivateSlave(const SlaveID& slaveId)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::DEACTIVATE_SLAVE);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+  record(event);
+}
+
+
+void Recorder::recoverResources(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    const Option<Filters>& filters)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::RECOVER_RESOURCES);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+  event.mutable_slave_id()->CopyFrom(slaveId);
+
+  AllocatorEvent::RecoverResources* recoverResources =
+    event.mutable_recover_resources();
+
+  recoverResources->mutable_resources()->CopyFrom(resources);
+
+  if (filters.isSome()) {
+    recoverResources->mutable_filters()->CopyFrom(filters.get());
+  }
+
+  record(event);
+}
+
+
+void Recorder::suppressOffers(
+    const FrameworkID& frameworkId,
+    const set<string>& roles)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::SUPPRESS_OFFERS);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+
+  AllocatorEvent::SuppressOffers* suppressOffers =
+    event.mutable_suppress_offers();
+
+  foreach (const string& role, roles) {
+    suppressOffers->add_roles(role);
+  }
+
+  record(event);
+}
+
+
+void Recorder::reviveOffers(
+    const FrameworkID& frameworkId,
+    const set<string>& roles)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::REVIVE_OFFERS);
+  event.mutable_framework_id()->CopyFrom(frameworkId);
+
+  AllocatorEvent::ReviveOffers* reviveOffers = event.mutable_revive_offers();
+
+  foreach (const string& role, roles) {
+    reviveOffers->add_roles(role);
+  }
+
+  record(event);
+}
+
+
+void Recorder::setQuota(const string& role, const Quota& quota)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::SET_QUOTA);
+
+  AllocatorEvent::SetQuota* setQuota = event.mutable_set_quota();
+  setQuota->set_role(role);
+  setQuota->mutable_quota_info()->CopyFrom(quota.info);
+
+  record(event);
+}
+
+
+void Recorder::removeQuota(const string& role)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::REMOVE_QUOTA);
+  event.mutable_remove_quota()->set_role(role);
+  record(event);
+}
+
+
+void Recorder::updateWeights(const vector<WeightInfo>& weights)
+{
+  AllocatorEvent event = createEvent(AllocatorEvent::UPDATE_WEIGHTS);
+
+  AllocatorEvent::UpdateWeights* updateWeights =
+    event.mutable_update_weights();
+
+  foreach (const WeightInfo& weight, weights) {
+    updateWeights->add_weights()->CopyFrom(weight);
+  }
+
+  record(event);
+}
+
+
+void Recorder::flush()
+{
+  if (buffer.empty()) {
+    return;
+  }
+
+  Try<Nothing> write = os::write(fd, buffer);
+  if (write.isError()) {
+    LOG(ERROR) << "Failed to write the recorded allocator events: "
+               << write.error();
+  }
+
+  buffer.clear();
+}
+
+
+void Recorder::record(const AllocatorEvent& event)
+{
+  if (full) {
+    return;
+  }
+
+  // This is the format of `protobuf::write`, so that the events can
+  // be read back with `protobuf::read`.
+  const uint32_t length = event.ByteSize();
+
+  // We never record part of an event, nor any event after one that
+  // did not fit, so that the recording can still be replayed.
+  if (size + Bytes(sizeof(length) + length) > maxSize) {
+    LOG(WARNING) << "Stopped recording the allocator calls since the"
+                 << " recording reached its maximum size of " << maxSize;
+
+    full = true;
+    flush();
+    return;
+  }
+
+  size += Bytes(sizeof(length) + length);
+
+  buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+
+  event.AppendToString(&buffer);
+
+  if (buffer.size() >= FLUSH_THRESHOLD) {
+    flush();
+  }
+}
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
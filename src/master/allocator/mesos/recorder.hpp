@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_ALLOCATOR_MESOS_RECORDER_HPP__
+#define __MASTER_ALLOCATOR_MESOS_RECORDER_HPP__
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <mesos/allocator/allocator.hpp>
+
+#include <mesos/quota/quota.hpp>
+
+#include <process/owned.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/int_fd.hpp>
+
+#include "master/allocator/mesos/recorder.pb.h"
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+// Records the calls into an allocator, with the (libprocess) time at
+// which they were made, to a file of length prefixed `AllocatorEvent`
+// protobufs. Replaying the calls into a fresh allocator reproduces
+// its allocations offline, see `mesos-allocator-replay`.
+//
+// Only the calls that affect the allocations are recorded: the
+// resource providers, operations, maintenance and the whitelist are
+// not. The events are buffered and only written to the file once
+// enough of them are buffered or `flush()` is called.
+//
+// NOTE: This is meant for debugging. The writes happen synchronously
+// on the caller's thread and the file is not rotated: once recording
+// another event would exceed the maximum size, nothing more is
+// recorded, so that the file remains a replayable prefix of the calls.
+class Recorder
+{
+public:
+  // Creates the file at `path` to record up to `maxSize` to,
+  // truncating it if it exists.
+  static Try<process::Owned<Recorder>> create(
+      const std::string& path,
+      const Bytes& maxSize);
+
+  ~Recorder();
+
+  void initialize(const mesos::allocator::Options& options);
+
+  void recover(
+      int expectedAgentCount,
+      const hashmap<std::string, Quota>& quotas);
+
+  void addFramework(
+      const FrameworkID& frameworkId,
+      const FrameworkInfo& frameworkInfo,
+      const hashmap<SlaveID, Resources>& used,
+      bool active,
+      const std::set<std::string>& suppressedRoles);
+
+  void removeFramework(const FrameworkID& frameworkId);
+
+  void activateFramework(const FrameworkID& frameworkId);
+
+  void deactivateFramework(const FrameworkID& frameworkId);
+
+  void updateFramework(
+      const FrameworkID& frameworkId,
+      const FrameworkInfo& frameworkInfo,
+      const std::set<std::string>& suppressedRoles);
+
+  void addSlave(
+      const SlaveID& slaveId,
+      const SlaveInfo& slaveInfo,
+      const std::vector<SlaveInfo::Capability>& capabilities,
+      const Option<Unavailability>& unavailability,
+      const Resources& total,
+      const hashmap<FrameworkID, Resources>& used);
+
+  void removeSlave(const SlaveID& slaveId);
+
+  void updateSlave(
+      const SlaveID& slaveId,
+      const SlaveInfo& slaveInfo,
+      const Option<Resources>& total,
+      const Option<std::vector<SlaveInfo::Capability>>& capabilities);
+
+  void activateSlave(const SlaveID& slaveId);
+
+  void deactivateSlave(const SlaveID& slaveId);
+
+  void recoverResources(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources,
+      const Option<Filters>& filters);
+
+  void suppressOffers(
+      const FrameworkID& frameworkId,
+      const std::set<std::string>& roles);
+
+  void reviveOffers(
+      const FrameworkID& frameworkId,
+      const std::set<std::string>& roles);
+
+  void setQuota(const std::string& role, const Quota& quota);
+
+  void removeQuota(const std::string& role);
+
+  void updateWeights(const std::vector<WeightInfo>& weights);
+
+  // Writes the buffered events to the file.
+  void flush();
+
+private:
+  Recorder(int_fd _fd, const Bytes& _maxSize)
+    : fd(_fd), maxSize(_maxSize) {}
+
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  void record(const AllocatorEvent& event);
+
+  const int_fd fd;
+  const Bytes maxSize;
+
+  // The size of the events recorded so far, including the buffered ones.
+  Bytes size;
+
+  // Whether recording stopped because of `maxSize`.
+  bool full = false;
+
+  // The length prefixed events that are not yet written to the file.
+  std::string buffer;
+};
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_ALLOCATOR_MESOS_RECORDER_HPP__
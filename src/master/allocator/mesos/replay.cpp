@@ -0,0 +1,772 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays a recording of the calls into an allocator (see
+// `--allocator_record_path`) against a fresh allocator, with the clock
+// paused, and reports how long its allocation cycles took, how many
+// offers it made and how fairly it allocated the resources.
+//
+// The replayed allocator does not necessarily make the same offers as
+// the recorded one (e.g. the agents are shuffled), so the recorded
+// calls to `recoverResources()` are applied to the offers that the
+// replayed allocator made instead: if the framework was not allocated
+// the recorded resources on the agent, all the resources it was
+// allocated on the agent for the role are recovered.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <mesos/allocator/allocator.hpp>
+
+#include <mesos/quota/quota.hpp>
+
+#include <process/clock.hpp>
+#include <process/process.hpp>
+#include <process/time.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/flags.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/protobuf.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/synchronized.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/open.hpp>
+
+#include "common/protobuf_utils.hpp"
+#include "common/resource_quantities.hpp"
+
+#include "logging/flags.hpp"
+#include "logging/logging.hpp"
+
+#include "master/constants.hpp"
+
+#include "master/allocator/mesos/recorder.hpp"
+
+using namespace mesos;
+
+using mesos::allocator::Allocator;
+
+using mesos::internal::master::DEFAULT_ALLOCATOR;
+
+using mesos::internal::master::allocator::AllocatorEvent;
+
+using mesos::internal::protobuf::framework::getRoles;
+
+using process::Clock;
+using process::Time;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+
+class Flags : public virtual mesos::internal::logging::Flags
+{
+public:
+  Flags()
+  {
+    setUsageMessage(
+        "Usage: mesos-allocator-replay --path=<PATH> [options]\n"
+        "\n"
+        "Replays the calls into an allocator that a master recorded\n"
+        "(see the `--allocator_record_path` flag of the master) against\n"
+        "a fresh allocator with a paused clock, and reports the latency\n"
+        "of its allocation cycles, the offers it made and how fairly\n"
+        "it allocated the resources between the roles.\n"
+        "\n");
+
+    add(&Flags::path,
+        "path",
+        "Path to the recording to replay.");
+
+    add(&Flags::role_sorter,
+        "role_sorter",
+        "Policy to use for allocating resources between roles.\n"
+        "May be one of: [drf, random]",
+        "drf");
+
+    add(&Flags::framework_sorter,
+        "framework_sorter",
+        "Policy to use for allocating resources between a given role's\n"
+        "frameworks. Options are the same as for `--role_sorter`.",
+        "drf");
+
+    add(&Flags::allocation_interval,
+        "allocation_interval",
+        "If set, overrides the recorded amount of time between (batch)\n"
+        "allocations.");
+
+    add(&Flags::allocation_agent_order,
+        "allocation_agent_order",
+        "If set, overrides the recorded order in which the allocator\n"
+        "considers agents, see the flag of the master.");
+  }
+
+  Option<string> path;
+  string role_sorter;
+  string framework_sorter;
+  Option<Duration> allocation_interval;
+  Option<string> allocation_agent_order;
+};
+
+
+// The state of the replay, which the recorded calls are translated
+// against and the metrics are computed from.
+class Replay
+{
+public:
+  Replay(Allocator* _allocator, const Time& _start, double _recordedStart)
+    : offersMade(0),
+      allocator(_allocator),
+      start(_start),
+      recordedStart(_recordedStart) {}
+
+  // Invoked by the allocator for each allocation that it makes.
+  void offer(
+      const FrameworkID& frameworkId,
+      const hashmap<string, hashmap<SlaveID, Resources>>& resources)
+  {
+    synchronized (mutex) {
+      offers.push_back({frameworkId, resources});
+    }
+  }
+
+  // Returns the (replay) time at which the event is replayed.
+  Time time(const AllocatorEvent& event) const
+  {
+    return start + Nanoseconds(static_cast<int64_t>(
+        (event.timestamp() - recordedStart) * Seconds(1).ns()));
+  }
+
+  // Makes the recorded call into the allocator.
+  void apply(const AllocatorEvent& event);
+
+  // Accounts for the offers that the allocator made since this was
+  // last called, and returns how many there were.
+  size_t collect();
+
+  // Returns Jain's fairness index over the weighted dominant shares of
+  // the roles of the frameworks, or none if nothing is allocated.
+  Option<double> fairness() const;
+
+  // Returns the weighted dominant shares of the roles of the frameworks.
+  hashmap<string, double> shares() const;
+
+  size_t offersMade;
+
+private:
+  Allocator* allocator;
+  const Time start;
+  const double recordedStart;
+
+  std::mutex mutex;
+  vector<pair<FrameworkID, hashmap<string, hashmap<SlaveID, Resources>>>>
+    offers;
+
+  // The roles of the frameworks that the allocator knows.
+  hashmap<FrameworkID, set<string>> frameworks;
+
+  // The total resources of the agents that the allocator knows.
+  hashmap<SlaveID, Resources> agents;
+
+  // The resources allocated to each framework on each agent.
+  hashmap<FrameworkID, hashmap<SlaveID, Resources>> allocations;
+
+  hashmap<string, double> weights;
+};
+
+
+void Replay::apply(const AllocatorEvent& event)
+{
+  const FrameworkID& frameworkId = event.framework_id();
+  const SlaveID& slaveId = event.slave_id();
+
+  switch (event.type()) {
+    case AllocatorEvent::RECOVER: {
+      hashmap<string, Quota> quotas;
+      foreach (const quota::QuotaInfo& info, event.recover().quotas()) {
+        quotas[info.role()] = Quota{info};
+      }
+
+      allocator->recover(event.recover().expected_agent_count(), quotas);
+      break;
+    }
+    case AllocatorEvent::ADD_FRAMEWORK: {
+      const AllocatorEvent::AddFramework& addFramework = event.add_framework();
+
+      hashmap<SlaveID, Resources> used;
+      foreach (const AllocatorEvent::Allocation& allocation,
+               addFramework.used()) {
+        used[allocation.slave_id()] += allocation.resources();
+
+        // Like the allocator, only track the resources on the agents
+        // that it knows.
+        if (agents.contains(allocation.slave_id())) {
+          allocations[frameworkId][allocation.slave_id()] +=
+            allocation.resources();
+        }
+      }
+
+      frameworks[frameworkId] =
+        getRoles(addFramework.framework_info());
+
+      allocator->addFramework(
+          frameworkId,
+          addFramework.framework_info(),
+          used,
+          addFramework.active(),
+          set<string>(
+              addFramework.suppressed_roles().begin(),
+              addFramework.suppressed_roles().end()));
+      break;
+    }
+    case AllocatorEvent::REMOVE_FRAMEWORK: {
+      frameworks.erase(frameworkId);
+      allocations.erase(frameworkId);
+
+      allocator->removeFramework(frameworkId);
+      break;
+    }
+    case AllocatorEvent::ACTIVATE_FRAMEWORK: {
+      allocator->activateFramework(frameworkId);
+      break;
+    }
+    case AllocatorEvent::DEACTIVATE_FRAMEWORK: {
+      allocator->deactivateFramework(frameworkId);
+      break;
+    }
+    case AllocatorEvent::UPDATE_FRAMEWORK: {
+      const AllocatorEvent::UpdateFramework& updateFramework =
+        event.update_framework();
+
+      frameworks[frameworkId] =
+        getRoles(updateFramework.framework_info());
+
+      allocator->updateFramework(
+          frameworkId,
+          updateFramework.framework_info(),
+          set<string>(
+              updateFramework.suppressed_roles().begin(),
+              updateFramework.suppressed_roles().end()));
+      break;
+    }
+    case AllocatorEvent::ADD_SLAVE: {
+      const AllocatorEvent::AddSlave& addSlave = event.add_slave();
+
+      hashmap<FrameworkID, Resources> used;
+      foreach (const AllocatorEvent::Allocation& allocation,
+               addSlave.used()) {
+        used[allocation.framework_id()] += allocation.resources();
+
+        // Like the allocator, only track the resources of the
+        // frameworks that it knows.
+        if (frameworks.contains(allocation.framework_id())) {
+          allocations[allocation.framework_id()][slaveId] +=
+            allocation.resources();
+        }
+      }
+
+      agents[slaveId] = addSlave.total();
+
+      Option<Unavailability> unavailability;
+      if (addSlave.has_unavailability()) {
+        unavailability = addSlave.unavailability();
+      }
+
+      allocator->addSlave(
+          slaveId,
+          addSlave.slave_info(),
+          vector<SlaveInfo::Capability>(
+              addSlave.capabilities().begin(),
+              addSlave.capabilities().end()),
+          unavailability,
+          addSlave.total(),
+          used);
+      break;
+    }
+    case AllocatorEvent::REMOVE_SLAVE: {
+      agents.erase(slaveId);
+
+      foreach (auto& allocation, allocations) {
+        allocation.second.erase(slaveId);
+      }
+
+      allocator->removeSlave(slaveId);
+      break;
+    }
+    case AllocatorEvent::UPDATE_SLAVE: {
+      const AllocatorEvent::UpdateSlave& updateSlave = event.update_slave();
+
+      Option<Resources> total;
+      if (updateSlave.update_total()) {
+        total = updateSlave.total();
+        agents[slaveId] = total.get();
+      }
+
+      Option<vector<SlaveInfo::Capability>> capabilities;
+      if (updateSlave.update_capabilities()) {
+        capabilities = vector<SlaveInfo::Capability>(
+            updateSlave.capabilities().begin(),
+            updateSlave.capabilities().end());
+      }
+
+      allocator->updateSlave(
+          slaveId, updateSlave.slave_info(), total, capabilities);
+      break;
+    }
+    case AllocatorEvent::ACTIVATE_SLAVE: {
+      allocator->activateSlave(slaveId);
+      break;
+    }
+    case AllocatorEvent::DEACTIVATE_SLAVE: {
+      allocator->deactivateSlave(slaveId);
+      break;
+    }
+    case AllocatorEvent::RECOVER_RESOURCES: {
+      const Resources resources = event.recover_resources().resources();
+
+      if (resources.empty() ||
+          !allocations.contains(frameworkId) ||
+          !allocations.at(frameworkId).contains(slaveId)) {
+        break;
+      }
+
+      // The resources are recovered for a single role at a time.
+      const hashmap<string, Resources> recoveredToRole =
+        resources.allocations();
+
+      if (recoveredToRole.size() != 1) {
+        break;
+      }
+
+      Resources& allocated = allocations.at(frameworkId).at(slaveId);
+
+      const Resources allocatedToRole =
+        allocated.allocations().get(recoveredToRole.begin()->first)
+          .getOrElse(Resources());
+
+      const Resources recovered = allocatedToRole.contains(resources)
+        ? resources
+        : allocatedToRole;
+
+      if (recovered.empty()) {
+        break;
+      }
+
+      allocated -= recovered;
+
+      Option<Filters> filters;
+      if (event.recover_resources().has_filters()) {
+        filters = event.recover_resources().filters();
+      }
+
+      allocator->recoverResources(frameworkId, slaveId, recovered, filters);
+      break;
+    }
+    case AllocatorEvent::SUPPRESS_OFFERS: {
+      allocator->suppressOffers(
+          frameworkId,
+          set<string>(
+              event.suppress_offers().roles().begin(),
+              event.suppress_offers().roles().end()));
+      break;
+    }
+    case AllocatorEvent::REVIVE_OFFERS: {
+      allocator->reviveOffers(
+          frameworkId,
+          set<string>(
+              event.revive_offers().roles().begin(),
+              event.revive_offers().roles().end()));
+      break;
+    }
+    case AllocatorEvent::SET_QUOTA: {
+      allocator->setQuota(
+          event.set_quota().role(), Quota{event.set_quota().quota_info()});
+      break;
+    }
+    case AllocatorEvent::REMOVE_QUOTA: {
+      allocator->removeQuota(event.remove_quota().role());
+      break;
+    }
+    case AllocatorEvent::UPDATE_WEIGHTS: {
+      vector<WeightInfo> weightInfos;
+      foreach (const WeightInfo& weightInfo,
+               event.update_weights().weights()) {
+        weights[weightInfo.role()] = weightInfo.weight();
+        weightInfos.push_back(weightInfo);
+      }
+
+      allocator->updateWeights(weightInfos);
+      break;
+    }
+    case AllocatorEvent::INITIALIZE:
+    case AllocatorEvent::UNKNOWN: {
+      LOG(WARNING) << "Ignoring unexpected allocator event of type "
+                   << AllocatorEvent::Type_Name(event.type());
+      break;
+    }
+  }
+}
+
+
+size_t Replay::collect()
+{
+  vector<pair<FrameworkID, hashmap<string, hashmap<SlaveID, Resources>>>>
+    offers_;
+
+  synchronized (mutex) {
+    std::swap(offers, offers_);
+  }
+
+  size_t count = 0;
+
+  foreach (const auto& offer, offers_) {
+    foreachvalue (const auto& resources, offer.second) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& offered,
+                   resources) {
+        allocations[offer.first][slaveId] += offered;
+        ++count;
+      }
+    }
+  }
+
+  offersMade += count;
+
+  return count;
+}
+
+
+hashmap<string, double> Replay::shares() const
+{
+  ResourceQuantities total;
+  foreachvalue (const Resources& resources, agents) {
+    total += ResourceQuantities::fromScalarResources(resources);
+  }
+
+  hashmap<string, ResourceQuantities> allocated;
+
+  foreachvalue (const set<string>& roles, frameworks) {
+    foreach (const string& role, roles) {
+      allocated[role];
+    }
+  }
+
+  foreachvalue (const auto& allocation, allocations) {
+    foreachvalue (const Resources& resources, allocation) {
+      foreachpair (const string& role,
+                   const Resources& resources_,
+                   resources.allocations()) {
+        allocated[role] += ResourceQuantities::fromScalarResources(resources_);
+      }
+    }
+  }
+
+  hashmap<string, double> result;
+
+  foreachpair (const string& role,
+               const ResourceQuantities& quantities,
+               allocated) {
+    double share = 0.0;
+
+    foreach (const string& name, total.names()) {
+      share = std::max(
+          share, quantities.get(name).value() / total.get(name).value());
+    }
+
+    result[role] = share / weights.get(role).getOrElse(1.0);
+  }
+
+  return result;
+}
+
+
+Option<double> Replay::fairness() const
+{
+  double sum = 0.0;
+  double squares = 0.0;
+
+  const hashmap<string, double> shares_ = shares();
+
+  foreachvalue (double share, shares_) {
+    sum += share;
+    squares += share * share;
+  }
+
+  if (squares == 0.0) {
+    return None();
+  }
+
+  return (sum * sum) / (shares_.size() * squares);
+}
+
+
+// Returns the `percentile` of the sorted `values`.
+static Duration percentile(const vector<Duration>& values, double percentile)
+{
+  CHECK(!values.empty());
+
+  size_t index = static_cast<size_t>(percentile * (values.size() - 1));
+  return values[index];
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Flags flags;
+
+  Try<flags::Warnings> load = flags.load(None(), argc, argv);
+
+  if (load.isError()) {
+    cerr << flags.usage(load.error()) << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (flags.help) {
+    cout << flags.usage() << endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (flags.path.isNone()) {
+    cerr << flags.usage("Missing required option --path") << endl;
+    return EXIT_FAILURE;
+  }
+
+  process::initialize();
+  mesos::internal::logging::initialize(argv[0], false, flags);
+
+  // Log any flag warnings (after logging is initialized).
+  foreach (const flags::Warning& warning, load->warnings) {
+    LOG(WARNING) << warning.message;
+  }
+
+  Try<int_fd> fd = os::open(flags.path.get(), O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    cerr << "Failed to open '" << flags.path.get() << "': "
+         << fd.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  vector<AllocatorEvent> events;
+
+  while (true) {
+    Result<AllocatorEvent> event = ::protobuf::read<AllocatorEvent>(fd.get());
+
+    if (event.isError()) {
+      cerr << "Failed to read the recording: " << event.error() << endl;
+      os::close(fd.get());
+      return EXIT_FAILURE;
+    }
+
+    if (event.isNone()) {
+      break;
+    }
+
+    events.push_back(event.get());
+  }
+
+  os::close(fd.get());
+
+  if (events.empty() || events.front().type() != AllocatorEvent::INITIALIZE) {
+    cerr << "Expected the recording to start with the initialization of"
+         << " the allocator" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const AllocatorEvent::Initialize& initialize = events.front().initialize();
+
+  mesos::allocator::Options options;
+
+  options.allocationInterval = flags.allocation_interval.getOrElse(
+      Nanoseconds(static_cast<int64_t>(
+          initialize.allocation_interval() * Seconds(1).ns())));
+
+  if (initialize.has_allocation_sweep_interval()) {
+    options.allocationSweepInterval = Nanoseconds(static_cast<int64_t>(
+        initialize.allocation_sweep_interval() * Seconds(1).ns()));
+  }
+
+  if (initialize.fairness_exclude_resource_names_size() > 0) {
+    options.fairnessExcludeResourceNames = set<string>(
+        initialize.fairness_exclude_resource_names().begin(),
+        initialize.fairness_exclude_resource_names().end());
+  }
+
+  options.filterGpuResources = initialize.filter_gpu_resources();
+
+  if (initialize.has_domain()) {
+    options.domain = initialize.domain();
+  }
+
+  if (initialize.min_allocatable_resources_size() > 0) {
+    vector<Resources> minAllocatableResources;
+    foreach (const AllocatorEvent::Initialize::MinAllocatableResources& min,
+             initialize.min_allocatable_resources()) {
+      minAllocatableResources.push_back(min.resources());
+    }
+
+    options.minAllocatableResources = minAllocatableResources;
+  }
+
+  options.agentOrder =
+    flags.allocation_agent_order.getOrElse(initialize.agent_order());
+
+  Try<Allocator*> allocator = Allocator::create(
+      DEFAULT_ALLOCATOR, flags.role_sorter, flags.framework_sorter);
+
+  if (allocator.isError()) {
+    cerr << "Failed to create the allocator: " << allocator.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  Clock::pause();
+
+  Replay replay(allocator.get(), Clock::now(), events.front().timestamp());
+
+  allocator.get()->initialize(
+      options,
+      [&replay](
+          const FrameworkID& frameworkId,
+          const hashmap<string, hashmap<SlaveID, Resources>>& resources) {
+        replay.offer(frameworkId, resources);
+      },
+      [](const FrameworkID&, const hashmap<SlaveID, UnavailableResources>&) {});
+
+  Clock::settle();
+
+  // The allocator performs a (batch) allocation every allocation
+  // interval since it was initialized. We replay the recorded calls in
+  // between, at the time they were recorded at. The latency of an
+  // allocation cycle only includes the batch allocation: the calls,
+  // along with the allocations they trigger, are timed separately.
+  vector<Duration> latencies;
+  vector<double> fairness;
+  Duration eventsElapsed = Duration::zero();
+  Time nextCycle = Clock::now() + options.allocationInterval;
+
+  auto cycle = [&]() {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    Clock::advance(nextCycle - Clock::now());
+    Clock::settle();
+
+    latencies.push_back(stopwatch.elapsed());
+
+    replay.collect();
+
+    Option<double> fairness_ = replay.fairness();
+    if (fairness_.isSome()) {
+      fairness.push_back(fairness_.get());
+    }
+
+    nextCycle += options.allocationInterval;
+  };
+
+  for (size_t i = 1; i < events.size(); ++i) {
+    const AllocatorEvent& event = events[i];
+    const Time time = replay.time(event);
+
+    while (nextCycle <= time) {
+      cycle();
+    }
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    if (time > Clock::now()) {
+      Clock::advance(time - Clock::now());
+    }
+
+    replay.apply(event);
+    Clock::settle();
+
+    eventsElapsed += stopwatch.elapsed();
+
+    replay.collect();
+  }
+
+  // Perform a final allocation after the last call.
+  cycle();
+
+  delete allocator.get();
+
+  vector<Duration> sorted = latencies;
+  std::sort(sorted.begin(), sorted.end());
+
+  Duration total = Duration::zero();
+  foreach (const Duration& latency, latencies) {
+    total += latency;
+  }
+
+  cout << "Replayed " << events.size() - 1 << " calls over "
+       << Nanoseconds(static_cast<int64_t>(
+              (events.back().timestamp() - events.front().timestamp()) *
+              Seconds(1).ns()))
+       << " in " << latencies.size() << " allocation cycles" << endl;
+
+  cout << "Allocation cycle latency: mean " << total / latencies.size()
+       << ", p50 " << percentile(sorted, 0.5)
+       << ", p90 " << percentile(sorted, 0.9)
+       << ", p99 " << percentile(sorted, 0.99)
+       << ", max " << sorted.back() << endl;
+
+  cout << "Handling the calls took " << eventsElapsed << endl;
+
+  cout << "Offers made: " << replay.offersMade << " ("
+       << static_cast<double>(replay.offersMade) / latencies.size()
+       << " per cycle)" << endl;
+
+  if (!fairness.empty()) {
+    double sum = 0.0;
+    foreach (double fairness_, fairness) {
+      sum += fairness_;
+    }
+
+    cout << "Fairness (Jain's index over the weighted dominant shares"
+         << " of the roles): mean " << sum / fairness.size()
+         << ", final " << fairness.back() << endl;
+  }
+
+  foreachpair (const string& role, double share, replay.shares()) {
+    cout << "  Role '" << role << "': weighted dominant share "
+         << share << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "master/allocator/mesos/worker_pool.hpp"
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+
+using std::function;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+WorkerPool::WorkerPool(size_t workers)
+  : pending(0),
+    stopping(false)
+{
+  threads.reserve(workers);
+
+  for (size_t i = 0; i < workers; ++i) {
+    threads.emplace_back(&WorkerPool::work, this);
+  }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+
+  queued.notify_all();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+}
+
+
+void WorkerPool::run(vector<function<void()>>&& tasks_)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  CHECK(tasks.empty());
+  CHECK_EQ(0u, pending);
+
+  pending = tasks_.size();
+
+  foreach (function<void()>& task, tasks_) {
+    tasks.push_back(std::move(task));
+  }
+
+  queued.notify_all();
+
+  while (!tasks.empty()) {
+    function<void()> task = std::move(tasks.front());
+    tasks.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+
+    --pending;
+  }
+
+  completed.wait(lock, [this]() { return pending == 0; });
+}
+
+
+void WorkerPool::work()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    queued.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+    if (stopping) {
+      return;
+    }
+
+    function<void()> task = std::move(tasks.front());
+    tasks.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+
+    if (--pending == 0) {
+      completed.notify_all();
+    }
+  }
+}
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
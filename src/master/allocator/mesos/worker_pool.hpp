@@ -0,0 +1,84 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_ALLOCATOR_MESOS_WORKER_POOL_HPP__
+#define __MASTER_ALLOCATOR_MESOS_WORKER_POOL_HPP__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace allocator {
+
+// A fixed set of threads that the hierarchical allocator uses to run
+// the CPU bound parts of an allocation cycle in parallel. The threads
+// are started once and reused for every allocation cycle, so that a
+// cycle does not pay for starting threads.
+//
+// NOTE: The tasks must not block on the allocator's actor, since
+// `run()` is called from it.
+class WorkerPool
+{
+public:
+  // Starts `workers` threads; with no workers, `run()` runs all the
+  // tasks on the calling thread.
+  explicit WorkerPool(size_t workers);
+
+  // Waits for the threads to finish the tasks they are running.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Runs the tasks and returns once all of them have completed. The
+  // calling thread runs the tasks that no worker has picked up yet,
+  // so it does not sit idle while the workers are busy.
+  void run(std::vector<std::function<void()>>&& tasks);
+
+private:
+  void work();
+
+  std::mutex mutex;
+
+  // Notified when tasks are queued or the pool is stopping.
+  std::condition_variable queued;
+
+  // Notified when a worker completes a task.
+  std::condition_variable completed;
+
+  std::deque<std::function<void()>> tasks;
+
+  // The number of tasks of the current `run()` that have not
+  // completed yet, including the queued ones.
+  size_t pending;
+
+  bool stopping;
+
+  std::vector<std::thread> threads;
+};
+
+} // namespace allocator {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_ALLOCATOR_MESOS_WORKER_POOL_HPP__
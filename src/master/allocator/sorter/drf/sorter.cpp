@@ -32,6 +32,8 @@
 #include <stout/option.hpp>
 #include <stout/strings.hpp>
 
+#include "common/resource_quantities.hpp"
+
 using std::set;
 using std::string;
 using std::vector;
@@ -120,6 +122,10 @@ void DRFSorter::add(const string& clientPath)
 
       internal->addChild(current);
 
+      // If `current` is active, it was placed at the beginning of the
+      // children of `internal`, so it needs to be repositioned.
+      markDirty(current);
+
       CHECK_EQ(internal->path, current->clientPath());
 
       current = internal;
@@ -169,8 +175,9 @@ void DRFSorter::add(const string& clientPath)
 
   clients[clientPath] = current;
 
-  // TODO(neilc): Avoid dirtying the tree in some circumstances.
-  dirty = true;
+  // The new client is inactive, so only the internal nodes created
+  // for it (if any) might be out of place.
+  markDirty(current);
 
   if (metrics.isSome()) {
     metrics->add(clientPath);
@@ -207,6 +214,10 @@ void DRFSorter::remove(const string& clientPath)
   while (current != root) {
     Node* parent = CHECK_NOTNULL(current->parent);
 
+    // The allocation (and thus the share) of `parent` changes, so it
+    // needs to be repositioned among its siblings.
+    parent->dirty = true;
+
     // Update `parent` to reflect the fact that the resources in the
     // leaf node are no longer allocated to the subtree rooted at
     // `parent`. We skip `root`, because we never update the
@@ -240,7 +251,7 @@ void DRFSorter::remove(const string& clientPath)
         // `current` has changed kind (from `INTERNAL` to a leaf,
         // which might be active or inactive). Hence we might need to
         // change its position in the `children` list.
-        if (current->kind == Node::INTERNAL) {
+        if (current->kind == Node::INACTIVE_LEAF) {
           CHECK_NOTNULL(current->parent);
 
           current->parent->removeChild(current);
@@ -256,9 +267,6 @@ void DRFSorter::remove(const string& clientPath)
     current = parent;
   }
 
-  // TODO(neilc): Avoid dirtying the tree in some circumstances.
-  dirty = true;
-
   if (metrics.isSome()) {
     metrics->remove(clientPath);
   }
@@ -273,18 +281,14 @@ void DRFSorter::activate(const string& clientPath)
     client->kind = Node::ACTIVE_LEAF;
 
     // `client` has been activated, so move it to the beginning of its
-    // parent's list of children. We mark the tree dirty, so that the
-    // client's share is updated correctly and it is sorted properly.
-    //
-    // TODO(neilc): We could instead calculate share here and insert
-    // the client into the appropriate place here, which would avoid
-    // dirtying the whole tree.
+    // parent's list of children. We mark the client dirty, so that its
+    // share is updated correctly and it is sorted properly.
     CHECK_NOTNULL(client->parent);
 
     client->parent->removeChild(client);
     client->parent->addChild(client);
 
-    dirty = true;
+    markDirty(client);
   }
 }
 
@@ -322,6 +326,9 @@ void DRFSorter::allocated(
 {
   Node* current = CHECK_NOTNULL(find(clientPath));
 
+  // Only the shares of the client and its ancestors change.
+  markDirty(current);
+
   // NOTE: We don't currently update the `allocation` for the root
   // node. This is debatable, but the current implementation doesn't
   // require looking at the allocation of the root node.
@@ -329,9 +336,6 @@ void DRFSorter::allocated(
     current->allocation.add(slaveId, resources);
     current = CHECK_NOTNULL(current->parent);
   }
-
-  // TODO(neilc): Avoid dirtying the tree in some circumstances.
-  dirty = true;
 }
 
 
@@ -347,6 +351,10 @@ void DRFSorter::update(
 
   Node* current = CHECK_NOTNULL(find(clientPath));
 
+  // Just assume the shares of the client and its ancestors have
+  // changed, per the TODO above.
+  markDirty(current);
+
   // NOTE: We don't currently update the `allocation` for the root
   // node. This is debatable, but the current implementation doesn't
   // require looking at the allocation of the root node.
@@ -354,9 +362,6 @@ void DRFSorter::update(
     current->allocation.update(slaveId, oldAllocation, newAllocation);
     current = CHECK_NOTNULL(current->parent);
   }
-
-  // Just assume the total has changed, per the TODO above.
-  dirty = true;
 }
 
 
@@ -367,6 +372,9 @@ void DRFSorter::unallocated(
 {
   Node* current = CHECK_NOTNULL(find(clientPath));
 
+  // Only the shares of the client and its ancestors change.
+  markDirty(current);
+
   // NOTE: We don't currently update the `allocation` for the root
   // node. This is debatable, but the current implementation doesn't
   // require looking at the allocation of the root node.
@@ -374,9 +382,6 @@ void DRFSorter::unallocated(
     current->allocation.subtract(slaveId, resources);
     current = CHECK_NOTNULL(current->parent);
   }
-
-  // TODO(neilc): Avoid dirtying the tree in some circumstances.
-  dirty = true;
 }
 
 
@@ -388,7 +393,7 @@ const hashmap<SlaveID, Resources>& DRFSorter::allocation(
 }
 
 
-const Resources& DRFSorter::allocationScalarQuantities(
+const ResourceQuantities& DRFSorter::allocationScalarQuantities(
     const string& clientPath) const
 {
   const Node* client = CHECK_NOTNULL(find(clientPath));
@@ -436,7 +441,7 @@ Resources DRFSorter::allocation(
 }
 
 
-const Resources& DRFSorter::totalScalarQuantities() const
+const ResourceQuantities& DRFSorter::totalScalarQuantities() const
 {
   return total_.scalarQuantities;
 }
@@ -454,14 +459,8 @@ void DRFSorter::add(const SlaveID& slaveId, const Resources& resources)
 
     total_.resources[slaveId] += resources;
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + newShared).createStrippedScalarQuantity();
-
-    total_.scalarQuantities += scalarQuantities;
-
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] += resource.scalar();
-    }
+    total_.scalarQuantities += ResourceQuantities::fromScalarResources(
+        resources.nonShared() + newShared);
 
     // We have to recalculate all shares when the total resources
     // change, but we put it off until `sort` is called so that if
@@ -488,12 +487,9 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
         return !total_.resources[slaveId].contains(resource);
       });
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + absentShared).createStrippedScalarQuantity();
-
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] -= resource.scalar();
-    }
+    const ResourceQuantities scalarQuantities =
+      ResourceQuantities::fromScalarResources(
+          resources.nonShared() + absentShared);
 
     CHECK(total_.scalarQuantities.contains(scalarQuantities));
     total_.scalarQuantities -= scalarQuantities;
@@ -509,40 +505,84 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
 
 vector<string> DRFSorter::sort()
 {
-  if (dirty) {
-    std::function<void (Node*)> sortTree = [this, &sortTree](Node* node) {
-      // Inactive leaves are always stored at the end of the
-      // `children` vector; this means that as soon as we see an
-      // inactive leaf, we can stop calculating shares, and we only
-      // need to sort the prefix of the vector before that point.
-      auto childIter = node->children.begin();
-
-      while (childIter != node->children.end()) {
-        Node* child = *childIter;
-
-        if (child->kind == Node::INACTIVE_LEAF) {
-          break;
+  // Recalculates the shares of the active children of `node` and
+  // sorts them. If the whole tree is dirty, this is done for all the
+  // children. Otherwise, this is only done for the dirty children: the
+  // other children are still sorted relative to each other, so we
+  // take the dirty ones out and insert them back in place by binary
+  // search. This makes the cost of sorting after a few allocations
+  // (the common case in the allocation loop) mostly independent of
+  // the number of clients.
+  std::function<void (Node*)> sortTree = [this, &sortTree](Node* node) {
+    // Inactive leaves are always stored at the end of the `children`
+    // vector; this means that as soon as we see an inactive leaf, we
+    // can stop calculating shares, and we only need to sort the
+    // prefix of the vector before that point.
+    auto begin = node->children.begin();
+    auto end = std::find_if(begin, node->children.end(), [](Node* child) {
+      return child->kind == Node::INACTIVE_LEAF;
+    });
+
+    if (dirty) {
+      for (auto it = begin; it != end; ++it) {
+        (*it)->share = calculateShare(*it);
+      }
+
+      std::sort(begin, end, DRFSorter::Node::compareDRF);
+
+      for (auto it = begin; it != end; ++it) {
+        if ((*it)->kind == Node::INTERNAL) {
+          sortTree(*it);
         }
 
-        child->share = calculateShare(child);
-        ++childIter;
+        (*it)->dirty = false;
       }
 
-      std::sort(node->children.begin(),
-                childIter,
-                DRFSorter::Node::compareDRF);
+      return;
+    }
 
-      foreach (Node* child, node->children) {
-        if (child->kind == Node::INTERNAL) {
-          sortTree(child);
-        } else if (child->kind == Node::INACTIVE_LEAF) {
-          break;
-        }
+    // Move the clean children to the front, preserving their order.
+    vector<Node*> updated;
+    auto sorted = begin;
+
+    for (auto it = begin; it != end; ++it) {
+      if ((*it)->dirty) {
+        updated.push_back(*it);
+      } else {
+        *sorted++ = *it;
+      }
+    }
+
+    foreach (Node* child, updated) {
+      child->share = calculateShare(child);
+
+      if (child->kind == Node::INTERNAL) {
+        sortTree(child);
       }
-    };
 
+      child->dirty = false;
+    }
+
+    std::sort(updated.begin(), updated.end(), DRFSorter::Node::compareDRF);
+
+    // Insert the updated children in place. The unused slots that
+    // the updated children have left are between `sorted` and `end`.
+    foreach (Node* child, updated) {
+      auto position =
+        std::upper_bound(begin, sorted, child, DRFSorter::Node::compareDRF);
+
+      std::move_backward(position, sorted, sorted + 1);
+      *position = child;
+      ++sorted;
+    }
+
+    CHECK(sorted == end);
+  };
+
+  if (dirty || root->dirty) {
     sortTree(root);
 
+    root->dirty = false;
     dirty = false;
   }
 
@@ -591,29 +631,11 @@ size_t DRFSorter::count() const
 
 double DRFSorter::calculateShare(const Node* node) const
 {
-  double share = 0.0;
-
   // TODO(benh): This implementation of "dominant resource fairness"
   // currently does not take into account resources that are not
   // scalars.
-
-  foreachpair (const string& resourceName,
-               const Value::Scalar& scalar,
-               total_.totals) {
-    // Filter out the resources excluded from fair sharing.
-    if (fairnessExcludeResourceNames.isSome() &&
-        fairnessExcludeResourceNames->count(resourceName) > 0) {
-      continue;
-    }
-
-    if (scalar.value() > 0.0 &&
-        node->allocation.totals.contains(resourceName)) {
-      const double allocation =
-        node->allocation.totals.at(resourceName).value();
-
-      share = std::max(share, allocation / scalar.value());
-    }
-  }
+  const double share = node->allocation.scalarQuantities.dominantShare(
+      total_.scalarQuantities, fairnessExcludeResourceNames);
 
   return share / findWeight(node);
 }
@@ -631,6 +653,18 @@ double DRFSorter::findWeight(const Node* node) const
 }
 
 
+void DRFSorter::markDirty(Node* node)
+{
+  // NOTE: We can't stop at the first ancestor that is already dirty,
+  // since inactive leaves are skipped by sort(), and thus remain
+  // dirty without their ancestors being dirty.
+  while (node != nullptr) {
+    node->dirty = true;
+    node = node->parent;
+  }
+}
+
+
 DRFSorter::Node* DRFSorter::find(const string& clientPath) const
 {
   Option<Node*> client_ = clients.get(clientPath);
@@ -30,6 +30,8 @@
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/allocator/sorter/drf/metrics.hpp"
 
 #include "master/allocator/sorter/sorter.hpp"
@@ -84,7 +86,7 @@ public:
   const hashmap<SlaveID, Resources>& allocation(
       const std::string& clientPath) const override;
 
-  const Resources& allocationScalarQuantities(
+  const ResourceQuantities& allocationScalarQuantities(
       const std::string& clientPath) const override;
 
   hashmap<std::string, Resources> allocation(
@@ -94,7 +96,7 @@ public:
       const std::string& clientPath,
       const SlaveID& slaveId) const override;
 
-  const Resources& totalScalarQuantities() const override;
+  const ResourceQuantities& totalScalarQuantities() const override;
 
   void add(const SlaveID& slaveId, const Resources& resources) override;
 
@@ -123,10 +125,20 @@ private:
   // internal node in the tree (not a client).
   Node* find(const std::string& clientPath) const;
 
+  // Marks the node and all of its ancestors as dirty, so that the
+  // next sort() recalculates their shares and repositions them among
+  // their siblings.
+  void markDirty(Node* node);
+
   // Resources (by name) that will be excluded from fair sharing.
   Option<std::set<std::string>> fairnessExcludeResourceNames;
 
   // If true, sort() will recalculate all shares and resort the tree.
+  // This is needed when a change affects the shares of all nodes,
+  // e.g., when the total resources or the weights change. Changes
+  // that only affect some clients instead mark the nodes on their
+  // paths dirty (see `Node::dirty`), so that sort() only updates
+  // those nodes.
   bool dirty = false;
 
   // The root node in the sorter tree.
@@ -167,16 +179,7 @@ private:
     // Sharedness info is also stripped out when resource identities
     // are omitted because sharedness inherently refers to the
     // identities of resources and not quantities.
-    Resources scalarQuantities;
-
-    // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
-    hashmap<std::string, Value::Scalar> totals;
+    ResourceQuantities scalarQuantities;
   } total_;
 
   // Metrics are optionally exposed by the sorter.
@@ -208,7 +211,7 @@ struct DRFSorter::Node
   };
 
   Node(const std::string& _name, Kind _kind, Node* _parent)
-    : name(_name), share(0), kind(_kind), parent(_parent)
+    : name(_name), share(0), dirty(false), kind(_kind), parent(_parent)
   {
     // Compute the node's path. Three cases:
     //
@@ -244,6 +247,12 @@ struct DRFSorter::Node
 
   double share;
 
+  // If true, the allocation or the state of the node has changed
+  // since the tree was last sorted, i.e., `share` might be stale and
+  // the node might be out of place among its siblings. If a node is
+  // dirty, so are all of its ancestors.
+  bool dirty;
+
   Kind kind;
 
   Node* parent;
@@ -259,7 +268,8 @@ struct DRFSorter::Node
   // can stop when the first inactive leaf is observed.
   //
   // (2) If the tree is not dirty, the active leaves and internal
-  // nodes are kept sorted by DRF share.
+  // nodes are kept sorted by DRF share. Otherwise, this holds for all
+  // of them except the nodes that are marked dirty.
   std::vector<Node*> children;
 
   // If this node represents a sorter client, this returns the path of
@@ -309,7 +319,7 @@ struct DRFSorter::Node
     // If we're inserting an inactive leaf, place it at the end of the
     // `children` vector; otherwise, place it at the beginning. This
     // maintains ordering invariant (1) above. It is up to the caller
-    // to maintain invariant (2) -- e.g., by marking the tree dirty.
+    // to maintain invariant (2) -- e.g., by marking the child dirty.
     if (child->kind == INACTIVE_LEAF) {
       children.push_back(child);
     } else {
@@ -331,16 +341,13 @@ struct DRFSorter::Node
             return !resources[slaveId].contains(resource);
         });
 
-      const Resources quantitiesToAdd =
-        (toAdd.nonShared() + sharedToAdd).createStrippedScalarQuantity();
+      const ResourceQuantities quantitiesToAdd =
+        ResourceQuantities::fromScalarResources(
+            toAdd.nonShared() + sharedToAdd);
 
       resources[slaveId] += toAdd;
       scalarQuantities += quantitiesToAdd;
 
-      foreach (const Resource& resource, quantitiesToAdd) {
-        totals[resource.name()] += resource.scalar();
-      }
-
       count++;
     }
 
@@ -360,12 +367,9 @@ struct DRFSorter::Node
             return !resources[slaveId].contains(resource);
         });
 
-      const Resources quantitiesToRemove =
-        (toRemove.nonShared() + sharedToRemove).createStrippedScalarQuantity();
-
-      foreach (const Resource& resource, quantitiesToRemove) {
-        totals[resource.name()] -= resource.scalar();
-      }
+      const ResourceQuantities quantitiesToRemove =
+        ResourceQuantities::fromScalarResources(
+            toRemove.nonShared() + sharedToRemove);
 
       CHECK(scalarQuantities.contains(quantitiesToRemove))
         << scalarQuantities << " does not contain " << quantitiesToRemove;
@@ -382,10 +386,10 @@ struct DRFSorter::Node
         const Resources& oldAllocation,
         const Resources& newAllocation)
     {
-      const Resources oldAllocationQuantity =
-        oldAllocation.createStrippedScalarQuantity();
-      const Resources newAllocationQuantity =
-        newAllocation.createStrippedScalarQuantity();
+      const ResourceQuantities oldAllocationQuantity =
+        ResourceQuantities::fromScalarResources(oldAllocation);
+      const ResourceQuantities newAllocationQuantity =
+        ResourceQuantities::fromScalarResources(newAllocation);
 
       CHECK(resources.contains(slaveId));
       CHECK(resources[slaveId].contains(oldAllocation))
@@ -400,14 +404,6 @@ struct DRFSorter::Node
 
       scalarQuantities -= oldAllocationQuantity;
       scalarQuantities += newAllocationQuantity;
-
-      foreach (const Resource& resource, oldAllocationQuantity) {
-        totals[resource.name()] -= resource.scalar();
-      }
-
-      foreach (const Resource& resource, newAllocationQuantity) {
-        totals[resource.name()] += resource.scalar();
-      }
     }
 
     // We store the number of times this client has been chosen for
@@ -428,16 +424,7 @@ struct DRFSorter::Node
     // Similarly, we aggregate scalars across slaves and omit information
     // about dynamic reservations, persistent volumes and sharedness of
     // the corresponding resource. See notes above.
-    Resources scalarQuantities;
-
-    // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
-    hashmap<std::string, Value::Scalar> totals;
+    ResourceQuantities scalarQuantities;
   } allocation;
 
   // Compares two nodes according to DRF share.
@@ -33,6 +33,8 @@
 #include <stout/option.hpp>
 #include <stout/strings.hpp>
 
+#include "common/resource_quantities.hpp"
+
 using std::set;
 using std::string;
 using std::vector;
@@ -351,7 +353,7 @@ const hashmap<SlaveID, Resources>& RandomSorter::allocation(
 }
 
 
-const Resources& RandomSorter::allocationScalarQuantities(
+const ResourceQuantities& RandomSorter::allocationScalarQuantities(
     const string& clientPath) const
 {
   const Node* client = CHECK_NOTNULL(find(clientPath));
@@ -400,7 +402,7 @@ Resources RandomSorter::allocation(
 }
 
 
-const Resources& RandomSorter::totalScalarQuantities() const
+const ResourceQuantities& RandomSorter::totalScalarQuantities() const
 {
   return total_.scalarQuantities;
 }
@@ -418,14 +420,8 @@ void RandomSorter::add(const SlaveID& slaveId, const Resources& resources)
 
     total_.resources[slaveId] += resources;
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + newShared).createStrippedScalarQuantity();
-
-    total_.scalarQuantities += scalarQuantities;
-
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] += resource.scalar();
-    }
+    total_.scalarQuantities += ResourceQuantities::fromScalarResources(
+        resources.nonShared() + newShared);
   }
 }
 
@@ -446,12 +442,9 @@ void RandomSorter::remove(const SlaveID& slaveId, const Resources& resources)
         return !total_.resources[slaveId].contains(resource);
       });
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + absentShared).createStrippedScalarQuantity();
-
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] -= resource.scalar();
-    }
+    const ResourceQuantities scalarQuantities =
+      ResourceQuantities::fromScalarResources(
+          resources.nonShared() + absentShared);
 
     CHECK(total_.scalarQuantities.contains(scalarQuantities));
     total_.scalarQuantities -= scalarQuantities;
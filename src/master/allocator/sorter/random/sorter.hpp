@@ -31,6 +31,8 @@
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/allocator/sorter/sorter.hpp"
 
 
@@ -83,7 +85,7 @@ public:
   const hashmap<SlaveID, Resources>& allocation(
       const std::string& clientPath) const override;
 
-  const Resources& allocationScalarQuantities(
+  const ResourceQuantities& allocationScalarQuantities(
       const std::string& clientPath) const override;
 
   hashmap<std::string, Resources> allocation(
@@ -93,7 +95,7 @@ public:
       const std::string& clientPath,
       const SlaveID& slaveId) const override;
 
-  const Resources& totalScalarQuantities() const override;
+  const ResourceQuantities& totalScalarQuantities() const override;
 
   void add(const SlaveID& slaveId, const Resources& resources) override;
 
@@ -165,16 +167,7 @@ private:
     // Sharedness info is also stripped out when resource identities
     // are omitted because sharedness inherently refers to the
     // identities of resources and not quantities.
-    Resources scalarQuantities;
-
-    // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
-    hashmap<std::string, Value::Scalar> totals;
+    ResourceQuantities scalarQuantities;
   } total_;
 };
 
@@ -318,15 +311,12 @@ struct RandomSorter::Node
             return !resources[slaveId].contains(resource);
         });
 
-      const Resources quantitiesToAdd =
-        (toAdd.nonShared() + sharedToAdd).createStrippedScalarQuantity();
+      const ResourceQuantities quantitiesToAdd =
+        ResourceQuantities::fromScalarResources(
+            toAdd.nonShared() + sharedToAdd);
 
       resources[slaveId] += toAdd;
       scalarQuantities += quantitiesToAdd;
-
-      foreach (const Resource& resource, quantitiesToAdd) {
-        totals[resource.name()] += resource.scalar();
-      }
     }
 
     void subtract(const SlaveID& slaveId, const Resources& toRemove)
@@ -345,12 +335,9 @@ struct RandomSorter::Node
             return !resources[slaveId].contains(resource);
         });
 
-      const Resources quantitiesToRemove =
-        (toRemove.nonShared() + sharedToRemove).createStrippedScalarQuantity();
-
-      foreach (const Resource& resource, quantitiesToRemove) {
-        totals[resource.name()] -= resource.scalar();
-      }
+      const ResourceQuantities quantitiesToRemove =
+        ResourceQuantities::fromScalarResources(
+            toRemove.nonShared() + sharedToRemove);
 
       CHECK(scalarQuantities.contains(quantitiesToRemove))
         << scalarQuantities << " does not contain " << quantitiesToRemove;
@@ -367,10 +354,10 @@ struct RandomSorter::Node
         const Resources& oldAllocation,
         const Resources& newAllocation)
     {
-      const Resources oldAllocationQuantity =
-        oldAllocation.createStrippedScalarQuantity();
-      const Resources newAllocationQuantity =
-        newAllocation.createStrippedScalarQuantity();
+      const ResourceQuantities oldAllocationQuantity =
+        ResourceQuantities::fromScalarResources(oldAllocation);
+      const ResourceQuantities newAllocationQuantity =
+        ResourceQuantities::fromScalarResources(newAllocation);
 
       CHECK(resources.contains(slaveId));
       CHECK(resources[slaveId].contains(oldAllocation))
@@ -385,14 +372,6 @@ struct RandomSorter::Node
 
       scalarQuantities -= oldAllocationQuantity;
       scalarQuantities += newAllocationQuantity;
-
-      foreach (const Resource& resource, oldAllocationQuantity) {
-        totals[resource.name()] -= resource.scalar();
-      }
-
-      foreach (const Resource& resource, newAllocationQuantity) {
-        totals[resource.name()] += resource.scalar();
-      }
     }
 
     // We maintain multiple copies of each shared resource allocated
@@ -404,16 +383,7 @@ struct RandomSorter::Node
     // Similarly, we aggregate scalars across slaves and omit information
     // about dynamic reservations, persistent volumes and sharedness of
     // the corresponding resource. See notes above.
-    Resources scalarQuantities;
-
-    // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
-    hashmap<std::string, Value::Scalar> totals;
+    ResourceQuantities scalarQuantities;
   } allocation;
 };
 
@@ -26,6 +26,8 @@
 
 #include <process/pid.hpp>
 
+#include "common/resource_quantities.hpp"
+
 namespace mesos {
 namespace internal {
 namespace master {
@@ -109,8 +111,8 @@ public:
 
   // Returns the total scalar resource quantities that are allocated to
   // this client. This omits metadata about dynamic reservations and
-  // persistent volumes; see `Resources::createStrippedScalarQuantity`.
-  virtual const Resources& allocationScalarQuantities(
+  // persistent volumes; see `ResourceQuantities`.
+  virtual const ResourceQuantities& allocationScalarQuantities(
       const std::string& client) const = 0;
 
   // Returns the clients that have allocations on this slave.
@@ -125,8 +127,8 @@ public:
 
   // Returns the total scalar resource quantities in this sorter. This
   // omits metadata about dynamic reservations and persistent volumes; see
-  // `Resources::createStrippedScalarQuantity`.
-  virtual const Resources& totalScalarQuantities() const = 0;
+  // `ResourceQuantities`.
+  virtual const ResourceQuantities& totalScalarQuantities() const = 0;
 
   // Add resources to the total pool of resources this
   // Sorter should consider.
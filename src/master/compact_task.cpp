@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include <stout/check.hpp>
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+#include "common/http.hpp"
+
+#include "master/compact_task.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+string internKey(
+    const google::protobuf::RepeatedPtrField<Resource>& resources)
+{
+  // The resources are prefixed with their sizes, so that the key of
+  // each sequence of resources is unique.
+  string key;
+
+  foreach (const Resource& resource, resources) {
+    const string serialized = resource.SerializeAsString();
+    key += stringify(serialized.size()) + ":" + serialized;
+  }
+
+  return key;
+}
+
+
+CompactTask::CompactTask(const Task& task, Interners* interners)
+  : taskId(task.task_id()),
+    state_(task.state()),
+    frameworkId(interners->frameworkIds.intern(task.framework_id())),
+    slaveId(interners->slaveIds.intern(task.slave_id())),
+    resources(interners->resources.intern(task.resources()))
+{
+  if (task.statuses_size() > 0) {
+    timestamp_ = task.statuses(0).timestamp();
+  }
+
+  Task remainder(task);
+  remainder.clear_task_id();
+  remainder.clear_state();
+  remainder.clear_framework_id();
+  remainder.clear_slave_id();
+  remainder.clear_resources();
+
+  if (task.has_labels()) {
+    labels = interners->labels.intern(task.labels());
+    remainder.clear_labels();
+  }
+
+  // NOTE: The remainder lacks required fields, hence we cannot use
+  // `SerializeToString()`, which checks that they are set.
+  CHECK(remainder.SerializePartialToString(&data));
+}
+
+
+Task CompactTask::get() const
+{
+  Task task;
+  CHECK(task.ParsePartialFromString(data));
+
+  task.mutable_task_id()->CopyFrom(taskId);
+  task.set_state(state_);
+  task.mutable_framework_id()->CopyFrom(*frameworkId);
+  task.mutable_slave_id()->CopyFrom(*slaveId);
+  task.mutable_resources()->CopyFrom(*resources);
+
+  if (labels != nullptr) {
+    task.mutable_labels()->CopyFrom(*labels);
+  }
+
+  return task;
+}
+
+
+void json(JSON::ObjectWriter* writer, const CompactTask& task)
+{
+  mesos::json(writer, task.get());
+}
+
+
+bool approved(
+    const process::Owned<ObjectApprovers>& approvers,
+    const CompactTask& task,
+    const FrameworkInfo& frameworkInfo)
+{
+  if (approvers->approvesAll(authorization::VIEW_TASK)) {
+    return true;
+  }
+
+  return approvers->approved<authorization::VIEW_TASK>(
+      task.get(), frameworkInfo);
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
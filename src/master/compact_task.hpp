@@ -0,0 +1,180 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_COMPACT_TASK_HPP__
+#define __MASTER_COMPACT_TASK_HPP__
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include <mesos/mesos.hpp>
+
+#include <process/owned.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/jsonify.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+
+// Forward declaration.
+class ObjectApprovers;
+
+namespace internal {
+namespace master {
+
+// Returns the key by which a message is interned.
+template <typename T>
+std::string internKey(const T& message)
+{
+  return message.SerializeAsString();
+}
+
+
+std::string internKey(
+    const google::protobuf::RepeatedPtrField<Resource>& resources);
+
+
+// Interns immutable protobuf messages, so that equal messages (e.g.,
+// the labels shared by the tasks of an application) are stored once
+// and shared by reference. A message is dropped from the interner
+// once it is no longer referenced.
+template <typename T>
+class Interner
+{
+public:
+  Interner() : threshold(MIN_THRESHOLD) {}
+
+  std::shared_ptr<const T> intern(const T& message)
+  {
+    std::string key = internKey(message);
+
+    std::weak_ptr<const T>& entry = messages[key];
+
+    std::shared_ptr<const T> interned = entry.lock();
+
+    if (interned == nullptr) {
+      interned = std::make_shared<const T>(message);
+      entry = interned;
+
+      // Drop the unreferenced messages whenever the number of entries
+      // doubles, which amortizes the cost of the sweep.
+      if (messages.size() >= threshold) {
+        sweep();
+      }
+    }
+
+    return interned;
+  }
+
+  size_t size() const { return messages.size(); }
+
+private:
+  void sweep()
+  {
+    for (auto it = messages.begin(); it != messages.end();) {
+      if (it->second.expired()) {
+        it = messages.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    threshold = std::max(MIN_THRESHOLD, 2 * messages.size());
+  }
+
+  static constexpr size_t MIN_THRESHOLD = 1024;
+
+  hashmap<std::string, std::weak_ptr<const T>> messages;
+  size_t threshold;
+};
+
+
+template <typename T>
+constexpr size_t Interner<T>::MIN_THRESHOLD;
+
+
+// A compact, immutable representation of a task which is no longer
+// running on an agent, i.e., a completed or an unreachable task.
+//
+// The fields which repeat across tasks (the framework and agent IDs,
+// the resources and the labels) are interned, and the remaining fields
+// are kept in their serialized form, which is considerably smaller than
+// the `Task` message. Fields which are (nearly) unique to a task, e.g.,
+// the executor ID, are not interned since that would only add overhead.
+// The task ID, state and the timestamp of the first status are kept
+// aside so that tasks can be filtered and sorted without materializing
+// them.
+class CompactTask
+{
+public:
+  // The interners shared by the compact tasks of a master.
+  struct Interners
+  {
+    Interner<FrameworkID> frameworkIds;
+    Interner<SlaveID> slaveIds;
+    Interner<google::protobuf::RepeatedPtrField<Resource>> resources;
+    Interner<Labels> labels;
+  };
+
+  CompactTask(const Task& task, Interners* interners);
+
+  // Returns the task, materialized from its compact form.
+  Task get() const;
+
+  const TaskID& task_id() const { return taskId; }
+  TaskState state() const { return state_; }
+  const FrameworkID& framework_id() const { return *frameworkId; }
+  const SlaveID& slave_id() const { return *slaveId; }
+
+  // Returns the timestamp of the first status of the task, if any.
+  const Option<double>& timestamp() const { return timestamp_; }
+
+private:
+  TaskID taskId;
+  TaskState state_;
+  Option<double> timestamp_;
+
+  std::shared_ptr<const FrameworkID> frameworkId;
+  std::shared_ptr<const SlaveID> slaveId;
+  std::shared_ptr<const google::protobuf::RepeatedPtrField<Resource>>
+    resources;
+
+  // Not set if the task does not have labels.
+  std::shared_ptr<const Labels> labels;
+
+  // The remaining fields of the task.
+  std::string data;
+};
+
+
+// Writes the JSON representation of the materialized task.
+void json(JSON::ObjectWriter* writer, const CompactTask& task);
+
+
+// Returns whether the principal is authorized to view the task. The
+// task is only materialized if the approver needs to inspect it.
+bool approved(
+    const process::Owned<ObjectApprovers>& approvers,
+    const CompactTask& task,
+    const FrameworkInfo& frameworkInfo);
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_COMPACT_TASK_HPP__
@@ -102,6 +102,10 @@ constexpr size_t DEFAULT_MAX_COMPLETED_TASKS_PER_FRAMEWORK = 1000;
 // to store in the cache.
 constexpr size_t DEFAULT_MAX_UNREACHABLE_TASKS_PER_FRAMEWORK = 1000;
 
+// Maximum number of frameworks and of agents whose latest change is
+// tracked to answer incremental '/state' requests.
+constexpr size_t MAX_STATE_CHANGES = 100000;
+
 // Time interval to check for updated watchers list.
 constexpr Duration WHITELIST_WATCH_INTERVAL = Seconds(5);
 
@@ -114,6 +118,9 @@ constexpr Duration DEFAULT_REGISTRY_MAX_AGENT_AGE = Weeks(2);
 
 constexpr size_t DEFAULT_REGISTRY_MAX_AGENT_COUNT = 100 * 1024;
 
+// Default maximum size of the recording of the allocator calls.
+constexpr Bytes DEFAULT_ALLOCATOR_RECORD_MAX_SIZE = Gigabytes(1);
+
 /**
  * Label used by the Leader Contender and Detector.
  *
@@ -141,6 +148,22 @@ constexpr char DEFAULT_ALLOCATOR[] = "hierarchical";
 // The default interval between allocations.
 constexpr Duration DEFAULT_ALLOCATION_INTERVAL = Seconds(1);
 
+// The default maximum number of threads used to evaluate the offer
+// filters in an allocation.
+constexpr size_t DEFAULT_OFFER_FILTER_PARALLELISM = 1;
+
+// The minimum number of agents for which each thread evaluates the
+// offer filters in an allocation. Fewer agents are not worth handing
+// to another thread.
+constexpr size_t MIN_OFFER_FILTER_AGENTS_PER_THREAD = 64;
+
+// The default order in which the allocator considers agents.
+constexpr char DEFAULT_ALLOCATION_AGENT_ORDER[] = "random";
+
+// The number of the most recent allocation runs that the allocator
+// keeps the profile of.
+constexpr size_t MAX_ALLOCATION_PROFILES = 100;
+
 // Name of the default, local authorizer.
 constexpr char DEFAULT_AUTHORIZER[] = "local";
 
@@ -24,8 +24,12 @@
 #include "master/constants.hpp"
 #include "master/flags.hpp"
 
+#include "master/allocator/mesos/agent_order.hpp"
+
 using std::string;
 
+using mesos::internal::master::allocator::AgentOrder;
+
 mesos::internal::master::Flags::Flags()
 {
   add(&Flags::version,
@@ -114,6 +118,48 @@ mesos::internal::master::Flags::Flags()
       "after which the operation is considered a failure.",
       Seconds(20));
 
+  add(&Flags::registry_max_batch_size,
+      "registry_max_batch_size",
+      "If set, the registrar stores at most this many operations (e.g.,\n"
+      "agent admissions or removals) in a single update of the registry.\n"
+      "While an update is being stored, the registrar applies the queued\n"
+      "operations on top of it so that the next update can be stored as\n"
+      "soon as the previous one completes.",
+      [](const Option<size_t>& value) -> Option<Error> {
+        if (value.isSome() && value.get() < 1) {
+          return Error("Expected `--registry_max_batch_size` to be at least 1");
+        }
+        return None();
+      });
+
+  add(&Flags::registry_batch_latency,
+      "registry_batch_latency",
+      "Duration of time the registrar waits for more operations before\n"
+      "storing an update of the registry when no other update is being\n"
+      "stored. Larger values trade the latency of single operations for\n"
+      "fewer, larger updates of the registry.",
+      Duration::zero());
+
+  add(&Flags::registry_max_delta_operations,
+      "registry_max_delta_operations",
+      "If set, the registrar persists operations on agents (e.g., agent\n"
+      "admissions or removals) as compact records on top of the last\n"
+      "checkpoint of the registry, instead of storing the whole registry\n"
+      "on every update. The whole registry is checkpointed once this many\n"
+      "records have accumulated, or when other operations (e.g., quota\n"
+      "or maintenance updates) are applied. The records are replayed when\n"
+      "the registry is recovered. Masters which do not support this flag\n"
+      "do not replay the records; before downgrading to such a master,\n"
+      "restart the masters without this flag, since recovering the\n"
+      "registry checkpoints it.",
+      [](const Option<size_t>& value) -> Option<Error> {
+        if (value.isSome() && value.get() < 1) {
+          return Error(
+              "Expected `--registry_max_delta_operations` to be at least 1");
+        }
+        return None();
+      });
+
   add(&Flags::log_auto_initialize,
       "log_auto_initialize",
       "Whether to automatically initialize the replicated log used for the\n"
@@ -196,6 +242,81 @@ mesos::internal::master::Flags::Flags()
       " (batch) allocations (e.g., 500ms, 1sec, etc).",
       DEFAULT_ALLOCATION_INTERVAL);
 
+  add(&Flags::offer_filter_parallelism,
+      "offer_filter_parallelism",
+      "The maximum number of threads that the (hierarchical) allocator\n"
+      "uses to evaluate the frameworks' offer filters for each agent in\n"
+      "an allocation. Additional threads are only used when there are\n"
+      "enough agents to share between them. This does not change the\n"
+      "resulting allocations.",
+      DEFAULT_OFFER_FILTER_PARALLELISM,
+      [](size_t value) -> Option<Error> {
+        if (value < 1) {
+          return Error(
+              "Expected `--offer_filter_parallelism` to be at least 1");
+        }
+        return None();
+      });
+
+  add(&Flags::allocation_agent_order,
+      "allocation_agent_order",
+      "The order in which the (hierarchical) allocator considers agents\n"
+      "in an allocation. May be one of:\n"
+      "  `random`: the agents are shuffled.\n"
+      "  `binpack`: the most allocated agents come first, packing\n"
+      "    allocations onto fewer agents so that others can be drained.\n"
+      "  `spread`: the least allocated agents come first.\n"
+      "  `attribute:NAME`: agents with the same value of the `NAME`\n"
+      "    attribute (e.g. a rack) come one after the other.\n"
+      "Agents are scored by their most allocated resource among cpus,\n"
+      "mem, disk and gpus. Ties are broken randomly.",
+      DEFAULT_ALLOCATION_AGENT_ORDER,
+      [](const string& value) -> Option<Error> {
+        Try<AgentOrder> order = AgentOrder::parse(value);
+
+        if (order.isError()) {
+          return Error(
+              "Invalid `--allocation_agent_order`: " + order.error());
+        }
+        return None();
+      });
+
+  add(&Flags::allocation_batch_size,
+      "allocation_batch_size",
+      "If set, the (hierarchical) allocator allocates from at most this\n"
+      "many agents at a time (counting each agent once per allocation\n"
+      "stage), and handles the updates that were queued meanwhile (e.g.,\n"
+      "resources being recovered or agents being added) before continuing\n"
+      "with the next agents. This keeps the allocator responsive while it\n"
+      "allocates from many agents. The allocations made so far are offered\n"
+      "once all the agents have been allocated from, unless the framework\n"
+      "or the agent was removed or deactivated in the meantime.",
+      [](const Option<size_t>& value) -> Option<Error> {
+        if (value.isSome() && value.get() < 1) {
+          return Error("Expected `--allocation_batch_size` to be at least 1");
+        }
+        return None();
+      });
+
+  add(&Flags::allocation_sweep_interval,
+      "allocation_sweep_interval",
+      "If set, the (hierarchical) allocator is driven by changes rather\n"
+      "than sweeping all agents every `--allocation_interval`: each\n"
+      "(batch) allocation only considers the agents whose allocation may\n"
+      "have changed since the last one (e.g., resources were recovered or\n"
+      "an offer filter expired on them), and is skipped if there are none.\n"
+      "Changes that may affect any agent (e.g., a framework is revived or\n"
+      "a quota is changed) result in an allocation for all agents. All\n"
+      "agents are also allocated from at least this often, as a safety\n"
+      "net (e.g., 1mins). Should be a multiple of `--allocation_interval`.",
+      [](const Option<Duration>& value) -> Option<Error> {
+        if (value.isSome() && value.get() <= Duration::zero()) {
+          return Error(
+              "Expected `--allocation_sweep_interval` to be positive");
+        }
+        return None();
+      });
+
   add(&Flags::cluster,
       "cluster",
       "Human readable name for the cluster, displayed in the webui.");
@@ -460,6 +581,27 @@ mesos::internal::master::Flags::Flags()
       "load an alternate allocator module using `--modules`.",
       DEFAULT_ALLOCATOR);
 
+  add(&Flags::allocator_record_path,
+      "allocator_record_path",
+      "If set, the (hierarchical) allocator records the calls into it\n"
+      "(e.g., agents and frameworks being added, resources being recovered\n"
+      "and quota and weight changes) to this file, which is truncated on\n"
+      "startup. The recording can be replayed offline against a fresh\n"
+      "allocator with `mesos-allocator-replay` to reproduce the\n"
+      "allocations of this master.\n"
+      "NOTE: This is meant for debugging allocation issues. The calls\n"
+      "are written out after every allocation run, on the allocator's\n"
+      "thread, and the recording is not rotated (see\n"
+      "`--allocator_record_max_size`).");
+
+  add(&Flags::allocator_record_max_size,
+      "allocator_record_max_size",
+      "Maximum size of the recording of the allocator calls (see\n"
+      "`--allocator_record_path`). Once it is reached, the allocator stops\n"
+      "recording, so that the recording stays a replayable prefix of the\n"
+      "calls.",
+      DEFAULT_ALLOCATOR_RECORD_MAX_SIZE);
+
   add(&Flags::fair_sharing_excluded_resource_names,
       "fair_sharing_excluded_resource_names",
       "A comma-separated list of the resource names (e.g. 'gpus')\n"
@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/option.hpp>
 #include <stout/path.hpp>
@@ -54,6 +55,9 @@ public:
   bool registry_strict;
   Duration registry_fetch_timeout;
   Duration registry_store_timeout;
+  Option<size_t> registry_max_batch_size;
+  Duration registry_batch_latency;
+  Option<size_t> registry_max_delta_operations;
   bool log_auto_initialize;
   Duration agent_reregister_timeout;
   std::string recovery_agent_removal_limit;
@@ -63,6 +67,10 @@ public:
   std::string role_sorter;
   std::string framework_sorter;
   Duration allocation_interval;
+  size_t offer_filter_parallelism;
+  std::string allocation_agent_order;
+  Option<size_t> allocation_batch_size;
+  Option<Duration> allocation_sweep_interval;
   Option<std::string> cluster;
   Option<std::string> roles;
   Option<std::string> weights;
@@ -81,6 +89,8 @@ public:
   Option<std::string> modulesDir;
   std::string authenticators;
   std::string allocator;
+  Option<std::string> allocator_record_path;
+  Bytes allocator_record_max_size;
   Option<std::set<std::string>> fair_sharing_excluded_resource_names;
   bool filter_gpu_resources;
   std::string min_allocatable_resources;
@@ -68,6 +68,7 @@ Framework::Framework(
     registeredTime(time),
     reregisteredTime(time),
     completedTasks(masterFlags.max_completed_tasks_per_framework),
+    completedTaskFragments(masterFlags.max_completed_tasks_per_framework),
     unreachableTasks(masterFlags.max_unreachable_tasks_per_framework),
     metrics(_info)
 {
@@ -117,6 +118,8 @@ void Framework::addTask(Task* task)
   }
 
   tasks[task->task_id()] = task;
+  taskFragments[task->task_id()] =
+    Fragment(master->stateChanges.changed(id()));
 
   // Unreachable tasks should be added via `addUnreachableTask`.
   CHECK(task->state() != TASK_UNREACHABLE)
@@ -192,24 +195,45 @@ void Framework::recoverResources(Task* task)
     CHECK(totalOfferedResources.filter(allocatedToRole).empty());
     untrackUnderRole(role);
   }
+
+  master->stateChanges.changed(id());
 }
 
 
-void Framework::addCompletedTask(Task&& task)
+void Framework::addCompletedTask(Task&& task, Fragment&& fragment)
 {
   // TODO(neilc): We currently allow frameworks to reuse the task
   // IDs of completed tasks (although this is discouraged). This
   // means that there might be multiple completed tasks with the
   // same task ID. We should consider rejecting attempts to reuse
   // task IDs (MESOS-6779).
-  completedTasks.push_back(process::Owned<Task>(new Task(std::move(task))));
+  //
+  // Once the completed tasks are at capacity, the oldest one is evicted
+  // (or the task itself if the capacity is zero).
+  if (completedTasks.full()) {
+    master->stateChanges.evicted(
+        id(),
+        completedTasks.empty()
+          ? task.task_id()
+          : completedTasks.front().task_id());
+  }
+
+  completedTasks.push_back(CompactTask(task, &master->taskInterners));
+
+  // The JSON representation of the task does not change when it
+  // completes, but the task moves into the completed tasks.
+  fragment.touch(master->stateChanges.changed(id()));
+  completedTaskFragments.push_back(std::move(fragment));
 }
 
 
 void Framework::addUnreachableTask(const Task& task)
 {
   // TODO(adam-mesos): Check if unreachable task already exists.
-  unreachableTasks.set(task.task_id(), process::Owned<Task>(new Task(task)));
+  unreachableTasks.set(
+      task.task_id(), CompactTask(task, &master->taskInterners));
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -233,10 +257,15 @@ void Framework::removeTask(Task* task, bool unreachable)
 
     // TODO(bmahler): This moves a potentially non-terminal task into
     // the completed list!
-    addCompletedTask(Task(*task));
+    //
+    // The task does not change when it completes, so we can keep
+    // its cached JSON representation.
+    addCompletedTask(
+        Task(*task), std::move(taskFragments.at(task->task_id())));
   }
 
   tasks.erase(task->task_id());
+  taskFragments.erase(task->task_id());
 }
 
 
@@ -246,6 +275,8 @@ void Framework::addOffer(Offer* offer)
   offers.insert(offer);
   totalOfferedResources += offer->resources();
   offeredResources[offer->slave_id()] += offer->resources();
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -261,6 +292,8 @@ void Framework::removeOffer(Offer* offer)
   }
 
   offers.erase(offer);
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -320,6 +353,8 @@ void Framework::addExecutor(
       trackUnderRole(role);
     }
   }
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -362,6 +397,8 @@ void Framework::removeExecutor(
   if (executors[slaveId].empty()) {
     executors.erase(slaveId);
   }
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -408,6 +445,8 @@ void Framework::addOperation(Operation* operation)
       }
     }
   }
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -470,6 +509,8 @@ void Framework::recoverResources(Operation* operation)
       untrackUnderRole(role);
     }
   }
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -492,6 +533,8 @@ void Framework::removeOperation(Operation* operation)
   }
 
   operations.erase(uuid);
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -608,6 +651,8 @@ void Framework::update(const FrameworkInfo& newInfo)
       trackUnderRole(role);
     }
   }
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -621,6 +666,8 @@ void Framework::updateConnection(const process::UPID& newPid)
 
   // TODO(benh): unlink(oldPid);
   pid = newPid;
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -641,6 +688,8 @@ void Framework::updateConnection(const HttpConnection& newHttp)
   CHECK_NONE(http);
 
   http = newHttp;
+
+  master->stateChanges.changed(id());
 }
 
 
@@ -742,6 +791,8 @@ void Framework::setFrameworkState(const Framework::State& _state)
 {
   state = _state;
   metrics.subscribed = state == Framework::State::ACTIVE ? 1 : 0;
+
+  master->stateChanges.changed(id());
 }
 
 } // namespace master {
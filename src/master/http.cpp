@@ -422,7 +422,7 @@ Future<Response> Master::Http::subscribe(
 
           // Master::subscribe will start the heartbeater process, which should
           // only happen after `SUBSCRIBED` event is sent.
-          master->subscribe(http, principal);
+          master->subscribe(http, principal, call.subscribe());
 
           return ok;
         }));
@@ -1248,13 +1248,176 @@ Future<Response> Master::Http::frameworks(
       {VIEW_FRAMEWORK, VIEW_TASK, VIEW_EXECUTOR})
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprovers>& approvers) {
+        [this, request, principal](const Owned<ObjectApprovers>& approvers) {
           return deferBatchedRequest(
-            &Master::ReadOnlyHandler::frameworks, request, approvers);
+              &Master::ReadOnlyHandler::frameworks,
+              principal,
+              request,
+              approvers);
         }));
 }
 
 
+// Adds the executors of the framework which the principal is
+// authorized to view.
+static void addExecutors(
+    const Framework& framework,
+    const Owned<ObjectApprovers>& approvers,
+    mesos::master::Response::GetExecutors* getExecutors)
+{
+  foreachpair (const SlaveID& slaveId,
+               const auto& executorsMap,
+               framework.executors) {
+    foreachvalue (const ExecutorInfo& executorInfo, executorsMap) {
+      // Skip unauthorized executors.
+      if (!approvers->approved<VIEW_EXECUTOR>(
+              executorInfo, framework.info)) {
+        continue;
+      }
+
+      mesos::master::Response::GetExecutors::Executor* executor =
+        getExecutors->add_executors();
+
+      executor->mutable_executor_info()->CopyFrom(executorInfo);
+      executor->mutable_slave_id()->CopyFrom(slaveId);
+    }
+  }
+}
+
+
+// Adds a task to the tasks of an operator API response. The v1
+// representation is taken from the fragment of the task, if any, so
+// that it is not evolved again for every response (see `Fragment`).
+static void addTask(
+    const Task& task,
+    const Fragment* fragment,
+    RepeatedPtrField<Task>* tasks)
+{
+  *tasks->Add() = task;
+}
+
+
+static void addTask(
+    const Task& task,
+    const Fragment* fragment,
+    RepeatedPtrField<v1::Task>* tasks)
+{
+  *tasks->Add() = fragment != nullptr ? *fragment->v1(task) : evolve(task);
+}
+
+
+static void addTask(
+    const CompactTask& task,
+    const Fragment* fragment,
+    RepeatedPtrField<Task>* tasks)
+{
+  *tasks->Add() = task.get();
+}
+
+
+static void addTask(
+    const CompactTask& task,
+    const Fragment* fragment,
+    RepeatedPtrField<v1::Task>* tasks)
+{
+  *tasks->Add() =
+    fragment != nullptr ? *fragment->v1(task) : evolve(task.get());
+}
+
+
+// Adds the tasks of the framework which the principal is authorized
+// to view, to either an internal or a v1 `GetTasks`. If `since` is
+// set, only the active and completed tasks which changed after that
+// version of the master state are added.
+template <typename GetTasks>
+static void addTasks(
+    const Framework& framework,
+    const Owned<ObjectApprovers>& approvers,
+    const Option<uint64_t>& since,
+    GetTasks* getTasks)
+{
+  // Pending tasks.
+  foreachvalue (const TaskInfo& taskInfo, framework.pendingTasks) {
+    // Skip unauthorized tasks.
+    if (!approvers->approved<VIEW_TASK>(taskInfo, framework.info)) {
+      continue;
+    }
+
+    addTask(
+        protobuf::createTask(taskInfo, TASK_STAGING, framework.id()),
+        nullptr,
+        getTasks->mutable_pending_tasks());
+  }
+
+  // Active tasks.
+  foreachvalue (Task* task, framework.tasks) {
+    CHECK_NOTNULL(task);
+
+    const Fragment& fragment = framework.taskFragments.at(task->task_id());
+
+    // Skip unchanged tasks.
+    if (since.isSome() && fragment.version() <= since.get()) {
+      continue;
+    }
+
+    // Skip unauthorized tasks.
+    if (!approvers->approved<VIEW_TASK>(*task, framework.info)) {
+      continue;
+    }
+
+    addTask(*task, &fragment, getTasks->mutable_tasks());
+  }
+
+  // Unreachable tasks.
+  foreachvalue (const CompactTask& task, framework.unreachableTasks) {
+    // Skip unauthorized tasks.
+    if (!approved(approvers, task, framework.info)) {
+      continue;
+    }
+
+    addTask(task, nullptr, getTasks->mutable_unreachable_tasks());
+  }
+
+  // Completed tasks.
+  for (size_t i = 0; i < framework.completedTasks.size(); ++i) {
+    const CompactTask& task = framework.completedTasks[i];
+    const Fragment& fragment = framework.completedTaskFragments[i];
+
+    // Skip unchanged tasks.
+    if (since.isSome() && fragment.version() <= since.get()) {
+      continue;
+    }
+
+    // Skip unauthorized tasks.
+    if (!approved(approvers, task, framework.info)) {
+      continue;
+    }
+
+    addTask(task, &fragment, getTasks->mutable_completed_tasks());
+  }
+}
+
+
+// Adds the recovered agents, without the resources which the
+// principal is not authorized to view.
+static void addRecoveredAgents(
+    const hashmap<SlaveID, SlaveInfo>& recovered,
+    const Owned<ObjectApprovers>& approvers,
+    mesos::master::Response::GetAgents* getAgents)
+{
+  foreachvalue (const SlaveInfo& slaveInfo, recovered) {
+    SlaveInfo* agent = getAgents->add_recovered_agents();
+    agent->CopyFrom(slaveInfo);
+    agent->clear_resources();
+    foreach (const Resource& resource, slaveInfo.resources()) {
+      if (approvers->approved<VIEW_ROLE>(resource)) {
+        agent->add_resources()->CopyFrom(resource);
+      }
+    }
+  }
+}
+
+
 mesos::master::Response::GetFrameworks::Framework model(
     const Framework& framework)
 {
@@ -1409,23 +1572,7 @@ mesos::master::Response::GetExecutors Master::Http::_getExecutors(
   mesos::master::Response::GetExecutors getExecutors;
 
   foreach (const Framework* framework, frameworks) {
-    foreachpair (const SlaveID& slaveId,
-                 const auto& executorsMap,
-                 framework->executors) {
-      foreachvalue (const ExecutorInfo& executorInfo, executorsMap) {
-        // Skip unauthorized executors.
-        if (!approvers->approved<VIEW_EXECUTOR>(
-                executorInfo, framework->info)) {
-          continue;
-        }
-
-        mesos::master::Response::GetExecutors::Executor* executor =
-          getExecutors.add_executors();
-
-        executor->mutable_executor_info()->CopyFrom(executorInfo);
-        executor->mutable_slave_id()->CopyFrom(slaveId);
-      }
-    }
+    addExecutors(*framework, approvers, &getExecutors);
   }
 
   return getExecutors;
@@ -1449,16 +1596,29 @@ Future<Response> Master::Http::getState(
           mesos::master::Response response;
           response.set_type(mesos::master::Response::GET_STATE);
 
-          *response.mutable_get_state() = _getState(approvers);
+          Option<string> since;
+          if (call.has_get_state() && call.get_state().has_since()) {
+            since = call.get_state().since();
+          }
+
+          // The tasks are added to the evolved response, since most of
+          // their v1 representations are cached.
+          v1::master::Response::GetTasks tasks;
+          *response.mutable_get_state() = _getState(approvers, since, &tasks);
+
+          v1::master::Response v1Response = evolve(response);
+          v1Response.mutable_get_state()->mutable_get_tasks()->Swap(&tasks);
 
           return OK(
-              serialize(contentType, evolve(response)), stringify(contentType));
+              serialize(contentType, v1Response), stringify(contentType));
         }));
 }
 
 
 mesos::master::Response::GetState Master::Http::_getState(
-    const Owned<ObjectApprovers>& approvers) const
+    const Owned<ObjectApprovers>& approvers,
+    const Option<string>& since,
+    v1::master::Response::GetTasks* v1Tasks) const
 {
   // NOTE: This function must be blocking instead of returning a
   // `Future`. This is because `subscribe()` needs to atomically
@@ -1467,10 +1627,96 @@ mesos::master::Response::GetState Master::Http::_getState(
 
   mesos::master::Response::GetState getState;
 
-  *getState.mutable_get_tasks() = _getTasks(approvers);
-  *getState.mutable_get_executors() = _getExecutors(approvers);
-  *getState.mutable_get_frameworks() = _getFrameworks(approvers);
-  *getState.mutable_get_agents() = _getAgents(approvers);
+  getState.set_cursor(master->stateCursor());
+
+  // The full state is returned if the changes since the cursor are
+  // not known (anymore), see `StateChanges`.
+  const Option<uint64_t> version =
+    since.isSome() ? master->stateVersion(since.get()) : None();
+
+  if (version.isNone()) {
+    *getState.mutable_get_tasks() = _getTasks(approvers, v1Tasks);
+    *getState.mutable_get_executors() = _getExecutors(approvers);
+    *getState.mutable_get_frameworks() = _getFrameworks(approvers);
+    *getState.mutable_get_agents() = _getAgents(approvers);
+
+    return getState;
+  }
+
+  getState.set_since(since.get());
+
+  // Model the changed frameworks, along with their changed tasks and
+  // the completed tasks which have been evicted. Frameworks which are
+  // neither registered nor completed have been evicted from the
+  // completed frameworks, and are listed as removed.
+  const hashmap<FrameworkID, vector<TaskID>> evictedTasks =
+    master->stateChanges.evictedTasks(version.get());
+
+  foreach (const FrameworkID& frameworkId,
+           master->stateChanges.frameworks(version.get())) {
+    const bool completed =
+      !master->frameworks.registered.contains(frameworkId);
+
+    if (completed && !master->frameworks.completed.contains(frameworkId)) {
+      *getState.add_removed_framework_ids() = frameworkId;
+      continue;
+    }
+
+    const Framework* framework = completed
+      ? master->frameworks.completed.at(frameworkId).get()
+      : master->frameworks.registered.at(frameworkId);
+
+    // Skip unauthorized frameworks.
+    if (!approvers->approved<VIEW_FRAMEWORK>(framework->info)) {
+      continue;
+    }
+
+    if (completed) {
+      *getState.mutable_get_frameworks()->add_completed_frameworks() =
+        model(*framework);
+    } else {
+      *getState.mutable_get_frameworks()->add_frameworks() =
+        model(*framework);
+    }
+
+    if (v1Tasks != nullptr) {
+      addTasks(*framework, approvers, version, v1Tasks);
+    } else {
+      addTasks(*framework, approvers, version, getState.mutable_get_tasks());
+    }
+    addExecutors(*framework, approvers, getState.mutable_get_executors());
+
+    if (evictedTasks.contains(frameworkId)) {
+      mesos::master::Response::GetState::EvictedTasks* evicted =
+        getState.add_evicted_completed_tasks();
+
+      *evicted->mutable_framework_id() = frameworkId;
+
+      foreach (const TaskID& taskId, evictedTasks.at(frameworkId)) {
+        *evicted->add_task_ids() = taskId;
+      }
+    }
+  }
+
+  // Model the changed agents, along with the ones which are no longer
+  // registered. The recovered agents are always modeled in full.
+  foreach (const SlaveID& slaveId,
+           master->stateChanges.slaves(version.get())) {
+    const Slave* slave = master->slaves.registered.get(slaveId);
+
+    if (slave == nullptr) {
+      *getState.add_removed_slave_ids() = slaveId;
+      continue;
+    }
+
+    *getState.mutable_get_agents()->add_agents() =
+      protobuf::master::event::createAgentResponse(*slave, approvers);
+  }
+
+  addRecoveredAgents(
+      master->slaves.recovered,
+      approvers,
+      getState.mutable_get_agents());
 
   return getState;
 }
@@ -2048,9 +2294,9 @@ Future<Response> Master::Http::slaves(
   return ObjectApprovers::create(master->authorizer, principal, {VIEW_ROLE})
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprovers>& approvers) {
+        [this, request, principal](const Owned<ObjectApprovers>& approvers) {
           return deferBatchedRequest(
-              &Master::ReadOnlyHandler::slaves, request, approvers);
+              &Master::ReadOnlyHandler::slaves, principal, request, approvers);
         }));
 }
 
@@ -2086,16 +2332,7 @@ mesos::master::Response::GetAgents Master::Http::_getAgents(
         protobuf::master::event::createAgentResponse(*slave, approvers);
   }
 
-  foreachvalue (const SlaveInfo& slaveInfo, master->slaves.recovered) {
-    SlaveInfo* agent = getAgents.add_recovered_agents();
-    agent->CopyFrom(slaveInfo);
-    agent->clear_resources();
-    foreach (const Resource& resource, slaveInfo.resources()) {
-      if (approvers->approved<VIEW_ROLE>(resource)) {
-        agent->add_resources()->CopyFrom(resource);
-      }
-    }
-  }
+  addRecoveredAgents(master->slaves.recovered, approvers, &getAgents);
 
   return getAgents;
 }
@@ -2248,6 +2485,22 @@ string Master::Http::STATE_HELP()
         "The information shown might be filtered based on the user",
         "accessing the endpoint.",
         "",
+        "Query parameters:",
+        ">        since=VALUE          The `cursor` of a previous response.",
+        "",
+        "Every response includes a `cursor`. When it is passed as `since`,",
+        "`slaves`, `frameworks` and `completed_frameworks` only include the",
+        "agents and frameworks which changed since the previous response,",
+        "and the frameworks only include the tasks and completed tasks",
+        "which changed. The completed tasks which were evicted since then",
+        "are listed by ID in `evicted_completed_tasks` of their framework.",
+        "Agents which are no longer registered are listed in",
+        "`removed_slaves`, and frameworks which were evicted from the",
+        "completed frameworks are listed in `removed_frameworks`. Such",
+        "incremental responses echo the cursor in `since`. If the changes",
+        "since the cursor are not known, e.g., because the cursor is too",
+        "old or was issued by another master, the whole state is returned.",
+        "",
         "Example (**Note**: this is not exhaustive):",
         "",
         "```",
@@ -2262,6 +2515,7 @@ string Master::Http::STATE_HELP()
         "    \"start_time\" : 1455643643.42422,",
         "    \"elected_time\" : 1455643643.43457,",
         "    \"id\" : \"b5eac2c5-609b-4ca1-a352-61941702fc9e\",",
+        "    \"cursor\" : \"b5eac2c5-609b-4ca1-a352-61941702fc9e:42\",",
         "    \"pid\" : \"master@127.0.0.1:5050\",",
         "    \"hostname\" : \"localhost\",",
         "    \"activated_slaves\" : 0,",
@@ -2344,19 +2598,16 @@ Future<Response> Master::Http::state(
     return redirect(request);
   }
 
-  // TODO(alexr): De-duplicate response processing when the principal is
-  // identical, e.g., if "bob" asks for state three times in one batch,
-  // ideally we only compute the response for "bob" once since they're all
-  // identical within a principal.
   return ObjectApprovers::create(
       master->authorizer,
       principal,
       {VIEW_ROLE, VIEW_FRAMEWORK, VIEW_TASK, VIEW_EXECUTOR, VIEW_FLAGS})
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprovers>& approvers) {
+        [this, request, principal](const Owned<ObjectApprovers>& approvers) {
           return deferBatchedRequest(
               &Master::ReadOnlyHandler::state,
+              principal,
               request,
               approvers);
         }));
@@ -2365,6 +2616,7 @@ Future<Response> Master::Http::state(
 
 Future<Response> Master::Http::deferBatchedRequest(
     ReadOnlyRequestHandler handler,
+    const Option<Principal>& principal,
     const Request& request,
     const Owned<ObjectApprovers>& approvers) const
 {
@@ -2373,8 +2625,8 @@ Future<Response> Master::Http::deferBatchedRequest(
   // Add an element to the batched state requests.
   Promise<Response> promise;
   Future<Response> future = promise.future();
-  batchedRequests.push_back(
-      BatchedRequest{handler, request, approvers, std::move(promise)});
+  batchedRequests.push_back(BatchedRequest{
+      handler, principal, request, approvers, std::move(promise)});
 
   // Schedule processing of batched requests if not yet scheduled.
   if (scheduleBatch) {
@@ -2394,12 +2646,43 @@ void Master::Http::processRequestsBatch() const
 
   // Produce the responses in parallel.
   //
+  // Identical requests, i.e., requests by the same principal to the same
+  // endpoint with the same query parameters, get the same response. So
+  // if, e.g., several dashboards of "bob" ask for state in one batch, we
+  // only compute the response for "bob" once, so that the time for which
+  // the master actor is blocked below does not grow with the number of
+  // such requests. It still grows with the number of distinct requests.
+  //
   // TODO(alexr): Consider abstracting this into `parallel_async` or
   // `foreach_parallel`, see MESOS-8587.
   //
   // TODO(alexr): Consider moving `BatchedStateRequest`'s fields into
   // `process::async` once it supports moving.
-  foreach (BatchedRequest& request, batchedRequests) {
+  vector<Future<Response>> responses;
+
+  for (size_t i = 0; i < batchedRequests.size(); ++i) {
+    BatchedRequest& request = batchedRequests[i];
+
+    // NOTE: Batches are small, so we look for an identical request
+    // among the previous ones rather than indexing them.
+    Option<size_t> identical;
+    for (size_t j = 0; j < i; ++j) {
+      const BatchedRequest& previous = batchedRequests[j];
+
+      if (previous.handler == request.handler &&
+          previous.principal == request.principal &&
+          previous.request.url.query == request.request.url.query) {
+        identical = j;
+        break;
+      }
+    }
+
+    if (identical.isSome()) {
+      request.promise.associate(
+          batchedRequests[identical.get()].promise.future());
+      continue;
+    }
+
     request.promise.associate(process::async(
         [this](ReadOnlyRequestHandler handler,
                const process::http::Request& request,
@@ -2409,6 +2692,8 @@ void Master::Http::processRequestsBatch() const
         request.handler,
         request.request,
         request.approvers));
+
+    responses.push_back(request.promise.future());
   }
 
   // Block the master actor until all workers have generated state responses.
@@ -2417,10 +2702,6 @@ void Master::Http::processRequestsBatch() const
   //
   // NOTE: There is the potential for deadlock since we are blocking 1 working
   // thread here, see MESOS-8256.
-  vector<Future<Response>> responses;
-  foreach (const BatchedRequest& request, batchedRequests) {
-    responses.push_back(request.promise.future());
-  }
   process::await(responses).await();
 
   batchedRequests.clear();
@@ -2529,9 +2810,12 @@ Future<Response> Master::Http::stateSummary(
       {VIEW_ROLE, VIEW_FRAMEWORK})
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprovers>& approvers) {
+        [this, request, principal](const Owned<ObjectApprovers>& approvers) {
           return deferBatchedRequest(
-              &Master::ReadOnlyHandler::stateSummary, request, approvers);
+              &Master::ReadOnlyHandler::stateSummary,
+              principal,
+              request,
+              approvers);
         }));
 }
 
@@ -3070,9 +3354,9 @@ Future<Response> Master::Http::tasks(
       {VIEW_FRAMEWORK, VIEW_TASK})
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprovers>& approvers) {
+        [this, request, principal](const Owned<ObjectApprovers>& approvers) {
           return deferBatchedRequest(
-              &Master::ReadOnlyHandler::tasks, request, approvers);
+              &Master::ReadOnlyHandler::tasks, principal, request, approvers);
         }));
 }
 
@@ -3094,16 +3378,23 @@ Future<Response> Master::Http::getTasks(
           mesos::master::Response response;
           response.set_type(mesos::master::Response::GET_TASKS);
 
-          *response.mutable_get_tasks() = _getTasks(approvers);
+          // The tasks are added to the evolved response, since most of
+          // their v1 representations are cached.
+          v1::master::Response::GetTasks tasks;
+          _getTasks(approvers, &tasks);
+
+          v1::master::Response v1Response = evolve(response);
+          v1Response.mutable_get_tasks()->Swap(&tasks);
 
           return OK(
-              serialize(contentType, evolve(response)), stringify(contentType));
+              serialize(contentType, v1Response), stringify(contentType));
   }));
 }
 
 
 mesos::master::Response::GetTasks Master::Http::_getTasks(
-    const Owned<ObjectApprovers>& approvers) const
+    const Owned<ObjectApprovers>& approvers,
+    v1::master::Response::GetTasks* v1Tasks) const
 {
   // Construct framework list with both active and completed frameworks.
   vector<const Framework*> frameworks;
@@ -3128,48 +3419,11 @@ mesos::master::Response::GetTasks Master::Http::_getTasks(
 
   mesos::master::Response::GetTasks getTasks;
 
-  vector<const Task*> tasks;
   foreach (const Framework* framework, frameworks) {
-    // Pending tasks.
-    foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
-      // Skip unauthorized tasks.
-      if (!approvers->approved<VIEW_TASK>(taskInfo, framework->info)) {
-        continue;
-      }
-
-      *getTasks.add_pending_tasks() =
-        protobuf::createTask(taskInfo, TASK_STAGING, framework->id());
-    }
-
-    // Active tasks.
-    foreachvalue (Task* task, framework->tasks) {
-      CHECK_NOTNULL(task);
-      // Skip unauthorized tasks.
-      if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
-        continue;
-      }
-
-      getTasks.add_tasks()->CopyFrom(*task);
-    }
-
-    // Unreachable tasks.
-    foreachvalue (const Owned<Task>& task, framework->unreachableTasks) {
-      // Skip unauthorized tasks.
-      if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
-        continue;
-      }
-
-      getTasks.add_unreachable_tasks()->CopyFrom(*task);
-    }
-
-    // Completed tasks.
-    foreach (const Owned<Task>& task, framework->completedTasks) {
-      // Skip unauthorized tasks.
-      if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
-        continue;
-      }
-
-      getTasks.add_completed_tasks()->CopyFrom(*task);
+    if (v1Tasks != nullptr) {
+      addTasks(*framework, approvers, None(), v1Tasks);
+    } else {
+      addTasks(*framework, approvers, None(), &getTasks);
     }
   }
 
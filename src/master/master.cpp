@@ -22,6 +22,7 @@
 #include <functional>
 #include <iomanip>
 #include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -69,6 +70,7 @@
 #include <stout/option.hpp>
 #include <stout/path.hpp>
 #include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 #include <stout/unreachable.hpp>
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
@@ -99,6 +101,8 @@
 using google::protobuf::RepeatedPtrField;
 
 using std::list;
+using std::map;
+using std::pair;
 using std::reference_wrapper;
 using std::set;
 using std::shared_ptr;
@@ -324,6 +328,7 @@ Master::Master(
     detector(_detector),
     authorizer(_authorizer),
     frameworks(flags),
+    stateChanges(MAX_STATE_CHANGES),
     subscribers(this),
     authenticator(None()),
     metrics(new Metrics(*this)),
@@ -754,16 +759,28 @@ void Master::initialize()
     }
   }
 
+  mesos::allocator::Options options;
+
+  options.allocationInterval = flags.allocation_interval;
+  options.allocationSweepInterval = flags.allocation_sweep_interval;
+  options.fairnessExcludeResourceNames =
+    flags.fair_sharing_excluded_resource_names;
+  options.filterGpuResources = flags.filter_gpu_resources;
+  options.domain = flags.domain;
+  options.minAllocatableResources = CHECK_NOTERROR(minAllocatableResources);
+  options.maxCompletedFrameworks = flags.max_completed_frameworks;
+  options.offerFilterParallelism = flags.offer_filter_parallelism;
+  options.agentOrder = flags.allocation_agent_order;
+  options.allocationBatchSize = flags.allocation_batch_size;
+  options.authenticationRealm = READONLY_HTTP_AUTHENTICATION_REALM;
+  options.recordPath = flags.allocator_record_path;
+  options.recordMaxSize = flags.allocator_record_max_size;
+
   // Initialize the allocator.
   allocator->initialize(
-      flags.allocation_interval,
+      options,
       defer(self(), &Master::offer, lambda::_1, lambda::_2),
-      defer(self(), &Master::inverseOffer, lambda::_1, lambda::_2),
-      flags.fair_sharing_excluded_resource_names,
-      flags.filter_gpu_resources,
-      flags.domain,
-      CHECK_NOTERROR(minAllocatableResources),
-      flags.max_completed_frameworks);
+      defer(self(), &Master::inverseOffer, lambda::_1, lambda::_2));
 
   // Parse the whitelist. Passing Allocator::updateWhitelist()
   // callback is safe because we shut down the whitelistWatcher in
@@ -842,6 +859,10 @@ void Master::initialize()
   install<StatusUpdateMessage>(
       &Master::statusUpdate);
 
+  // Added in 1.7.0 to handle the status updates of many tasks at once.
+  install<StatusUpdatesMessage>(
+      &Master::statusUpdates);
+
   // Added in 0.24.0 to support HTTP schedulers. Since
   // these do not have a pid, the slave must forward
   // messages through the master.
@@ -3267,6 +3288,7 @@ void Master::disconnect(Slave* slave)
   LOG(INFO) << "Disconnecting agent " << *slave;
 
   slave->connected = false;
+  stateChanges.changed(slave->id);
 
   // Inform the slave observer.
   dispatch(slave->observer, &SlaveObserver::disconnect);
@@ -3286,6 +3308,7 @@ void Master::deactivate(Slave* slave)
   LOG(INFO) << "Deactivating agent " << *slave;
 
   slave->active = false;
+  stateChanges.changed(slave->id);
 
   allocator->deactivateSlave(slave->id);
 
@@ -7548,6 +7571,7 @@ void Master::___reregisterSlave(
   }
 
   slave->reregisteredTime = Clock::now();
+  stateChanges.changed(slave->id);
 
   allocator->updateSlave(
     slave->id,
@@ -7578,6 +7602,8 @@ void Master::___reregisterSlave(
     dispatch(slave->observer, &SlaveObserver::reconnect);
 
     slave->active = true;
+    stateChanges.changed(slave->id);
+
     allocator->activateSlave(slave->id);
   }
 
@@ -7765,6 +7791,8 @@ void Master::updateSlave(UpdateSlaveMessage&& message)
     return;
   }
 
+  stateChanges.changed(slaveId);
+
   // NOTE: We must *first* update the agent's resources before we
   // recover the resources. If we recovered the resources first,
   // an allocation could trigger between recovering resources and
@@ -8288,12 +8316,53 @@ void Master::updateUnavailability(
 // TODO(vinod): Add a benchmark test for status update handling.
 void Master::statusUpdate(StatusUpdateMessage&& statusUpdateMessage)
 {
-  const StatusUpdate& update = statusUpdateMessage.update();
-  const UPID& pid = statusUpdateMessage.pid();
+  ++metrics->messages_status_update;
 
-  CHECK_NE(pid, UPID());
+  StatusUpdateBatch batch;
 
-  ++metrics->messages_status_update;
+  statusUpdate(
+      statusUpdateMessage.update(), statusUpdateMessage.pid(), &batch);
+
+  commitStatusUpdates(batch);
+}
+
+
+void Master::statusUpdates(StatusUpdatesMessage&& statusUpdatesMessage)
+{
+  const int count = statusUpdatesMessage.updates_size();
+
+  LOG(INFO) << "Received " << count << " status updates from agent "
+            << statusUpdatesMessage.slave_id();
+
+  metrics->messages_status_update += count;
+
+  StatusUpdateBatch batch;
+
+  foreach (const StatusUpdate& update, statusUpdatesMessage.updates()) {
+    // The agent forwards the updates of its own tasks only.
+    if (update.slave_id() != statusUpdatesMessage.slave_id()) {
+      LOG(WARNING) << "Ignoring status update " << update
+                   << " for agent " << update.slave_id() << " from agent "
+                   << statusUpdatesMessage.slave_id();
+
+      ++metrics->invalid_status_updates;
+      continue;
+    }
+
+    statusUpdate(update, statusUpdatesMessage.pid(), &batch);
+  }
+
+  commitStatusUpdates(batch);
+}
+
+
+void Master::statusUpdate(
+    const StatusUpdate& update,
+    const UPID& pid,
+    StatusUpdateBatch* batch)
+{
+  CHECK_NOTNULL(batch);
+  CHECK_NE(pid, UPID());
 
   if (slaves.removed.get(update.slave_id()).isSome()) {
     // If the slave has been removed, drop the status update. The
@@ -8341,7 +8410,7 @@ void Master::statusUpdate(StatusUpdateMessage&& statusUpdateMessage)
   // A framework might not have reregistered upon a master failover or
   // got disconnected.
   if (framework != nullptr && framework->connected()) {
-    forward(update, pid, framework);
+    forward(update, pid, framework, &batch->forwarded[framework->id()]);
   } else {
     validStatusUpdate = false;
     LOG(WARNING) << "Received status update " << update << " from agent "
@@ -8366,17 +8435,42 @@ void Master::statusUpdate(StatusUpdateMessage&& statusUpdateMessage)
     return;
   }
 
-  updateTask(task, update);
+  updateTask(task, update, &batch->recovered);
 
   validStatusUpdate
     ? metrics->valid_status_updates++ : metrics->invalid_status_updates++;
 }
 
 
+void Master::commitStatusUpdates(const StatusUpdateBatch& batch)
+{
+  foreachpair (const FrameworkID& frameworkId,
+               const auto& recovered,
+               batch.recovered) {
+    foreachpair (const SlaveID& slaveId,
+                 const Resources& resources,
+                 recovered) {
+      allocator->recoverResources(frameworkId, slaveId, resources, None());
+    }
+  }
+
+  foreachpair (const FrameworkID& frameworkId,
+               const vector<StatusUpdateMessage>& messages,
+               batch.forwarded) {
+    // The framework is still registered, since it is not
+    // removed while the updates are handled.
+    Framework* framework = CHECK_NOTNULL(getFramework(frameworkId));
+
+    framework->send(messages);
+  }
+}
+
+
 void Master::forward(
     const StatusUpdate& update,
     const UPID& acknowledgee,
-    Framework* framework)
+    Framework* framework,
+    vector<StatusUpdateMessage>* forwarded)
 {
   CHECK_NOTNULL(framework);
 
@@ -8404,7 +8498,12 @@ void Master::forward(
   StatusUpdateMessage message;
   message.mutable_update()->MergeFrom(update);
   message.set_pid(acknowledgee);
-  framework->send(message);
+
+  if (forwarded != nullptr) {
+    forwarded->push_back(std::move(message));
+  } else {
+    framework->send(message);
+  }
 }
 
 
@@ -9316,18 +9415,21 @@ void Master::offer(
       url.mutable_address()->set_port(slave->pid.address.port);
       url.set_path("/" + slave->pid.id);
 
-      Offer* offer = new Offer();
-      offer->mutable_id()->MergeFrom(newOfferId());
-      offer->mutable_framework_id()->MergeFrom(framework->id());
-      offer->mutable_slave_id()->MergeFrom(slave->id);
-      offer->set_hostname(slave->info.hostname());
-      offer->mutable_url()->MergeFrom(url);
-      offer->mutable_resources()->MergeFrom(offered);
-      offer->mutable_attributes()->MergeFrom(slave->info.attributes());
-      offer->mutable_allocation_info()->set_role(role);
+      // The offer sent to the framework is built first, and the offer
+      // tracked by the master is copied from it before any resources
+      // are added, so that the resources are copied only once into
+      // each of them.
+      Offer offer_;
+      *offer_.mutable_id() = newOfferId();
+      *offer_.mutable_framework_id() = framework->id();
+      *offer_.mutable_slave_id() = slave->id;
+      offer_.set_hostname(slave->info.hostname());
+      *offer_.mutable_url() = std::move(url);
+      *offer_.mutable_attributes() = slave->info.attributes();
+      offer_.mutable_allocation_info()->set_role(role);
 
       if (slave->info.has_domain()) {
-        offer->mutable_domain()->MergeFrom(slave->info.domain());
+        *offer_.mutable_domain() = slave->info.domain();
       }
 
       // Add all framework's executors running on this slave.
@@ -9335,7 +9437,7 @@ void Master::offer(
         const hashmap<ExecutorID, ExecutorInfo>& executors =
           slave->executors[framework->id()];
         foreachkey (const ExecutorID& executorId, executors) {
-          offer->add_executor_ids()->MergeFrom(executorId);
+          *offer_.add_executor_ids() = executorId;
         }
       }
 
@@ -9343,36 +9445,28 @@ void Master::offer(
       // maintenance in the future, then set the Unavailability.
       CHECK(machines.contains(slave->machineId));
       if (machines[slave->machineId].info.has_unavailability()) {
-        offer->mutable_unavailability()->CopyFrom(
-            machines[slave->machineId].info.unavailability());
+        *offer_.mutable_unavailability() =
+          machines[slave->machineId].info.unavailability();
       }
 
-      offers[offer->id()] = offer;
-
-      framework->addOffer(offer);
-      slave->addOffer(offer);
-
-      if (flags.offer_timeout.isSome()) {
-        // Rescind the offer after the timeout elapses.
-        offerTimers[offer->id()] =
-          delay(flags.offer_timeout.get(),
-                self(),
-                &Self::offerTimeout,
-                offer->id());
-      }
+      Offer* offer = new Offer(offer_);
 
       // TODO(jieyu): For now, we strip 'ephemeral_ports' resource from
       // offers so that frameworks do not see this resource. This is a
       // short term workaround. Revisit this once we resolve MESOS-1654.
-      Offer offer_ = *offer;
-      offer_.clear_resources();
-
       foreach (const Resource& resource, offered) {
+        *offer->add_resources() = resource;
+
         if (resource.name() != "ephemeral_ports") {
-          offer_.add_resources()->CopyFrom(resource);
+          *offer_.add_resources() = resource;
         }
       }
 
+      offers[offer->id()] = offer;
+
+      framework->addOffer(offer);
+      slave->addOffer(offer);
+
       // Per MESOS-8237, it is problematic to show the
       // `Resource.allocation_info` for pre-MULTI_ROLE schedulers.
       // Pre-MULTI_ROLE schedulers are not `AllocationInfo` aware,
@@ -9414,6 +9508,16 @@ void Master::offer(
 
   LOG(INFO) << "Sending offers " << offerIds << " to framework " << *framework;
 
+  if (flags.offer_timeout.isSome()) {
+    // Rescind the offers after the timeout elapses. A single timer is
+    // used for all the offers sent together, since they expire at the
+    // same time.
+    delay(flags.offer_timeout.get(),
+          self(),
+          &Self::offerTimeout,
+          offerIds);
+  }
+
   framework->metrics.offers_sent += message.offers().size();
   framework->send(message);
 }
@@ -9831,6 +9935,7 @@ void Master::addFramework(
             << stringify(suppressedRoles) << " suppressed";
 
   frameworks.registered[framework->id()] = framework;
+  stateChanges.changed(framework->id());
 
   if (framework->connected()) {
     if (framework->pid.isSome()) {
@@ -10214,36 +10319,36 @@ void Master::removeFramework(Framework* framework)
 
   // Mark the framework's unreachable tasks as completed.
   foreach (const TaskID& taskId, framework->unreachableTasks.keys()) {
-    const Owned<Task>& task = framework->unreachableTasks.at(taskId);
+    Task task = framework->unreachableTasks.at(taskId).get();
 
     // TODO(neilc): Per comment above, using TASK_KILLED here is not
     // ideal. It would be better to use TASK_UNREACHABLE here and only
     // transition it to a terminal state when the agent reregisters
     // and the task is shutdown (MESOS-6608).
     const StatusUpdate& update = protobuf::createStatusUpdate(
-        task->framework_id(),
-        task->slave_id(),
-        task->task_id(),
+        task.framework_id(),
+        task.slave_id(),
+        task.task_id(),
         TASK_KILLED,
         TaskStatus::SOURCE_MASTER,
         None(),
         "Framework " + framework->id().value() + " removed",
         TaskStatus::REASON_FRAMEWORK_REMOVED,
-        (task->has_executor_id()
-         ? Option<ExecutorID>(task->executor_id())
+        (task.has_executor_id()
+         ? Option<ExecutorID>(task.executor_id())
          : None()));
 
-    updateTask(task.get(), update);
+    updateTask(&task, update);
 
     // We don't need to remove the task from the slave, because the
     // task was removed when the agent was marked unreachable.
-    CHECK(!slaves.registered.contains(task->slave_id()))
-      << "Unreachable task " << task->task_id()
-      << " of framework " << task->framework_id()
-      << " was found on registered agent " << task->slave_id();
+    CHECK(!slaves.registered.contains(task.slave_id()))
+      << "Unreachable task " << task.task_id()
+      << " of framework " << task.framework_id()
+      << " was found on registered agent " << task.slave_id();
 
     // Move task from unreachable map to completed map.
-    framework->addCompletedTask(std::move(*task));
+    framework->addCompletedTask(std::move(task));
     framework->unreachableTasks.erase(taskId);
   }
 
@@ -10302,8 +10407,16 @@ void Master::removeFramework(Framework* framework)
   frameworks.registered.erase(framework->id());
   allocator->removeFramework(framework->id());
 
+  // Once the completed frameworks are at capacity, the oldest one is
+  // evicted, which clients of the '/state' endpoint need to learn about.
+  if (!frameworks.completed.empty() &&
+      frameworks.completed.size() >= flags.max_completed_frameworks) {
+    stateChanges.changed(frameworks.completed.keys().front());
+  }
+
   // The framework pointer is now owned by `frameworks.completed`.
   frameworks.completed.set(framework->id(), Owned<Framework>(framework));
+  stateChanges.changed(framework->id());
 
   if (!subscribers.subscribed.empty()) {
     subscribers.send(
@@ -10371,6 +10484,7 @@ void Master::addSlave(
   CHECK(slaves.removed.get(slave->id).isNone());
 
   slaves.registered.put(slave);
+  stateChanges.changed(slave->id);
 
   link(slave->pid);
 
@@ -10638,6 +10752,7 @@ void Master::_removeSlave(
 
   // Mark the slave as being removed.
   slaves.registered.remove(slave);
+  stateChanges.changed(slave->id);
   slaves.removed.put(slave->id, Nothing());
   authenticated.erase(slave->pid);
 
@@ -10760,6 +10875,7 @@ void Master::__removeSlave(
 
   // Mark the slave as being removed.
   slaves.registered.remove(slave);
+  stateChanges.changed(slave->id);
   slaves.removed.put(slave->id, Nothing());
   authenticated.erase(slave->pid);
 
@@ -10784,7 +10900,10 @@ void Master::__removeSlave(
 }
 
 
-void Master::updateTask(Task* task, const StatusUpdate& update)
+void Master::updateTask(
+    Task* task,
+    const StatusUpdate& update,
+    hashmap<FrameworkID, hashmap<SlaveID, Resources>>* recovered)
 {
   CHECK_NOTNULL(task);
 
@@ -10818,6 +10937,13 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
 
   Framework* framework = getFramework(task->framework_id());
 
+  // The cached representations of the task are stale after the update.
+  if (framework != nullptr &&
+      framework->taskFragments.contains(task->task_id())) {
+    framework->taskFragments.at(task->task_id()).invalidate(
+        stateChanges.changed(framework->id()));
+  }
+
   // If the task has already transitioned to a terminal state,
   // do not update its state. Note that we are being defensive
   // here because this should not happen unless there is a bug
@@ -10884,11 +11010,16 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
   // Once the task transitioned to terminal or unreachable,
   // recover the resources.
   if (transitionedToTerminalOrUnreachable) {
-    allocator->recoverResources(
-        task->framework_id(),
-        task->slave_id(),
-        task->resources(),
-        None());
+    if (recovered != nullptr) {
+      (*recovered)[task->framework_id()][task->slave_id()] +=
+        task->resources();
+    } else {
+      allocator->recoverResources(
+          task->framework_id(),
+          task->slave_id(),
+          task->resources(),
+          None());
+    }
 
     // The slave owns the Task object and cannot be nullptr.
     Slave* slave = slaves.registered.get(task->slave_id());
@@ -11359,13 +11490,17 @@ void Master::_apply(
 }
 
 
-void Master::offerTimeout(const OfferID& offerId)
+void Master::offerTimeout(const vector<OfferID>& offerIds)
 {
-  Offer* offer = getOffer(offerId);
-  if (offer != nullptr) {
-    allocator->recoverResources(
-        offer->framework_id(), offer->slave_id(), offer->resources(), None());
-    removeOffer(offer, true);
+  // Some of the offers may have already been accepted,
+  // declined or rescinded.
+  foreach (const OfferID& offerId, offerIds) {
+    Offer* offer = getOffer(offerId);
+    if (offer != nullptr) {
+      allocator->recoverResources(
+          offer->framework_id(), offer->slave_id(), offer->resources(), None());
+      removeOffer(offer, true);
+    }
   }
 }
 
@@ -11398,13 +11533,6 @@ void Master::removeOffer(Offer* offer, bool rescind)
     framework->send(message);
   }
 
-  // Remove and cancel offer removal timers. Canceling the Timers is
-  // only done to avoid having too many active Timers in libprocess.
-  if (offerTimers.contains(offer->id())) {
-    Clock::cancel(offerTimers[offer->id()]);
-    offerTimers.erase(offer->id());
-  }
-
   // Delete it.
   LOG(INFO) << "Removing offer " << offer->id();
   offers.erase(offer->id());
@@ -11531,6 +11659,30 @@ SlaveID Master::newSlaveId()
 }
 
 
+string Master::stateCursor() const
+{
+  return info().id() + ":" + stringify(stateChanges.version());
+}
+
+
+Option<uint64_t> Master::stateVersion(const string& cursor) const
+{
+  const vector<string> tokens = strings::split(cursor, ":");
+
+  if (tokens.size() != 2 || tokens[0] != info().id()) {
+    return None();
+  }
+
+  Try<uint64_t> version = numify<uint64_t>(tokens[1]);
+
+  if (version.isError() || !stateChanges.knows(version.get())) {
+    return None();
+  }
+
+  return version.get();
+}
+
+
 double Master::_const_slaves_connected() const
 {
   double count = 0.0;
@@ -11729,8 +11881,8 @@ double Master::_tasks_unreachable()
   double count = 0.0;
 
   foreachvalue (Framework* framework, frameworks.registered) {
-    foreachvalue (const Owned<Task>& task, framework->unreachableTasks) {
-      if (task->state() == TASK_UNREACHABLE) {
+    foreachvalue (const CompactTask& task, framework->unreachableTasks) {
+      if (task.state() == TASK_UNREACHABLE) {
         count++;
       }
     }
@@ -11882,27 +12034,185 @@ void Master::Subscribers::send(
         ? new FrameworkInfo(frameworkInfo.get()) : nullptr);
   Shared<Task> sharedTask(task.isSome() ? new Task(task.get()) : nullptr);
 
+  // Group the interested subscribers by principal, since the result
+  // of the authorization only depends on the principal.
+  vector<pair<Option<Principal>, vector<Owned<Subscriber>>>> groups;
+
   foreachvalue (const Owned<Subscriber>& subscriber, subscribed) {
+    if (!subscriber->accepts(*sharedEvent, sharedFrameworkInfo, sharedTask)) {
+      continue;
+    }
+
+    auto group = std::find_if(
+        groups.begin(),
+        groups.end(),
+        [&subscriber](
+            const pair<Option<Principal>, vector<Owned<Subscriber>>>& group) {
+          return group.first == subscriber->principal;
+        });
+
+    if (group == groups.end()) {
+      groups.emplace_back(
+          subscriber->principal, vector<Owned<Subscriber>>{subscriber});
+    } else {
+      group->second.push_back(subscriber);
+    }
+  }
+
+  foreach (auto& group, groups) {
+    const vector<Owned<Subscriber>> subscribers_ = std::move(group.second);
+
     ObjectApprovers::create(
         master->authorizer,
-        subscriber->principal,
+        group.first,
         {VIEW_ROLE, VIEW_FRAMEWORK, VIEW_TASK, VIEW_EXECUTOR})
       .then(defer(
           master->self(),
           [=](const Owned<ObjectApprovers>& approvers) {
-            subscriber->send(
+            Option<Shared<mesos::master::Event>> visible = authorize(
                 sharedEvent,
                 approvers,
                 sharedFrameworkInfo,
                 sharedTask);
 
+            if (visible.isNone()) {
+              return Nothing();
+            }
+
+            const v1::master::Event evolved = evolve(*visible.get());
+
+            // The records are encoded lazily, once per content type.
+            map<ContentType, string> records;
+
+            foreach (const Owned<Subscriber>& subscriber, subscribers_) {
+              const ContentType contentType = subscriber->http.contentType;
+
+              if (records.count(contentType) == 0) {
+                records[contentType] = subscriber->http.encode(evolved);
+              }
+
+              subscriber->http.write(records.at(contentType));
+            }
+
             return Nothing();
           }));
   }
 }
 
 
-void Master::Subscribers::Subscriber::send(
+bool Master::Subscribers::Subscriber::accepts(
+    const mesos::master::Event& event,
+    const Shared<FrameworkInfo>& frameworkInfo,
+    const Shared<Task>& task) const
+{
+  if (event.type() == mesos::master::Event::SUBSCRIBED ||
+      event.type() == mesos::master::Event::HEARTBEAT) {
+    return true;
+  }
+
+  if (!filters.event_types().empty() &&
+      std::find(
+          filters.event_types().begin(),
+          filters.event_types().end(),
+          event.type()) == filters.event_types().end()) {
+    return false;
+  }
+
+  auto acceptsFramework = [this](const FrameworkInfo& frameworkInfo) {
+    if (!filters.framework_ids().empty() &&
+        std::find(
+            filters.framework_ids().begin(),
+            filters.framework_ids().end(),
+            frameworkInfo.id()) == filters.framework_ids().end()) {
+      return false;
+    }
+
+    if (!filters.roles().empty()) {
+      const set<string> roles = protobuf::framework::getRoles(frameworkInfo);
+
+      return std::any_of(
+          filters.roles().begin(),
+          filters.roles().end(),
+          [&roles](const string& role) { return roles.count(role) > 0; });
+    }
+
+    return true;
+  };
+
+  auto acceptsAgent = [this](const SlaveID& slaveId) {
+    return filters.slave_ids().empty() ||
+      std::find(
+          filters.slave_ids().begin(),
+          filters.slave_ids().end(),
+          slaveId) != filters.slave_ids().end();
+  };
+
+  auto acceptsTask = [this, &acceptsAgent](const Task& task) {
+    if (!filters.framework_ids().empty() &&
+        std::find(
+            filters.framework_ids().begin(),
+            filters.framework_ids().end(),
+            task.framework_id()) == filters.framework_ids().end()) {
+      return false;
+    }
+
+    // Tasks are not allowed to mix resources allocated to
+    // different roles, see MESOS-6636.
+    if (!filters.roles().empty() &&
+        (task.resources().empty() ||
+         std::find(
+             filters.roles().begin(),
+             filters.roles().end(),
+             task.resources().begin()->allocation_info().role()) ==
+           filters.roles().end())) {
+      return false;
+    }
+
+    if (!acceptsAgent(task.slave_id())) {
+      return false;
+    }
+
+    foreach (const Label& label, filters.task_labels().labels()) {
+      if (std::find(
+              task.labels().labels().begin(),
+              task.labels().labels().end(),
+              label) == task.labels().labels().end()) {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  switch (event.type()) {
+    case mesos::master::Event::TASK_ADDED:
+      return acceptsTask(event.task_added().task());
+    case mesos::master::Event::TASK_UPDATED:
+      CHECK_NOTNULL(task.get());
+      return acceptsTask(*task);
+    case mesos::master::Event::FRAMEWORK_ADDED:
+      return acceptsFramework(
+          event.framework_added().framework().framework_info());
+    case mesos::master::Event::FRAMEWORK_UPDATED:
+      return acceptsFramework(
+          event.framework_updated().framework().framework_info());
+    case mesos::master::Event::FRAMEWORK_REMOVED:
+      return acceptsFramework(event.framework_removed().framework_info());
+    case mesos::master::Event::AGENT_ADDED:
+      return acceptsAgent(event.agent_added().agent().agent_info().id());
+    case mesos::master::Event::AGENT_REMOVED:
+      return acceptsAgent(event.agent_removed().agent_id());
+    case mesos::master::Event::SUBSCRIBED:
+    case mesos::master::Event::HEARTBEAT:
+    case mesos::master::Event::UNKNOWN:
+      return true;
+  }
+
+  UNREACHABLE();
+}
+
+
+Option<Shared<mesos::master::Event>> Master::Subscribers::authorize(
     const Shared<mesos::master::Event>& event,
     const Owned<ObjectApprovers>& approvers,
     const Shared<FrameworkInfo>& frameworkInfo,
@@ -11915,9 +12225,10 @@ void Master::Subscribers::Subscriber::send(
       if (approvers->approved<VIEW_TASK>(
               event->task_added().task(), *frameworkInfo) &&
           approvers->approved<VIEW_FRAMEWORK>(*frameworkInfo)) {
-        http.send<mesos::master::Event, v1::master::Event>(*event);
+        return event;
       }
-      break;
+
+      return None();
     }
     case mesos::master::Event::TASK_UPDATED: {
       CHECK_NOTNULL(frameworkInfo.get());
@@ -11925,9 +12236,10 @@ void Master::Subscribers::Subscriber::send(
 
       if (approvers->approved<VIEW_TASK>(*task, *frameworkInfo) &&
           approvers->approved<VIEW_FRAMEWORK>(*frameworkInfo)) {
-        http.send<mesos::master::Event, v1::master::Event>(*event);
+        return event;
       }
-      break;
+
+      return None();
     }
     case mesos::master::Event::FRAMEWORK_ADDED: {
       if (approvers->approved<VIEW_FRAMEWORK>(
@@ -11956,9 +12268,11 @@ void Master::Subscribers::Subscriber::send(
           }
         }
 
-        http.send<mesos::master::Event, v1::master::Event>(event_);
+        return Shared<mesos::master::Event>(
+            new mesos::master::Event(std::move(event_)));
       }
-      break;
+
+      return None();
     }
     case mesos::master::Event::FRAMEWORK_UPDATED: {
       if (approvers->approved<VIEW_FRAMEWORK>(
@@ -11987,16 +12301,19 @@ void Master::Subscribers::Subscriber::send(
           }
         }
 
-        http.send<mesos::master::Event, v1::master::Event>(event_);
+        return Shared<mesos::master::Event>(
+            new mesos::master::Event(std::move(event_)));
       }
-      break;
+
+      return None();
     }
     case mesos::master::Event::FRAMEWORK_REMOVED: {
       if (approvers->approved<VIEW_FRAMEWORK>(
               event->framework_removed().framework_info())) {
-        http.send<mesos::master::Event, v1::master::Event>(*event);
+        return event;
       }
-      break;
+
+      return None();
     }
     case mesos::master::Event::AGENT_ADDED: {
       mesos::master::Event event_(*event);
@@ -12012,16 +12329,17 @@ void Master::Subscribers::Subscriber::send(
         }
       }
 
-      http.send<mesos::master::Event, v1::master::Event>(event_);
-      break;
+      return Shared<mesos::master::Event>(
+          new mesos::master::Event(std::move(event_)));
     }
     case mesos::master::Event::AGENT_REMOVED:
     case mesos::master::Event::SUBSCRIBED:
     case mesos::master::Event::HEARTBEAT:
     case mesos::master::Event::UNKNOWN:
-      http.send<mesos::master::Event, v1::master::Event>(*event);
-      break;
+      return event;
   }
+
+  UNREACHABLE();
 }
 
 
@@ -12041,7 +12359,8 @@ void Master::exited(const id::UUID& id)
 
 void Master::subscribe(
     const HttpConnection& http,
-    const Option<Principal>& principal)
+    const Option<Principal>& principal,
+    const mesos::master::Call::Subscribe& filters)
 {
   LOG(INFO) << "Added subscriber " << http.streamId
             << " to the list of active subscribers";
@@ -12055,7 +12374,7 @@ void Master::subscribe(
   subscribers.subscribed.put(
       http.streamId,
       Owned<Subscribers::Subscriber>(
-          new Subscribers::Subscriber{http, principal}));
+          new Subscribers::Subscriber{http, principal, filters}));
 }
 
 
@@ -12158,6 +12477,8 @@ void Slave::addTask(Task* task)
   LOG(INFO) << "Adding task " << taskId
             << " with resources " << resources
             << " on agent " << *this;
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12178,6 +12499,8 @@ void Slave::recoverResources(Task* task)
   if (usedResources[frameworkId].empty()) {
     usedResources.erase(frameworkId);
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12212,6 +12535,8 @@ void Slave::removeTask(Task* task)
   }
 
   killedTasks.remove(frameworkId, taskId);
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12245,6 +12570,8 @@ void Slave::addOperation(Operation* operation)
 
     usedResources[operation->framework_id()] += consumed.get();
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12274,6 +12601,8 @@ void Slave::recoverResources(Operation* operation)
   if (usedResources[frameworkId].empty()) {
     usedResources.erase(frameworkId);
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12313,6 +12642,8 @@ void Slave::removeOperation(Operation* operation)
 
     resourceProvider.operations.erase(operation->uuid());
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12338,6 +12669,8 @@ void Slave::addOffer(Offer* offer)
 
   offers.insert(offer);
   offeredResources += offer->resources();
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12347,6 +12680,8 @@ void Slave::removeOffer(Offer* offer)
 
   offeredResources -= offer->resources();
   offers.erase(offer);
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12391,6 +12726,8 @@ void Slave::addExecutor(const FrameworkID& frameworkId,
 
   executors[frameworkId][executorInfo.executor_id()] = executorInfo;
   usedResources[frameworkId] += executorInfo.resources();
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12410,6 +12747,8 @@ void Slave::removeExecutor(const FrameworkID& frameworkId,
   if (executors[frameworkId].empty()) {
     executors.erase(frameworkId);
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12439,6 +12778,8 @@ void Slave::apply(const vector<ResourceConversion>& conversions)
     provider.totalResources -= conversion.consumed;
     provider.totalResources += conversion.converted;
   }
+
+  master->stateChanges.changed(id);
 }
 
 
@@ -12471,6 +12812,8 @@ Try<Nothing> Slave::update(
 
   resourceVersion = _resourceVersion;
 
+  master->stateChanges.changed(id);
+
   return Nothing();
 }
 
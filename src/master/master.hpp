@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <deque>
 #include <list>
 #include <memory>
 #include <set>
@@ -42,6 +44,10 @@
 
 #include <mesos/scheduler/scheduler.hpp>
 
+#include <mesos/v1/mesos.hpp>
+
+#include <mesos/v1/master/master.hpp>
+
 #include <process/future.hpp>
 #include <process/limiter.hpp>
 #include <process/http.hpp>
@@ -74,6 +80,7 @@
 #include "internal/devolve.hpp"
 #include "internal/evolve.hpp"
 
+#include "master/compact_task.hpp"
 #include "master/constants.hpp"
 #include "master/flags.hpp"
 #include "master/machine.hpp"
@@ -342,11 +349,26 @@ struct HttpConnection
   // versioned event e.g., `v1::scheduler::Event` or `v1::master::Event`.
   template <typename Message, typename Event = v1::scheduler::Event>
   bool send(const Message& message)
+  {
+    return writer.write(encode<Event>(evolve(message)));
+  }
+
+  // Encodes an already evolved event as a record for the content
+  // type of this connection.
+  template <typename Event>
+  std::string encode(const Event& event) const
   {
     ::recordio::Encoder<Event> encoder (lambda::bind(
         serialize, contentType, lambda::_1));
 
-    return writer.write(encoder.encode(evolve(message)));
+    return encoder.encode(event);
+  }
+
+  // Sends a record which has already been evolved and encoded
+  // for the content type of this connection.
+  bool write(const std::string& record)
+  {
+    return writer.write(record);
   }
 
   bool close()
@@ -430,6 +452,149 @@ private:
 };
 
 
+// Versions the frameworks and agents exposed by the '/state' endpoint,
+// so that polling clients can ask for the changes since a previous
+// response rather than for the whole state. Every change of a framework
+// or an agent (including the tasks of the framework) bumps the version.
+// Only the latest change of each framework and agent is tracked, and at
+// most `capacity` of them; a cursor older than the oldest dropped change
+// has to be answered with the whole state.
+//
+// The completed tasks which are evicted from the bounded buffers of their
+// frameworks are tracked as well (again at most `capacity` of them), so
+// that clients can drop them from the state they hold.
+class StateChanges
+{
+public:
+  explicit StateChanges(size_t _capacity)
+    : capacity(_capacity), version_(0), dropped(0) {}
+
+  // Records a change, returns the version of the state after the change.
+  uint64_t changed(const FrameworkID& frameworkId)
+  {
+    return changed(frameworkId, &frameworks_);
+  }
+
+  uint64_t changed(const SlaveID& slaveId)
+  {
+    return changed(slaveId, &slaves_);
+  }
+
+  // Records the eviction of a completed task of the framework, returns
+  // the version of the state after the change.
+  uint64_t evicted(const FrameworkID& frameworkId, const TaskID& taskId)
+  {
+    const uint64_t version = changed(frameworkId);
+
+    evictedTasks_.push_back({version, frameworkId, taskId});
+
+    if (evictedTasks_.size() > capacity) {
+      dropped = std::max(dropped, evictedTasks_.front().version);
+      evictedTasks_.pop_front();
+    }
+
+    return version;
+  }
+
+  uint64_t version() const { return version_; }
+
+  // Returns whether all changes after `version` are known.
+  bool knows(uint64_t version) const
+  {
+    return version >= dropped && version <= version_;
+  }
+
+  // Returns the frameworks and agents which changed after `version`.
+  std::vector<FrameworkID> frameworks(uint64_t version) const
+  {
+    return since(frameworks_, version);
+  }
+
+  std::vector<SlaveID> slaves(uint64_t version) const
+  {
+    return since(slaves_, version);
+  }
+
+  // Returns the completed tasks of each framework evicted after `version`.
+  hashmap<FrameworkID, std::vector<TaskID>> evictedTasks(
+      uint64_t version) const
+  {
+    hashmap<FrameworkID, std::vector<TaskID>> result;
+
+    auto iterator = evictedTasks_.end();
+    while (iterator != evictedTasks_.begin()) {
+      --iterator;
+
+      if (iterator->version <= version) {
+        break;
+      }
+
+      result[iterator->frameworkId].push_back(iterator->taskId);
+    }
+
+    return result;
+  }
+
+private:
+  template <typename Key>
+  uint64_t changed(const Key& key, LinkedHashMap<Key, uint64_t>* changes)
+  {
+    // Move the change to the back to keep the changes ordered by version.
+    changes->erase(key);
+    (*changes)[key] = ++version_;
+
+    if (changes->size() > capacity) {
+      const Key oldest = changes->begin()->first;
+      dropped = std::max(dropped, changes->begin()->second);
+      changes->erase(oldest);
+    }
+
+    return version_;
+  }
+
+  template <typename Key>
+  static std::vector<Key> since(
+      const LinkedHashMap<Key, uint64_t>& changes,
+      uint64_t version)
+  {
+    std::vector<Key> result;
+
+    auto iterator = changes.end();
+    while (iterator != changes.begin()) {
+      --iterator;
+
+      if (iterator->second <= version) {
+        break;
+      }
+
+      result.push_back(iterator->first);
+    }
+
+    return result;
+  }
+
+  const size_t capacity;
+
+  uint64_t version_;
+
+  // The latest version of a change which is no longer tracked.
+  uint64_t dropped;
+
+  LinkedHashMap<FrameworkID, uint64_t> frameworks_;
+  LinkedHashMap<SlaveID, uint64_t> slaves_;
+
+  struct EvictedTask
+  {
+    uint64_t version;
+    FrameworkID frameworkId;
+    TaskID taskId;
+  };
+
+  // Ordered by version.
+  std::deque<EvictedTask> evictedTasks_;
+};
+
+
 class Master : public ProtobufProcess<Master>
 {
 public:
@@ -512,6 +677,9 @@ public:
   void statusUpdate(
       StatusUpdateMessage&& statusUpdateMessage);
 
+  void statusUpdates(
+      StatusUpdatesMessage&& statusUpdatesMessage);
+
   void reconcileTasks(
       const process::UPID& from,
       ReconcileTasksMessage&& reconcileTasksMessage);
@@ -959,9 +1127,35 @@ protected:
   // Add task to the framework and slave.
   void addTask(const TaskInfo& task, Framework* framework, Slave* slave);
 
+  // The effects of the status updates from an agent which are applied
+  // at once, so that a batch of updates results in a single allocator
+  // dispatch and a single send per (framework, agent).
+  struct StatusUpdateBatch
+  {
+    // The resources of the tasks which became terminal or unreachable.
+    hashmap<FrameworkID, hashmap<SlaveID, Resources>> recovered;
+
+    // The status updates to forward to each framework.
+    hashmap<FrameworkID, std::vector<StatusUpdateMessage>> forwarded;
+  };
+
+  // Handles a status update from an agent, accumulating its effects
+  // into the batch.
+  void statusUpdate(
+      const StatusUpdate& update,
+      const process::UPID& pid,
+      StatusUpdateBatch* batch);
+
+  // Recovers the resources and forwards the updates of the batch.
+  void commitStatusUpdates(const StatusUpdateBatch& batch);
+
   // Transitions the task, and recovers resources if the task becomes
-  // terminal.
-  void updateTask(Task* task, const StatusUpdate& update);
+  // terminal. If `recovered` is set, the resources are accumulated
+  // into it instead of being recovered in the allocator.
+  void updateTask(
+      Task* task,
+      const StatusUpdate& update,
+      hashmap<FrameworkID, hashmap<SlaveID, Resources>>* recovered = nullptr);
 
   // Removes the task. `unreachable` indicates whether the task is removed due
   // to being unreachable. Note that we cannot rely on the task state because
@@ -1002,14 +1196,16 @@ protected:
       Slave* slave,
       const Offer::Operation& operation);
 
-  // Forwards the update to the framework.
+  // Forwards the update to the framework. If `forwarded` is set, the
+  // update is appended to it instead of being sent.
   void forward(
       const StatusUpdate& update,
       const process::UPID& acknowledgee,
-      Framework* framework);
+      Framework* framework,
+      std::vector<StatusUpdateMessage>* forwarded = nullptr);
 
-  // Remove an offer after specified timeout
-  void offerTimeout(const OfferID& offerId);
+  // Remove the offers sent together after the specified timeout.
+  void offerTimeout(const std::vector<OfferID>& offerIds);
 
   // Remove an offer and optionally rescind the offer as well.
   void removeOffer(Offer* offer, bool rescind = false);
@@ -1096,7 +1292,8 @@ private:
   // Subscribes a client to the 'api/vX' endpoint.
   void subscribe(
       const HttpConnection& http,
-      const Option<process::http::authentication::Principal>& principal);
+      const Option<process::http::authentication::Principal>& principal,
+      const mesos::master::Call::Subscribe& filters);
 
   void teardown(Framework* framework);
 
@@ -1789,8 +1986,12 @@ private:
         const Option<process::http::authentication::Principal>& principal,
         ContentType contentType) const;
 
+    // Returns the tasks. If `v1Tasks` is set, the tasks are added to
+    // it instead, using the cached v1 representations of the active
+    // and completed tasks (see `Fragment`).
     mesos::master::Response::GetTasks _getTasks(
-        const process::Owned<ObjectApprovers>& approvers) const;
+        const process::Owned<ObjectApprovers>& approvers,
+        v1::master::Response::GetTasks* v1Tasks = nullptr) const;
 
     process::Future<process::http::Response> createVolumes(
         const mesos::master::Call& call,
@@ -1843,8 +2044,13 @@ private:
         const Option<process::http::authentication::Principal>& principal,
         ContentType contentType) const;
 
+    // Returns the state, or only the changes since the state identified
+    // by the cursor `since`, if they are known. If `v1Tasks` is set,
+    // the tasks are added to it instead, see `_getTasks()`.
     mesos::master::Response::GetState _getState(
-        const process::Owned<ObjectApprovers>& approvers) const;
+        const process::Owned<ObjectApprovers>& approvers,
+        const Option<std::string>& since = None(),
+        v1::master::Response::GetTasks* v1Tasks = nullptr) const;
 
     process::Future<process::http::Response> subscribe(
         const mesos::master::Call& call,
@@ -1898,6 +2104,7 @@ private:
 
     process::Future<process::http::Response> deferBatchedRequest(
         ReadOnlyRequestHandler handler,
+        const Option<process::http::authentication::Principal>& principal,
         const process::http::Request& request,
         const process::Owned<ObjectApprovers>& approvers) const;
 
@@ -1906,6 +2113,7 @@ private:
     struct BatchedRequest
     {
       ReadOnlyRequestHandler handler;
+      Option<process::http::authentication::Principal> principal;
       process::http::Request request;
       process::Owned<ObjectApprovers> approvers;
       process::Promise<process::http::Response> promise;
@@ -2143,21 +2351,36 @@ private:
     Option<process::Owned<BoundedRateLimiter>> defaultLimiter;
   } frameworks;
 
+  StateChanges stateChanges;
+
+  // Returns the cursor which identifies the current version of the
+  // state. The cursor includes the ID of the master, since versions
+  // are not comparable across masters.
+  std::string stateCursor() const;
+
+  // Returns the version of the state identified by `cursor`, if the
+  // cursor was issued by this master and all changes since then are
+  // known (see `StateChanges`).
+  Option<uint64_t> stateVersion(const std::string& cursor) const;
+
+  // Interns the fields shared by the completed and unreachable tasks
+  // of all frameworks, see `CompactTask`.
+  CompactTask::Interners taskInterners;
+
   struct Subscribers
   {
     Subscribers(Master* _master) : master(_master) {};
 
     // Represents a client subscribed to the 'api/vX' endpoint.
-    //
-    // TODO(anand): Add support for filtering. Some subscribers
-    // might only be interested in a subset of events.
     struct Subscriber
     {
       Subscriber(
           const HttpConnection& _http,
-          const Option<process::http::authentication::Principal> _principal)
+          const Option<process::http::authentication::Principal> _principal,
+          const mesos::master::Call::Subscribe& _filters)
         : http(_http),
-          principal(_principal)
+          principal(_principal),
+          filters(_filters)
       {
         mesos::master::Event event;
         event.set_type(mesos::master::Event::HEARTBEAT);
@@ -2178,13 +2401,12 @@ private:
       Subscriber(const Subscriber&) = delete;
       Subscriber& operator=(const Subscriber&) = delete;
 
-      // TODO(greggomann): Refactor this function into multiple event-specific
-      // overloads. See MESOS-8475.
-      void send(
-          const process::Shared<mesos::master::Event>& event,
-          const process::Owned<ObjectApprovers>& approvers,
+      // Returns whether the event passes the filters of the subscriber.
+      // This is checked before authorizing and serializing the event.
+      bool accepts(
+          const mesos::master::Event& event,
           const process::Shared<FrameworkInfo>& frameworkInfo,
-          const process::Shared<Task>& task);
+          const process::Shared<Task>& task) const;
 
       ~Subscriber()
       {
@@ -2202,14 +2424,31 @@ private:
       process::Owned<Heartbeater<mesos::master::Event, v1::master::Event>>
         heartbeater;
       const Option<process::http::authentication::Principal> principal;
+      const mesos::master::Call::Subscribe filters;
     };
 
     // Sends the event to all subscribers connected to the 'api/vX' endpoint.
+    //
+    // Subscribers with the same principal see the same parts of the event,
+    // so the event is authorized once per principal and then evolved and
+    // encoded once per content type; the encoded record is shared by all
+    // the subscribers of the principal.
     void send(
         mesos::master::Event&& event,
         const Option<FrameworkInfo>& frameworkInfo = None(),
         const Option<Task>& task = None());
 
+    // Returns the part of the event which is visible to the given
+    // approvers, or `None()` if the event must not be sent at all.
+    //
+    // TODO(greggomann): Refactor this function into multiple event-specific
+    // overloads. See MESOS-8475.
+    static Option<process::Shared<mesos::master::Event>> authorize(
+        const process::Shared<mesos::master::Event>& event,
+        const process::Owned<ObjectApprovers>& approvers,
+        const process::Shared<FrameworkInfo>& frameworkInfo,
+        const process::Shared<Task>& task);
+
     Master* master;
 
     // Active subscribers to the 'api/vX' endpoint keyed by the stream
@@ -2220,7 +2459,6 @@ private:
   Subscribers subscribers;
 
   hashmap<OfferID, Offer*> offers;
-  hashmap<OfferID, process::Timer> offerTimers;
 
   hashmap<OfferID, InverseOffer*> inverseOffers;
   hashmap<OfferID, process::Timer> inverseOfferTimers;
@@ -2350,6 +2588,76 @@ inline std::ostream& operator<<(
     const Framework& framework);
 
 
+// Caches the JSON and the v1 protobuf representations of a task for
+// the read-only endpoints and the operator API, so that tasks which
+// did not change since a previous request are not serialized again.
+// The caches are filled lazily by the (possibly concurrently running)
+// request handlers, which is why they are accessed atomically. The
+// master actor has to invalidate the caches whenever it changes the
+// task, passing the version of the master state after the change (see
+// `StateChanges`).
+class Fragment
+{
+public:
+  explicit Fragment(uint64_t _version = 0) : version_(_version) {}
+
+  template <typename T>
+  std::shared_ptr<const std::string> json(const T& task) const
+  {
+    std::shared_ptr<const std::string> result = std::atomic_load(&json_);
+
+    if (result == nullptr) {
+      result = std::make_shared<const std::string>(jsonify(task));
+      std::atomic_store(&json_, result);
+    }
+
+    return result;
+  }
+
+  std::shared_ptr<const v1::Task> v1(const Task& task) const
+  {
+    return cache([&task]() { return evolve(task); });
+  }
+
+  std::shared_ptr<const v1::Task> v1(const CompactTask& task) const
+  {
+    return cache([&task]() { return evolve(task.get()); });
+  }
+
+  void invalidate(uint64_t version)
+  {
+    std::atomic_store(&json_, std::shared_ptr<const std::string>());
+    std::atomic_store(&v1_, std::shared_ptr<const v1::Task>());
+    version_ = version;
+  }
+
+  // Records a change of the object which does not affect its JSON
+  // representation, e.g., when a task moves into the completed tasks.
+  void touch(uint64_t version) { version_ = version; }
+
+  // The version of the master state in which the object last changed.
+  uint64_t version() const { return version_; }
+
+private:
+  template <typename F>
+  std::shared_ptr<const v1::Task> cache(F&& create) const
+  {
+    std::shared_ptr<const v1::Task> result = std::atomic_load(&v1_);
+
+    if (result == nullptr) {
+      result = std::make_shared<const v1::Task>(create());
+      std::atomic_store(&v1_, result);
+    }
+
+    return result;
+  }
+
+  mutable std::shared_ptr<const std::string> json_;
+  mutable std::shared_ptr<const v1::Task> v1_;
+  uint64_t version_;
+};
+
+
 // TODO(bmahler): Keeping the task and executor information in sync
 // across the Slave and Framework structs is error prone!
 struct Framework
@@ -2408,7 +2716,12 @@ struct Framework
   template <typename Message>
   void send(const Message& message);
 
-  void addCompletedTask(Task&& task);
+  // Sends several messages to the connected framework. The messages
+  // are written to the connection of an HTTP framework at once.
+  template <typename Message>
+  void send(const std::vector<Message>& messages);
+
+  void addCompletedTask(Task&& task, Fragment&& fragment = Fragment());
 
   void addUnreachableTask(const Task& task);
 
@@ -2505,14 +2818,21 @@ struct Framework
   // state and have had all their updates acknowledged. We only keep a
   // fixed-size cache to avoid consuming too much memory. We use
   // circular_buffer rather than BoundedHashMap because there
-  // can be multiple completed tasks with the same task ID.
-  circular_buffer<process::Owned<Task>> completedTasks;
+  // can be multiple completed tasks with the same task ID. The tasks
+  // are kept in their compact form to reduce the memory footprint.
+  circular_buffer<CompactTask> completedTasks;
+
+  // Cached JSON representations of the tasks in `tasks` and
+  // `completedTasks`. The latter is kept aligned with `completedTasks`,
+  // i.e., `completedTaskFragments[i]` caches `completedTasks[i]`.
+  hashmap<TaskID, Fragment> taskFragments;
+  circular_buffer<Fragment> completedTaskFragments;
 
   // When an agent is marked unreachable, tasks running on it are stored
   // here. We only keep a fixed-size cache to avoid consuming too much memory.
   // NOTE: Non-partition-aware unreachable tasks in this map are marked
   // TASK_LOST instead of TASK_UNREACHABLE for backward compatibility.
-  BoundedHashMap<TaskID, process::Owned<Task>> unreachableTasks;
+  BoundedHashMap<TaskID, CompactTask> unreachableTasks;
 
   hashset<Offer*> offers; // Active offers for framework.
 
@@ -2592,12 +2912,15 @@ void Framework::send(const Message& message)
                  << " framework " << *this;
   }
 
-  // TODO(gilbert): add a helper to transform `SchedulerDriver` API messages
-  // directly to v0 events.
-  metrics.incrementEvent(devolve(evolve(message)));
+  // The message is evolved once, both to count the event and to
+  // encode it for HTTP frameworks; this matters for large messages
+  // such as offers.
+  const v1::scheduler::Event event = evolve(message);
+
+  metrics.incrementEvent(event.type());
 
   if (http.isSome()) {
-    if (!http->send(message)) {
+    if (!http->write(http->encode(event))) {
       LOG(WARNING) << "Unable to send event to framework " << *this << ":"
                    << " connection closed";
     }
@@ -2608,6 +2931,41 @@ void Framework::send(const Message& message)
 }
 
 
+template <typename Message>
+void Framework::send(const std::vector<Message>& messages)
+{
+  if (!connected()) {
+    LOG(WARNING) << "Master attempted to send messages to disconnected"
+                 << " framework " << *this;
+  }
+
+  if (http.isSome()) {
+    std::string records;
+
+    foreach (const Message& message, messages) {
+      const v1::scheduler::Event event = evolve(message);
+
+      metrics.incrementEvent(event.type());
+
+      records += http->encode(event);
+    }
+
+    if (!http->write(records)) {
+      LOG(WARNING) << "Unable to send events to framework " << *this << ":"
+                   << " connection closed";
+    }
+  } else {
+    CHECK_SOME(pid);
+
+    foreach (const Message& message, messages) {
+      metrics.incrementEvent(evolve(message).type());
+
+      master->send(pid.get(), message);
+    }
+  }
+}
+
+
 // TODO(bevers): Check if there is anything preventing us from
 // returning a const reference here.
 inline const FrameworkID Framework::id() const
@@ -761,6 +761,20 @@ void FrameworkMetrics::incrementEvent(const scheduler::Event& event)
   events++;
 }
 
+
+void FrameworkMetrics::incrementEvent(
+    const v1::scheduler::Event::Type& eventType)
+{
+  // The v0 and v1 scheduler event types share their values.
+  const scheduler::Event::Type type =
+    static_cast<scheduler::Event::Type>(eventType);
+
+  CHECK(event_types.contains(type));
+
+  event_types.get(type).get()++;
+  events++;
+}
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
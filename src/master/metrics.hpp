@@ -22,6 +22,8 @@
 
 #include <mesos/scheduler/scheduler.hpp>
 
+#include <mesos/v1/scheduler/scheduler.hpp>
+
 #include <process/metrics/counter.hpp>
 #include <process/metrics/pull_gauge.hpp>
 #include <process/metrics/push_gauge.hpp>
@@ -227,6 +229,7 @@ struct FrameworkMetrics
   void incrementCall(const mesos::scheduler::Call::Type& callType);
 
   void incrementEvent(const mesos::scheduler::Event& event);
+  void incrementEvent(const v1::scheduler::Event::Type& eventType);
 
   void incrementTaskState(const TaskState& state);
   void decrementActiveTaskState(const TaskState& state);
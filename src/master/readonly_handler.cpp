@@ -30,8 +30,10 @@
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/jsonify.hpp>
+#include <stout/numify.hpp>
 #include <stout/option.hpp>
 #include <stout/representation.hpp>
+#include <stout/stringify.hpp>
 
 #include "common/build.hpp"
 #include "common/http.hpp"
@@ -73,16 +75,23 @@ struct Full : Representation<T>
 
 // Filtered representation of Full<Framework>.
 // Executors and Tasks are filtered based on whether the
-// user is authorized to view them.
+// user is authorized to view them. If `since` is set, the
+// active and completed tasks are further filtered to those
+// which changed after that version of the master state, and
+// the completed tasks evicted since then are listed by ID.
 struct FullFrameworkWriter {
   FullFrameworkWriter(
       const process::Owned<ObjectApprovers>& approvers,
-      const Framework* framework);
+      const Framework* framework,
+      const Option<uint64_t>& since = None(),
+      const vector<TaskID>& evictedTasks = vector<TaskID>());
 
   void operator()(JSON::ObjectWriter* writer) const;
 
   const process::Owned<ObjectApprovers>& approvers_;
   const Framework* framework_;
+  const Option<uint64_t> since_;
+  const vector<TaskID> evictedTasks_;
 };
 
 
@@ -121,9 +130,13 @@ void json(JSON::ObjectWriter* writer, const Summary<Framework>& summary);
 
 FullFrameworkWriter::FullFrameworkWriter(
     const Owned<ObjectApprovers>& approvers,
-    const Framework* framework)
+    const Framework* framework,
+    const Option<uint64_t>& since,
+    const vector<TaskID>& evictedTasks)
   : approvers_(approvers),
-    framework_(framework)
+    framework_(framework),
+    since_(since),
+    evictedTasks_(evictedTasks)
 {}
 
 
@@ -214,32 +227,65 @@ void FullFrameworkWriter::operator()(JSON::ObjectWriter* writer) const
         continue;
       }
 
-      writer->element(*task);
+      const Fragment& fragment =
+        framework_->taskFragments.at(task->task_id());
+
+      // Skip unchanged tasks.
+      if (since_.isSome() && fragment.version() <= since_.get()) {
+        continue;
+      }
+
+      writer->element(JSON::Raw(*fragment.json(*task)));
     }
   });
 
   writer->field("unreachable_tasks", [this](JSON::ArrayWriter* writer) {
-    foreachvalue (const Owned<Task>& task, framework_->unreachableTasks) {
+    foreachvalue (const CompactTask& task, framework_->unreachableTasks) {
       // Skip unauthorized tasks.
-      if (!approvers_->approved<VIEW_TASK>(*task, framework_->info)) {
+      if (!approved(approvers_, task, framework_->info)) {
         continue;
       }
 
-      writer->element(*task);
+      writer->element(task);
     }
   });
 
   writer->field("completed_tasks", [this](JSON::ArrayWriter* writer) {
-    foreach (const Owned<Task>& task, framework_->completedTasks) {
+    CHECK_EQ(
+        framework_->completedTasks.size(),
+        framework_->completedTaskFragments.size());
+
+    for (size_t i = 0; i < framework_->completedTasks.size(); ++i) {
+      const CompactTask& task = framework_->completedTasks[i];
+      const Fragment& fragment = framework_->completedTaskFragments[i];
+
+      // Skip unchanged tasks.
+      if (since_.isSome() && fragment.version() <= since_.get()) {
+        continue;
+      }
+
       // Skip unauthorized tasks.
-      if (!approvers_->approved<VIEW_TASK>(*task, framework_->info)) {
+      if (!approved(approvers_, task, framework_->info)) {
         continue;
       }
 
-      writer->element(*task);
+      // The task is only materialized if its fragment is not cached.
+      writer->element(JSON::Raw(*fragment.json(task)));
     }
   });
 
+  // Clients drop the evicted completed tasks before they merge the
+  // changed ones, since task IDs might be reused (MESOS-6779).
+  if (since_.isSome()) {
+    writer->field(
+        "evicted_completed_tasks",
+        [this](JSON::ArrayWriter* writer) {
+          foreach (const TaskID& taskId, evictedTasks_) {
+            writer->element(taskId.value());
+          }
+        });
+  }
+
   // Model all of the offers associated with a framework.
   writer->field("offers", [this](JSON::ArrayWriter* writer) {
     foreach (Offer* offer, framework_->offers) {
@@ -477,14 +523,14 @@ public:
         slavesToFrameworks[task->slave_id()].insert(frameworkId);
       }
 
-      foreachvalue (const Owned<Task>& task, framework->unreachableTasks) {
-        frameworksToSlaves[frameworkId].insert(task->slave_id());
-        slavesToFrameworks[task->slave_id()].insert(frameworkId);
+      foreachvalue (const CompactTask& task, framework->unreachableTasks) {
+        frameworksToSlaves[frameworkId].insert(task.slave_id());
+        slavesToFrameworks[task.slave_id()].insert(frameworkId);
       }
 
-      foreach (const Owned<Task>& task, framework->completedTasks) {
-        frameworksToSlaves[frameworkId].insert(task->slave_id());
-        slavesToFrameworks[task->slave_id()].insert(frameworkId);
+      foreach (const CompactTask& task, framework->completedTasks) {
+        frameworksToSlaves[frameworkId].insert(task.slave_id());
+        slavesToFrameworks[task.slave_id()].insert(frameworkId);
       }
     }
   }
@@ -536,7 +582,12 @@ struct TaskStateSummary
   // Account for the state of the given task.
   void count(const Task& task)
   {
-    switch (task.state()) {
+    count(task.state());
+  }
+
+  void count(TaskState state)
+  {
+    switch (state) {
       case TASK_STAGING: { ++staging; break; }
       case TASK_STARTING: { ++starting; break; }
       case TASK_RUNNING: { ++running; break; }
@@ -598,14 +649,14 @@ public:
         slaveTaskSummaries[task->slave_id()].count(*task);
       }
 
-      foreachvalue (const Owned<Task>& task, framework->unreachableTasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+      foreachvalue (const CompactTask& task, framework->unreachableTasks) {
+        frameworkTaskSummaries[frameworkId].count(task.state());
+        slaveTaskSummaries[task.slave_id()].count(task.state());
       }
 
-      foreach (const Owned<Task>& task, framework->completedTasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+      foreach (const CompactTask& task, framework->completedTasks) {
+        frameworkTaskSummaries[frameworkId].count(task.state());
+        slaveTaskSummaries[task.slave_id()].count(task.state());
       }
     }
   }
@@ -705,7 +756,24 @@ process::http::Response Master::ReadOnlyHandler::state(
     const process::Owned<ObjectApprovers>& approvers) const
 {
   const Master* master = this->master;
-  auto calculateState = [master, &approvers](JSON::ObjectWriter* writer) {
+
+  // Every response carries a cursor, which clients can pass back as the
+  // `since` query parameter to only get the frameworks and agents which
+  // changed since that response. The cursor includes the ID of the
+  // master, since versions are not comparable across masters. If the
+  // changes since the cursor are not known (anymore), the whole state
+  // is returned, which clients can tell by the absence of `since`.
+  const string cursor = master->stateCursor();
+
+  Option<uint64_t> since;
+
+  Option<string> sinceQuery = request.url.query.get("since");
+  if (sinceQuery.isSome()) {
+    since = master->stateVersion(sinceQuery.get());
+  }
+
+  auto calculateState = [master, &approvers, &cursor, &since, &sinceQuery](
+      JSON::ObjectWriter* writer) {
     writer->field("version", MESOS_VERSION);
 
     if (build::GIT_SHA.isSome()) {
@@ -730,6 +798,12 @@ process::http::Response Master::ReadOnlyHandler::state(
     }
 
     writer->field("id", master->info().id());
+    writer->field("cursor", cursor);
+
+    if (since.isSome()) {
+      writer->field("since", sinceQuery.get());
+    }
+
     writer->field("pid", string(master->self()));
     writer->field("hostname", master->info().hostname());
     writer->field("capabilities", master->info().capabilities());
@@ -776,14 +850,41 @@ process::http::Response Master::ReadOnlyHandler::state(
         });
     }
 
-    // Model all of the registered slaves.
-    writer->field(
-        "slaves",
-        [master, &approvers](JSON::ArrayWriter* writer) {
-          foreachvalue (Slave* slave, master->slaves.registered) {
-            writer->element(SlaveWriter(*slave, approvers));
-          }
-        });
+    // Model all of the registered slaves, or only the changed ones
+    // along with the ones which are no longer registered.
+    if (since.isNone()) {
+      writer->field(
+          "slaves",
+          [master, &approvers](JSON::ArrayWriter* writer) {
+            foreachvalue (Slave* slave, master->slaves.registered) {
+              writer->element(SlaveWriter(*slave, approvers));
+            }
+          });
+    } else {
+      const vector<SlaveID> slaveIds =
+        master->stateChanges.slaves(since.get());
+
+      writer->field(
+          "slaves",
+          [master, &approvers, &slaveIds](JSON::ArrayWriter* writer) {
+            foreach (const SlaveID& slaveId, slaveIds) {
+              Slave* slave = master->slaves.registered.get(slaveId);
+              if (slave != nullptr) {
+                writer->element(SlaveWriter(*slave, approvers));
+              }
+            }
+          });
+
+      writer->field(
+          "removed_slaves",
+          [master, &slaveIds](JSON::ArrayWriter* writer) {
+            foreach (const SlaveID& slaveId, slaveIds) {
+              if (master->slaves.registered.get(slaveId) == nullptr) {
+                writer->element(slaveId.value());
+              }
+            }
+          });
+    }
 
     // Model all of the recovered slaves.
     writer->field(
@@ -798,36 +899,105 @@ process::http::Response Master::ReadOnlyHandler::state(
         });
 
     // Model all of the frameworks.
-    writer->field(
-        "frameworks",
-        [master, &approvers](JSON::ArrayWriter* writer) {
-          foreachvalue (
-              Framework* framework, master->frameworks.registered) {
-            // Skip unauthorized frameworks.
-            if (!approvers->approved<VIEW_FRAMEWORK>(framework->info)) {
-              continue;
+    if (since.isNone()) {
+      writer->field(
+          "frameworks",
+          [master, &approvers](JSON::ArrayWriter* writer) {
+            foreachvalue (
+                Framework* framework, master->frameworks.registered) {
+              // Skip unauthorized frameworks.
+              if (!approvers->approved<VIEW_FRAMEWORK>(framework->info)) {
+                continue;
+              }
+
+              writer->element(FullFrameworkWriter(approvers, framework));
             }
+          });
 
-            writer->element(FullFrameworkWriter(approvers, framework));
-          }
-        });
+      // Model all of the completed frameworks.
+      writer->field(
+          "completed_frameworks",
+          [master, &approvers](JSON::ArrayWriter* writer) {
+            foreachvalue (
+                const Owned<Framework>& framework,
+                master->frameworks.completed) {
+              // Skip unauthorized frameworks.
+              if (!approvers->approved<VIEW_FRAMEWORK>(framework->info)) {
+                continue;
+              }
 
-    // Model all of the completed frameworks.
-    writer->field(
-        "completed_frameworks",
-        [master, &approvers](JSON::ArrayWriter* writer) {
-          foreachvalue (
-              const Owned<Framework>& framework,
-              master->frameworks.completed) {
-            // Skip unauthorized frameworks.
-            if (!approvers->approved<VIEW_FRAMEWORK>(framework->info)) {
-              continue;
+              writer->element(
+                  FullFrameworkWriter(approvers, framework.get()));
             }
+          });
+    } else {
+      // Model the changed frameworks, along with their changed tasks
+      // and the completed tasks which have been evicted. Frameworks
+      // which are neither registered nor completed have been evicted
+      // from the completed frameworks, and are listed as removed.
+      const vector<FrameworkID> frameworkIds =
+        master->stateChanges.frameworks(since.get());
 
-            writer->element(
-                FullFrameworkWriter(approvers, framework.get()));
-          }
-        });
+      const hashmap<FrameworkID, vector<TaskID>> evictedTasks =
+        master->stateChanges.evictedTasks(since.get());
+
+      writer->field(
+          "frameworks",
+          [master, &approvers, &since, &frameworkIds, &evictedTasks](
+              JSON::ArrayWriter* writer) {
+            foreach (const FrameworkID& frameworkId, frameworkIds) {
+              const Option<Framework*> framework =
+                master->frameworks.registered.get(frameworkId);
+
+              // Skip unknown and unauthorized frameworks.
+              if (framework.isNone() ||
+                  !approvers->approved<VIEW_FRAMEWORK>(
+                      framework.get()->info)) {
+                continue;
+              }
+
+              writer->element(FullFrameworkWriter(
+                  approvers,
+                  framework.get(),
+                  since,
+                  evictedTasks.get(frameworkId).getOrElse(vector<TaskID>())));
+            }
+          });
+
+      writer->field(
+          "completed_frameworks",
+          [master, &approvers, &since, &frameworkIds, &evictedTasks](
+              JSON::ArrayWriter* writer) {
+            foreach (const FrameworkID& frameworkId, frameworkIds) {
+              const Option<Owned<Framework>> framework =
+                master->frameworks.completed.get(frameworkId);
+
+              // Skip unknown and unauthorized frameworks.
+              if (framework.isNone() ||
+                  !approvers->approved<VIEW_FRAMEWORK>(
+                      framework.get()->info)) {
+                continue;
+              }
+
+              writer->element(FullFrameworkWriter(
+                  approvers,
+                  framework->get(),
+                  since,
+                  evictedTasks.get(frameworkId).getOrElse(vector<TaskID>())));
+            }
+          });
+
+      writer->field(
+          "removed_frameworks",
+          [master, &frameworkIds](JSON::ArrayWriter* writer) {
+            foreach (const FrameworkID& frameworkId, frameworkIds) {
+              if (!master->frameworks.registered.contains(frameworkId) &&
+                  !master->frameworks.completed.contains(frameworkId)) {
+                writer->element(frameworkId.value());
+              }
+            }
+          });
+    }
 
     // Orphan tasks are no longer possible. We emit an empty array
     // for the sake of backward compatibility.
@@ -989,46 +1159,41 @@ process::http::Response Master::ReadOnlyHandler::stateSummary(
 }
 
 
+// Compares tasks by the timestamps of their first statuses.
 struct TaskComparator
 {
-  static bool ascending(const Task* lhs, const Task* rhs)
+  static bool ascending(const Option<double>& lhs, const Option<double>& rhs)
   {
-    size_t lhsSize = lhs->statuses().size();
-    size_t rhsSize = rhs->statuses().size();
-
-    if ((lhsSize == 0) && (rhsSize == 0)) {
+    if (lhs.isNone() && rhs.isNone()) {
       return false;
     }
 
-    if (lhsSize == 0) {
+    if (lhs.isNone()) {
       return true;
     }
 
-    if (rhsSize == 0) {
+    if (rhs.isNone()) {
       return false;
     }
 
-    return (lhs->statuses(0).timestamp() < rhs->statuses(0).timestamp());
+    return (lhs.get() < rhs.get());
   }
 
-  static bool descending(const Task* lhs, const Task* rhs)
+  static bool descending(const Option<double>& lhs, const Option<double>& rhs)
   {
-    size_t lhsSize = lhs->statuses().size();
-    size_t rhsSize = rhs->statuses().size();
-
-    if ((lhsSize == 0) && (rhsSize == 0)) {
+    if (lhs.isNone() && rhs.isNone()) {
       return false;
     }
 
-    if (rhsSize == 0) {
+    if (rhs.isNone()) {
       return true;
     }
 
-    if (lhsSize == 0) {
+    if (lhs.isNone()) {
       return false;
     }
 
-    return (lhs->statuses(0).timestamp() > rhs->statuses(0).timestamp());
+    return (lhs.get() > rhs.get());
   }
 };
 
@@ -1080,7 +1245,21 @@ process::http::Response Master::ReadOnlyHandler::tasks(
 
   // Construct task list with both running,
   // completed and unreachable tasks.
-  vector<const Task*> tasks;
+  //
+  // The completed and unreachable tasks are kept in their compact form
+  // while sorting, and only the returned tasks are materialized.
+  struct Entry
+  {
+    // The timestamp of the first status of the task, if any.
+    Option<double> timestamp;
+
+    // Exactly one of these is set.
+    const Task* task;
+    const CompactTask* compact;
+  };
+
+  vector<Entry> tasks;
+
   foreach (const Framework* framework, frameworks) {
     foreachvalue (Task* task, framework->tasks) {
       CHECK_NOTNULL(task);
@@ -1090,29 +1269,30 @@ process::http::Response Master::ReadOnlyHandler::tasks(
         continue;
       }
 
-      tasks.push_back(task);
-    }
-
-    foreachvalue (
-        const Owned<Task>& task,
-        framework->unreachableTasks) {
-      // Skip unauthorized tasks or tasks without matching task ID.
-      if (!selectTaskId.accept(task->task_id()) ||
-          !approvers->approved<VIEW_TASK>(*task, framework->info)) {
-        continue;
+      Option<double> timestamp;
+      if (task->statuses_size() > 0) {
+        timestamp = task->statuses(0).timestamp();
       }
 
-      tasks.push_back(task.get());
+      tasks.push_back({timestamp, task, nullptr});
     }
 
-    foreach (const Owned<Task>& task, framework->completedTasks) {
+    auto add = [&](const CompactTask& task) {
       // Skip unauthorized tasks or tasks without matching task ID.
-      if (!selectTaskId.accept(task->task_id()) ||
-          !approvers->approved<VIEW_TASK>(*task, framework->info)) {
-        continue;
+      if (!selectTaskId.accept(task.task_id()) ||
+          !approved(approvers, task, framework->info)) {
+        return;
       }
 
-      tasks.push_back(task.get());
+      tasks.push_back({task.timestamp(), nullptr, &task});
+    };
+
+    foreachvalue (const CompactTask& task, framework->unreachableTasks) {
+      add(task);
+    }
+
+    foreach (const CompactTask& task, framework->completedTasks) {
+      add(task);
     }
   }
 
@@ -1120,9 +1300,13 @@ process::http::Response Master::ReadOnlyHandler::tasks(
   // The earliest timestamp is chosen for comparison when
   // multiple are present.
   if (_order == "asc") {
-    sort(tasks.begin(), tasks.end(), TaskComparator::ascending);
+    sort(tasks.begin(), tasks.end(), [](const Entry& lhs, const Entry& rhs) {
+      return TaskComparator::ascending(lhs.timestamp, rhs.timestamp);
+    });
   } else {
-    sort(tasks.begin(), tasks.end(), TaskComparator::descending);
+    sort(tasks.begin(), tasks.end(), [](const Entry& lhs, const Entry& rhs) {
+      return TaskComparator::descending(lhs.timestamp, rhs.timestamp);
+    });
   }
 
   auto tasksWriter =
@@ -1133,7 +1317,11 @@ process::http::Response Master::ReadOnlyHandler::tasks(
             // Collect 'limit' number of tasks starting from 'offset'.
             size_t end = std::min(offset + limit, tasks.size());
             for (size_t i = offset; i < end; i++) {
-              writer->element(*tasks[i]);
+              if (tasks[i].task != nullptr) {
+                writer->element(*tasks[i].task);
+              } else {
+                writer->element(*tasks[i].compact);
+              }
             }
           });
   };
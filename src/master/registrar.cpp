@@ -16,12 +16,15 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include <mesos/type_utils.hpp>
 
 #include <mesos/state/state.hpp>
 
+#include <process/clock.hpp>
 #include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/help.hpp>
@@ -29,8 +32,10 @@
 #include <process/id.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/timer.hpp>
 
 #include <process/metrics/pull_gauge.hpp>
+#include <process/metrics/push_gauge.hpp>
 #include <process/metrics/metrics.hpp>
 #include <process/metrics/timer.hpp>
 
@@ -43,16 +48,19 @@
 
 #include "master/registrar.hpp"
 #include "master/registry.hpp"
+#include "master/registry_operations.hpp"
 
 using mesos::state::State;
 using mesos::state::Variable;
 
+using process::delay;
 using process::dispatch;
 using process::spawn;
 using process::terminate;
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using process::AUTHENTICATION;
+using process::Clock;
 using process::DESCRIPTION;
 using process::Failure;
 using process::Future;
@@ -68,10 +76,12 @@ using process::http::OK;
 using process::http::authentication::Principal;
 
 using process::metrics::PullGauge;
+using process::metrics::PushGauge;
 using process::metrics::Timer;
 
 using std::deque;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -147,36 +157,55 @@ private:
         registry_size_bytes(
             "registrar/registry_size_bytes",
             defer(process, &RegistrarProcess::_registry_size_bytes)),
+        batch_size("registrar/batch_size"),
         state_fetch("registrar/state_fetch"),
-        state_store("registrar/state_store", Days(1))
+        state_store("registrar/state_store", Days(1)),
+        commit_latency("registrar/commit_latency", Days(1))
     {
       process::metrics::add(queued_operations);
       process::metrics::add(registry_size_bytes);
+      process::metrics::add(batch_size);
 
       process::metrics::add(state_fetch);
       process::metrics::add(state_store);
+      process::metrics::add(commit_latency);
     }
 
     ~Metrics()
     {
       process::metrics::remove(queued_operations);
       process::metrics::remove(registry_size_bytes);
+      process::metrics::remove(batch_size);
 
       process::metrics::remove(state_fetch);
       process::metrics::remove(state_store);
+      process::metrics::remove(commit_latency);
     }
 
     PullGauge queued_operations;
     PullGauge registry_size_bytes;
 
+    // Number of operations in the most recently stored batch.
+    PushGauge batch_size;
+
     Timer<Milliseconds> state_fetch;
     Timer<Milliseconds> state_store;
+
+    // Time from the application of an operation being requested
+    // until the operation is stored in the registry.
+    Timer<Milliseconds> commit_latency;
   } metrics;
 
   // PullGauge handlers.
   double _queued_operations()
   {
-    return static_cast<double>(operations.size());
+    size_t queued = operations.size();
+
+    if (prepared.isSome()) {
+      queued += prepared->operations.size();
+    }
+
+    return static_cast<double>(queued);
   }
 
   Future<double> _registry_size_bytes()
@@ -192,15 +221,45 @@ private:
   void _recover(
       const MasterInfo& info,
       const Future<Variable>& recovery);
-  void __recover(const Future<bool>& recover);
+  void __recover(
+      const MasterInfo& info,
+      const Future<Variable>& recovery);
+  void ___recover(const Future<bool>& recover);
   Future<bool> _apply(Owned<RegistryOperation> operation);
 
+  // A batch of operations, along with the snapshot of the registry
+  // (and the 'slaveIDs' accumulator) they have been applied to.
+  struct Batch
+  {
+    Owned<Registry> registry;
+    hashset<SlaveID> slaveIDs;
+    deque<Owned<RegistryOperation>> operations;
+
+    // The records of the mutations performed by the operations. If any
+    // of the mutations has no record, the batch can only be stored as
+    // a checkpoint of the registry.
+    vector<Registry::Operation> records;
+    bool checkpoint;
+
+    // Set if the batch is stored as this delta rather than as a
+    // checkpoint of the registry.
+    Option<Registry::Delta> delta;
+  };
+
+  // Fills the batch by applying the queued operations to its
+  // snapshot of the registry, up to the maximum batch size.
+  void fill(Batch* batch);
+
+  // Applies queued operations on top of the batch being stored, so
+  // that the next batch is ready to be stored as soon as the store
+  // completes. Note that the store itself cannot be pipelined, since
+  // it is only valid for the version of the variable written by the
+  // store in flight.
+  void prepare();
+
   // Helper for updating state (performing store).
   void update();
-  void _update(
-      const Future<Option<Variable>>& store,
-      const Owned<Registry>& updatedRegistry,
-      deque<Owned<RegistryOperation>> operations);
+  void _update(const Future<Option<Variable>>& store);
 
   // Fails all pending operations and transitions the Registrar
   // into an error state in which all subsequent operations will fail.
@@ -222,7 +281,21 @@ private:
   Option<Variable> variable;
   Option<Registry> registry;
 
+  // The operations which have been stored on top of the checkpoint
+  // of the registry, see `--registry_max_delta_operations`.
+  Option<Variable> deltaVariable;
+  Registry::Delta delta;
+
+  // Operations which have not been applied to any batch yet.
   deque<Owned<RegistryOperation>> operations;
+
+  // The batch being stored, if any, and the batch to be stored next.
+  Option<Batch> storing;
+  Option<Batch> prepared;
+
+  // Used to delay storing a batch by `--registry_batch_latency`.
+  Option<process::Timer> batchTimer;
+
   bool updating; // Used to signify fetching (recovering) or storing.
 
   const Flags flags;
@@ -391,17 +464,95 @@ void RegistrarProcess::_recover(
   registry = Option<Registry>(Registry());
   registry->Swap(&deserialized.get());
 
+  // Fetch the operations stored on top of the registry.
+  state->fetch("registry_delta")
+    .after(flags.registry_fetch_timeout,
+           lambda::bind(
+               &timeout<Variable>,
+               "fetch",
+               flags.registry_fetch_timeout,
+               lambda::_1))
+    .onAny(defer(self(), &Self::__recover, info, lambda::_1));
+
+  updating = true;
+}
+
+
+void RegistrarProcess::__recover(
+    const MasterInfo& info,
+    const Future<Variable>& recovery)
+{
+  updating = false;
+
+  CHECK(!recovery.isPending());
+
+  if (!recovery.isReady()) {
+    recovered.get()->fail("Failed to recover registrar: " +
+        (recovery.isFailed() ? recovery.failure() : "discarded"));
+    return;
+  }
+
+  Try<Registry::Delta> deserialized =
+    ::protobuf::deserialize<Registry::Delta>(recovery->value());
+  if (deserialized.isError()) {
+    recovered.get()->fail("Failed to recover registrar: " +
+                          deserialized.error());
+    return;
+  }
+
+  deltaVariable = recovery.get();
+
+  // A delta which does not belong to the checkpoint has been
+  // superseded by a later checkpoint.
+  if (deserialized->checkpoint() == registry->checkpoint() &&
+      !deserialized->operations().empty()) {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    hashset<SlaveID> slaveIDs;
+    foreach (const Registry::Slave& slave, registry->slaves().slaves()) {
+      slaveIDs.insert(slave.info().id());
+    }
+
+    foreach (const Registry::Operation& record, deserialized->operations()) {
+      Try<Owned<RegistryOperation>> operation =
+        createRegistryOperation(record);
+
+      if (operation.isError()) {
+        recovered.get()->fail("Failed to recover registrar: " +
+                              operation.error());
+        return;
+      }
+
+      Try<bool> result = (*operation.get())(&registry.get(), &slaveIDs);
+
+      if (result.isError()) {
+        recovered.get()->fail("Failed to recover registrar: Failed to"
+                              " replay operation: " + result.error());
+        return;
+      }
+    }
+
+    LOG(INFO) << "Replayed " << deserialized->operations().size()
+              << " operations on top of the registry in "
+              << stopwatch.elapsed();
+
+    delta.Swap(&deserialized.get());
+  } else {
+    delta.set_checkpoint(registry->checkpoint());
+  }
+
   // Perform the Recover operation to add the new MasterInfo.
   Owned<RegistryOperation> operation(new Recover(info));
   operations.push_back(operation);
   operation->future()
-    .onAny(defer(self(), &Self::__recover, lambda::_1));
+    .onAny(defer(self(), &Self::___recover, lambda::_1));
 
   update();
 }
 
 
-void RegistrarProcess::__recover(const Future<bool>& recover)
+void RegistrarProcess::___recover(const Future<bool>& recover)
 {
   CHECK(!recover.isPending());
 
@@ -445,23 +596,85 @@ Future<bool> RegistrarProcess::_apply(Owned<RegistryOperation> operation)
   CHECK_SOME(variable);
 
   operations.push_back(operation);
-  Future<bool> future = operation->future();
-  if (!updating) {
+  Future<bool> future = metrics.commit_latency.time(operation->future());
+
+  if (updating) {
+    prepare();
+  } else if (flags.registry_batch_latency == Duration::zero() ||
+             (flags.registry_max_batch_size.isSome() &&
+              operations.size() >= flags.registry_max_batch_size.get())) {
     update();
+  } else if (batchTimer.isNone()) {
+    batchTimer = delay(flags.registry_batch_latency, self(), &Self::update);
   }
+
   return future;
 }
 
 
+void RegistrarProcess::fill(Batch* batch)
+{
+  while (!operations.empty() &&
+         (flags.registry_max_batch_size.isNone() ||
+          batch->operations.size() < flags.registry_max_batch_size.get())) {
+    Owned<RegistryOperation> operation = operations.front();
+    operations.pop_front();
+
+    Try<bool> result = (*operation)(batch->registry.get(), &batch->slaveIDs);
+
+    // Only mutations need to be recorded.
+    if (result.isSome() && result.get()) {
+      Option<Registry::Operation> record = operation->record();
+
+      if (record.isSome()) {
+        batch->records.push_back(record.get());
+      } else {
+        batch->checkpoint = true;
+      }
+    }
+
+    batch->operations.push_back(operation);
+  }
+}
+
+
+void RegistrarProcess::prepare()
+{
+  if (storing.isNone() || operations.empty()) {
+    return; // Still recovering, or nothing to prepare.
+  }
+
+  if (prepared.isNone()) {
+    // Create a snapshot of the registry being stored. We use an `Owned`
+    // here to avoid copying, since protobuf doesn't suppport move
+    // construction.
+    prepared = Batch{
+      Owned<Registry>(new Registry(*storing->registry)),
+      storing->slaveIDs,
+      {},
+      {},
+      false,
+      None()};
+  }
+
+  fill(&prepared.get());
+}
+
+
 void RegistrarProcess::update()
 {
-  if (operations.empty()) {
+  if (batchTimer.isSome()) {
+    Clock::cancel(batchTimer.get());
+    batchTimer = None();
+  }
+
+  if (updating || (operations.empty() && prepared.isNone())) {
     return; // No-op.
   }
 
-  CHECK(!updating);
   CHECK_NONE(error);
   CHECK_SOME(variable);
+  CHECK_SOME(deltaVariable);
 
   // Time how long it takes to apply the operations.
   Stopwatch stopwatch;
@@ -469,58 +682,93 @@ void RegistrarProcess::update()
 
   updating = true;
 
-  // Create a snapshot of the current registry. We use an `Owned` here
-  // to avoid copying, since protobuf doesn't suppport move construction.
-  auto updatedRegistry = Owned<Registry>(new Registry(registry.get()));
-
-  // Create the 'slaveIDs' accumulator.
-  hashset<SlaveID> slaveIDs;
-  foreach (const Registry::Slave& slave, updatedRegistry->slaves().slaves()) {
-    slaveIDs.insert(slave.info().id());
+  if (prepared.isNone()) {
+    // Create a snapshot of the current registry. We use an `Owned` here
+    // to avoid copying, since protobuf doesn't suppport move construction.
+    prepared = Batch{
+      Owned<Registry>(new Registry(registry.get())),
+      {},
+      {},
+      {},
+      false,
+      None()};
+
+    // Create the 'slaveIDs' accumulator.
+    foreach (const Registry::Slave& slave,
+             prepared->registry->slaves().slaves()) {
+      prepared->slaveIDs.insert(slave.info().id());
+    }
   }
 
-  foreach (Owned<RegistryOperation>& operation, operations) {
-    // No need to process the result of the operation.
-    (*operation)(updatedRegistry.get(), &slaveIDs);
-  }
+  fill(&prepared.get());
+
+  storing = std::move(prepared.get());
+  prepared = None();
 
-  LOG(INFO) << "Applied " << operations.size() << " operations in "
+  LOG(INFO) << "Applied " << storing->operations.size() << " operations in "
             << stopwatch.elapsed() << "; attempting to update the registry";
 
+  metrics.batch_size = static_cast<double>(storing->operations.size());
+
+  // Store the batch as a delta on top of the checkpoint if possible,
+  // otherwise checkpoint the registry. The checkpoint is advanced
+  // whenever a delta is superseded, so that it is not replayed.
+  if (flags.registry_max_delta_operations.isSome() &&
+      !storing->checkpoint &&
+      delta.operations().size() + storing->records.size() <=
+        flags.registry_max_delta_operations.get()) {
+    storing->delta = delta;
+
+    foreach (const Registry::Operation& record, storing->records) {
+      storing->delta->add_operations()->CopyFrom(record);
+    }
+  } else if (!delta.operations().empty()) {
+    storing->registry->set_checkpoint(delta.checkpoint() + 1);
+  }
+
   // Perform the store, and time the operation.
   metrics.state_store.start();
 
-  // Serialize updated registry.
-  Try<string> serialized = ::protobuf::serialize(*updatedRegistry);
+  // Serialize the updated registry, or the delta.
+  Try<string> serialized = storing->delta.isSome()
+    ? ::protobuf::serialize(storing->delta.get())
+    : ::protobuf::serialize(*storing->registry);
+
   if (serialized.isError()) {
     string message = "Failed to update registry: " + serialized.error();
-    fail(&operations, message);
+    fail(&storing->operations, message);
+    storing = None();
     abort(message);
     return;
   }
 
-  state->store(variable->mutate(serialized.get()))
+  Variable mutated = storing->delta.isSome()
+    ? deltaVariable->mutate(serialized.get())
+    : variable->mutate(serialized.get());
+
+  state->store(mutated)
     .after(flags.registry_store_timeout,
            lambda::bind(
                &timeout<Option<Variable>>,
                "store",
                flags.registry_store_timeout,
                lambda::_1))
-    .onAny(defer(
-        self(), &Self::_update, lambda::_1, updatedRegistry, operations));
+    .onAny(defer(self(), &Self::_update, lambda::_1));
 
-  // Clear the operations, _update will transition the Promises!
-  operations.clear();
+  // Prepare the next batch while the store is in flight.
+  prepare();
 }
 
 
-void RegistrarProcess::_update(
-    const Future<Option<Variable>>& store,
-    const Owned<Registry>& updatedRegistry,
-    deque<Owned<RegistryOperation>> applied)
+void RegistrarProcess::_update(const Future<Option<Variable>>& store)
 {
   updating = false;
 
+  CHECK_SOME(storing);
+
+  Batch applied = std::move(storing.get());
+  storing = None();
+
   // Abort if the storage operation did not succeed.
   if (!store.isReady() || store->isNone()) {
     string message = "Failed to update registry: ";
@@ -533,7 +781,7 @@ void RegistrarProcess::_update(
       message += "version mismatch";
     }
 
-    fail(&applied, message);
+    fail(&applied.operations, message);
     abort(message);
 
     return;
@@ -543,18 +791,26 @@ void RegistrarProcess::_update(
 
   LOG(INFO) << "Successfully updated the registry in " << elapsed;
 
-  variable = store->get();
-  registry->Swap(updatedRegistry.get());
+  if (applied.delta.isSome()) {
+    deltaVariable = store->get();
+    delta.Swap(&applied.delta.get());
+  } else {
+    variable = store->get();
+    delta.Clear();
+    delta.set_checkpoint(applied.registry->checkpoint());
+  }
+
+  registry->Swap(applied.registry.get());
 
   // Remove the operations.
-  while (!applied.empty()) {
-    Owned<RegistryOperation> operation = applied.front();
-    applied.pop_front();
+  while (!applied.operations.empty()) {
+    Owned<RegistryOperation> operation = applied.operations.front();
+    applied.operations.pop_front();
 
     operation->set();
   }
 
-  if (!operations.empty()) {
+  if (prepared.isSome() || !operations.empty()) {
     update();
   }
 }
@@ -566,6 +822,11 @@ void RegistrarProcess::abort(const string& message)
 
   LOG(ERROR) << "Registrar aborting: " << message;
 
+  if (prepared.isSome()) {
+    fail(&prepared->operations, message);
+    prepared = None();
+  }
+
   fail(&operations, message);
 }
 
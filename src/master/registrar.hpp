@@ -66,6 +66,11 @@ public:
   // Sets the promise based on whether the operation was successful.
   bool set() { return process::Promise<bool>::set(success); }
 
+  // Returns a record which allows the operation to be replayed on top
+  // of a checkpoint of the registry, see `Registry::Delta`. Operations
+  // without a record can only be persisted by storing the whole registry.
+  virtual Option<Registry::Operation> record() const { return None(); }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) = 0;
 
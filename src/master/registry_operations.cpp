@@ -20,6 +20,8 @@
 
 #include "common/resources_utils.hpp"
 
+using process::Owned;
+
 namespace mesos {
 namespace internal {
 namespace master {
@@ -30,6 +32,16 @@ AdmitSlave::AdmitSlave(const SlaveInfo& _info) : info(_info)
 }
 
 
+Option<Registry::Operation> AdmitSlave::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::ADMIT_SLAVE);
+  operation.mutable_slave_info()->CopyFrom(info);
+
+  return operation;
+}
+
+
 Try<bool> AdmitSlave::perform(Registry* registry, hashset<SlaveID>* slaveIDs)
 {
   // Check if this slave is currently admitted. This should only
@@ -57,6 +69,16 @@ UpdateSlave::UpdateSlave(const SlaveInfo& _info) : info(_info)
 }
 
 
+Option<Registry::Operation> UpdateSlave::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::UPDATE_SLAVE);
+  operation.mutable_slave_info()->CopyFrom(info);
+
+  return operation;
+}
+
+
 Try<bool> UpdateSlave::perform(Registry* registry, hashset<SlaveID>* slaveIDs)
 {
   if (!slaveIDs->contains(info.id())) {
@@ -104,6 +126,17 @@ MarkSlaveUnreachable::MarkSlaveUnreachable(
 }
 
 
+Option<Registry::Operation> MarkSlaveUnreachable::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::MARK_SLAVE_UNREACHABLE);
+  operation.mutable_slave_info()->CopyFrom(info);
+  operation.mutable_timestamp()->CopyFrom(unreachableTime);
+
+  return operation;
+}
+
+
 Try<bool> MarkSlaveUnreachable::perform(
     Registry* registry,
     hashset<SlaveID>* slaveIDs)
@@ -150,6 +183,16 @@ MarkSlaveReachable::MarkSlaveReachable(const SlaveInfo& _info)
 }
 
 
+Option<Registry::Operation> MarkSlaveReachable::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::MARK_SLAVE_REACHABLE);
+  operation.mutable_slave_info()->CopyFrom(info);
+
+  return operation;
+}
+
+
 Try<bool> MarkSlaveReachable::perform(
     Registry* registry,
     hashset<SlaveID>* slaveIDs)
@@ -264,6 +307,16 @@ RemoveSlave::RemoveSlave(const SlaveInfo& _info)
 }
 
 
+Option<Registry::Operation> RemoveSlave::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::REMOVE_SLAVE);
+  operation.mutable_slave_info()->CopyFrom(info);
+
+  return operation;
+}
+
+
 Try<bool> RemoveSlave::perform(
     Registry* registry,
     hashset<SlaveID>* slaveIDs)
@@ -291,6 +344,17 @@ MarkSlaveGone::MarkSlaveGone(
 {}
 
 
+Option<Registry::Operation> MarkSlaveGone::record() const
+{
+  Registry::Operation operation;
+  operation.set_type(Registry::Operation::MARK_SLAVE_GONE);
+  operation.mutable_slave_id()->CopyFrom(id);
+  operation.mutable_timestamp()->CopyFrom(goneTime);
+
+  return operation;
+}
+
+
 Try<bool> MarkSlaveGone::perform(Registry* registry, hashset<SlaveID>* slaveIDs)
 {
   // Check whether the slave is already in the gone list. As currently
@@ -347,6 +411,53 @@ Try<bool> MarkSlaveGone::perform(Registry* registry, hashset<SlaveID>* slaveIDs)
   return Error("Failed to find agent " + stringify(id));
 }
 
+
+Try<Owned<RegistryOperation>> createRegistryOperation(
+    const Registry::Operation& record)
+{
+  switch (record.type()) {
+    case Registry::Operation::ADMIT_SLAVE:
+      if (record.has_slave_info()) {
+        return Owned<RegistryOperation>(new AdmitSlave(record.slave_info()));
+      }
+      break;
+    case Registry::Operation::UPDATE_SLAVE:
+      if (record.has_slave_info()) {
+        return Owned<RegistryOperation>(new UpdateSlave(record.slave_info()));
+      }
+      break;
+    case Registry::Operation::MARK_SLAVE_UNREACHABLE:
+      if (record.has_slave_info() && record.has_timestamp()) {
+        return Owned<RegistryOperation>(new MarkSlaveUnreachable(
+            record.slave_info(), record.timestamp()));
+      }
+      break;
+    case Registry::Operation::MARK_SLAVE_REACHABLE:
+      if (record.has_slave_info()) {
+        return Owned<RegistryOperation>(
+            new MarkSlaveReachable(record.slave_info()));
+      }
+      break;
+    case Registry::Operation::REMOVE_SLAVE:
+      if (record.has_slave_info()) {
+        return Owned<RegistryOperation>(new RemoveSlave(record.slave_info()));
+      }
+      break;
+    case Registry::Operation::MARK_SLAVE_GONE:
+      if (record.has_slave_id() && record.has_timestamp()) {
+        return Owned<RegistryOperation>(
+            new MarkSlaveGone(record.slave_id(), record.timestamp()));
+      }
+      break;
+    case Registry::Operation::UNKNOWN:
+      break;
+  }
+
+  return Error(
+      "Invalid registry operation record of type " +
+      Registry::Operation::Type_Name(record.type()));
+}
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
@@ -20,6 +20,10 @@
 #include <mesos/mesos.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/owned.hpp>
+
+#include <stout/try.hpp>
+
 #include "master/registrar.hpp"
 
 
@@ -33,6 +37,8 @@ class AdmitSlave : public RegistryOperation
 public:
   explicit AdmitSlave(const SlaveInfo& _info);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -47,6 +53,8 @@ class UpdateSlave : public RegistryOperation
 public:
   explicit UpdateSlave(const SlaveInfo& _info);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -64,6 +72,8 @@ public:
       const SlaveInfo& _info,
       const TimeInfo& _unreachableTime);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -84,6 +94,8 @@ class MarkSlaveReachable : public RegistryOperation
 public:
   explicit MarkSlaveReachable(const SlaveInfo& _info);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -114,6 +126,8 @@ class RemoveSlave : public RegistryOperation
 public:
   explicit RemoveSlave(const SlaveInfo& _info);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -129,6 +143,8 @@ class MarkSlaveGone : public RegistryOperation
 public:
   MarkSlaveGone(const SlaveID& _id, const TimeInfo& _goneTime);
 
+  Option<Registry::Operation> record() const override;
+
 protected:
   Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) override;
 
@@ -137,6 +153,12 @@ private:
   const TimeInfo goneTime;
 };
 
+
+// Creates the operation described by the record, so that it can be
+// replayed on top of a checkpoint of the registry.
+Try<process::Owned<RegistryOperation>> createRegistryOperation(
+    const Registry::Operation& record);
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
@@ -1243,13 +1243,17 @@ void Slave::detected(const Future<Option<MasterInfo>>& _master)
     LOG(INFO) << "Re-detecting master";
     latest = None();
     master = None();
+    masterCapabilities = protobuf::master::Capabilities();
   } else if (_master->isNone()) {
     LOG(INFO) << "Lost leading master";
     latest = None();
     master = None();
+    masterCapabilities = protobuf::master::Capabilities();
   } else {
     latest = _master.get();
     master = UPID(latest->pid());
+    masterCapabilities =
+      protobuf::master::Capabilities(latest->capabilities());
 
     LOG(INFO) << "New master detected at " << master.get();
 
@@ -1264,9 +1268,6 @@ void Slave::detected(const Future<Option<MasterInfo>>& _master)
     }
 
     if (requiredMasterCapabilities.agentUpdate) {
-      protobuf::master::Capabilities masterCapabilities(
-          latest->capabilities());
-
       if (!masterCapabilities.agentUpdate) {
         EXIT(EXIT_FAILURE) <<
           "Agent state changed on restart, but the detected master lacks the "
@@ -5769,10 +5770,56 @@ void Slave::forward(StatusUpdate update)
   // re-registration can generate updates when framework/executor/task
   // are unknown.
 
-  // Forward the update to master.
-  StatusUpdateMessage message;
-  message.mutable_update()->MergeFrom(update);
-  message.set_pid(self()); // The ACK will be first received by the slave.
+  // Forward the update to master, along with the other updates
+  // forwarded before the agent processes its next event.
+  if (pendingStatusUpdates.empty()) {
+    dispatch(self(), &Self::forwardStatusUpdates);
+  }
+
+  pendingStatusUpdates.push_back(std::move(update));
+}
+
+
+void Slave::forwardStatusUpdates()
+{
+  vector<StatusUpdate> updates = std::move(pendingStatusUpdates);
+  pendingStatusUpdates.clear();
+
+  if (updates.empty()) {
+    return;
+  }
+
+  // The updates are dropped if the master was lost in the meantime;
+  // the task status update manager retries them once the agent
+  // reregisters.
+  if (state != RUNNING || master.isNone()) {
+    LOG(WARNING) << "Dropping " << updates.size() << " status updates"
+                 << " because the agent is in " << state << " state";
+    return;
+  }
+
+  if (updates.size() == 1 || !masterCapabilities.batchedStatusUpdates) {
+    foreach (StatusUpdate& update, updates) {
+      StatusUpdateMessage message;
+      *message.mutable_update() = std::move(update);
+      message.set_pid(self()); // The ACK will be first received by the slave.
+
+      send(master.get(), message);
+    }
+
+    return;
+  }
+
+  StatusUpdatesMessage message;
+  message.mutable_slave_id()->CopyFrom(info.id());
+  message.set_pid(self()); // The ACKs will be first received by the slave.
+
+  foreach (StatusUpdate& update, updates) {
+    *message.add_updates() = std::move(update);
+  }
+
+  LOG(INFO) << "Forwarding " << message.updates_size()
+            << " status updates to " << master.get();
 
   send(master.get(), message);
 }
@@ -348,6 +348,10 @@ public:
   // added to the update before forwarding.
   void forward(StatusUpdate update);
 
+  // Sends the status updates forwarded since the last call to the
+  // master, in a single message if the master supports it.
+  void forwardStatusUpdates();
+
   void statusUpdateAcknowledgement(
       const process::UPID& from,
       const SlaveID& slaveId,
@@ -737,6 +741,15 @@ private:
 
   Option<process::UPID> master;
 
+  // The capabilities of the detected master.
+  protobuf::master::Capabilities masterCapabilities;
+
+  // The status updates which are pending to be sent to the master.
+  // The updates forwarded by the task status update manager are
+  // collected until the agent processes its next event, so that the
+  // updates of many tasks terminating together are sent at once.
+  std::vector<StatusUpdate> pendingStatusUpdates;
+
   hashmap<FrameworkID, Framework*> frameworks;
 
   // Note that these frameworks are "completed" only in that
@@ -0,0 +1,190 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <mesos/resources.hpp>
+
+#include <stout/gtest.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+
+#include "master/allocator/mesos/agent_order.hpp"
+
+using mesos::internal::master::allocator::AgentOrder;
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace tests {
+
+
+static vector<SlaveID> createAgentIds(size_t count)
+{
+  vector<SlaveID> result;
+
+  for (size_t i = 0; i < count; ++i) {
+    SlaveID slaveId;
+    slaveId.set_value("agent" + stringify(i));
+    result.push_back(slaveId);
+  }
+
+  return result;
+}
+
+
+// Appends the packed quantities of `resources` to `quantities`.
+static void pack(const string& resources, vector<double>* quantities)
+{
+  const AgentOrder::Quantities packed =
+    AgentOrder::quantities(CHECK_NOTERROR(Resources::parse(resources)));
+
+  quantities->insert(quantities->end(), packed.begin(), packed.end());
+}
+
+
+TEST(AgentOrderTest, Parse)
+{
+  Try<AgentOrder> order = AgentOrder::parse("random");
+  ASSERT_SOME(order);
+  EXPECT_EQ(AgentOrder::RANDOM, order->policy());
+
+  order = AgentOrder::parse("binpack");
+  ASSERT_SOME(order);
+  EXPECT_EQ(AgentOrder::BINPACK, order->policy());
+
+  order = AgentOrder::parse("spread");
+  ASSERT_SOME(order);
+  EXPECT_EQ(AgentOrder::SPREAD, order->policy());
+
+  order = AgentOrder::parse("attribute:rack");
+  ASSERT_SOME(order);
+  EXPECT_EQ(AgentOrder::ATTRIBUTE, order->policy());
+  EXPECT_EQ("rack", order->attribute());
+
+  EXPECT_ERROR(AgentOrder::parse("attribute:"));
+  EXPECT_ERROR(AgentOrder::parse("drf"));
+  EXPECT_ERROR(AgentOrder::parse(""));
+}
+
+
+TEST(AgentOrderTest, Quantities)
+{
+  const AgentOrder::Quantities quantities = AgentOrder::quantities(
+      CHECK_NOTERROR(Resources::parse(
+          "cpus:2;cpus(role):1;mem:512;disk:1024;gpus:1;ports:[1-10]")));
+
+  EXPECT_EQ((AgentOrder::Quantities{3, 512, 1024, 1}), quantities);
+}
+
+
+TEST(AgentOrderTest, Random)
+{
+  const vector<SlaveID> agentIds = createAgentIds(10);
+
+  vector<SlaveID> sorted = agentIds;
+  AgentOrder().sort(&sorted, {}, {}, {});
+
+  // The agents are shuffled.
+  EXPECT_TRUE(
+      std::is_permutation(agentIds.begin(), agentIds.end(), sorted.begin()));
+}
+
+
+// The most allocated agents come first, where agents are scored by
+// their most allocated resource.
+TEST(AgentOrderTest, BinPack)
+{
+  const vector<SlaveID> agentIds = createAgentIds(3);
+
+  vector<double> available;
+  vector<double> total;
+
+  pack("cpus:4;mem:1024", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  pack("cpus:1;mem:1024", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  pack("cpus:4;mem:512", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  vector<SlaveID> sorted = agentIds;
+  CHECK_NOTERROR(AgentOrder::parse("binpack"))
+    .sort(&sorted, available, total, {});
+
+  EXPECT_EQ(vector<SlaveID>({agentIds[1], agentIds[2], agentIds[0]}), sorted);
+}
+
+
+TEST(AgentOrderTest, Spread)
+{
+  const vector<SlaveID> agentIds = createAgentIds(3);
+
+  vector<double> available;
+  vector<double> total;
+
+  pack("cpus:1;mem:1024", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  pack("cpus:4;mem:1024", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  pack("cpus:4;mem:512", &available);
+  pack("cpus:4;mem:1024", &total);
+
+  vector<SlaveID> sorted = agentIds;
+  CHECK_NOTERROR(AgentOrder::parse("spread"))
+    .sort(&sorted, available, total, {});
+
+  EXPECT_EQ(vector<SlaveID>({agentIds[1], agentIds[2], agentIds[0]}), sorted);
+}
+
+
+// The agents with the same value of the attribute come one after
+// the other, followed by the agents without the attribute.
+TEST(AgentOrderTest, Attribute)
+{
+  const vector<SlaveID> agentIds = createAgentIds(5);
+
+  const vector<Option<string>> localities = {
+    string("rack:b"), None(), string("rack:a"), string("rack:b"),
+    string("rack:a")};
+
+  vector<SlaveID> sorted = agentIds;
+  CHECK_NOTERROR(AgentOrder::parse("attribute:rack"))
+    .sort(&sorted, {}, {}, localities);
+
+  ASSERT_EQ(5u, sorted.size());
+
+  const vector<SlaveID> rackA = {agentIds[2], agentIds[4]};
+  const vector<SlaveID> rackB = {agentIds[0], agentIds[3]};
+
+  EXPECT_TRUE(std::is_permutation(rackA.begin(), rackA.end(), sorted.begin()));
+  EXPECT_TRUE(
+      std::is_permutation(rackB.begin(), rackB.end(), sorted.begin() + 2));
+  EXPECT_EQ(agentIds[1], sorted[4]);
+}
+
+} // namespace tests {
+} // namespace internal {
+} // namespace mesos {
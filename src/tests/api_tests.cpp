@@ -634,6 +634,156 @@ TEST_P(MasterAPITest, GetState)
 }
 
 
+// This test verifies that GET_STATE only returns the agents and tasks
+// which changed since the cursor passed as `since`, and that it returns
+// the full state for unknown cursors.
+TEST_P(MasterAPITest, GetStateSince)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  // The agent updates its resources after it registered.
+  Future<UpdateSlaveMessage> updateSlaveMessage =
+    FUTURE_PROTOBUF(UpdateSlaveMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(updateSlaveMessage);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  ContentType contentType = GetParam();
+
+  auto getState = [this, &master, contentType](const Option<string>& since) {
+    v1::master::Call v1Call;
+    v1Call.set_type(v1::master::Call::GET_STATE);
+
+    if (since.isSome()) {
+      v1Call.mutable_get_state()->set_since(since.get());
+    }
+
+    return post(master.get()->pid, v1Call, contentType);
+  };
+
+  Future<v1::master::Response> v1Response = getState(None());
+  AWAIT_READY(v1Response);
+  ASSERT_EQ(v1::master::Response::GET_STATE, v1Response->type());
+
+  const string cursor = v1Response->get_state().cursor();
+  EXPECT_FALSE(cursor.empty());
+  EXPECT_FALSE(v1Response->get_state().has_since());
+  EXPECT_EQ(1, v1Response->get_state().get_agents().agents_size());
+  EXPECT_EQ(1, v1Response->get_state().get_frameworks().frameworks_size());
+
+  TaskInfo task = createTask(offers.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<StatusUpdateAcknowledgementMessage> acknowledgement =
+    FUTURE_PROTOBUF(
+        StatusUpdateAcknowledgementMessage(),
+        Eq(master.get()->pid),
+        Eq(slave.get()->pid));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  // Decline the remaining resources for long enough that the framework
+  // does not get another offer, which would change it again.
+  Filters filters;
+  filters.set_refuse_seconds(1000);
+
+  driver.launchTasks(offers.get()[0].id(), {task}, filters);
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  AWAIT_READY(acknowledgement);
+
+  // The framework and the agent changed, since both have a new task.
+  v1Response = getState(cursor);
+  AWAIT_READY(v1Response);
+  ASSERT_EQ(v1::master::Response::GET_STATE, v1Response->type());
+
+  {
+    const v1::master::Response::GetState& changes = v1Response->get_state();
+
+    EXPECT_EQ(cursor, changes.since());
+    EXPECT_NE(cursor, changes.cursor());
+
+    EXPECT_EQ(1, changes.get_frameworks().frameworks_size());
+    EXPECT_EQ(1, changes.get_agents().agents_size());
+    ASSERT_EQ(1, changes.get_tasks().tasks_size());
+    EXPECT_EQ(task.task_id(), devolve(changes.get_tasks().tasks(0).task_id()));
+
+    EXPECT_TRUE(changes.removed_framework_ids().empty());
+    EXPECT_TRUE(changes.removed_agent_ids().empty());
+    EXPECT_TRUE(changes.evicted_completed_tasks().empty());
+  }
+
+  // Nothing changed since the latest cursor.
+  const string latest = v1Response->get_state().cursor();
+
+  v1Response = getState(latest);
+  AWAIT_READY(v1Response);
+  ASSERT_EQ(v1::master::Response::GET_STATE, v1Response->type());
+
+  {
+    const v1::master::Response::GetState& changes = v1Response->get_state();
+
+    EXPECT_EQ(latest, changes.since());
+    EXPECT_EQ(latest, changes.cursor());
+    EXPECT_TRUE(changes.get_frameworks().frameworks().empty());
+    EXPECT_TRUE(changes.get_agents().agents().empty());
+    EXPECT_TRUE(changes.get_tasks().tasks().empty());
+    EXPECT_TRUE(changes.get_executors().executors().empty());
+  }
+
+  // The full state is returned for unknown cursors.
+  v1Response = getState(string("unknown:0"));
+  AWAIT_READY(v1Response);
+  ASSERT_EQ(v1::master::Response::GET_STATE, v1Response->type());
+
+  {
+    const v1::master::Response::GetState& state = v1Response->get_state();
+
+    EXPECT_FALSE(state.has_since());
+    EXPECT_EQ(1, state.get_agents().agents_size());
+    EXPECT_EQ(1, state.get_frameworks().frameworks_size());
+    EXPECT_EQ(1, state.get_tasks().tasks_size());
+  }
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 TEST_P(MasterAPITest, GetTasksNoRunningTask)
 {
   Try<Owned<cluster::Master>> master = this->StartMaster();
@@ -1196,7 +1346,7 @@ TEST_P(MasterAPITest, ReserveResources)
 {
   TestAllocator<> allocator;
 
-  EXPECT_CALL(allocator, initialize(_, _, _, _, _, _, _, _));
+  EXPECT_CALL(allocator, initialize(_, _, _));
 
   Try<Owned<cluster::Master>> master = StartMaster(&allocator);
   ASSERT_SOME(master);
@@ -1287,7 +1437,7 @@ TEST_P(MasterAPITest, UnreserveResources)
 {
   TestAllocator<> allocator;
 
-  EXPECT_CALL(allocator, initialize(_, _, _, _, _, _, _, _));
+  EXPECT_CALL(allocator, initialize(_, _, _));
 
   Try<Owned<cluster::Master>> master = StartMaster(&allocator);
   ASSERT_SOME(master);
@@ -1858,6 +2008,165 @@ TEST_P(MasterAPITest, SubscribeAgentEvents)
 }
 
 
+// This test verifies that a subscriber which filters the event types
+// only receives events of these types.
+TEST_P(MasterAPITest, SubscribeEventTypesFilter)
+{
+  ContentType contentType = GetParam();
+
+  Try<Owned<cluster::Master>> master = this->StartMaster();
+  ASSERT_SOME(master);
+
+  v1::master::Call v1Call;
+  v1Call.set_type(v1::master::Call::SUBSCRIBE);
+  v1Call.mutable_subscribe()->add_event_types(
+      v1::master::Event::AGENT_REMOVED);
+
+  http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+
+  headers["Accept"] = stringify(contentType);
+
+  Future<http::Response> response = http::streaming::post(
+      master.get()->pid,
+      "api/v1",
+      headers,
+      serialize(contentType, v1Call),
+      stringify(contentType));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  ASSERT_EQ(http::Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+
+  http::Pipe::Reader reader = response->reader.get();
+
+  auto deserializer =
+    lambda::bind(deserialize<v1::master::Event>, contentType, lambda::_1);
+
+  Reader<v1::master::Event> decoder(
+      Decoder<v1::master::Event>(deserializer), reader);
+
+  // The `SUBSCRIBED` and `HEARTBEAT` events are always sent.
+  Future<Result<v1::master::Event>> event = decoder.read();
+  AWAIT_READY(event);
+
+  EXPECT_EQ(v1::master::Event::SUBSCRIBED, event->get().type());
+
+  event = decoder.read();
+  AWAIT_READY(event);
+
+  EXPECT_EQ(v1::master::Event::HEARTBEAT, event->get().type());
+
+  // Start one agent. The `AGENT_ADDED` event is filtered.
+  Future<SlaveRegisteredMessage> agentRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get()->pid, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(agentRegisteredMessage);
+
+  // Forcefully trigger a shutdown on the slave so that master will remove it.
+  slave.get()->shutdown();
+  slave->reset();
+
+  event = decoder.read();
+  AWAIT_READY(event);
+
+  ASSERT_EQ(v1::master::Event::AGENT_REMOVED, event->get().type());
+  EXPECT_EQ(
+      evolve(agentRegisteredMessage->slave_id()),
+      event->get().agent_removed().agent_id());
+}
+
+
+// This test verifies that subscribers of the same principal which use
+// different content types all receive the events, since the master
+// encodes an event once per content type and shares it among them.
+TEST_P(MasterAPITest, SubscribeSharedEvents)
+{
+  ContentType contentType = GetParam();
+  ContentType otherContentType = contentType == ContentType::PROTOBUF
+    ? ContentType::JSON
+    : ContentType::PROTOBUF;
+
+  Try<Owned<cluster::Master>> master = this->StartMaster();
+  ASSERT_SOME(master);
+
+  auto subscribe = [&master](ContentType contentType) {
+    v1::master::Call v1Call;
+    v1Call.set_type(v1::master::Call::SUBSCRIBE);
+
+    http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+
+    headers["Accept"] = stringify(contentType);
+
+    return http::streaming::post(
+        master.get()->pid,
+        "api/v1",
+        headers,
+        serialize(contentType, v1Call),
+        stringify(contentType));
+  };
+
+  vector<Future<http::Response>> responses = {
+    subscribe(contentType),
+    subscribe(contentType),
+    subscribe(otherContentType)
+  };
+
+  vector<ContentType> contentTypes = {
+    contentType,
+    contentType,
+    otherContentType
+  };
+
+  vector<Owned<Reader<v1::master::Event>>> decoders;
+
+  for (size_t i = 0; i < responses.size(); i++) {
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, responses[i]);
+    ASSERT_EQ(http::Response::PIPE, responses[i]->type);
+    ASSERT_SOME(responses[i]->reader);
+
+    auto deserializer = lambda::bind(
+        deserialize<v1::master::Event>, contentTypes[i], lambda::_1);
+
+    decoders.emplace_back(new Reader<v1::master::Event>(
+        Decoder<v1::master::Event>(deserializer),
+        responses[i]->reader.get()));
+
+    Future<Result<v1::master::Event>> event = decoders.back()->read();
+    AWAIT_READY(event);
+
+    EXPECT_EQ(v1::master::Event::SUBSCRIBED, event->get().type());
+
+    event = decoders.back()->read();
+    AWAIT_READY(event);
+
+    EXPECT_EQ(v1::master::Event::HEARTBEAT, event->get().type());
+  }
+
+  Future<SlaveRegisteredMessage> agentRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get()->pid, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(agentRegisteredMessage);
+
+  foreach (const Owned<Reader<v1::master::Event>>& decoder, decoders) {
+    Future<Result<v1::master::Event>> event = decoder->read();
+    AWAIT_READY(event);
+
+    ASSERT_EQ(v1::master::Event::AGENT_ADDED, event->get().type());
+    EXPECT_EQ(
+        evolve(agentRegisteredMessage->slave_id()),
+        event->get().agent_added().agent().agent_info().id());
+  }
+}
+
+
 // This test verifies that no information about reservations and/or allocations
 // is returned to unauthorized users in response to the GET_AGENTS call.
 TEST_P(MasterAPITest, GetAgentsFiltering)
@@ -28,6 +28,7 @@
 #include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gtest.hpp>
+#include <process/http.hpp>
 #include <process/queue.hpp>
 
 #include <stout/duration.hpp>
@@ -40,10 +41,13 @@
 #include <stout/stopwatch.hpp>
 #include <stout/utils.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/constants.hpp"
 #include "master/flags.hpp"
 
 #include "master/allocator/mesos/hierarchical.hpp"
+#include "master/allocator/mesos/recorder.hpp"
 
 #include "slave/constants.hpp"
 
@@ -55,6 +59,7 @@
 using mesos::internal::master::MIN_CPUS;
 using mesos::internal::master::MIN_MEM;
 
+using mesos::internal::master::allocator::AllocatorEvent;
 using mesos::internal::master::allocator::HierarchicalDRFAllocator;
 
 using mesos::internal::protobuf::createLabel;
@@ -65,6 +70,7 @@ using mesos::allocator::Allocator;
 
 using process::Clock;
 using process::Future;
+using process::UPID;
 
 using std::atomic;
 using std::cout;
@@ -182,14 +188,21 @@ protected:
     minAllocatableResources.push_back(CHECK_NOTERROR(Resources::parse(
         "mem:" + stringify((double)MIN_MEM.bytes() / Bytes::MEGABYTES))));
 
+    mesos::allocator::Options options;
+
+    options.allocationInterval = flags.allocation_interval;
+    options.allocationSweepInterval = flags.allocation_sweep_interval;
+    options.fairnessExcludeResourceNames =
+      flags.fair_sharing_excluded_resource_names;
+    options.minAllocatableResources = minAllocatableResources;
+    options.offerFilterParallelism = flags.offer_filter_parallelism;
+    options.agentOrder = flags.allocation_agent_order;
+    options.allocationBatchSize = flags.allocation_batch_size;
+    options.recordPath = flags.allocator_record_path;
+    options.recordMaxSize = flags.allocator_record_max_size;
+
     allocator->initialize(
-        flags.allocation_interval,
-        offerCallback.get(),
-        inverseOfferCallback.get(),
-        flags.fair_sharing_excluded_resource_names,
-        true,
-        None(),
-        minAllocatableResources);
+        options, offerCallback.get(), inverseOfferCallback.get());
   }
 
   SlaveInfo createSlaveInfo(const Resources& resources)
@@ -1068,6 +1081,117 @@ TEST_F(HierarchicalAllocatorTest, SmallOfferFilterTimeout)
 }
 
 
+// This test ensures that an agent whose resources are filtered by all
+// frameworks is offered to a framework that is added later, and that
+// offer filters with different timeouts each expire on time.
+TEST_F(HierarchicalAllocatorTest, OfferFiltersOfAllFrameworks)
+{
+  Clock::pause();
+
+  const string ROLE{"role"};
+
+  initialize();
+
+  FrameworkInfo framework1 = createFrameworkInfo({ROLE});
+  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+
+  SlaveInfo agent = createSlaveInfo("cpus:1;mem:512;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  Allocation expected = Allocation(
+      framework1.id(),
+      {{ROLE, {{agent.id(), agent.resources()}}}});
+
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_EXPECT_EQ(expected, allocation);
+
+  // `framework1` declines the offer for 10 allocation intervals.
+  Filters offerFilter;
+  offerFilter.set_refuse_seconds((flags.allocation_interval * 10).secs());
+
+  allocator->recoverResources(
+      framework1.id(),
+      agent.id(),
+      allocation->resources.at(ROLE).at(agent.id()),
+      offerFilter);
+
+  // There should be no allocation in the next batch allocations.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+
+  // A new framework is not filtered.
+  FrameworkInfo framework2 = createFrameworkInfo({ROLE});
+  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+
+  expected = Allocation(
+      framework2.id(),
+      {{ROLE, {{agent.id(), agent.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocation);
+
+  // `framework2` declines the offer for 2 allocation intervals,
+  // which expires before the filter of `framework1`.
+  offerFilter.set_refuse_seconds((flags.allocation_interval * 2).secs());
+
+  allocator->recoverResources(
+      framework2.id(),
+      agent.id(),
+      allocation->resources.at(ROLE).at(agent.id()),
+      offerFilter);
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  AWAIT_EXPECT_EQ(expected, allocation);
+
+  // `framework2` now declines the offer for a day, so the agent is
+  // offered to `framework1` once its filter expires, 10 allocation
+  // intervals after it was installed.
+  offerFilter.set_refuse_seconds(Days(1).secs());
+
+  allocator->recoverResources(
+      framework2.id(),
+      agent.id(),
+      allocation->resources.at(ROLE).at(agent.id()),
+      offerFilter);
+
+  for (int i = 0; i < 5; i++) {
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+  }
+
+  allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  expected = Allocation(
+      framework1.id(),
+      {{ROLE, {{agent.id(), agent.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocation);
+}
+
+
 // This test ensures that agents which are scheduled for maintenance are
 // properly sent inverse offers after they have accepted or reserved resources.
 TEST_F(HierarchicalAllocatorTest, MaintenanceInverseOffers)
@@ -2507,6 +2631,58 @@ TEST_F(HierarchicalAllocatorTest, SharedResourcesCapability)
 }
 
 
+// Tests that agents with GPUs are only offered to frameworks that have
+// opted in for GPU_RESOURCES, while the other agents are offered to all
+// frameworks of a role.
+TEST_F(HierarchicalAllocatorTest, GPUResourcesCapability)
+{
+  Clock::pause();
+
+  initialize();
+
+  // framework1 comes first in the sort order, but it is not capable
+  // of receiving agents with GPUs.
+  FrameworkInfo framework1 = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+
+  FrameworkInfo framework2 = createFrameworkInfo(
+      {"role1"}, {FrameworkInfo::Capability::GPU_RESOURCES});
+  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+
+  SlaveInfo agent1 = createSlaveInfo("cpus:2;mem:1024;disk:0;gpus:1");
+  allocator->addSlave(
+      agent1.id(),
+      agent1,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent1.resources(),
+      {});
+
+  Allocation expected = Allocation(
+      framework2.id(),
+      {{"role1", {{agent1.id(), agent1.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  // framework1 has the lowest share, and is capable of receiving
+  // an agent without GPUs.
+  SlaveInfo agent2 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(
+      agent2.id(),
+      agent2,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent2.resources(),
+      {});
+
+  expected = Allocation(
+      framework1.id(),
+      {{"role1", {{agent2.id(), agent2.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+}
+
+
 // This test ensures that a call to 'updateAvailable' succeeds when the
 // allocator has sufficient available resources.
 TEST_F(HierarchicalAllocatorTest, UpdateAvailableSuccess)
@@ -3572,6 +3748,64 @@ TEST_F(HierarchicalAllocatorTest, QuotaAllocationGranularityUnchoppableResource)
 }
 
 
+// When an agent has more than one resource of the same name, a quota
+// role should be allocated from each of them until its guarantee is
+// met, rather than stopping after the first one. This test verifies
+// this with two divisible disks that are both smaller than the disk
+// quota guarantee.
+TEST_F(HierarchicalAllocatorTest, QuotaAllocationGranularityMultipleDisks)
+{
+  Clock::pause();
+  initialize();
+
+  const string QUOTA_ROLE{"quota-role"};
+
+  const Quota quota = createQuota(QUOTA_ROLE, "cpus:1;mem:512;disk:150");
+  allocator->setQuota(QUOTA_ROLE, quota);
+
+  // Create 100 disk resource of type PATH in addition to the
+  // 100 default disk resource.
+  Resources pathDiskResource =
+    createDiskResource("100", "*", None(), None(),
+      createDiskSourcePath("/mnt/path"), false);
+
+  Resources agentResources =
+    Resources::parse("cpus:1;mem:512;disk:100").get() + pathDiskResource;
+
+  SlaveInfo agent = createSlaveInfo(agentResources);
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  FrameworkInfo framework = createFrameworkInfo({QUOTA_ROLE});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  Clock::settle();
+
+  // `framework` will get one disk in full and 50 of the other one
+  // (which one is chosen randomly), i.e. exactly its quota.
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_READY(allocation);
+
+  EXPECT_EQ(framework.id(), allocation->frameworkId);
+  ASSERT_TRUE(allocation->resources.contains(QUOTA_ROLE));
+  ASSERT_TRUE(allocation->resources.at(QUOTA_ROLE).contains(agent.id()));
+
+  Resources allocated = allocation->resources.at(QUOTA_ROLE).at(agent.id());
+
+  EXPECT_EQ(
+      Resources(quota.info.guarantee()),
+      allocated.createStrippedScalarQuantity());
+
+  // Quota: "cpus:1;mem:512;disk:150".
+  // Allocated quota: "cpus:1;mem:512;disk:150".
+}
+
+
 // This test verifies the behavior of allocating a resource to quota roles
 // that has no quota set for that particular resource (e.g. allocating
 // memory to a role with only quota set for CPU). If a role has no quota
@@ -4154,86 +4388,436 @@ TEST_F(HierarchicalAllocatorTest, MultiQuotaWithFrameworks)
 }
 
 
-// This tests that reserved resources are accounted for in the role's quota.
-TEST_F(HierarchicalAllocatorTest, ReservationWithinQuota)
+// A hierarchical allocator process that can check the quota related
+// state, which the allocator tracks incrementally, against a fresh
+// computation from the agents, the allocations and the quotas.
+class QuotaTrackingAllocatorProcess
+  : public master::allocator::HierarchicalDRFAllocatorProcess
 {
-  // Pausing the clock is not necessary, but ensures that the test
-  // doesn't rely on the batch allocation in the allocator, which
-  // would slow down the test.
-  Clock::pause();
+public:
+  QuotaTrackingAllocatorProcess()
+    : ProcessBase(process::ID::generate("hierarchical-allocator")) {}
 
-  const string QUOTA_ROLE{"quota-role"};
-  const string NON_QUOTA_ROLE{"non-quota-role"};
+  // Returns a description of the tracked state that does not match
+  // the fresh computation, if any.
+  Option<string> validate() const
+  {
+    hashmap<string, ResourceQuantities> consumed;
+    ResourceQuantities totalUnreserved;
+    ResourceQuantities allocatedUnreserved;
+
+    auto consume = [&consumed](
+        const string& role, const ResourceQuantities& quantities) {
+      if (!quantities.empty()) {
+        consumed[role] += quantities;
+      }
+    };
 
-  initialize();
+    foreachvalue (const Slave& slave, slaves) {
+      foreachpair (const string& role,
+                   const Resources& reservations,
+                   slave.getTotal().reservations()) {
+        consume(role, ResourceQuantities::fromScalarResources(reservations));
+      }
 
-  const Quota quota = createQuota(QUOTA_ROLE, "cpus:2;mem:256");
-  allocator->setQuota(QUOTA_ROLE, quota);
+      totalUnreserved += ResourceQuantities::fromScalarResources(
+          slave.getTotal().unreserved().nonRevocable());
+    }
 
-  FrameworkInfo framework1 = createFrameworkInfo({QUOTA_ROLE});
-  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+    // NOTE: The allocations on removed agents are tracked until they
+    // are recovered (see MESOS-621), so we take the allocations from
+    // the role sorter rather than from the agents.
+    foreachkey (const string& role, roles) {
+      foreachvalue (const Resources& allocation,
+                    roleSorter->allocation(role)) {
+        const ResourceQuantities unreserved =
+          ResourceQuantities::fromScalarResources(
+              allocation.unreserved().nonRevocable());
+
+        consume(role, unreserved);
+        allocatedUnreserved += unreserved;
+      }
+    }
 
-  FrameworkInfo framework2 = createFrameworkInfo({NON_QUOTA_ROLE});
-  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+    hashmap<string, ResourceQuantities> guarantees;
+    ResourceQuantities required;
 
-  // Process all triggered allocation events.
-  //
-  // NOTE: No allocations happen because there are no resources to allocate.
-  Clock::settle();
+    foreachkey (const string& role, quotas) {
+      guarantees[role] =
+        ResourceQuantities::fromScalarResources(quotas.at(role).info.guarantee());
 
-  // Some resources on `agent1` are now being used by `framework1` as part
-  // of its role quota. `framework2` will be offered the rest of `agent1`'s
-  // resources since `framework1`'s quota is satisfied, and `framework2` has
-  // no resources.
-  SlaveInfo agent1 = createSlaveInfo("cpus:8;mem(" + QUOTA_ROLE + "):256");
-  allocator->addSlave(
-      agent1.id(),
-      agent1,
-      AGENT_CAPABILITIES(),
-      None(),
-      agent1.resources(),
-      {{framework1.id(),
-        // The `mem` portion is used to test that reserved resources are
-        // accounted for, and the `cpus` portion is allocated to show that
-        // the result of DRF would be different if `mem` was not accounted.
-        allocatedResources(
-            Resources::parse("cpus:2;mem(" + QUOTA_ROLE + "):256").get(),
-            QUOTA_ROLE)}});
+      required +=
+        guarantees.at(role) - consumed.get(role).getOrElse(ResourceQuantities());
+    }
 
-  Allocation expected = Allocation(
-      framework2.id(),
-      {{NON_QUOTA_ROLE, {{agent1.id(), Resources::parse("cpus:6").get()}}}});
+    if (consumed != consumedQuotaScalarQuantities) {
+      return "Consumed quota " + stringify(consumedQuotaScalarQuantities) +
+             " does not match " + stringify(consumed);
+    }
 
-  AWAIT_EXPECT_EQ(expected, allocations.get());
+    if (guarantees != quotaGuaranteeScalarQuantities) {
+      return "Quota guarantees " + stringify(quotaGuaranteeScalarQuantities) +
+             " do not match " + stringify(guarantees);
+    }
 
-  // Since the reserved resources account towards the quota as well as being
-  // accounted for DRF, we expect these resources to also be allocated to
-  // `framework2`.
-  SlaveInfo agent2 = createSlaveInfo("cpus:4");
-  allocator->addSlave(
-      agent2.id(),
-      agent2,
-      AGENT_CAPABILITIES(),
-      None(),
-      agent2.resources(),
-      {});
+    if (required != requiredHeadroom) {
+      return "Required headroom " + stringify(requiredHeadroom) +
+             " does not match " + stringify(required);
+    }
 
-  expected = Allocation(
-      framework2.id(),
-      {{NON_QUOTA_ROLE, {{agent2.id(), agent2.resources()}}}});
+    if (totalUnreserved != totalUnreservedNonRevocableScalarQuantities) {
+      return "Unreserved resources " +
+             stringify(totalUnreservedNonRevocableScalarQuantities) +
+             " do not match " + stringify(totalUnreserved);
+    }
 
-  AWAIT_EXPECT_EQ(expected, allocations.get());
-}
+    if (allocatedUnreserved !=
+          allocatedUnreservedNonRevocableScalarQuantities) {
+      return "Allocated unreserved resources " +
+             stringify(allocatedUnreservedNonRevocableScalarQuantities) +
+             " do not match " + stringify(allocatedUnreserved);
+    }
 
+    return None();
+  }
+};
 
-// This test checks that when setting aside unallocated resources to
-// ensure that a quota guarantee can be met, we don't use resources
-// that have been reserved for a different role.
-//
-// We setup a scenario with 8 CPUs, where role X has quota for 4 CPUs
-// and role Y has 4 CPUs reserved. All offers are declined; the 4
-// unreserved CPUs should not be offered to role Y.
-TEST_F(HierarchicalAllocatorTest, QuotaSetAsideReservedResources)
+
+// This test ensures that the consumed quota and the headroom, which
+// the allocator tracks incrementally, match a fresh computation after
+// a mix of allocations, recoveries, reservations, agent and role
+// removals as well as quota changes.
+TEST_F(HierarchicalAllocatorTest, QuotaTrackingMatchesFreshComputation)
+{
+  Clock::pause();
+
+  QuotaTrackingAllocatorProcess process;
+  process::spawn(process);
+
+  // The resources offered to each framework, by agent. This is only
+  // modified on the allocator's thread.
+  hashmap<FrameworkID, hashmap<SlaveID, Resources>> offered;
+
+  auto offerCallback =
+    [&offered](const FrameworkID& frameworkId,
+               const hashmap<string, hashmap<SlaveID, Resources>>& offers) {
+      foreachvalue (const auto& resources, offers) {
+        foreachpair (const SlaveID& slaveId,
+                     const Resources& offer,
+                     resources) {
+          offered[frameworkId][slaveId] += offer;
+        }
+      }
+    };
+
+  // Runs `f` on the allocator's thread and then validates the state.
+  auto step = [&process](const lambda::function<void()>& f) {
+    Future<Option<string>> error =
+      process::dispatch(process.self(), [&process, f]() {
+        f();
+        return process.validate();
+      });
+
+    // Let the allocations triggered by `f` run.
+    Clock::settle();
+
+    return error;
+  };
+
+  auto validate = [&process]() {
+    return process::dispatch(process.self(), [&process]() {
+      return process.validate();
+    });
+  };
+
+  // Recovers all the resources offered to the framework.
+  auto recover = [&process, &offered](const FrameworkID& frameworkId) {
+    foreachpair (const SlaveID& slaveId,
+                 const Resources& resources,
+                 offered[frameworkId]) {
+      process.recoverResources(frameworkId, slaveId, resources, None());
+    }
+
+    offered.erase(frameworkId);
+  };
+
+  const string QUOTA_ROLE{"quota-role"};
+  const string NO_QUOTA_ROLE{"no-quota-role"};
+
+  Future<Option<string>> error = step([&]() {
+    process.initialize(
+        mesos::allocator::Options(), offerCallback, [](
+            const FrameworkID&,
+            const hashmap<SlaveID, UnavailableResources>&) {});
+
+    process.setQuota(QUOTA_ROLE, createQuota(QUOTA_ROLE, "cpus:4;mem:2048"));
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  SlaveInfo agent1 = createSlaveInfo("cpus:4;mem:2048");
+  SlaveInfo agent2 = createSlaveInfo(
+      "cpus:2;mem:1024;cpus(" + QUOTA_ROLE + "):1;mem(" + QUOTA_ROLE + "):512");
+  SlaveInfo agent3 = createSlaveInfo("cpus:2;mem:1024");
+
+  const vector<SlaveInfo> agents = {agent1, agent2};
+
+  foreach (const SlaveInfo& agent, agents) {
+    error = step([&process, agent]() {
+      process.addSlave(
+          agent.id(),
+          agent,
+          AGENT_CAPABILITIES(),
+          None(),
+          agent.resources(),
+          {});
+    });
+
+    AWAIT_READY(error);
+    EXPECT_NONE(error.get()) << error->get();
+  }
+
+  FrameworkInfo framework1 = createFrameworkInfo({QUOTA_ROLE});
+  FrameworkInfo framework2 = createFrameworkInfo({NO_QUOTA_ROLE});
+
+  const vector<FrameworkInfo> frameworks = {framework1, framework2};
+
+  foreach (const FrameworkInfo& framework, frameworks) {
+    error = step([&process, framework]() {
+      process.addFramework(framework.id(), framework, {}, true, {});
+    });
+
+    AWAIT_READY(error);
+    EXPECT_NONE(error.get()) << error->get();
+  }
+
+  // Both frameworks should have been allocated all the resources.
+  error = validate();
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+  ASSERT_TRUE(offered.contains(framework1.id()));
+
+  // Reserve part of the unreserved resources allocated to the quota
+  // role, which moves them from its unreserved allocation to its
+  // reservations.
+  Resources unreserved = Resources::parse("cpus:1;mem:128").get();
+  unreserved.allocate(QUOTA_ROLE);
+
+  Resources dynamicallyReserved =
+    unreserved.pushReservation(createDynamicReservationInfo(QUOTA_ROLE, "ops"));
+
+  Try<vector<ResourceConversion>> conversions =
+    getResourceConversions(RESERVE(dynamicallyReserved));
+
+  ASSERT_SOME(conversions);
+
+  Option<SlaveID> reservedAgent;
+  foreachpair (const SlaveID& slaveId,
+               const Resources& resources,
+               offered.at(framework1.id())) {
+    if (resources.contains(unreserved)) {
+      reservedAgent = slaveId;
+      break;
+    }
+  }
+
+  ASSERT_SOME(reservedAgent);
+
+  error = step([&]() {
+    Resources& resources = offered[framework1.id()][reservedAgent.get()];
+
+    process.updateAllocation(
+        framework1.id(), reservedAgent.get(), resources, conversions.get());
+
+    resources = CHECK_NOTERROR(resources.apply(conversions.get()));
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Recover the resources of the framework without quota.
+  error = step([&]() { recover(framework2.id()); });
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Add another agent and trigger a batch allocation.
+  error = step([&]() {
+    process.addSlave(
+        agent3.id(),
+        agent3,
+        AGENT_CAPABILITIES(),
+        None(),
+        agent3.resources(),
+        {});
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  Clock::advance(mesos::allocator::Options().allocationInterval);
+  Clock::settle();
+
+  error = validate();
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Remove an agent: its allocations are tracked until they are
+  // recovered.
+  error = step([&]() { process.removeSlave(agent1.id()); });
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  error = step([&]() {
+    foreachkey (const FrameworkID& frameworkId, offered) {
+      if (offered.at(frameworkId).contains(agent1.id())) {
+        process.recoverResources(
+            frameworkId,
+            agent1.id(),
+            offered.at(frameworkId).at(agent1.id()),
+            None());
+
+        offered.at(frameworkId).erase(agent1.id());
+      }
+    }
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Remove the framework without quota, which removes its role.
+  error = step([&]() {
+    recover(framework2.id());
+    process.removeFramework(framework2.id());
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Update the quota to a guarantee which is less than the quota
+  // role's reservations, and then to a larger one.
+  const vector<string> guarantees = {"cpus:1;mem:128", "cpus:8;mem:4096"};
+
+  foreach (const string& guarantee, guarantees) {
+    error = step([&]() {
+      process.removeQuota(QUOTA_ROLE);
+      process.setQuota(QUOTA_ROLE, createQuota(QUOTA_ROLE, guarantee));
+    });
+
+    AWAIT_READY(error);
+    EXPECT_NONE(error.get()) << error->get();
+  }
+
+  error = step([&]() { process.removeQuota(QUOTA_ROLE); });
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  // Set the quota again before the quota role's resources are
+  // recovered and its framework is removed.
+  error = step([&]() {
+    process.setQuota(QUOTA_ROLE, createQuota(QUOTA_ROLE, "cpus:2;mem:1024"));
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  error = step([&]() {
+    recover(framework1.id());
+    process.removeFramework(framework1.id());
+  });
+
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  error = step([&]() { process.removeSlave(agent2.id()); });
+  AWAIT_READY(error);
+  EXPECT_NONE(error.get()) << error->get();
+
+  process::terminate(process);
+  process::wait(process);
+}
+
+
+// This tests that reserved resources are accounted for in the role's quota.
+TEST_F(HierarchicalAllocatorTest, ReservationWithinQuota)
+{
+  // Pausing the clock is not necessary, but ensures that the test
+  // doesn't rely on the batch allocation in the allocator, which
+  // would slow down the test.
+  Clock::pause();
+
+  const string QUOTA_ROLE{"quota-role"};
+  const string NON_QUOTA_ROLE{"non-quota-role"};
+
+  initialize();
+
+  const Quota quota = createQuota(QUOTA_ROLE, "cpus:2;mem:256");
+  allocator->setQuota(QUOTA_ROLE, quota);
+
+  FrameworkInfo framework1 = createFrameworkInfo({QUOTA_ROLE});
+  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+
+  FrameworkInfo framework2 = createFrameworkInfo({NON_QUOTA_ROLE});
+  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+
+  // Process all triggered allocation events.
+  //
+  // NOTE: No allocations happen because there are no resources to allocate.
+  Clock::settle();
+
+  // Some resources on `agent1` are now being used by `framework1` as part
+  // of its role quota. `framework2` will be offered the rest of `agent1`'s
+  // resources since `framework1`'s quota is satisfied, and `framework2` has
+  // no resources.
+  SlaveInfo agent1 = createSlaveInfo("cpus:8;mem(" + QUOTA_ROLE + "):256");
+  allocator->addSlave(
+      agent1.id(),
+      agent1,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent1.resources(),
+      {{framework1.id(),
+        // The `mem` portion is used to test that reserved resources are
+        // accounted for, and the `cpus` portion is allocated to show that
+        // the result of DRF would be different if `mem` was not accounted.
+        allocatedResources(
+            Resources::parse("cpus:2;mem(" + QUOTA_ROLE + "):256").get(),
+            QUOTA_ROLE)}});
+
+  Allocation expected = Allocation(
+      framework2.id(),
+      {{NON_QUOTA_ROLE, {{agent1.id(), Resources::parse("cpus:6").get()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  // Since the reserved resources account towards the quota as well as being
+  // accounted for DRF, we expect these resources to also be allocated to
+  // `framework2`.
+  SlaveInfo agent2 = createSlaveInfo("cpus:4");
+  allocator->addSlave(
+      agent2.id(),
+      agent2,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent2.resources(),
+      {});
+
+  expected = Allocation(
+      framework2.id(),
+      {{NON_QUOTA_ROLE, {{agent2.id(), agent2.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+}
+
+
+// This test checks that when setting aside unallocated resources to
+// ensure that a quota guarantee can be met, we don't use resources
+// that have been reserved for a different role.
+//
+// We setup a scenario with 8 CPUs, where role X has quota for 4 CPUs
+// and role Y has 4 CPUs reserved. All offers are declined; the 4
+// unreserved CPUs should not be offered to role Y.
+TEST_F(HierarchicalAllocatorTest, QuotaSetAsideReservedResources)
 {
   Clock::pause();
 
@@ -4479,6 +5063,174 @@ TEST_F(HierarchicalAllocatorTest, SuppressAndReviveOffers)
 }
 
 
+// This test checks that the allocator records the calls into it when
+// `--allocator_record_path` is set, so that they can be replayed.
+TEST_F(HierarchicalAllocatorTest, RecordCalls)
+{
+  // Pausing the clock ensures that the recording is only written
+  // out by the batch allocation that the test triggers.
+  Clock::pause();
+
+  Try<string> path = os::mktemp();
+  ASSERT_SOME(path);
+
+  master::Flags flags_;
+  flags_.allocator_record_path = path.get();
+
+  initialize(flags_);
+
+  SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  Allocation expected = Allocation(
+      framework.id(),
+      {{"role1", {{agent.id(), agent.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  const Resources recovered = allocatedResources(agent.resources(), "role1");
+
+  allocator->recoverResources(framework.id(), agent.id(), recovered, None());
+
+  Clock::settle();
+  Clock::advance(flags.allocation_interval / 2);
+
+  allocator->suppressOffers(framework.id(), {});
+
+  // Trigger a batch allocation, which writes out the recording.
+  Clock::advance(flags.allocation_interval / 2);
+  Clock::settle();
+
+  Try<int_fd> fd = os::open(path.get(), O_RDONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  vector<AllocatorEvent> events;
+
+  while (true) {
+    Result<AllocatorEvent> event = ::protobuf::read<AllocatorEvent>(fd.get());
+    ASSERT_FALSE(event.isError()) << event.error();
+
+    if (event.isNone()) {
+      break;
+    }
+
+    events.push_back(event.get());
+  }
+
+  os::close(fd.get());
+
+  ASSERT_EQ(5u, events.size());
+
+  EXPECT_EQ(AllocatorEvent::INITIALIZE, events[0].type());
+  EXPECT_EQ(
+      flags.allocation_interval.secs(),
+      events[0].initialize().allocation_interval());
+
+  EXPECT_EQ(AllocatorEvent::ADD_SLAVE, events[1].type());
+  EXPECT_EQ(agent.id(), events[1].slave_id());
+  EXPECT_EQ(agent.resources(), Resources(events[1].add_slave().total()));
+
+  EXPECT_EQ(AllocatorEvent::ADD_FRAMEWORK, events[2].type());
+  EXPECT_EQ(framework.id(), events[2].framework_id());
+  EXPECT_TRUE(events[2].add_framework().active());
+
+  EXPECT_EQ(AllocatorEvent::RECOVER_RESOURCES, events[3].type());
+  EXPECT_EQ(framework.id(), events[3].framework_id());
+  EXPECT_EQ(agent.id(), events[3].slave_id());
+  EXPECT_EQ(
+      recovered,
+      Resources(events[3].recover_resources().resources()));
+
+  EXPECT_EQ(AllocatorEvent::SUPPRESS_OFFERS, events[4].type());
+  EXPECT_EQ(framework.id(), events[4].framework_id());
+
+  // The calls are recorded with the time they were made at.
+  EXPECT_EQ(events[0].timestamp(), events[3].timestamp());
+  EXPECT_NEAR(
+      (flags.allocation_interval / 2).secs(),
+      events[4].timestamp() - events[3].timestamp(),
+      0.001);
+
+  ASSERT_SOME(os::rm(path.get()));
+}
+
+
+// This test checks that the allocator stops recording the calls into
+// it once the recording would exceed `--allocator_record_max_size`,
+// without recording a partial event.
+TEST_F(HierarchicalAllocatorTest, RecordCallsMaxSize)
+{
+  Clock::pause();
+
+  Try<string> path = os::mktemp();
+  ASSERT_SOME(path);
+
+  master::Flags flags_;
+  flags_.allocator_record_path = path.get();
+  flags_.allocator_record_max_size = Bytes(512);
+
+  initialize(flags_);
+
+  const size_t agentCount = 10;
+
+  for (size_t i = 0; i < agentCount; i++) {
+    SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
+    allocator->addSlave(
+        agent.id(),
+        agent,
+        AGENT_CAPABILITIES(),
+        None(),
+        agent.resources(),
+        {});
+  }
+
+  // Trigger a batch allocation, which writes out the recording.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  Try<Bytes> size = os::stat::size(path.get());
+  ASSERT_SOME(size);
+  EXPECT_LE(size.get(), flags_.allocator_record_max_size);
+
+  Try<int_fd> fd = os::open(path.get(), O_RDONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  vector<AllocatorEvent> events;
+
+  while (true) {
+    Result<AllocatorEvent> event = ::protobuf::read<AllocatorEvent>(fd.get());
+    ASSERT_FALSE(event.isError()) << event.error();
+
+    if (event.isNone()) {
+      break;
+    }
+
+    events.push_back(event.get());
+  }
+
+  os::close(fd.get());
+
+  // The recording is a prefix of the calls.
+  ASSERT_FALSE(events.empty());
+  EXPECT_LT(events.size(), agentCount + 1);
+
+  EXPECT_EQ(AllocatorEvent::INITIALIZE, events[0].type());
+
+  for (size_t i = 1; i < events.size(); i++) {
+    EXPECT_EQ(AllocatorEvent::ADD_SLAVE, events[i].type());
+  }
+}
+
+
 // This test checks that total and allocator resources
 // are correctly reflected in the metrics endpoint.
 TEST_F_TEMP_DISABLED_ON_WINDOWS(HierarchicalAllocatorTest, ResourceMetrics)
@@ -4513,94 +5265,288 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(HierarchicalAllocatorTest, ResourceMetrics)
       {"allocator/mesos/resources/disk/offered_or_allocated", 0},
   };
 
-  JSON::Value metrics = Metrics();
+  JSON::Value metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+  Clock::settle();
+
+  // All of the resources should be offered.
+  expected.values = {
+      {"allocator/mesos/resources/cpus/total",   2},
+      {"allocator/mesos/resources/mem/total", 1024},
+      {"allocator/mesos/resources/disk/total",   0},
+      {"allocator/mesos/resources/cpus/offered_or_allocated",   2},
+      {"allocator/mesos/resources/mem/offered_or_allocated", 1024},
+      {"allocator/mesos/resources/disk/offered_or_allocated",   0},
+  };
+
+  metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+
+  allocator->removeSlave(agent.id());
+  Clock::settle();
+
+  // No frameworks are registered yet, so nothing is allocated.
+  expected.values = {
+      {"allocator/mesos/resources/cpus/total", 0},
+      {"allocator/mesos/resources/mem/total",  0},
+      {"allocator/mesos/resources/disk/total", 0},
+      {"allocator/mesos/resources/cpus/offered_or_allocated", 0},
+      {"allocator/mesos/resources/mem/offered_or_allocated",  0},
+      {"allocator/mesos/resources/disk/offered_or_allocated", 0},
+  };
+
+  metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+}
+
+
+// The allocator is not fully initialized until `allocator->initialize(...)`
+// is called (e.g., from `Master::initialize()` or
+// `HierarchicalAllocatorTestBase::initialize(...)`). This test
+// verifies that metrics collection works but returns empty results
+// when the allocator is uninitialized. In reality this can happen if
+// the metrics endpoint is polled before the master is initialized.
+TEST_F(HierarchicalAllocatorTest, ResourceMetricsUninitialized)
+{
+  JSON::Value metrics = Metrics();
+
+  JSON::Object expected;
+
+  // Nothing is added to the allocator or allocated.
+  expected.values = {
+      {"allocator/mesos/resources/cpus/total", 0},
+      {"allocator/mesos/resources/mem/total",  0},
+      {"allocator/mesos/resources/disk/total", 0},
+      {"allocator/mesos/resources/cpus/offered_or_allocated", 0},
+      {"allocator/mesos/resources/mem/offered_or_allocated",  0},
+      {"allocator/mesos/resources/disk/offered_or_allocated", 0},
+  };
+
+  EXPECT_TRUE(metrics.contains(expected));
+}
+
+
+// This test checks that the number of times the allocation
+// algorithm has run is correctly reflected in the metric.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(HierarchicalAllocatorTest, AllocationRunsMetric)
+{
+  // Pausing the clock is not necessary, but ensures that the test
+  // doesn't rely on the batch allocation in the allocator, which
+  // would slow down the test.
+  Clock::pause();
+
+  initialize();
+
+  size_t allocations = 0;
+
+  JSON::Object expected;
+
+  expected.values = { {"allocator/mesos/allocation_runs", allocations} };
+
+  JSON::Value metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+
+  SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  // Wait for the allocation triggered from `addSlave()` to complete.
+  // Otherwise `addFramework()` below may not trigger a new allocation
+  // because the allocator batches them.
+  Clock::settle();
+
+  ++allocations; // Adding an agent triggers allocations.
+
+  FrameworkInfo framework = createFrameworkInfo({"role"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  Clock::settle();
+
+  ++allocations; // Adding a framework triggers allocations.
+
+  // Allocation count is set based on adding an agent and a framework.
+  expected.values = { {"allocator/mesos/allocation_runs", allocations} };
+
+  metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+}
+
+
+// This test checks that with an allocation sweep interval, the periodic
+// allocation only runs if an agent changed since the last allocation,
+// and for all the agents once the sweep interval elapses.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(
+    HierarchicalAllocatorTest,
+    AllocationSweepInterval)
+{
+  Clock::pause();
+
+  master::Flags flags_;
+  flags_.allocation_sweep_interval = flags_.allocation_interval * 10;
+
+  initialize(flags_);
+
+  SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  // Wait for the allocation triggered from `addSlave()` to complete.
+  Clock::settle();
+
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  Allocation expected = Allocation(
+      framework.id(),
+      {{"role1", {{agent.id(), agent.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  // The first periodic allocation allocates from all the agents. The
+  // following ones do not run, since no agent changed.
+  for (int i = 0; i < 6; i++) {
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+  }
+
+  const string metric = "allocator/mesos/allocation_runs";
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(3, metrics.values[metric].as<JSON::Number>().as<int>());
+
+  // The recovered resources are offered by the next periodic allocation.
+  allocator->recoverResources(
+      framework.id(),
+      agent.id(),
+      allocatedResources(agent.resources(), "role1"),
+      None());
+
+  Clock::advance(flags.allocation_interval);
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  metrics = Metrics();
+  EXPECT_EQ(4, metrics.values[metric].as<JSON::Number>().as<int>());
+
+  // The periodic allocation allocates from all the agents once the
+  // sweep interval since the first periodic allocation elapses.
+  for (int i = 0; i < 3; i++) {
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+  }
+
+  metrics = Metrics();
+  EXPECT_EQ(4, metrics.values[metric].as<JSON::Number>().as<int>());
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  metrics = Metrics();
+  EXPECT_EQ(5, metrics.values[metric].as<JSON::Number>().as<int>());
+}
+
+
+// This test checks that with an allocation batch size, an allocation
+// run that spans several batches of agents makes the same allocations
+// as a single batch, and offers them once at the end of the run.
+TEST_F(HierarchicalAllocatorTest, AllocationBatchSize)
+{
+  Clock::pause();
+
+  const string QUOTA_ROLE{"quota-role"};
+  const string NO_QUOTA_ROLE{"no-quota-role"};
 
-  EXPECT_TRUE(metrics.contains(expected));
+  master::Flags flags_;
+  flags_.allocation_batch_size = 1;
 
-  FrameworkInfo framework = createFrameworkInfo({"role1"});
-  allocator->addFramework(framework.id(), framework, {}, true, {});
-  Clock::settle();
+  initialize(flags_);
 
-  // All of the resources should be offered.
-  expected.values = {
-      {"allocator/mesos/resources/cpus/total",   2},
-      {"allocator/mesos/resources/mem/total", 1024},
-      {"allocator/mesos/resources/disk/total",   0},
-      {"allocator/mesos/resources/cpus/offered_or_allocated",   2},
-      {"allocator/mesos/resources/mem/offered_or_allocated", 1024},
-      {"allocator/mesos/resources/disk/offered_or_allocated",   0},
-  };
+  vector<SlaveInfo> agents;
+  for (int i = 0; i < 4; i++) {
+    SlaveInfo agent = createSlaveInfo("cpus:1;mem:512;disk:0");
+    allocator->addSlave(
+        agent.id(),
+        agent,
+        AGENT_CAPABILITIES(),
+        None(),
+        agent.resources(),
+        {});
 
-  metrics = Metrics();
+    agents.push_back(agent);
+  }
 
-  EXPECT_TRUE(metrics.contains(expected));
+  const Quota quota = createQuota(QUOTA_ROLE, "cpus:1;mem:512");
+  allocator->setQuota(QUOTA_ROLE, quota);
 
-  allocator->removeSlave(agent.id());
+  // Process all triggered allocation events.
+  //
+  // NOTE: No allocations happen because there are no frameworks.
   Clock::settle();
 
-  // No frameworks are registered yet, so nothing is allocated.
-  expected.values = {
-      {"allocator/mesos/resources/cpus/total", 0},
-      {"allocator/mesos/resources/mem/total",  0},
-      {"allocator/mesos/resources/disk/total", 0},
-      {"allocator/mesos/resources/cpus/offered_or_allocated", 0},
-      {"allocator/mesos/resources/mem/offered_or_allocated",  0},
-      {"allocator/mesos/resources/disk/offered_or_allocated", 0},
-  };
+  // NOTE: A single framework triggers a single allocation run.
+  FrameworkInfo framework = createFrameworkInfo({QUOTA_ROLE, NO_QUOTA_ROLE});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
 
-  metrics = Metrics();
+  // The framework is offered one of the agents for its quota role in
+  // the first stage, and the others for its other role in the second
+  // stage, in a single offer.
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_READY(allocation);
 
-  EXPECT_TRUE(metrics.contains(expected));
-}
+  EXPECT_EQ(framework.id(), allocation->frameworkId);
+  ASSERT_TRUE(allocation->resources.contains(QUOTA_ROLE));
+  ASSERT_TRUE(allocation->resources.contains(NO_QUOTA_ROLE));
 
+  const hashmap<SlaveID, Resources>& quotaAllocation =
+    allocation->resources.at(QUOTA_ROLE);
+  const hashmap<SlaveID, Resources>& noQuotaAllocation =
+    allocation->resources.at(NO_QUOTA_ROLE);
 
-// The allocator is not fully initialized until `allocator->initialize(...)`
-// is called (e.g., from `Master::initialize()` or
-// `HierarchicalAllocatorTestBase::initialize(...)`). This test
-// verifies that metrics collection works but returns empty results
-// when the allocator is uninitialized. In reality this can happen if
-// the metrics endpoint is polled before the master is initialized.
-TEST_F(HierarchicalAllocatorTest, ResourceMetricsUninitialized)
-{
-  JSON::Value metrics = Metrics();
+  EXPECT_EQ(1u, quotaAllocation.size());
+  EXPECT_EQ(3u, noQuotaAllocation.size());
 
-  JSON::Object expected;
+  foreach (const SlaveInfo& agent, agents) {
+    EXPECT_NE(
+        quotaAllocation.contains(agent.id()),
+        noQuotaAllocation.contains(agent.id()));
+  }
 
-  // Nothing is added to the allocator or allocated.
-  expected.values = {
-      {"allocator/mesos/resources/cpus/total", 0},
-      {"allocator/mesos/resources/mem/total",  0},
-      {"allocator/mesos/resources/disk/total", 0},
-      {"allocator/mesos/resources/cpus/offered_or_allocated", 0},
-      {"allocator/mesos/resources/mem/offered_or_allocated",  0},
-      {"allocator/mesos/resources/disk/offered_or_allocated", 0},
-  };
+  // There are no more allocations.
+  allocation = allocations.get();
 
-  EXPECT_TRUE(metrics.contains(expected));
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  EXPECT_TRUE(allocation.isPending());
 }
 
 
-// This test checks that the number of times the allocation
-// algorithm has run is correctly reflected in the metric.
-TEST_F_TEMP_DISABLED_ON_WINDOWS(HierarchicalAllocatorTest, AllocationRunsMetric)
+// This test checks that the allocator profiles its allocation runs,
+// and exposes the profiles on its `/profile` endpoint.
+TEST_F(HierarchicalAllocatorTest, AllocationProfile)
 {
-  // Pausing the clock is not necessary, but ensures that the test
-  // doesn't rely on the batch allocation in the allocator, which
-  // would slow down the test.
   Clock::pause();
 
   initialize();
 
-  size_t allocations = 0;
-
-  JSON::Object expected;
-
-  expected.values = { {"allocator/mesos/allocation_runs", allocations} };
-
-  JSON::Value metrics = Metrics();
-
-  EXPECT_TRUE(metrics.contains(expected));
-
   SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
   allocator->addSlave(
       agent.id(),
@@ -4610,26 +5556,77 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(HierarchicalAllocatorTest, AllocationRunsMetric)
       agent.resources(),
       {});
 
-  // Wait for the allocation triggered from `addSlave()` to complete.
-  // Otherwise `addFramework()` below may not trigger a new allocation
-  // because the allocator batches them.
-  Clock::settle();
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
 
-  ++allocations; // Adding an agent triggers allocations.
+  Allocation expected = Allocation(
+      framework.id(),
+      {{"role1", {{agent.id(), agent.resources()}}}});
 
-  FrameworkInfo framework = createFrameworkInfo({"role"});
-  allocator->addFramework(framework.id(), framework, {}, true, {});
+  AWAIT_EXPECT_EQ(expected, allocations.get());
 
+  // Wait for the allocation run to complete.
   Clock::settle();
 
-  ++allocations; // Adding a framework triggers allocations.
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(1u, metrics.values.count(
+      "allocator/mesos/allocation_run/non_quota_stage_ms"));
+  EXPECT_EQ(1u, metrics.values.count(
+      "allocator/mesos/allocation_run/offer_callback_ms"));
 
-  // Allocation count is set based on adding an agent and a framework.
-  expected.values = { {"allocator/mesos/allocation_runs", allocations} };
+  // Look up the allocator process to query its endpoint.
+  Future<process::http::Response> response =
+    process::http::get(UPID("__processes__", process::address()));
 
-  metrics = Metrics();
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
 
-  EXPECT_TRUE(metrics.contains(expected));
+  Try<JSON::Array> processes = JSON::parse<JSON::Array>(response->body);
+  ASSERT_SOME(processes);
+
+  Option<string> id;
+  foreach (const JSON::Value& value, processes->values) {
+    Result<JSON::String> id_ = value.as<JSON::Object>().at<JSON::String>("id");
+    ASSERT_SOME(id_);
+
+    if (strings::startsWith(id_->value, "hierarchical-allocator")) {
+      id = id_->value;
+    }
+  }
+
+  ASSERT_SOME(id);
+
+  response = process::http::get(
+      UPID(id.get(), process::address()), "profile", "limit=1");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  Try<JSON::Object> profile = JSON::parse<JSON::Object>(response->body);
+  ASSERT_SOME(profile);
+
+  Result<JSON::Array> runs = profile->at<JSON::Array>("allocation_runs");
+  ASSERT_SOME(runs);
+  ASSERT_EQ(1u, runs->values.size());
+
+  // The most recent run is the one that allocated the agent to the
+  // framework.
+  const JSON::Object& run = runs->values[0].as<JSON::Object>();
+
+  EXPECT_SOME_EQ(JSON::Number(1), run.at<JSON::Number>("agents"));
+  EXPECT_SOME_EQ(JSON::Number(1), run.at<JSON::Number>("batches"));
+  EXPECT_SOME_EQ(
+      JSON::Number(1), run.find<JSON::Number>("non_quota_stage.agents"));
+  EXPECT_SOME_EQ(
+      JSON::Number(1), run.find<JSON::Number>("non_quota_stage.frameworks"));
+  EXPECT_SOME_EQ(JSON::Number(1), run.at<JSON::Number>("frameworks_offered"));
+  EXPECT_SOME_EQ(JSON::Number(1), run.at<JSON::Number>("offers"));
+  EXPECT_SOME(run.find<JSON::Number>("steps_ms.filter_checks"));
+  EXPECT_SOME(run.at<JSON::Number>("total_ms"));
+
+  response = process::http::get(
+      UPID(id.get(), process::address()), "profile", "limit=foo");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::BadRequest().status, response);
 }
 
 
@@ -6086,6 +7083,136 @@ TEST_P(HierarchicalAllocatorTestWithParam, AllocateSharedResources)
 }
 
 
+class HierarchicalAllocatorTestWithOfferFilterParallelism
+  : public HierarchicalAllocatorTestBase,
+    public WithParamInterface<size_t> {};
+
+
+// The HierarchicalAllocatorTestWithOfferFilterParallelism tests are
+// parameterized by the number of threads used to evaluate the offer
+// filters, see `--offer_filter_parallelism`.
+INSTANTIATE_TEST_CASE_P(
+    OfferFilterParallelism,
+    HierarchicalAllocatorTestWithOfferFilterParallelism,
+    ::testing::Values(1U, 4U));
+
+
+// This test ensures that the offer filters decline the same resources
+// whether they are evaluated during the allocation or beforehand, in
+// parallel for shards of the agents. This includes filters which only
+// decline part of an agent's resources, and roles whose frameworks
+// are all filtered.
+TEST_P(HierarchicalAllocatorTestWithOfferFilterParallelism, OfferFilters)
+{
+  Clock::pause();
+
+  master::Flags flags_;
+  flags_.offer_filter_parallelism = GetParam();
+
+  initialize(flags_);
+
+  // There must be enough agents for the offer filters to be evaluated
+  // by several threads.
+  const size_t agentCount = 256;
+
+  vector<SlaveInfo> agents;
+
+  for (size_t i = 0; i < agentCount; i++) {
+    SlaveInfo agent = createSlaveInfo("cpus:1;mem:512;disk:0");
+    agents.push_back(agent);
+
+    allocator->addSlave(
+        agent.id(),
+        agent,
+        AGENT_CAPABILITIES(),
+        None(),
+        agent.resources(),
+        {});
+  }
+
+  FrameworkInfo framework1 = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+
+  // `framework1` is offered all the agents, since it is the only
+  // framework in the cluster.
+  hashmap<SlaveID, Resources> expected;
+  foreach (const SlaveInfo& agent, agents) {
+    expected[agent.id()] = agent.resources();
+  }
+
+  AWAIT_EXPECT_EQ(
+      Allocation(framework1.id(), {{"role1", expected}}),
+      allocations.get());
+
+  // `framework1` declines all the resources. It filters all the
+  // resources of every fourth agent and only part of the resources
+  // of the agents after the next ones, which does not decline the
+  // whole agents.
+  Filters filter;
+  filter.set_refuse_seconds(Days(1).secs());
+
+  const Resources part =
+    allocatedResources(Resources::parse("cpus:1;mem:256").get(), "role1");
+
+  expected.clear();
+
+  for (size_t i = 0; i < agentCount; i++) {
+    const SlaveInfo& agent = agents[i];
+
+    const Resources resources =
+      allocatedResources(agent.resources(), "role1");
+
+    if (i % 4 == 0) {
+      allocator->recoverResources(
+          framework1.id(), agent.id(), resources, filter);
+    } else if (i % 4 == 2) {
+      allocator->recoverResources(
+          framework1.id(), agent.id(), part, filter);
+      allocator->recoverResources(
+          framework1.id(), agent.id(), resources - part, None());
+
+      expected[agent.id()] = agent.resources();
+    } else {
+      allocator->recoverResources(
+          framework1.id(), agent.id(), resources, None());
+
+      expected[agent.id()] = agent.resources();
+    }
+  }
+
+  // Trigger a batch allocation.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  AWAIT_EXPECT_EQ(
+      Allocation(framework1.id(), {{"role1", expected}}),
+      allocations.get());
+
+  // A framework in another role is offered the agents which
+  // `framework1` filtered, since all the frameworks of "role1"
+  // are filtered for these agents.
+  FrameworkInfo framework2 = createFrameworkInfo({"role2"});
+  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+
+  expected.clear();
+
+  for (size_t i = 0; i < agentCount; i += 4) {
+    expected[agents[i].id()] = agents[i].resources();
+  }
+
+  AWAIT_EXPECT_EQ(
+      Allocation(framework2.id(), {{"role2", expected}}),
+      allocations.get());
+
+  // Nothing else is offered.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  Future<Allocation> allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+}
+
+
 // Resource sharing types used for the PersistentVolumes benchmark test:
 //
 // 1. `REGULAR` uses no shared resources.
@@ -6585,6 +7712,121 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, DeclineOffers)
 }
 
 
+// This benchmark measures the allocation cycles of `DeclineOffers` for
+// different values of `--offer_filter_parallelism`. As the frameworks
+// permanently decline the offers, more and more of the frameworks no
+// longer need to be considered for each agent.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, ParallelDeclineOffers)
+{
+  size_t slaveCount = std::get<0>(GetParam());
+  size_t frameworkCount = std::get<1>(GetParam());
+
+  // The number of allocation cycles to measure.
+  const size_t rounds = 20;
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  struct OfferedResources
+  {
+    FrameworkID   frameworkId;
+    SlaveID       slaveId;
+    Resources     resources;
+  };
+
+  vector<OfferedResources> offers;
+
+  auto offerCallback = [&offers](
+      const FrameworkID& frameworkId,
+      const hashmap<string, hashmap<SlaveID, Resources>>& resources_)
+  {
+    foreachkey (const string& role, resources_) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   resources_.at(role)) {
+        offers.push_back(OfferedResources{frameworkId, slaveId, resources});
+      }
+    }
+  };
+
+  cout << "Using " << slaveCount << " agents and "
+       << frameworkCount << " frameworks" << endl;
+
+  const Resources agentResources = Resources::parse(
+      "cpus:24;mem:4096;disk:4096;ports:[31000-32000]").get();
+
+  foreach (size_t parallelism, vector<size_t>({1u, 2u, 4u, 8u})) {
+    // Start each measurement with a fresh allocator.
+    delete allocator;
+    allocator = createAllocator<HierarchicalDRFAllocator>();
+
+    offers.clear();
+
+    master::Flags flags;
+    flags.offer_filter_parallelism = parallelism;
+
+    initialize(flags, offerCallback);
+
+    for (size_t i = 0; i < frameworkCount; i++) {
+      FrameworkInfo framework = createFrameworkInfo({"*"});
+      allocator->addFramework(framework.id(), framework, {}, true, {});
+    }
+
+    for (size_t i = 0; i < slaveCount; i++) {
+      SlaveInfo slave = createSlaveInfo(agentResources);
+
+      allocator->addSlave(
+          slave.id(),
+          slave,
+          AGENT_CAPABILITIES(),
+          None(),
+          slave.resources(),
+          {});
+    }
+
+    // Wait for all the `addFramework` and `addSlave` operations
+    // to be processed.
+    Clock::settle();
+
+    Duration elapsed;
+    size_t offerCount = 0;
+
+    for (size_t i = 0; i < rounds; i++) {
+      // Permanently decline any offered resources.
+      foreach (const OfferedResources& offer, offers) {
+        Filters filters;
+
+        filters.set_refuse_seconds(INT_MAX);
+        allocator->recoverResources(
+            offer.frameworkId, offer.slaveId, offer.resources, filters);
+      }
+
+      // Wait for the declined offers.
+      Clock::settle();
+      offers.clear();
+
+      Stopwatch watch;
+      watch.start();
+
+      // Advance the clock and trigger a background allocation cycle.
+      Clock::advance(flags.allocation_interval);
+      Clock::settle();
+
+      watch.stop();
+
+      elapsed += watch.elapsed();
+      offerCount += offers.size();
+    }
+
+    cout << rounds << " allocation cycles with an offer filter parallelism"
+         << " of " << parallelism << " took " << elapsed
+         << " to make " << offerCount << " offers" << endl;
+  }
+
+  Clock::resume();
+}
+
+
 // Returns the requested number of labels:
 //   [{"<key>_1": "<value>_1"}, ..., {"<key>_<count>":"<value>_<count>"}]
 static Labels createLabels(
@@ -16,6 +16,7 @@
 
 #include <unistd.h>
 
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -43,12 +44,15 @@
 #include <stout/net.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/recordio.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 
 #include "common/build.hpp"
 #include "common/protobuf_utils.hpp"
 
+#include "internal/devolve.hpp"
+
 #include "master/flags.hpp"
 #include "master/master.hpp"
 #include "master/metrics.hpp"
@@ -70,6 +74,7 @@
 
 #include "slave/containerizer/mesos/containerizer.hpp"
 
+#include "tests/allocator.hpp"
 #include "tests/containerizer.hpp"
 #include "tests/limiter.hpp"
 #include "tests/mesos.hpp"
@@ -104,6 +109,7 @@ using process::Message;
 using process::Owned;
 using process::PID;
 using process::Promise;
+using process::Time;
 
 using process::http::Accepted;
 using process::http::OK;
@@ -4546,6 +4552,187 @@ TEST_F(MasterTest, OfferNotRescindedOnceDeclined)
 }
 
 
+// This test verifies that when the offers which were made together
+// time out, only those which are still outstanding are rescinded.
+TEST_F(MasterTest, OfferTimeoutPartiallyUsedBatch)
+{
+  Clock::pause();
+
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.offer_timeout = Seconds(30);
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  // Register two agents, so that they are offered together.
+  slave::Flags agentFlags1 = CreateSlaveFlags();
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage1 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<Owned<cluster::Slave>> slave1 = StartSlave(detector.get(), agentFlags1);
+  ASSERT_SOME(slave1);
+
+  Clock::advance(agentFlags1.registration_backoff_factor);
+  AWAIT_READY(slaveRegisteredMessage1);
+
+  slave::Flags agentFlags2 = CreateSlaveFlags();
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage2 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<Owned<cluster::Slave>> slave2 = StartSlave(detector.get(), agentFlags2);
+  ASSERT_SOME(slave2);
+
+  Clock::advance(agentFlags2.registration_backoff_factor);
+  AWAIT_READY(slaveRegisteredMessage2);
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, frameworkInfo, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  FrameworkID frameworkId;
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .WillOnce(SaveArg<1>(&frameworkId));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  Clock::advance(masterFlags.allocation_interval);
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(2u, offers->size());
+
+  // Use the first offer, with a filter so that its resources are not
+  // offered again.
+  Filters filters;
+  filters.set_refuse_seconds(Days(1).secs());
+
+  Future<Nothing> recoverResources =
+    FUTURE_DISPATCH(_, &MesosAllocatorProcess::recoverResources);
+
+  driver.acceptOffers({offers.get()[0].id()}, {}, filters);
+
+  AWAIT_READY(recoverResources);
+
+  // Only the second offer is expected to be rescinded.
+  Future<Nothing> offerRescinded;
+  EXPECT_CALL(sched, offerRescinded(&driver, offers.get()[1].id()))
+    .WillOnce(FutureSatisfy(&offerRescinded));
+
+  Clock::advance(masterFlags.offer_timeout.get());
+  Clock::settle();
+
+  AWAIT_READY(offerRescinded);
+
+  JSON::Object metrics = Metrics();
+
+  frameworkInfo.mutable_id()->CopyFrom(frameworkId);
+
+  const string prefix = master::getFrameworkMetricPrefix(frameworkInfo);
+
+  EXPECT_EQ(1, metrics.values[prefix + "offers/rescinded"]);
+  EXPECT_EQ(1, metrics.values[prefix + "events/rescind"]);
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This test verifies that an offer does not time out together with
+// the offers made before it.
+TEST_F(MasterTest, OfferTimeoutLaterOffer)
+{
+  Clock::pause();
+
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.offer_timeout = Seconds(30);
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  slave::Flags agentFlags1 = CreateSlaveFlags();
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage1 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<Owned<cluster::Slave>> slave1 = StartSlave(detector.get(), agentFlags1);
+  ASSERT_SOME(slave1);
+
+  Clock::advance(agentFlags1.registration_backoff_factor);
+  AWAIT_READY(slaveRegisteredMessage1);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers1;
+  Future<vector<Offer>> offers2;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers1))
+    .WillOnce(FutureArg<1>(&offers2))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  Clock::advance(masterFlags.allocation_interval);
+
+  AWAIT_READY(offers1);
+  ASSERT_EQ(1u, offers1->size());
+
+  const Time offered1 = Clock::now();
+
+  // Register another agent halfway through the offer timeout, so
+  // that it is offered later.
+  Clock::advance(masterFlags.offer_timeout.get() / 2);
+
+  slave::Flags agentFlags2 = CreateSlaveFlags();
+
+  Try<Owned<cluster::Slave>> slave2 = StartSlave(detector.get(), agentFlags2);
+  ASSERT_SOME(slave2);
+
+  Clock::advance(agentFlags2.registration_backoff_factor);
+
+  AWAIT_READY(offers2);
+  ASSERT_EQ(1u, offers2->size());
+
+  const Time offered2 = Clock::now();
+
+  Future<Nothing> offerRescinded1;
+  EXPECT_CALL(sched, offerRescinded(&driver, offers1.get()[0].id()))
+    .WillOnce(FutureSatisfy(&offerRescinded1));
+
+  Future<Nothing> offerRescinded2;
+  EXPECT_CALL(sched, offerRescinded(&driver, offers2.get()[0].id()))
+    .WillOnce(FutureSatisfy(&offerRescinded2));
+
+  // Only the first offer is rescinded once it times out.
+  Clock::advance(offered1 + masterFlags.offer_timeout.get() - Clock::now());
+  Clock::settle();
+
+  AWAIT_READY(offerRescinded1);
+  EXPECT_TRUE(offerRescinded2.isPending());
+
+  Clock::advance(offered2 + masterFlags.offer_timeout.get() - Clock::now());
+  Clock::settle();
+
+  AWAIT_READY(offerRescinded2);
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test ensures that the master releases resources for tasks
 // when they terminate, even if no acknowledgements occur.
 TEST_F(MasterTest, UnacknowledgedTerminalTask)
@@ -4808,8 +4995,10 @@ TEST_F(MasterTest, StateEndpoint)
 
   JSON::Value masterCapabilities = state.values.at("capabilities");
 
-  // Master should always have the AGENT_UPDATE capability
-  Try<JSON::Value> expectedCapabilities = JSON::parse("[\"AGENT_UPDATE\"]");
+  // Master should always have the AGENT_UPDATE and the
+  // BATCHED_STATUS_UPDATES capabilities.
+  Try<JSON::Value> expectedCapabilities =
+    JSON::parse("[\"AGENT_UPDATE\", \"BATCHED_STATUS_UPDATES\"]");
 
   ASSERT_SOME(expectedCapabilities);
   EXPECT_TRUE(masterCapabilities.contains(expectedCapabilities.get()));
@@ -5041,15 +5230,16 @@ TEST_F(MasterTest, StateSummaryEndpoint)
 }
 
 
-// This ensures that agent capabilities are included in
-// the response of master's /state endpoint.
-TEST_F(MasterTest, StateEndpointAgentCapabilities)
+// This ensures that identical read-only requests which are processed
+// in the same batch get identical responses, while requests that only
+// differ in their query parameters are still answered individually.
+TEST_F(MasterTest, StateEndpointIdenticalRequests)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
   ASSERT_SOME(master);
 
   Future<SlaveRegisteredMessage> slaveRegisteredMessage =
-    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get()->pid, _);
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
 
   Owned<MasterDetector> detector = master.get()->createDetector();
   Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
@@ -5057,47 +5247,40 @@ TEST_F(MasterTest, StateEndpointAgentCapabilities)
 
   AWAIT_READY(slaveRegisteredMessage);
 
-  Future<Response> response = process::http::get(
+  vector<Future<Response>> responses;
+  for (int i = 0; i < 3; i++) {
+    responses.push_back(process::http::get(
+        master.get()->pid,
+        "state",
+        None(),
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL)));
+  }
+
+  Future<Response> jsonp = process::http::get(
       master.get()->pid,
       "state",
-      None(),
+      "jsonp=callback",
       createBasicAuthHeaders(DEFAULT_CREDENTIAL));
 
-  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
-
-  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
-  ASSERT_SOME(parse);
-
-  Result<JSON::Array> slaveArray = parse->find<JSON::Array>("slaves");
-  ASSERT_SOME(slaveArray);
-  ASSERT_EQ(1u, slaveArray->values.size());
-
-  JSON::Object slaveInfo = slaveArray->values[0].as<JSON::Object>();
+  foreach (const Future<Response>& response, responses) {
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
 
-  ASSERT_EQ(1u, slaveInfo.values.count("capabilities"));
-  JSON::Value slaveCapabilities = slaveInfo.values.at("capabilities");
+    Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
+    ASSERT_SOME(parse);
 
-  // Agents should have the following capabilities in the current
-  // implementation.
-  Try<JSON::Value> expectedCapabilities = JSON::parse(
-    R"~(
-      [
-        "MULTI_ROLE",
-        "HIERARCHICAL_ROLE",
-        "RESERVATION_REFINEMENT",
-        "RESOURCE_PROVIDER",
-        "RESIZE_VOLUME"
-      ]
-    )~");
+    EXPECT_SOME_EQ(1u, parse->find<JSON::Number>("activated_slaves"));
+    EXPECT_EQ(responses[0]->body, response->body);
+  }
 
-  ASSERT_SOME(expectedCapabilities);
-  EXPECT_TRUE(slaveCapabilities.contains(expectedCapabilities.get()));
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, jsonp);
+  EXPECT_TRUE(strings::startsWith(jsonp->body, "callback("));
 }
 
 
-// This ensures allocation role of task and its executor is exposed
-// in master's /state endpoint.
-TEST_F(MasterTest, StateEndpointAllocationRole)
+// This ensures that the /state endpoint reflects the status updates
+// of a task after its JSON representation has been cached, both while
+// the task is active and once it has completed.
+TEST_F(MasterTest, StateEndpointTaskUpdates)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
   ASSERT_SOME(master);
@@ -5109,16 +5292,17 @@ TEST_F(MasterTest, StateEndpointAllocationRole)
   Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
   ASSERT_SOME(slave);
 
-  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
-  frameworkInfo.set_roles(0, "foo");
-
+  // The status updates are acknowledged explicitly, so that we can
+  // wait for the master to remove the task once it is killed.
   MockScheduler sched;
   MesosSchedulerDriver driver(
-      &sched, frameworkInfo, master.get()->pid, DEFAULT_CREDENTIAL);
+      &sched,
+      DEFAULT_FRAMEWORK_INFO,
+      master.get()->pid,
+      false,
+      DEFAULT_CREDENTIAL);
 
-  Future<Nothing> registered;
-  EXPECT_CALL(sched, registered(&driver, _, _))
-    .WillOnce(FutureSatisfy(&registered));
+  EXPECT_CALL(sched, registered(&driver, _, _));
 
   Future<vector<Offer>> offers;
   EXPECT_CALL(sched, resourceOffers(&driver, _))
@@ -5127,54 +5311,625 @@ TEST_F(MasterTest, StateEndpointAllocationRole)
 
   driver.start();
 
-  AWAIT_READY(registered);
   AWAIT_READY(offers);
   ASSERT_FALSE(offers->empty());
 
-  Resources executorResources = Resources::parse("cpus:0.1;mem:32").get();
-  executorResources.allocate("foo");
+  TaskInfo task = createTask(offers.get()[0], "", DEFAULT_EXECUTOR_ID);
 
-  TaskID taskId;
-  taskId.set_value("1");
+  ExecutorDriver* execDriver;
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .WillOnce(SaveArg<0>(&execDriver));
 
-  TaskInfo taskInfo;
-  taskInfo.set_name("");
-  taskInfo.mutable_task_id()->MergeFrom(taskId);
-  taskInfo.mutable_slave_id()->MergeFrom(offers.get()[0].slave_id());
-  taskInfo.mutable_resources()->MergeFrom(
-      Resources(offers.get()[0].resources()) - executorResources);
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_STARTING));
 
-  taskInfo.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
-  taskInfo.mutable_executor()->mutable_resources()->CopyFrom(executorResources);
+  Future<TaskStatus> startingStatus;
+  Future<TaskStatus> runningStatus;
+  Future<TaskStatus> killedStatus;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&startingStatus))
+    .WillOnce(FutureArg<1>(&runningStatus))
+    .WillOnce(FutureArg<1>(&killedStatus));
 
-  EXPECT_CALL(exec, registered(_, _, _, _));
+  driver.launchTasks(offers.get()[0].id(), {task});
 
-  EXPECT_CALL(exec, launchTask(_, _))
-    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+  AWAIT_READY(startingStatus);
+  EXPECT_EQ(TASK_STARTING, startingStatus->state());
 
-  Future<TaskStatus> status;
-  EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillOnce(FutureArg<1>(&status));
+  auto state = [&master]() {
+    Future<Response> response = process::http::get(
+        master.get()->pid,
+        "state",
+        None(),
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
 
-  driver.launchTasks(offers.get()[0].id(), {taskInfo});
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
 
-  AWAIT_READY(status);
-  EXPECT_EQ(TASK_RUNNING, status->state());
+    return JSON::parse<JSON::Object>(response->body);
+  };
 
-  Future<Response> response = process::http::get(
-      master.get()->pid,
-      "state",
-      None(),
-      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+  // This request caches the JSON representation of the task.
+  Try<JSON::Object> parse = state();
+  ASSERT_SOME(parse);
 
-  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  EXPECT_SOME_EQ(
+      JSON::String("TASK_STARTING"),
+      parse->find<JSON::String>("frameworks[0].tasks[0].state"));
 
-  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
+  driver.acknowledgeStatusUpdate(startingStatus.get());
+
+  TaskStatus status;
+  status.mutable_task_id()->CopyFrom(task.task_id());
+  status.set_state(TASK_RUNNING);
+
+  execDriver->sendStatusUpdate(status);
+
+  AWAIT_READY(runningStatus);
+  EXPECT_EQ(TASK_RUNNING, runningStatus->state());
+
+  parse = state();
   ASSERT_SOME(parse);
 
-  JSON::Value result = parse.get();
+  EXPECT_SOME_EQ(
+      JSON::String("TASK_RUNNING"),
+      parse->find<JSON::String>("frameworks[0].tasks[0].state"));
 
-  JSON::Object expected = {
+  Result<JSON::Array> statuses =
+    parse->find<JSON::Array>("frameworks[0].tasks[0].statuses");
+  ASSERT_SOME(statuses);
+  EXPECT_EQ(2u, statuses->values.size());
+
+  driver.acknowledgeStatusUpdate(runningStatus.get());
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillOnce(SendStatusUpdateFromTaskID(TASK_KILLED));
+
+  driver.killTask(task.task_id());
+
+  AWAIT_READY(killedStatus);
+  EXPECT_EQ(TASK_KILLED, killedStatus->state());
+
+  // The master removes the task once the terminal status update is
+  // acknowledged.
+  Future<mesos::scheduler::Call> acknowledgement = FUTURE_CALL(
+      mesos::scheduler::Call(),
+      mesos::scheduler::Call::ACKNOWLEDGE,
+      _,
+      master.get()->pid);
+
+  driver.acknowledgeStatusUpdate(killedStatus.get());
+
+  AWAIT_READY(acknowledgement);
+
+  parse = state();
+  ASSERT_SOME(parse);
+
+  EXPECT_SOME_EQ(
+      JSON::Array(),
+      parse->find<JSON::Array>("frameworks[0].tasks"));
+
+  EXPECT_SOME_EQ(
+      JSON::String("TASK_KILLED"),
+      parse->find<JSON::String>("frameworks[0].completed_tasks[0].state"));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This ensures that the /state endpoint only includes the agents
+// which changed since the cursor passed as `since`, and that it
+// returns the whole state for unknown cursors.
+TEST_F(MasterTest, StateEndpointSince)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage1 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  // The agent updates its resources after it registered.
+  Future<UpdateSlaveMessage> updateSlaveMessage =
+    FUTURE_PROTOBUF(UpdateSlaveMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave1 = StartSlave(detector.get());
+  ASSERT_SOME(slave1);
+
+  AWAIT_READY(slaveRegisteredMessage1);
+  AWAIT_READY(updateSlaveMessage);
+
+  auto state = [&master](const Option<string>& query) {
+    Future<Response> response = process::http::get(
+        master.get()->pid,
+        "state",
+        query,
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    return JSON::parse<JSON::Object>(response->body);
+  };
+
+  Try<JSON::Object> full = state(None());
+  ASSERT_SOME(full);
+
+  Result<JSON::String> cursor = full->find<JSON::String>("cursor");
+  ASSERT_SOME(cursor);
+  EXPECT_NONE(full->find<JSON::String>("since"));
+
+  // Nothing changed since the cursor.
+  Try<JSON::Object> changes = state("since=" + cursor->value);
+  ASSERT_SOME(changes);
+
+  EXPECT_SOME_EQ(cursor.get(), changes->find<JSON::String>("since"));
+  EXPECT_SOME_EQ(JSON::Array(), changes->find<JSON::Array>("slaves"));
+  EXPECT_SOME_EQ(JSON::Array(), changes->find<JSON::Array>("removed_slaves"));
+
+  // Only the new agent is included.
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage2 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  slave::Flags slaveFlags = CreateSlaveFlags();
+  Try<Owned<cluster::Slave>> slave2 = StartSlave(detector.get(), slaveFlags);
+  ASSERT_SOME(slave2);
+
+  AWAIT_READY(slaveRegisteredMessage2);
+
+  changes = state("since=" + cursor->value);
+  ASSERT_SOME(changes);
+
+  Result<JSON::Array> slaves = changes->find<JSON::Array>("slaves");
+  ASSERT_SOME(slaves);
+  ASSERT_EQ(1u, slaves->values.size());
+
+  EXPECT_SOME_EQ(
+      slaveRegisteredMessage2->slave_id().value(),
+      changes->find<JSON::String>("slaves[0].id"));
+
+  // The whole state is returned for unknown cursors.
+  changes = state("since=unknown:0");
+  ASSERT_SOME(changes);
+
+  EXPECT_NONE(changes->find<JSON::String>("since"));
+
+  slaves = changes->find<JSON::Array>("slaves");
+  ASSERT_SOME(slaves);
+  EXPECT_EQ(2u, slaves->values.size());
+}
+
+
+// This ensures that the /state endpoint includes the task changes since
+// the cursor passed as `since`, and lists the completed tasks which were
+// evicted since then.
+TEST_F(MasterTest, StateEndpointSinceTasks)
+{
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.max_completed_tasks_per_framework = 1;
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  // The status updates are acknowledged explicitly, so that we can
+  // wait for the master to complete the killed tasks.
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched,
+      DEFAULT_FRAMEWORK_INFO,
+      master.get()->pid,
+      false,
+      DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers1;
+  Future<vector<Offer>> offers2;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers1))
+    .WillOnce(FutureArg<1>(&offers2))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillRepeatedly(SendStatusUpdateFromTaskID(TASK_KILLED));
+
+  Future<TaskStatus> runningStatus1;
+  Future<TaskStatus> killedStatus1;
+  Future<TaskStatus> runningStatus2;
+  Future<TaskStatus> killedStatus2;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&runningStatus1))
+    .WillOnce(FutureArg<1>(&killedStatus1))
+    .WillOnce(FutureArg<1>(&runningStatus2))
+    .WillOnce(FutureArg<1>(&killedStatus2));
+
+  driver.start();
+
+  AWAIT_READY(offers1);
+  ASSERT_FALSE(offers1->empty());
+
+  auto state = [&master](const Option<string>& query) {
+    Future<Response> response = process::http::get(
+        master.get()->pid,
+        "state",
+        query,
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    return JSON::parse<JSON::Object>(response->body);
+  };
+
+  Try<JSON::Object> full = state(None());
+  ASSERT_SOME(full);
+
+  Result<JSON::String> cursor = full->find<JSON::String>("cursor");
+  ASSERT_SOME(cursor);
+
+  // The first task completes.
+  TaskInfo task1 = createTask(offers1.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  driver.launchTasks(offers1.get()[0].id(), {task1});
+
+  AWAIT_READY(runningStatus1);
+  EXPECT_EQ(TASK_RUNNING, runningStatus1->state());
+
+  driver.acknowledgeStatusUpdate(runningStatus1.get());
+
+  driver.killTask(task1.task_id());
+
+  AWAIT_READY(killedStatus1);
+  EXPECT_EQ(TASK_KILLED, killedStatus1->state());
+
+  Future<mesos::scheduler::Call> acknowledgement1 = FUTURE_CALL(
+      mesos::scheduler::Call(),
+      mesos::scheduler::Call::ACKNOWLEDGE,
+      _,
+      master.get()->pid);
+
+  driver.acknowledgeStatusUpdate(killedStatus1.get());
+
+  AWAIT_READY(acknowledgement1);
+
+  Try<JSON::Object> changes = state("since=" + cursor->value);
+  ASSERT_SOME(changes);
+
+  EXPECT_SOME_EQ(
+      JSON::Array(),
+      changes->find<JSON::Array>("frameworks[0].tasks"));
+
+  Result<JSON::Array> completedTasks =
+    changes->find<JSON::Array>("frameworks[0].completed_tasks");
+  ASSERT_SOME(completedTasks);
+  ASSERT_EQ(1u, completedTasks->values.size());
+
+  EXPECT_SOME_EQ(
+      JSON::String(task1.task_id().value()),
+      changes->find<JSON::String>("frameworks[0].completed_tasks[0].id"));
+
+  EXPECT_SOME_EQ(
+      JSON::String("TASK_KILLED"),
+      changes->find<JSON::String>("frameworks[0].completed_tasks[0].state"));
+
+  EXPECT_SOME_EQ(
+      JSON::Array(),
+      changes->find<JSON::Array>("frameworks[0].evicted_completed_tasks"));
+
+  cursor = changes->find<JSON::String>("cursor");
+  ASSERT_SOME(cursor);
+
+  // The second task starts running.
+  AWAIT_READY(offers2);
+  ASSERT_FALSE(offers2->empty());
+
+  TaskInfo task2 = createTask(offers2.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  driver.launchTasks(offers2.get()[0].id(), {task2});
+
+  AWAIT_READY(runningStatus2);
+  EXPECT_EQ(TASK_RUNNING, runningStatus2->state());
+
+  changes = state("since=" + cursor->value);
+  ASSERT_SOME(changes);
+
+  Result<JSON::Array> tasks =
+    changes->find<JSON::Array>("frameworks[0].tasks");
+  ASSERT_SOME(tasks);
+  ASSERT_EQ(1u, tasks->values.size());
+
+  EXPECT_SOME_EQ(
+      JSON::String(task2.task_id().value()),
+      changes->find<JSON::String>("frameworks[0].tasks[0].id"));
+
+  EXPECT_SOME_EQ(
+      JSON::String("TASK_RUNNING"),
+      changes->find<JSON::String>("frameworks[0].tasks[0].state"));
+
+  EXPECT_SOME_EQ(
+      JSON::Array(),
+      changes->find<JSON::Array>("frameworks[0].completed_tasks"));
+
+  // The second task completes, which evicts the first one from the
+  // completed tasks.
+  driver.acknowledgeStatusUpdate(runningStatus2.get());
+
+  driver.killTask(task2.task_id());
+
+  AWAIT_READY(killedStatus2);
+  EXPECT_EQ(TASK_KILLED, killedStatus2->state());
+
+  Future<mesos::scheduler::Call> acknowledgement2 = FUTURE_CALL(
+      mesos::scheduler::Call(),
+      mesos::scheduler::Call::ACKNOWLEDGE,
+      _,
+      master.get()->pid);
+
+  driver.acknowledgeStatusUpdate(killedStatus2.get());
+
+  AWAIT_READY(acknowledgement2);
+
+  changes = state("since=" + cursor->value);
+  ASSERT_SOME(changes);
+
+  EXPECT_SOME_EQ(
+      JSON::Array(),
+      changes->find<JSON::Array>("frameworks[0].tasks"));
+
+  completedTasks = changes->find<JSON::Array>("frameworks[0].completed_tasks");
+  ASSERT_SOME(completedTasks);
+  ASSERT_EQ(1u, completedTasks->values.size());
+
+  EXPECT_SOME_EQ(
+      JSON::String(task2.task_id().value()),
+      changes->find<JSON::String>("frameworks[0].completed_tasks[0].id"));
+
+  JSON::Array evictedTasks;
+  evictedTasks.values.push_back(task1.task_id().value());
+
+  EXPECT_SOME_EQ(
+      evictedTasks,
+      changes->find<JSON::Array>("frameworks[0].evicted_completed_tasks"));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This ensures that the /state endpoint includes the frameworks which
+// completed since the cursor passed as `since`, and lists the completed
+// frameworks which were evicted since then.
+TEST_F(MasterTest, StateEndpointSinceFrameworks)
+{
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.max_completed_frameworks = 1;
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  auto state = [&master](const Option<string>& query) {
+    Future<Response> response = process::http::get(
+        master.get()->pid,
+        "state",
+        query,
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    return JSON::parse<JSON::Object>(response->body);
+  };
+
+  vector<FrameworkID> frameworkIds;
+
+  for (size_t i = 0; i < 2; i++) {
+    MockScheduler sched;
+    MesosSchedulerDriver driver(
+        &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+    Future<FrameworkID> frameworkId;
+    EXPECT_CALL(sched, registered(&driver, _, _))
+      .WillOnce(FutureArg<1>(&frameworkId));
+
+    driver.start();
+
+    AWAIT_READY(frameworkId);
+    frameworkIds.push_back(frameworkId.get());
+
+    Try<JSON::Object> full = state(None());
+    ASSERT_SOME(full);
+
+    Result<JSON::String> cursor = full->find<JSON::String>("cursor");
+    ASSERT_SOME(cursor);
+
+    Future<mesos::scheduler::Call> teardown = FUTURE_CALL(
+        mesos::scheduler::Call(),
+        mesos::scheduler::Call::TEARDOWN,
+        _,
+        master.get()->pid);
+
+    driver.stop();
+    driver.join();
+
+    AWAIT_READY(teardown);
+
+    Try<JSON::Object> changes = state("since=" + cursor->value);
+    ASSERT_SOME(changes);
+
+    EXPECT_SOME_EQ(JSON::Array(), changes->find<JSON::Array>("frameworks"));
+
+    Result<JSON::Array> completedFrameworks =
+      changes->find<JSON::Array>("completed_frameworks");
+    ASSERT_SOME(completedFrameworks);
+    ASSERT_EQ(1u, completedFrameworks->values.size());
+
+    EXPECT_SOME_EQ(
+        JSON::String(frameworkId->value()),
+        changes->find<JSON::String>("completed_frameworks[0].id"));
+
+    // The second framework evicts the first one from the completed
+    // frameworks.
+    JSON::Array removedFrameworks;
+    if (i > 0) {
+      removedFrameworks.values.push_back(frameworkIds[0].value());
+    }
+
+    EXPECT_SOME_EQ(
+        removedFrameworks,
+        changes->find<JSON::Array>("removed_frameworks"));
+  }
+}
+
+
+// This ensures that agent capabilities are included in
+// the response of master's /state endpoint.
+TEST_F(MasterTest, StateEndpointAgentCapabilities)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get()->pid, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+
+  Future<Response> response = process::http::get(
+      master.get()->pid,
+      "state",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
+  ASSERT_SOME(parse);
+
+  Result<JSON::Array> slaveArray = parse->find<JSON::Array>("slaves");
+  ASSERT_SOME(slaveArray);
+  ASSERT_EQ(1u, slaveArray->values.size());
+
+  JSON::Object slaveInfo = slaveArray->values[0].as<JSON::Object>();
+
+  ASSERT_EQ(1u, slaveInfo.values.count("capabilities"));
+  JSON::Value slaveCapabilities = slaveInfo.values.at("capabilities");
+
+  // Agents should have the following capabilities in the current
+  // implementation.
+  Try<JSON::Value> expectedCapabilities = JSON::parse(
+    R"~(
+      [
+        "MULTI_ROLE",
+        "HIERARCHICAL_ROLE",
+        "RESERVATION_REFINEMENT",
+        "RESOURCE_PROVIDER",
+        "RESIZE_VOLUME"
+      ]
+    )~");
+
+  ASSERT_SOME(expectedCapabilities);
+  EXPECT_TRUE(slaveCapabilities.contains(expectedCapabilities.get()));
+}
+
+
+// This ensures allocation role of task and its executor is exposed
+// in master's /state endpoint.
+TEST_F(MasterTest, StateEndpointAllocationRole)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.set_roles(0, "foo");
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, frameworkInfo, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  Future<Nothing> registered;
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .WillOnce(FutureSatisfy(&registered));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(registered);
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  Resources executorResources = Resources::parse("cpus:0.1;mem:32").get();
+  executorResources.allocate("foo");
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  TaskInfo taskInfo;
+  taskInfo.set_name("");
+  taskInfo.mutable_task_id()->MergeFrom(taskId);
+  taskInfo.mutable_slave_id()->MergeFrom(offers.get()[0].slave_id());
+  taskInfo.mutable_resources()->MergeFrom(
+      Resources(offers.get()[0].resources()) - executorResources);
+
+  taskInfo.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+  taskInfo.mutable_executor()->mutable_resources()->CopyFrom(executorResources);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  driver.launchTasks(offers.get()[0].id(), {taskInfo});
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  Future<Response> response = process::http::get(
+      master.get()->pid,
+      "state",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response->body);
+  ASSERT_SOME(parse);
+
+  JSON::Value result = parse.get();
+
+  JSON::Object expected = {
     {
       "frameworks",
       JSON::Array {
@@ -6623,6 +7378,334 @@ TEST_F(MasterTest, MaxCompletedFrameworksFlag)
 }
 
 
+// Tests that a task can be materialized from its compact form, and
+// that the compact forms of similar tasks share the interned fields.
+TEST_F(MasterTest, CompactTask)
+{
+  master::CompactTask::Interners interners;
+
+  Task task;
+  task.set_name("task");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_framework_id()->set_value("framework");
+  task.mutable_slave_id()->set_value("agent");
+  task.mutable_executor_id()->set_value("executor1");
+  task.set_state(TASK_FINISHED);
+  task.mutable_resources()->CopyFrom(
+      Resources::parse("cpus:1;mem:128").get());
+
+  Label* label = task.mutable_labels()->add_labels();
+  label->set_key("app");
+  label->set_value("web");
+
+  TaskStatus* status = task.add_statuses();
+  status->mutable_task_id()->CopyFrom(task.task_id());
+  status->set_state(TASK_RUNNING);
+  status->set_timestamp(1.0);
+
+  Option<master::CompactTask> compact =
+    master::CompactTask(task, &interners);
+
+  EXPECT_EQ(task.task_id(), compact->task_id());
+  EXPECT_EQ(TASK_FINISHED, compact->state());
+  EXPECT_EQ(task.framework_id(), compact->framework_id());
+  EXPECT_EQ(task.slave_id(), compact->slave_id());
+  EXPECT_SOME_EQ(1.0, compact->timestamp());
+  EXPECT_EQ(task, compact->get());
+
+  Task task2 = task;
+  task2.mutable_task_id()->set_value("2");
+  task2.mutable_executor_id()->set_value("executor2");
+
+  Option<master::CompactTask> compact2 =
+    master::CompactTask(task2, &interners);
+
+  EXPECT_EQ(task2, compact2->get());
+
+  EXPECT_EQ(1u, interners.frameworkIds.size());
+  EXPECT_EQ(1u, interners.slaveIds.size());
+  EXPECT_EQ(1u, interners.resources.size());
+  EXPECT_EQ(1u, interners.labels.size());
+
+  // The interned labels are shared by both compact tasks, and by the
+  // reference we obtain here.
+  shared_ptr<const Labels> labels = interners.labels.intern(task.labels());
+  EXPECT_EQ(3, labels.use_count());
+
+  shared_ptr<const google::protobuf::RepeatedPtrField<Resource>>
+    resources = interners.resources.intern(task.resources());
+  EXPECT_EQ(3, resources.use_count());
+
+  // The interned fields are released along with the compact tasks.
+  compact = None();
+  EXPECT_EQ(2, labels.use_count());
+  EXPECT_EQ(2, resources.use_count());
+
+  compact2 = None();
+  EXPECT_EQ(1, labels.use_count());
+  EXPECT_EQ(1, resources.use_count());
+}
+
+
+// This test verifies that the master handles the status updates
+// forwarded by an agent in a batch, and ignores the updates in the
+// batch which are not for tasks on that agent.
+TEST_F(MasterTest, BatchedStatusUpdates)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  TaskInfo task = createTask(offers.get()[0], "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  // Intercept the update forwarded by the agent, so that it can be
+  // sent to the master in a batch instead.
+  Future<StatusUpdateMessage> statusUpdateMessage =
+    DROP_PROTOBUF(StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+
+  driver.launchTasks(offers.get()[0].id(), {task});
+
+  AWAIT_READY(statusUpdateMessage);
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  const StatusUpdate& update = statusUpdateMessage->update();
+
+  StatusUpdatesMessage message;
+  message.mutable_slave_id()->CopyFrom(update.slave_id());
+  message.set_pid(statusUpdateMessage->pid());
+  message.add_updates()->CopyFrom(update);
+
+  // This update is for a task on another agent.
+  StatusUpdate* other = message.add_updates();
+  other->CopyFrom(update);
+  other->mutable_slave_id()->set_value("other");
+
+  process::post(slave.get()->pid, master.get()->pid, message);
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+  EXPECT_EQ(task.task_id(), status->task_id());
+
+  JSON::Object metrics = Metrics();
+
+  EXPECT_EQ(2, metrics.values["master/messages_status_update"]);
+  EXPECT_EQ(1, metrics.values["master/valid_status_updates"]);
+  EXPECT_EQ(1, metrics.values["master/invalid_status_updates"]);
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This test verifies that when an agent forwards the terminal status
+// updates of several tasks in a batch, the master recovers their
+// resources with a single allocator call, and sends all the updates
+// to an HTTP framework in a single write on its event stream.
+TEST_F(MasterTest, BatchedTerminalStatusUpdates)
+{
+  Clock::pause();
+
+  TestAllocator<> allocator;
+
+  EXPECT_CALL(allocator, initialize(_, _, _));
+
+  master::Flags masterFlags = CreateMasterFlags();
+
+  Try<Owned<cluster::Master>> master = StartMaster(&allocator, masterFlags);
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  slave::Flags slaveFlags = CreateSlaveFlags();
+  slaveFlags.resources = "cpus:2;mem:1024;disk:1024";
+
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), slaveFlags);
+  ASSERT_SOME(slave);
+
+  Clock::advance(slaveFlags.registration_backoff_factor);
+  AWAIT_READY(slaveRegisteredMessage);
+
+  // We subscribe the framework on a raw stream rather than through
+  // the scheduler library, so that the test sees how the master
+  // writes the events to the stream.
+  const ContentType contentType = ContentType::PROTOBUF;
+
+  process::http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+  headers["Accept"] = stringify(contentType);
+
+  Future<Response> response = process::http::streaming::post(
+      master.get()->pid,
+      "api/v1/scheduler",
+      headers,
+      serialize(
+          contentType,
+          v1::createCallSubscribe(v1::DEFAULT_FRAMEWORK_INFO)),
+      stringify(contentType));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  ASSERT_EQ(Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+  ASSERT_TRUE(response->headers.contains("Mesos-Stream-Id"));
+
+  process::http::Pipe::Reader reader = response->reader.get();
+
+  ::recordio::Decoder<Event> decoder(
+      lambda::bind(deserialize<Event>, contentType, lambda::_1));
+
+  Clock::advance(masterFlags.allocation_interval);
+
+  Option<v1::FrameworkID> frameworkId;
+  Option<v1::Offer> offer;
+
+  while (offer.isNone()) {
+    Future<string> chunk = reader.read();
+    AWAIT_READY(chunk);
+
+    Try<std::deque<Try<Event>>> events = decoder.decode(chunk.get());
+    ASSERT_SOME(events);
+
+    foreach (const Try<Event>& event, events.get()) {
+      ASSERT_SOME(event);
+
+      if (event->type() == Event::SUBSCRIBED) {
+        frameworkId = event->subscribed().framework_id();
+      } else if (event->type() == Event::OFFERS) {
+        ASSERT_FALSE(event->offers().offers().empty());
+        offer = event->offers().offers(0);
+      }
+    }
+  }
+
+  ASSERT_SOME(frameworkId);
+
+  const v1::AgentID& agentId = offer->agent_id();
+
+  v1::Resources resources = v1::Resources::parse("cpus:1;mem:512").get();
+  resources.allocate(v1::DEFAULT_FRAMEWORK_INFO.roles(0));
+
+  v1::TaskInfo task1 = v1::createTask(agentId, resources, "sleep 1000");
+  v1::TaskInfo task2 = v1::createTask(agentId, resources, "sleep 1000");
+
+  // The agent does not need to run the tasks, since the test sends
+  // their status updates to the master on its behalf.
+  Future<RunTaskMessage> runTaskMessage1 =
+    DROP_PROTOBUF(RunTaskMessage(), _, _);
+  Future<RunTaskMessage> runTaskMessage2 =
+    DROP_PROTOBUF(RunTaskMessage(), _, _);
+
+  headers["Mesos-Stream-Id"] = response->headers.at("Mesos-Stream-Id");
+
+  Future<Response> accepted = process::http::post(
+      master.get()->pid,
+      "api/v1/scheduler",
+      headers,
+      serialize(
+          contentType,
+          v1::createCallAccept(
+              frameworkId.get(),
+              offer.get(),
+              {v1::LAUNCH({task1, task2})})),
+      stringify(contentType));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(Accepted().status, accepted);
+  AWAIT_READY(runTaskMessage1);
+  AWAIT_READY(runTaskMessage2);
+
+  // Make sure the unused resources of the offer are recovered
+  // before we expect the resources of the tasks.
+  Clock::settle();
+
+  Future<Resources> recovered;
+  EXPECT_CALL(
+      allocator,
+      recoverResources(devolve(frameworkId.get()), devolve(agentId), _, _))
+    .WillOnce(DoAll(InvokeRecoverResources(&allocator),
+                    FutureArg<2>(&recovered)));
+
+  StatusUpdatesMessage message;
+  message.mutable_slave_id()->CopyFrom(devolve(agentId));
+  message.set_pid(slave.get()->pid);
+
+  const vector<v1::TaskInfo> tasks = {task1, task2};
+
+  foreach (const v1::TaskInfo& task, tasks) {
+    message.add_updates()->CopyFrom(protobuf::createStatusUpdate(
+        devolve(frameworkId.get()),
+        devolve(agentId),
+        devolve(task.task_id()),
+        TASK_FINISHED,
+        TaskStatus::SOURCE_EXECUTOR,
+        id::UUID::random()));
+  }
+
+  process::post(slave.get()->pid, master.get()->pid, message);
+
+  // Both updates arrive in the next write on the stream.
+  Future<string> chunk = reader.read();
+  AWAIT_READY(chunk);
+
+  Try<std::deque<Try<Event>>> events = decoder.decode(chunk.get());
+  ASSERT_SOME(events);
+  ASSERT_EQ(2u, events->size());
+
+  foreach (const Try<Event>& event, events.get()) {
+    ASSERT_SOME(event);
+    ASSERT_EQ(Event::UPDATE, event->type());
+    EXPECT_EQ(v1::TASK_FINISHED, event->update().status().state());
+  }
+
+  AWAIT_READY(recovered);
+  EXPECT_EQ(
+      devolve(task1.resources()) + devolve(task2.resources()),
+      recovered.get());
+
+  // Ensure that no other resources of the tasks are recovered
+  // before the resources are recovered on teardown.
+  Clock::settle();
+
+  EXPECT_CALL(allocator, recoverResources(_, _, _, _))
+    .WillRepeatedly(DoDefault());
+}
+
+
 // Test the max_completed_tasks_per_framework flag for master.
 TEST_F(MasterTest, MaxCompletedTasksPerFrameworkFlag)
 {
@@ -19,6 +19,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <mesos/attributes.hpp>
@@ -73,6 +74,7 @@ using std::endl;
 using std::map;
 using std::set;
 using std::string;
+using std::tuple;
 using std::vector;
 
 using process::Clock;
@@ -262,6 +264,52 @@ TEST_F(RegistrarTest, Admit)
 }
 
 
+// Tests that the operations stored as a delta on top of a checkpoint
+// of the registry are replayed when recovering the registry, unless
+// the delta was superseded by a later checkpoint.
+TEST_F(RegistrarTest, RecoverDelta)
+{
+  flags.registry_max_delta_operations = 2;
+
+  SlaveInfo slave2 = slave;
+  slave2.mutable_id()->set_value("2");
+
+  SlaveInfo slave3 = slave;
+  slave3.mutable_id()->set_value("3");
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    // These are stored as a delta of two operations.
+    AWAIT_TRUE(registrar.apply(Owned<RegistryOperation>(
+        new AdmitSlave(slave))));
+    AWAIT_TRUE(registrar.apply(Owned<RegistryOperation>(
+        new MarkSlaveUnreachable(slave, protobuf::getCurrentTime()))));
+
+    // The delta is full, so this checkpoints the registry.
+    AWAIT_TRUE(registrar.apply(Owned<RegistryOperation>(
+        new AdmitSlave(slave2))));
+
+    // This is stored as a delta on top of the new checkpoint.
+    AWAIT_TRUE(registrar.apply(Owned<RegistryOperation>(
+        new AdmitSlave(slave3))));
+  }
+
+  Registrar registrar(flags, state);
+
+  Future<Registry> registry = registrar.recover(master);
+  AWAIT_READY(registry);
+
+  ASSERT_EQ(2, registry->slaves().slaves().size());
+  EXPECT_EQ(slave2.id(), registry->slaves().slaves(0).info().id());
+  EXPECT_EQ(slave3.id(), registry->slaves().slaves(1).info().id());
+
+  ASSERT_EQ(1, registry->unreachable().slaves().size());
+  EXPECT_EQ(slave.id(), registry->unreachable().slaves(0).id());
+}
+
+
 TEST_F(RegistrarTest, UpdateSlave)
 {
   // Add a new slave to the registry.
@@ -1261,7 +1309,8 @@ TEST_F(RegistrarTest, StoreTimeout)
   Registrar registrar(flags, &state);
 
   EXPECT_CALL(storage, get(_))
-    .WillOnce(Return(None()));
+    .Times(2)
+    .WillRepeatedly(Return(None()));
 
   Future<Nothing> set;
   EXPECT_CALL(storage, set(_, _))
@@ -1292,7 +1341,8 @@ TEST_F(RegistrarTest, Abort)
   Registrar registrar(flags, &state);
 
   EXPECT_CALL(storage, get(_))
-    .WillOnce(Return(None()));
+    .Times(2)
+    .WillRepeatedly(Return(None()));
 
   EXPECT_CALL(storage, set(_, _))
     .WillOnce(Return(Future<bool>(true)))              // Recovery.
@@ -1311,6 +1361,64 @@ TEST_F(RegistrarTest, Abort)
 }
 
 
+// Tests that the registrar prepares the next batches of operations
+// while a store is in flight, and bounds the size of the batches.
+TEST_F(RegistrarTest, PipelinedBatches)
+{
+  MockStorage storage;
+  State state(&storage);
+
+  flags.registry_max_batch_size = 2;
+
+  Registrar registrar(flags, &state);
+
+  EXPECT_CALL(storage, get(_))
+    .Times(2)
+    .WillRepeatedly(Return(None()));
+
+  Promise<bool> stored;
+  Future<Nothing> storing;
+
+  // The recovery, the first operation and two batches of two operations.
+  EXPECT_CALL(storage, set(_, _))
+    .WillOnce(Return(Future<bool>(true)))
+    .WillOnce(DoAll(FutureSatisfy(&storing),
+                    Return(stored.future())))
+    .WillOnce(Return(Future<bool>(true)))
+    .WillOnce(Return(Future<bool>(true)));
+
+  AWAIT_READY(registrar.recover(master));
+
+  vector<Future<bool>> applied;
+
+  for (int i = 0; i < 5; i++) {
+    SlaveInfo info = slave;
+    info.mutable_id()->set_value(stringify(i));
+
+    applied.push_back(
+        registrar.apply(Owned<RegistryOperation>(new AdmitSlave(info))));
+
+    if (i == 0) {
+      AWAIT_READY(storing);
+    }
+  }
+
+  // The remaining operations are held back by the store in flight.
+  EXPECT_TRUE(applied[1].isPending());
+
+  stored.set(true);
+
+  foreach (const Future<bool>& future, applied) {
+    AWAIT_TRUE(future);
+  }
+
+  JSON::Object metrics = Metrics();
+
+  EXPECT_EQ(2, metrics.values["registrar/batch_size"]);
+  EXPECT_EQ(1u, metrics.values.count("registrar/commit_latency_ms"));
+}
+
+
 // Tests that requests to the '/registry' endpoint are authenticated when HTTP
 // authentication is enabled.
 TEST_F(RegistrarTest, Authentication)
@@ -1586,6 +1694,109 @@ TEST_P(Registrar_BENCHMARK_Test, GcManyAgents)
        << watch.elapsed() << endl;
 }
 
+
+class RegistrarDelta_BENCHMARK_Test
+  : public RegistrarTestBase,
+    public WithParamInterface<tuple<size_t, bool>> {};
+
+
+// The delta benchmarks are parameterized by the number of agents, and
+// by whether operations are persisted as deltas of the registry.
+INSTANTIATE_TEST_CASE_P(
+    AgentCountAndDelta,
+    RegistrarDelta_BENCHMARK_Test,
+    ::testing::Combine(
+        ::testing::Values(50000U, 100000U),
+        ::testing::Bool()));
+
+
+// Measures the cost of single agent operations (e.g., agents
+// registering one by one) in a large registry, and of recovering
+// the registry afterwards.
+TEST_P(RegistrarDelta_BENCHMARK_Test, SingleOperations)
+{
+  size_t agentCount;
+  bool delta;
+
+  std::tie(agentCount, delta) = GetParam();
+
+  if (delta) {
+    flags.registry_max_delta_operations = 1000;
+  }
+
+  Registrar registrar(flags, state);
+  AWAIT_READY(registrar.recover(master));
+
+  Attributes attributes = Attributes::parse("foo:bar;baz:quux");
+  Resources resources =
+    Resources::parse("cpus(*):1.0;mem(*):512;disk(*):2048").get();
+
+  // Create agents.
+  vector<SlaveInfo> infos;
+  for (size_t i = 0; i < agentCount; ++i) {
+    // Simulate real agent information.
+    SlaveInfo info;
+    info.set_hostname("localhost");
+    info.mutable_id()->set_value(
+        string("201310101658-2280333834-5050-48574-") + stringify(i));
+    info.mutable_resources()->MergeFrom(resources);
+    info.mutable_attributes()->MergeFrom(attributes);
+    infos.push_back(info);
+  }
+
+  // Admit all but the last agents in a few large batches.
+  const size_t operationCount = 100;
+
+  Stopwatch watch;
+  watch.start();
+  Future<bool> result;
+  for (size_t i = 0; i < agentCount - operationCount; i++) {
+    result = registrar.apply(Owned<RegistryOperation>(
+        new AdmitSlave(infos[i])));
+  }
+  AWAIT_READY_FOR(result, Minutes(5));
+  LOG(INFO) << "Admitted " << agentCount - operationCount
+            << " agents in " << watch.elapsed();
+
+  // Admit the last agents one by one.
+  watch.start();
+  for (size_t i = agentCount - operationCount; i < agentCount; i++) {
+    AWAIT_TRUE_FOR(
+        registrar.apply(Owned<RegistryOperation>(new AdmitSlave(infos[i]))),
+        Minutes(5));
+  }
+  cout << "Admitted " << operationCount << " agents one by one in "
+       << watch.elapsed() << endl;
+
+  // Mark the same agents unreachable one by one.
+  TimeInfo unreachableTime = protobuf::getCurrentTime();
+
+  watch.start();
+  for (size_t i = agentCount - operationCount; i < agentCount; i++) {
+    AWAIT_TRUE_FOR(
+        registrar.apply(Owned<RegistryOperation>(
+            new MarkSlaveUnreachable(infos[i], unreachableTime))),
+        Minutes(5));
+  }
+  cout << "Marked " << operationCount << " agents unreachable one by one in "
+       << watch.elapsed() << endl;
+
+  // Recover the registry, which replays the delta if there is one.
+  Registrar registrar2(flags, state);
+  watch.start();
+  Future<Registry> registry = registrar2.recover(master);
+  AWAIT_READY_FOR(registry, Minutes(5));
+  cout << "Recovered " << agentCount << " agents ("
+       << Bytes(registry->ByteSize()) << ") in " << watch.elapsed() << endl;
+
+  EXPECT_EQ(
+      agentCount - operationCount,
+      static_cast<size_t>(registry->slaves().slaves().size()));
+  EXPECT_EQ(
+      operationCount,
+      static_cast<size_t>(registry->unreachable().slaves().size()));
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
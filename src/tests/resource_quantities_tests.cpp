@@ -0,0 +1,167 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <mesos/resources.hpp>
+
+#include <stout/gtest.hpp>
+#include <stout/stringify.hpp>
+
+#include "common/resource_quantities.hpp"
+
+#include "tests/mesos.hpp"
+#include "tests/resources_utils.hpp"
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace tests {
+
+
+static ResourceQuantities quantities(const string& text)
+{
+  return ResourceQuantities::fromScalarResources(
+      CHECK_NOTERROR(Resources::parse(text)));
+}
+
+
+TEST(ResourceQuantitiesTest, FromScalarResources)
+{
+  // Metadata is stripped and quantities are aggregated by name.
+  Resources resources = CHECK_NOTERROR(Resources::parse(
+      "cpus:1;cpus(role1):2;mem:512;disk(role1):1024;ports:[1-10]"));
+
+  resources += createDiskResource("100", "role1", "id1", "path1");
+
+  ResourceQuantities result =
+    ResourceQuantities::fromScalarResources(resources);
+
+  EXPECT_EQ(vector<string>({"cpus", "disk", "mem"}), result.names());
+  EXPECT_EQ(3u, result.size());
+
+  EXPECT_DOUBLE_EQ(3, result.get("cpus").value());
+  EXPECT_DOUBLE_EQ(1124, result.get("disk").value());
+  EXPECT_DOUBLE_EQ(512, result.get("mem").value());
+
+  // Absent resources have a zero quantity.
+  EXPECT_DOUBLE_EQ(0, result.get("ports").value());
+  EXPECT_DOUBLE_EQ(0, result.get("gpus").value());
+
+  // Quantities match the equivalent `Resources` arithmetic.
+  EXPECT_EQ(
+      resources.createStrippedScalarQuantity().get<Value::Scalar>("cpus"),
+      result.get("cpus"));
+
+  EXPECT_TRUE(ResourceQuantities::fromScalarResources(Resources()).empty());
+}
+
+
+TEST(ResourceQuantitiesTest, Addition)
+{
+  EXPECT_EQ(quantities("cpus:3;mem:10"),
+            quantities("cpus:1;mem:4") + quantities("cpus:2;mem:6"));
+
+  EXPECT_EQ(quantities("cpus:1;disk:5;mem:4"),
+            quantities("cpus:1;mem:4") + quantities("disk:5"));
+
+  EXPECT_EQ(quantities("cpus:1"), quantities("cpus:1") + quantities(""));
+  EXPECT_EQ(quantities("cpus:1"), quantities("") + quantities("cpus:1"));
+
+  // Fixed-point arithmetic does not accumulate rounding errors.
+  ResourceQuantities sum;
+  for (int i = 0; i < 10; ++i) {
+    sum += quantities("cpus:0.1");
+  }
+
+  EXPECT_EQ(quantities("cpus:1"), sum);
+}
+
+
+TEST(ResourceQuantitiesTest, Subtraction)
+{
+  EXPECT_EQ(quantities("cpus:1;mem:4"),
+            quantities("cpus:3;mem:10") - quantities("cpus:2;mem:6"));
+
+  // Exhausted quantities are removed.
+  EXPECT_EQ(quantities("mem:4"),
+            quantities("cpus:2;mem:10") - quantities("cpus:2;mem:6"));
+
+  // Subtraction saturates at zero.
+  EXPECT_EQ(quantities("mem:4"),
+            quantities("cpus:1;mem:4") - quantities("cpus:2;disk:5"));
+
+  EXPECT_TRUE((quantities("cpus:1") - quantities("cpus:1;mem:1")).empty());
+
+  EXPECT_EQ(quantities("cpus:0.7"),
+            quantities("cpus:1") - quantities("cpus:0.3"));
+}
+
+
+TEST(ResourceQuantitiesTest, Contains)
+{
+  EXPECT_TRUE(quantities("").contains(quantities("")));
+  EXPECT_TRUE(quantities("cpus:1").contains(quantities("")));
+  EXPECT_FALSE(quantities("").contains(quantities("cpus:1")));
+
+  EXPECT_TRUE(quantities("cpus:2;mem:4").contains(quantities("cpus:2;mem:4")));
+  EXPECT_TRUE(quantities("cpus:2;mem:4").contains(quantities("cpus:1;mem:4")));
+  EXPECT_FALSE(
+      quantities("cpus:2;mem:4").contains(quantities("cpus:3;mem:4")));
+
+  EXPECT_TRUE(quantities("cpus:2;disk:1;mem:4").contains(quantities("mem:4")));
+  EXPECT_FALSE(quantities("cpus:2;mem:4").contains(quantities("disk:1")));
+  EXPECT_FALSE(
+      quantities("cpus:2;mem:4").contains(quantities("cpus:1;disk:1")));
+}
+
+
+TEST(ResourceQuantitiesTest, DominantShare)
+{
+  const ResourceQuantities total = quantities("cpus:10;disk:100;mem:1000");
+
+  EXPECT_EQ(0.0, quantities("").dominantShare(total));
+  EXPECT_EQ(0.0, quantities("cpus:1").dominantShare(quantities("")));
+
+  EXPECT_DOUBLE_EQ(0.1, quantities("cpus:1").dominantShare(total));
+  EXPECT_DOUBLE_EQ(0.5, quantities("cpus:1;mem:500").dominantShare(total));
+
+  // Resources that are absent from the total are ignored.
+  EXPECT_DOUBLE_EQ(0.1, quantities("cpus:1;gpus:1").dominantShare(total));
+
+  // Excluded resources are ignored.
+  EXPECT_DOUBLE_EQ(
+      0.1,
+      quantities("cpus:1;mem:500").dominantShare(
+          total, std::set<string>({"mem"})));
+}
+
+
+TEST(ResourceQuantitiesTest, Printing)
+{
+  EXPECT_EQ("", stringify(quantities("")));
+  EXPECT_EQ("cpus:1.5; mem:512", stringify(quantities("mem:512;cpus:1.5")));
+}
+
+} // namespace tests {
+} // namespace internal {
+} // namespace mesos {
@@ -838,6 +838,102 @@ TEST(ResourcesTest, MoveConstruction)
 }
 
 
+// Copies of a `Resources` object share the underlying resource
+// objects; this verifies that mutating a copy does not affect the
+// original (i.e., copy-on-write semantics).
+TEST(ResourcesTest, CopyOnWrite)
+{
+  const Resources original = CHECK_NOTERROR(Resources::parse(
+      "cpus:4;mem:1024;ports:[10000-20000]"));
+
+  Resources copy = original;
+  copy += CHECK_NOTERROR(Resources::parse("cpus:1;ports:[30000-30001]"));
+  copy -= CHECK_NOTERROR(Resources::parse("mem:512"));
+
+  EXPECT_EQ(CHECK_NOTERROR(Resources::parse(
+      "cpus:4;mem:1024;ports:[10000-20000]")), original);
+
+  EXPECT_EQ(CHECK_NOTERROR(Resources::parse(
+      "cpus:5;mem:512;ports:[10000-20000,30000-30001]")), copy);
+
+  Resources allocated = original;
+  allocated.allocate("role");
+
+  foreach (const Resource& resource, original) {
+    EXPECT_FALSE(resource.has_allocation_info());
+  }
+
+  foreach (const Resource& resource, allocated) {
+    EXPECT_EQ("role", resource.allocation_info().role());
+  }
+
+  Resources unallocated = allocated;
+  unallocated.unallocate();
+
+  EXPECT_EQ(original, unallocated);
+  EXPECT_NE(original, allocated);
+}
+
+
+// Tests the arithmetic on `Resources` large enough to be indexed.
+TEST(ResourcesTest, IndexedArithmetic)
+{
+  Resources volumes;
+  Resources reservations;
+  for (size_t i = 0; i < 20; i++) {
+    volumes += createPersistentVolume(
+        Megabytes(64),
+        "role1",
+        "id" + stringify(i),
+        "path" + stringify(i),
+        "principal");
+
+    reservations += createReservedResource(
+        "cpus",
+        "1",
+        createDynamicReservationInfo("role1", "principal" + stringify(i)));
+  }
+
+  ASSERT_EQ(20u, volumes.size());
+  ASSERT_EQ(20u, reservations.size());
+
+  Resources unreserved = Resources::parse("cpus:4;mem:1024").get();
+
+  Resources total = volumes + reservations + unreserved;
+
+  const Resource& volume = *volumes.begin();
+  const Resource& reservation = *reservations.begin();
+
+  Resources subset = unreserved;
+  subset += volume;
+  subset += reservation;
+
+  EXPECT_TRUE(total.contains(subset));
+  EXPECT_TRUE(total.contains(total));
+  EXPECT_FALSE(subset.contains(total));
+
+  // A persistent volume is only contained once.
+  EXPECT_FALSE(total.contains(subset + volume));
+
+  // Scalars are combined with the indexed `Resource` objects.
+  EXPECT_TRUE(total.contains(unreserved + unreserved - unreserved));
+  EXPECT_FALSE(total.contains(unreserved + unreserved));
+
+  Resources remaining = total - subset;
+  EXPECT_EQ(total.size() - 4, remaining.size());
+  EXPECT_FALSE(remaining.contains(subset));
+  EXPECT_EQ(total, remaining + subset);
+
+  // Subtracting more than what is available removes the resource.
+  remaining = total - (unreserved + unreserved);
+  EXPECT_EQ(volumes + reservations, remaining);
+
+  remaining = total;
+  remaining -= remaining;
+  EXPECT_TRUE(remaining.empty());
+}
+
+
 TEST(ResourcesTest, Printing)
 {
   Resources r = Resources::parse(
@@ -4014,6 +4110,61 @@ public:
     mixed3.superset = mixed1.subset;
     mixed3.totalOperations = 1;
 
+    // Create an agent with many persistent volumes and reservations,
+    // each of which is kept as a separate `Resource` object.
+    Resources volumes;
+    Resources reservations;
+    for (size_t i = 0; i < 500; i++) {
+      const string role = "role" + stringify(i % 50);
+
+      volumes += createPersistentVolume(
+          Megabytes(64),
+          role,
+          "id" + stringify(i),
+          "path" + stringify(i),
+          "principal");
+
+      reservations += createReservedResource(
+          "cpus",
+          "1",
+          createDynamicReservationInfo(role, "principal" + stringify(i)));
+    }
+
+    Resources everyOtherVolume;
+    Resources everyOtherReservation;
+    foreach (const Resource& resource, volumes) {
+      if (everyOtherVolume.size() * 2 < volumes.size()) {
+        everyOtherVolume += resource;
+      }
+    }
+    foreach (const Resource& resource, reservations) {
+      if (everyOtherReservation.size() * 2 < reservations.size()) {
+        everyOtherReservation += resource;
+      }
+    }
+
+    // Test persistent volumes and reservations, the superset
+    // contains the subset for this case.
+    ContainsParameter volumes1;
+    volumes1.subset = everyOtherVolume + everyOtherReservation;
+    volumes1.superset =
+      scalars1.superset + range1.superset + volumes + reservations;
+    volumes1.totalOperations = 100;
+
+    // Test persistent volumes and reservations, the superset
+    // does not contain the subset for this case.
+    ContainsParameter volumes2;
+    volumes2.subset = volumes1.superset;
+    volumes2.superset = volumes1.subset;
+    volumes2.totalOperations = 100;
+
+    // Test persistent volumes and reservations, the superset
+    // is same as the subset for this case.
+    ContainsParameter volumes3;
+    volumes3.subset = volumes1.superset;
+    volumes3.superset = volumes1.superset;
+    volumes3.totalOperations = 100;
+
     parameters_.push_back(std::move(scalars1));
     parameters_.push_back(std::move(scalars2));
     parameters_.push_back(std::move(scalars3));
@@ -4023,6 +4174,9 @@ public:
     parameters_.push_back(std::move(mixed1));
     parameters_.push_back(std::move(mixed2));
     parameters_.push_back(std::move(mixed3));
+    parameters_.push_back(std::move(volumes1));
+    parameters_.push_back(std::move(volumes2));
+    parameters_.push_back(std::move(volumes3));
 
     return parameters_;
   }
@@ -4057,6 +4211,20 @@ TEST_P(Resources_Contains_BENCHMARK_Test, Contains)
        << abbreviate(stringify(superset), 50)
        << " contains subset resources " << abbreviate(stringify(subset), 50)
        << endl;
+
+  watch.start();
+  for (size_t i = 0; i < totalOperations; i++) {
+    Resources result = superset;
+    result -= subset;
+  }
+  watch.stop();
+
+  cout << "Took " << watch.elapsed()
+       << " to perform " << totalOperations
+       << " 'superset -= subset' operations on superset resources "
+       << abbreviate(stringify(superset), 50)
+       << " and subset resources " << abbreviate(stringify(subset), 50)
+       << endl;
 }
 
 
@@ -4188,6 +4356,71 @@ TEST_P(Resources_Ranges_BENCHMARK_Test, ArithmeticOverlapping)
   printResult("a - b", watch.elapsed());
 }
 
+
+// This test benchmarks allocating and recovering single ports on an
+// agent whose ports are fragmented, e.g. after many tasks that each
+// use a few ports have been launched on it.
+TEST_P(Resources_Ranges_BENCHMARK_Test, ArithmeticFragmented)
+{
+  const size_t totalOperations = 10000;
+
+  // ports = [1-1, 3-3, 5-5, ..., (2 * GetParam() - 1)-64000]
+  Value::Ranges ranges =
+    CHECK_NOTERROR(fragment(createRange(1, 64000), GetParam()));
+
+  Resources ports = createPorts(ranges);
+
+  vector<Resources> singlePorts;
+  singlePorts.reserve(ranges.range_size());
+
+  foreach (const Value::Range& range, ranges.range()) {
+    Value::Ranges single;
+    *single.add_range() = createRange(range.begin(), range.begin());
+
+    singlePorts.push_back(createPorts(single));
+  }
+
+  auto printResult = [&](const string& operation, const Duration& elapsed) {
+    cout << "Took " << elapsed << " to perform " << totalOperations << " '"
+         << operation << "' operations on ports with " << GetParam()
+         << " sub-ranges" << endl;
+  };
+
+  Stopwatch watch;
+
+  watch.start();
+  for (size_t i = 0; i < totalOperations; i++) {
+    ports.contains(singlePorts[i % singlePorts.size()]);
+  }
+  watch.stop();
+
+  printResult("a.contains(port)", watch.elapsed());
+
+  Duration allocated;
+  Duration recovered;
+
+  for (size_t i = 0; i < totalOperations; i++) {
+    const Resources& port = singlePorts[i % singlePorts.size()];
+
+    watch.start();
+    ports -= port;
+    watch.stop();
+
+    allocated += watch.elapsed();
+
+    watch.start();
+    ports += port;
+    watch.stop();
+
+    recovered += watch.elapsed();
+  }
+
+  printResult("a -= port", allocated);
+  printResult("a += port", recovered);
+
+  EXPECT_EQ(Resources(createPorts(ranges)), ports);
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
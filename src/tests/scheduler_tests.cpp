@@ -1415,6 +1415,90 @@ TEST_P(SchedulerTest, Decline)
 }
 
 
+// This test verifies that an HTTP scheduler receives the offers and
+// their rescinds when they time out, and that these events are
+// counted in the framework's metrics.
+TEST_P(SchedulerTest, OfferTimeout)
+{
+  master::Flags flags = CreateMasterFlags();
+  flags.offer_timeout = Seconds(30);
+
+  Try<Owned<cluster::Master>> master = StartMaster(flags);
+  ASSERT_SOME(master);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  auto scheduler = std::make_shared<v1::MockHTTPScheduler>();
+
+  Future<Nothing> connected;
+  EXPECT_CALL(*scheduler, connected(_))
+    .WillOnce(FutureSatisfy(&connected));
+
+  ContentType contentType = GetParam();
+
+  v1::scheduler::TestMesos mesos(
+      master.get()->pid,
+      contentType,
+      scheduler);
+
+  AWAIT_READY(connected);
+
+  Future<Event::Subscribed> subscribed;
+  EXPECT_CALL(*scheduler, subscribed(_, _))
+    .WillOnce(FutureArg<1>(&subscribed));
+
+  EXPECT_CALL(*scheduler, heartbeat(_))
+    .WillRepeatedly(Return()); // Ignore heartbeats.
+
+  Future<Event::Offers> offers;
+  EXPECT_CALL(*scheduler, offers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  v1::FrameworkInfo frameworkInfo = v1::DEFAULT_FRAMEWORK_INFO;
+
+  {
+    Call call;
+    call.set_type(Call::SUBSCRIBE);
+
+    Call::Subscribe* subscribe = call.mutable_subscribe();
+    subscribe->mutable_framework_info()->CopyFrom(frameworkInfo);
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(subscribed);
+
+  frameworkInfo.mutable_id()->CopyFrom(subscribed->framework_id());
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(1, offers->offers().size());
+
+  Future<Event::Rescind> rescind;
+  EXPECT_CALL(*scheduler, rescind(_, _))
+    .WillOnce(FutureArg<1>(&rescind));
+
+  Clock::pause();
+  Clock::advance(flags.offer_timeout.get());
+  Clock::settle();
+
+  AWAIT_READY(rescind);
+  EXPECT_EQ(offers->offers(0).id(), rescind->offer_id());
+
+  JSON::Object metrics = Metrics();
+
+  const string prefix =
+    master::getFrameworkMetricPrefix(devolve(frameworkInfo));
+
+  EXPECT_EQ(1, metrics.values[prefix + "events/subscribed"]);
+  EXPECT_EQ(1, metrics.values[prefix + "events/offers"]);
+  EXPECT_EQ(1, metrics.values[prefix + "events/rescind"]);
+  EXPECT_EQ(1, metrics.values[prefix + "offers/rescinded"]);
+}
+
+
 TEST_P(SchedulerTest, Revive)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
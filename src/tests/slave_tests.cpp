@@ -19,6 +19,7 @@
 #endif // __WINDOWS__
 
 #include <algorithm>
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -65,6 +66,7 @@
 #include "common/http.hpp"
 #include "common/protobuf_utils.hpp"
 
+#include "master/constants.hpp"
 #include "master/flags.hpp"
 #include "master/master.hpp"
 #include "master/registry_operations.hpp"
@@ -360,6 +362,268 @@ TEST_F(SlaveTest, DuplicateTerminalUpdateBeforeAck)
 }
 
 
+// This test verifies that the status updates which are forwarded to
+// the agent before it gets to send them to the master are sent in a
+// single `StatusUpdatesMessage`.
+TEST_F(SlaveTest, BatchedStatusUpdates)
+{
+  Clock::pause();
+
+  master::Flags masterFlags = CreateMasterFlags();
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  slave::Flags agentFlags = CreateSlaveFlags();
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(detector.get(), &containerizer, agentFlags);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(_, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  // Advance the clock to trigger both agent registration and a batch
+  // allocation.
+  Clock::advance(agentFlags.registration_backoff_factor);
+  Clock::advance(masterFlags.allocation_interval);
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  const Resources resources = Resources::parse("cpus:1;mem:128").get();
+
+  TaskInfo task1 = createTask(
+      offers.get()[0].slave_id(), resources, "", DEFAULT_EXECUTOR_ID);
+
+  TaskInfo task2 = createTask(
+      offers.get()[0].slave_id(), resources, "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  // Capture the updates sent by the executor, so that they can be
+  // forwarded again below.
+  Future<StatusUpdateMessage> update1 =
+    FUTURE_PROTOBUF(StatusUpdateMessage(), _, slave.get()->pid);
+  Future<StatusUpdateMessage> update2 =
+    FUTURE_PROTOBUF(StatusUpdateMessage(), _, slave.get()->pid);
+
+  // Drop the updates when they are first forwarded. Whether these are
+  // batched depends on the order in which the agent and the task
+  // status update manager process their events.
+  DROP_PROTOBUFS(StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+  DROP_PROTOBUFS(StatusUpdatesMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<Nothing> forward1 = FUTURE_DISPATCH(_, &Slave::forward);
+  Future<Nothing> forward2 = FUTURE_DISPATCH(_, &Slave::forward);
+
+  driver.launchTasks(offers.get()[0].id(), {task1, task2});
+
+  AWAIT_READY(update1);
+  AWAIT_READY(update2);
+
+  AWAIT_READY(forward1);
+  AWAIT_READY(forward2);
+
+  Clock::settle();
+
+  // Block the agent and forward both updates again, so that both are
+  // queued before the agent processes either of them. We do this
+  // directly rather than through a retry of the task status update
+  // manager, since the test cannot observe when a retry has been
+  // queued on a blocked agent.
+  std::promise<Nothing> unblock;
+  std::shared_future<Nothing> unblocked = unblock.get_future().share();
+
+  process::dispatch(slave.get()->pid, [unblocked]() { unblocked.wait(); });
+
+  process::dispatch(slave.get()->pid, &Slave::forward, update1->update());
+  process::dispatch(slave.get()->pid, &Slave::forward, update2->update());
+
+  EXPECT_NO_FUTURE_PROTOBUFS(
+      StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<StatusUpdatesMessage> statusUpdatesMessage = FUTURE_PROTOBUF(
+      StatusUpdatesMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<TaskStatus> status1;
+  Future<TaskStatus> status2;
+  EXPECT_CALL(sched, statusUpdate(_, _))
+    .WillOnce(FutureArg<1>(&status1))
+    .WillOnce(FutureArg<1>(&status2));
+
+  unblock.set_value(Nothing());
+
+  AWAIT_READY(statusUpdatesMessage);
+  EXPECT_EQ(2, statusUpdatesMessage->updates_size());
+  EXPECT_EQ(slave.get()->pid, statusUpdatesMessage->pid());
+
+  AWAIT_READY(status1);
+  EXPECT_EQ(TASK_RUNNING, status1->state());
+
+  AWAIT_READY(status2);
+  EXPECT_EQ(TASK_RUNNING, status2->state());
+
+  EXPECT_NE(status1->task_id().value(), status2->task_id().value());
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This test verifies that the agent sends the status updates in
+// separate `StatusUpdateMessage`s if the master does not have the
+// BATCHED_STATUS_UPDATES capability.
+TEST_F(SlaveTest, BatchedStatusUpdatesWithoutMasterCapability)
+{
+  Clock::pause();
+
+  master::Flags masterFlags = CreateMasterFlags();
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  // Make the agent detect a master without the capability, as if
+  // it was running an older version.
+  MasterInfo masterInfo = protobuf::createMasterInfo(master.get()->pid);
+  masterInfo.clear_capabilities();
+
+  foreach (const MasterInfo::Capability& capability,
+           master::MASTER_CAPABILITIES()) {
+    if (capability.type() !=
+          MasterInfo::Capability::BATCHED_STATUS_UPDATES) {
+      masterInfo.add_capabilities()->CopyFrom(capability);
+    }
+  }
+
+  StandaloneMasterDetector detector(masterInfo);
+
+  slave::Flags agentFlags = CreateSlaveFlags();
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(&detector, &containerizer, agentFlags);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(_, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  Clock::advance(agentFlags.registration_backoff_factor);
+  Clock::advance(masterFlags.allocation_interval);
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  const Resources resources = Resources::parse("cpus:1;mem:128").get();
+
+  TaskInfo task1 = createTask(
+      offers.get()[0].slave_id(), resources, "", DEFAULT_EXECUTOR_ID);
+
+  TaskInfo task2 = createTask(
+      offers.get()[0].slave_id(), resources, "", DEFAULT_EXECUTOR_ID);
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  // As above, drop the updates when they are first forwarded and
+  // forward them again while the agent is blocked.
+  Future<StatusUpdateMessage> update1 =
+    FUTURE_PROTOBUF(StatusUpdateMessage(), _, slave.get()->pid);
+  Future<StatusUpdateMessage> update2 =
+    FUTURE_PROTOBUF(StatusUpdateMessage(), _, slave.get()->pid);
+
+  DROP_PROTOBUFS(StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+  DROP_PROTOBUFS(StatusUpdatesMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<Nothing> forward1 = FUTURE_DISPATCH(_, &Slave::forward);
+  Future<Nothing> forward2 = FUTURE_DISPATCH(_, &Slave::forward);
+
+  driver.launchTasks(offers.get()[0].id(), {task1, task2});
+
+  AWAIT_READY(update1);
+  AWAIT_READY(update2);
+
+  AWAIT_READY(forward1);
+  AWAIT_READY(forward2);
+
+  Clock::settle();
+
+  std::promise<Nothing> unblock;
+  std::shared_future<Nothing> unblocked = unblock.get_future().share();
+
+  process::dispatch(slave.get()->pid, [unblocked]() { unblocked.wait(); });
+
+  process::dispatch(slave.get()->pid, &Slave::forward, update1->update());
+  process::dispatch(slave.get()->pid, &Slave::forward, update2->update());
+
+  EXPECT_NO_FUTURE_PROTOBUFS(
+      StatusUpdatesMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<StatusUpdateMessage> statusUpdateMessage1 = FUTURE_PROTOBUF(
+      StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<StatusUpdateMessage> statusUpdateMessage2 = FUTURE_PROTOBUF(
+      StatusUpdateMessage(), slave.get()->pid, master.get()->pid);
+
+  Future<TaskStatus> status1;
+  Future<TaskStatus> status2;
+  EXPECT_CALL(sched, statusUpdate(_, _))
+    .WillOnce(FutureArg<1>(&status1))
+    .WillOnce(FutureArg<1>(&status2));
+
+  unblock.set_value(Nothing());
+
+  AWAIT_READY(statusUpdateMessage1);
+  AWAIT_READY(statusUpdateMessage2);
+
+  EXPECT_NE(
+      statusUpdateMessage1->update().status().task_id().value(),
+      statusUpdateMessage2->update().status().task_id().value());
+
+  AWAIT_READY(status1);
+  EXPECT_EQ(TASK_RUNNING, status1->state());
+
+  AWAIT_READY(status2);
+  EXPECT_EQ(TASK_RUNNING, status2->state());
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 TEST_F(SlaveTest, ShutdownUnregisteredExecutor)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
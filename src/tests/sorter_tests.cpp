@@ -14,7 +14,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
 #include <iostream>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -24,6 +26,8 @@
 
 #include <stout/gtest.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/allocator/sorter/drf/sorter.hpp"
 
 #include "master/allocator/sorter/random/sorter.hpp"
@@ -934,6 +938,170 @@ TEST(DRFSorterTest, RemoveLeafCollapseParentInactive)
 }
 
 
+// This test checks that when a client is removed and its parent node
+// is collapsed into an inactive leaf, the leaf is moved behind the
+// active children of its parent. Otherwise, the active clients sorted
+// after the collapsed leaf are not returned by `sort()`.
+TEST(DRFSorterTest, RemoveLeafCollapseParentInactiveFirst)
+{
+  DRFSorter sorter;
+
+  SlaveID slaveId;
+  slaveId.set_value("agentId");
+
+  sorter.add(slaveId, Resources::parse("cpus:100;mem:100").get());
+
+  sorter.add("a");
+  sorter.activate("a");
+  sorter.allocated(
+      "a", slaveId, Resources::parse("cpus:1;mem:1").get());
+
+  sorter.add("b");
+  sorter.activate("b");
+  sorter.allocated(
+      "b", slaveId, Resources::parse("cpus:6;mem:6").get());
+
+  sorter.add("c");
+  sorter.activate("c");
+  sorter.allocated(
+      "c", slaveId, Resources::parse("cpus:8;mem:8").get());
+
+  sorter.add("a/d");
+  sorter.activate("a/d");
+  sorter.allocated(
+      "a/d", slaveId, Resources::parse("cpus:1;mem:1").get());
+
+  sorter.deactivate("a");
+
+  // The subtree of "a" has the lowest share, so it is sorted first.
+  EXPECT_EQ(vector<string>({"a/d", "b", "c"}), sorter.sort());
+
+  sorter.remove("a/d");
+
+  EXPECT_EQ(vector<string>({"b", "c"}), sorter.sort());
+
+  sorter.activate("a");
+
+  EXPECT_EQ(vector<string>({"a", "b", "c"}), sorter.sort());
+}
+
+
+// This test applies a random sequence of sorter operations and checks
+// that the clients sorted incrementally, i.e., by only repositioning
+// the changed nodes, are in the same order as when the whole tree is
+// sorted again.
+TEST(DRFSorterTest, IncrementalSortMatchesFullSort)
+{
+  std::mt19937 generator(0); // Pass a consistent seed.
+
+  SlaveID slaveId;
+  slaveId.set_value("agentId");
+
+  // Both sorters see the same operations. `sorter` is sorted
+  // incrementally, while `reference` has its total resources
+  // changed before each sort, which forces a full sort.
+  DRFSorter sorter;
+  DRFSorter reference;
+
+  auto apply = [&](const std::function<void(DRFSorter*)>& operation) {
+    operation(&sorter);
+    operation(&reference);
+  };
+
+  apply([&](DRFSorter* s) {
+    s->add(slaveId, Resources::parse("cpus:1000;mem:1000").get());
+  });
+
+  const vector<string> paths = {
+    "a", "b", "c", "d", "a/x", "a/y", "b/x", "a/x/1", "a/x/2", "c/z/1"};
+
+  const vector<string> weighted = {"a", "b", "c", "d", "a/x", "c/z"};
+
+  // The resources allocated to each client.
+  hashmap<string, vector<Resources>> allocations;
+
+  for (int i = 0; i < 5000; i++) {
+    const string& path = paths[generator() % paths.size()];
+
+    switch (generator() % 7) {
+      case 0: {
+        if (!allocations.contains(path)) {
+          apply([&](DRFSorter* s) { s->add(path); });
+          allocations[path] = {};
+        }
+        break;
+      }
+      case 1: {
+        if (allocations.contains(path)) {
+          apply([&](DRFSorter* s) { s->remove(path); });
+          allocations.erase(path);
+        }
+        break;
+      }
+      case 2: {
+        if (allocations.contains(path)) {
+          apply([&](DRFSorter* s) { s->activate(path); });
+        }
+        break;
+      }
+      case 3: {
+        if (allocations.contains(path)) {
+          apply([&](DRFSorter* s) { s->deactivate(path); });
+        }
+        break;
+      }
+      case 4: {
+        if (allocations.contains(path)) {
+          const Resources resources = Resources::parse(
+              "cpus:" + stringify(1 + generator() % 5) +
+              ";mem:" + stringify(1 + generator() % 5)).get();
+
+          apply([&](DRFSorter* s) {
+            s->allocated(path, slaveId, resources);
+          });
+
+          allocations[path].push_back(resources);
+        }
+        break;
+      }
+      case 5: {
+        if (allocations.contains(path) && !allocations[path].empty()) {
+          vector<Resources>& allocation = allocations[path];
+
+          const size_t index = generator() % allocation.size();
+          const Resources resources = allocation[index];
+
+          apply([&](DRFSorter* s) {
+            s->unallocated(path, slaveId, resources);
+          });
+
+          allocation.erase(allocation.begin() + index);
+        }
+        break;
+      }
+      case 6: {
+        const string& role = weighted[generator() % weighted.size()];
+        const double weight = 1 + generator() % 3;
+
+        apply([&](DRFSorter* s) { s->updateWeight(role, weight); });
+        break;
+      }
+    }
+
+    // Sort only after some of the operations, so that changes
+    // accumulate between the sorts.
+    if (generator() % 3 == 0) {
+      const Resources resources = Resources::parse("cpus:1").get();
+
+      reference.add(slaveId, resources);
+      reference.remove(slaveId, resources);
+
+      ASSERT_EQ(reference.sort(), sorter.sort()) << "After operation " << i;
+    }
+  }
+}
+
+
 // This test checks that setting a weight on an internal node works
 // correctly.
 TEST(DRFSorterTest, ChangeWeightOnSubtree)
@@ -1628,15 +1796,18 @@ TYPED_TEST(CommonSorterTest, RemoveSharedResources)
   sorter.add(
       slaveId, Resources::parse("cpus:100;mem:100;disk(role1):900").get());
 
-  Resources quantity1 = sorter.totalScalarQuantities();
+  ResourceQuantities quantity1 = sorter.totalScalarQuantities();
 
   sorter.add(slaveId, sharedDisk);
-  Resources quantity2 = sorter.totalScalarQuantities();
+  ResourceQuantities quantity2 = sorter.totalScalarQuantities();
 
-  EXPECT_EQ(Resources::parse("disk:100").get(), quantity2 - quantity1);
+  EXPECT_EQ(
+      ResourceQuantities::fromScalarResources(
+          Resources::parse("disk:100").get()),
+      quantity2 - quantity1);
 
   sorter.add(slaveId, sharedDisk);
-  Resources quantity3 = sorter.totalScalarQuantities();
+  ResourceQuantities quantity3 = sorter.totalScalarQuantities();
 
   EXPECT_NE(quantity1, quantity3);
   EXPECT_EQ(quantity2, quantity3);
@@ -1971,6 +2142,115 @@ TYPED_TEST(CommonSorterTest, BENCHMARK_HierarchyFullSort)
   }
 }
 
+
+// This benchmark simulates the allocation loop of the allocator on a
+// large number of active clients, e.g., 10k roles or 50k frameworks
+// (either flat, or as 10k roles with 5 frameworks each): each
+// iteration allocates to a single client and sorts the clients again.
+//
+// NOTE: There is not a way to write a test that is *both* type and
+// value parameterized, so the benchmark is typed and iterates over
+// the values specific to what it benchmarks.
+TYPED_TEST(CommonSorterTest, BENCHMARK_IncrementalSort)
+{
+  typedef std::pair<size_t, size_t> RolesAndFrameworksPerRole;
+
+  // A single framework per role means that the clients are flat.
+  const RolesAndFrameworksPerRole rolesAndFrameworksPerRoles[] = {
+      {1000U, 1U},  // 1000 clients.
+      {10000U, 1U}, // 10000 clients.
+      {50000U, 1U}, // 50000 clients.
+      {10000U, 5U}, // 50000 clients in 10000 subtrees.
+  };
+
+  const size_t agentCount = 1000U;
+  const size_t allocationCount = 1000U;
+
+  foreach (RolesAndFrameworksPerRole pair, rolesAndFrameworksPerRoles) {
+    const size_t roleCount = std::get<0>(pair);
+    const size_t frameworksPerRole = std::get<1>(pair);
+
+    vector<string> clients;
+    clients.reserve(roleCount * frameworksPerRole);
+
+    for (size_t i = 0; i < roleCount; i++) {
+      if (frameworksPerRole == 1) {
+        clients.push_back("role" + stringify(i));
+        continue;
+      }
+
+      for (size_t j = 0; j < frameworksPerRole; j++) {
+        clients.push_back(
+            "role" + stringify(i) + "/framework" + stringify(j));
+      }
+    }
+
+    cout << "Using " << agentCount << " agents and " << clients.size()
+         << " clients in " << roleCount << " roles" << endl;
+
+    TypeParam sorter;
+
+    foreach (const string& client, clients) {
+      sorter.add(client);
+      sorter.activate(client);
+    }
+
+    Resources agentResources = Resources::parse(
+        "cpus:24;mem:4096;disk:4096").get();
+
+    vector<SlaveID> agents;
+    agents.reserve(agentCount);
+
+    for (size_t i = 0; i < agentCount; i++) {
+      SlaveID slaveId;
+      slaveId.set_value("agent" + stringify(i));
+
+      agents.push_back(slaveId);
+
+      sorter.add(slaveId, agentResources);
+    }
+
+    Resources allocated = Resources::parse("cpus:0.01;mem:1").get();
+
+    // Give every client an initial allocation, so that the clients
+    // have different shares.
+    for (size_t i = 0; i < clients.size(); i++) {
+      const size_t count = i % 10 + 1;
+
+      for (size_t j = 0; j < count; j++) {
+        sorter.allocated(clients[i], agents[i % agents.size()], allocated);
+      }
+    }
+
+    Stopwatch watch;
+
+    watch.start();
+    {
+      sorter.sort();
+    }
+    watch.stop();
+
+    cout << "Full sort of " << clients.size() << " clients took "
+         << watch.elapsed() << endl;
+
+    watch.start();
+    {
+      for (size_t i = 0; i < allocationCount; i++) {
+        // Pick clients spread over the tree.
+        const string& client = clients[(i * 7919) % clients.size()];
+
+        sorter.allocated(client, agents[i % agents.size()], allocated);
+        sorter.sort();
+      }
+    }
+    watch.stop();
+
+    cout << "Sorting " << clients.size() << " clients after each of "
+         << allocationCount << " allocations took " << watch.elapsed()
+         << endl;
+  }
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 
+#include <limits>
 #include <sstream>
 
 #include <gtest/gtest.h>
@@ -24,6 +25,7 @@
 
 #include <stout/gtest.hpp>
 #include <stout/interval.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
 #include "common/values.hpp"
@@ -489,6 +491,53 @@ TEST(ValuesTest, RangesSubtraction)
   EXPECT_EQ(parse("[3-8]")->ranges(), ranges1 - ranges2);
 }
 
+
+// Test that adding and subtracting a few ranges to and from coalesced
+// ranges, which is done in place, keeps the ranges coalesced.
+TEST(ValuesTest, RangesInPlaceArithmetic)
+{
+  Value::Ranges ranges = parse("[1-4, 9-10, 20-22, 26-30]")->ranges();
+
+  // NOTE: We compare the printed ranges since `operator==` coalesces
+  // its operands.
+  ranges += parse("[5-8, 12-12]")->ranges();
+  EXPECT_EQ("[1-10, 12-12, 20-22, 26-30]", stringify(ranges));
+
+  ranges += parse("[11-25]")->ranges();
+  EXPECT_EQ("[1-30]", stringify(ranges));
+
+  ranges += parse("[0-0, 40-50]")->ranges();
+  EXPECT_EQ("[0-30, 40-50]", stringify(ranges));
+
+  ranges -= parse("[5-5, 20-29]")->ranges();
+  EXPECT_EQ("[0-4, 6-19, 30-30, 40-50]", stringify(ranges));
+
+  ranges -= parse("[3-45]")->ranges();
+  EXPECT_EQ("[0-2, 46-50]", stringify(ranges));
+
+  ranges -= parse("[0-0, 50-60]")->ranges();
+  EXPECT_EQ("[1-2, 46-49]", stringify(ranges));
+
+  // The bounds of the port range type do not overflow.
+  const uint64_t max = std::numeric_limits<uint64_t>::max();
+
+  Value::Ranges bounds;
+  Value::Range* range = bounds.add_range();
+  range->set_begin(max - 1);
+  range->set_end(max);
+
+  ranges += bounds;
+  EXPECT_EQ(
+      "[1-2, 46-49, " + stringify(max - 1) + "-" + stringify(max) + "]",
+      stringify(ranges));
+
+  EXPECT_TRUE(bounds <= ranges);
+  EXPECT_FALSE(parse("[1-3]")->ranges() <= ranges);
+
+  ranges -= bounds;
+  EXPECT_EQ("[1-2, 46-49]", stringify(ranges));
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {